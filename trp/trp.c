@@ -56,6 +56,7 @@ void trp_init( int argc, char *argv[] )
     trp_init_check();
     trp_arg_init( argc, argv );
     trp_char_init();
+    trp_sig64_init();
     trp_special_init();
     /*
      modifica il sistema di allocazione di gmp
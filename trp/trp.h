@@ -62,6 +62,13 @@
 
 #define TRP_FORCE_FREE
 
+/*
+ intervallo degli interi preallocati da trp_sig64()
+ (deve contenere almeno 0, 1 e 10)
+ */
+#define TRP_SIG64_CACHE_MIN (-1024)
+#define TRP_SIG64_CACHE_MAX 65535
+
 /*
  macro eventualmente da ridefinire -- fine
  */
@@ -139,6 +146,10 @@ enum {
     TRP_MHD,
     TRP_DBF,
     TRP_SDL,
+    TRP_CHAN,
+    TRP_CPAT,
+    TRP_MATRIX,
+    TRP_PCM,
     TRP_MAX_T /* lasciarlo sempre per ultimo */
 };
 
@@ -175,6 +186,10 @@ enum {
 #define TRP_ABS(a) (((a)>=0.0)?(a):-(a))
 #define TRP_ABSDIFF(a,b) (((a)>=(b))?((a)-(b)):((b)-(a)))
 
+#define TRP_CONST_LAZY  0
+#define TRP_CONST_EAGER 1
+#define TRP_CONST_DROP  2
+
 typedef struct {
     uns8b flags;
     FILE *fp;
@@ -233,6 +248,9 @@ typedef struct {
     FILE *fp;
     uns32b line;
     uns8b last;
+    uns8b *rbuf;
+    uns32b rpos;
+    uns32b rlen;
 } trp_file_t;
 
 typedef struct {
@@ -272,14 +290,17 @@ typedef struct {
 typedef struct {
     uns8b tipo;
     uns32b len;
-    void *first;
-    void *last;
+    uns32b size;
+    uns32b first;
+    void *data;
 } trp_queue_t;
 
 typedef struct {
     uns8b tipo;
     uns32b len;
+    uns32b top;
     void *data;
+    void *spare;
 } trp_stack_t;
 
 typedef struct {
@@ -307,7 +328,10 @@ typedef struct {
 typedef struct {
     uns8b tipo;
     uns32b len;
-    void *root;
+    uns32b size;
+    uns32b used;
+    void *table;
+    void *sorted;
 } trp_assoc_t;
 
 typedef struct {
@@ -335,6 +359,15 @@ typedef struct {
     regex_t *preg;
 } trp_regex_t;
 
+typedef struct {
+    uns8b tipo;
+    uns8b flags;
+    uns32b len;
+    uns8b *p;
+    trp_obj_t *src;
+    uns32b shift[ 256 ];
+} trp_cpat_t;
+
 typedef struct trp_fibo_node_t {
     uns8b tipo;
     uns8b sottotipo;
@@ -357,6 +390,39 @@ typedef struct {
     objfun_t cmp;
 } trp_fibo_t;
 
+/*
+ elemento (i,j) in data[ i * rs + j * cs ];
+ la trasposta condivide data scambiando righe/colonne e passi
+ */
+
+typedef struct {
+    uns8b tipo;
+    uns32b rows;
+    uns32b cols;
+    uns32b rs;
+    uns32b cs;
+    flt64b *data;
+} trp_matrix_t;
+
+/*
+ campioni interleaved: sig16b, sig32b o flt32b secondo fmt;
+ bps sono i bit per campione del sorgente
+ */
+
+#define TRP_PCM_S16 0
+#define TRP_PCM_S32 1
+#define TRP_PCM_F32 2
+
+typedef struct {
+    uns8b tipo;
+    uns8b fmt;
+    uns8b bps;
+    uns32b channels;
+    uns32b frequency;
+    uns32b len;
+    void *data;
+} trp_pcm_t;
+
 void trp_init( int argc, char *argv[] );
 void trp_exit( trp_obj_t *obj );
 trp_obj_t *trp_heap_size();
@@ -422,6 +488,7 @@ trp_obj_t *trp_height( trp_obj_t *obj );
 trp_obj_t *trp_nth( trp_obj_t *n, trp_obj_t *obj );
 trp_obj_t *trp_sub( trp_obj_t *start, trp_obj_t *len, trp_obj_t *obj );
 trp_obj_t *trp_cat( trp_obj_t *obj, ... );
+trp_obj_t *trp_cat2( trp_obj_t *o1, trp_obj_t *o2 );
 trp_obj_t *trp_in_func( trp_obj_t *obj, trp_obj_t *seq, trp_obj_t *interv );
 uns8b trp_in_test( trp_obj_t *obj, trp_obj_t *seq, trp_obj_t *interv, trp_obj_t **pos, trp_obj_t *nth );
 trp_obj_t *trp_reverse( trp_obj_t *obj );
@@ -444,6 +511,8 @@ trp_obj_t *trp_booleanp( trp_obj_t *obj );
 #define trp_treep(p) (((p)->tipo==TRP_TREE)?TRP_TRUE:TRP_FALSE)
 #define trp_dgraphp(p) (((p)->tipo==TRP_DGRAPH)?TRP_TRUE:TRP_FALSE)
 #define trp_fibop(p) (((p)->tipo==TRP_FIBO)?TRP_TRUE:TRP_FALSE)
+#define trp_matrixp(p) (((p)->tipo==TRP_MATRIX)?TRP_TRUE:TRP_FALSE)
+#define trp_pcmp(p) (((p)->tipo==TRP_PCM)?TRP_TRUE:TRP_FALSE)
 #define trp_pixp(p) (((p)->tipo==TRP_PIX)?TRP_TRUE:TRP_FALSE)
 #define trp_threadp(p) (((p)->tipo==TRP_THREAD)?TRP_TRUE:TRP_FALSE)
 #define trp_gtkp(p) (((p)->tipo==TRP_GTK)?TRP_TRUE:TRP_FALSE)
@@ -482,12 +551,18 @@ trp_obj_t *trp_and( trp_obj_t *obj, ... );
 trp_obj_t *trp_not( trp_obj_t *obj );
 
 void trp_const_init( uns32b n, trp_raw_t r[], uns8b *c[], uns64b cst_totsize );
+void trp_const_mode( uns8b mode );
+void trp_const_set_mode( uns8b mode );
+void trp_const_eager();
 void trp_glb_init( uns32b n, trp_obj_t *glb[] );
 void trp_gc();
 trp_obj_t *trp_const( uns32b i );
 void trp_push_env( trp_obj_t *obj, ... );
 void trp_pop_env( trp_obj_t **obj, ... );
 void trp_pop_env_void( uns32b n );
+void trp_push_env_glb( uns32b *glb, trp_obj_t *obj, ... );
+void trp_pop_env_glb( uns32b *glb, trp_obj_t **obj, ... );
+void trp_pop_env_void_glb( uns32b *glb, uns32b n );
 uns8b trp_for_init( trp_obj_t **fst, trp_obj_t **var, trp_obj_t *from, trp_obj_t *to, trp_obj_t *step, uns8b rev );
 uns8b trp_for_next( trp_obj_t **fst );
 void trp_for_break( trp_obj_t **fst );
@@ -551,6 +626,11 @@ trp_obj_t *trp_fork();
 trp_obj_t *trp_sysinfo();
 trp_obj_t *trp_ratio2uns64b( trp_obj_t *obj );
 void trp_print_rusage_diff( char *msg );
+uns8b trp_date_time_t( trp_obj_t *date, time_t *t );
+uns32b trp_ncpus();
+void trp_parallel_run( void *(*routine)( void * ), void *par, size_t size, uns32b parts );
+uns8b trp_file_copy( trp_obj_t *src, trp_obj_t *dst );
+uns8b trp_mirror( trp_obj_t *src, trp_obj_t *dst, trp_obj_t *date, trp_obj_t *cb );
 
 uns8b trp_special_print( trp_print_t *p, trp_special_t *obj );
 uns32b trp_special_size( trp_special_t *obj );
@@ -575,6 +655,7 @@ trp_obj_t *trp_raw_length( trp_raw_t *obj );
 trp_obj_t *trp_raw_nth( uns32b n, trp_raw_t *obj );
 trp_obj_t *trp_raw_cat( trp_raw_t *obj, va_list args );
 uns8b trp_raw_close( trp_raw_t *obj );
+trp_obj_t *trp_raw_internal( uns32b sz, uns8b use_malloc );
 trp_obj_t *trp_raw( trp_obj_t *n );
 uns8b trp_raw_realloc( trp_obj_t *obj, trp_obj_t *n );
 trp_obj_t *trp_raw_mode( trp_obj_t *obj );
@@ -658,9 +739,12 @@ trp_obj_t *trp_file_pos_line( trp_obj_t *obj );
 trp_obj_t *trp_file_md5sum( trp_obj_t *path );
 trp_obj_t *trp_file_sha1sum( trp_obj_t *path );
 uns32b trp_file_read_chars( FILE *fp, uns8b *buf, uns32b n );
+uns32b trp_file_read_chars_internal( trp_obj_t *stream, uns8b *buf, uns32b n );
+uns8b trp_file_readable_internal( trp_obj_t *stream );
 uns32b trp_file_write_chars( FILE *fp, uns8b *buf, uns32b n );
 trp_obj_t *trp_read_char( trp_obj_t *stream );
 trp_obj_t *trp_read_line( trp_obj_t *stream );
+trp_obj_t *trp_read_lines( trp_obj_t *stream, trp_obj_t *cnt );
 trp_obj_t *trp_read_str( trp_obj_t *stream, trp_obj_t *cnt );
 trp_obj_t *trp_read_uint_le( trp_obj_t *stream, trp_obj_t *cnt );
 trp_obj_t *trp_read_uint_be( trp_obj_t *stream, trp_obj_t *cnt );
@@ -703,6 +787,7 @@ trp_obj_t *trp_math_get_prec();
 uns8b trp_math_set_seed( trp_obj_t *obj );
 trp_obj_t *trp_math_get_seed();
 trp_obj_t *trp_math_gmp_version();
+void trp_sig64_init();
 trp_obj_t *trp_sig64( sig64b val );
 trp_obj_t *trp_uns64( uns64b val );
 trp_obj_t *trp_double( flt64b val );
@@ -739,6 +824,8 @@ trp_obj_t *trp_math_cat( trp_obj_t *obj, va_list args );
 trp_obj_t *trp_math_minus( trp_obj_t *obj, ... );
 trp_obj_t *trp_math_times( trp_obj_t *obj, ... );
 trp_obj_t *trp_math_ratio( trp_obj_t *obj, ... );
+trp_obj_t *trp_math_minus2( trp_obj_t *o1, trp_obj_t *o2 );
+trp_obj_t *trp_math_times2( trp_obj_t *o1, trp_obj_t *o2 );
 trp_obj_t *trp_math_div( trp_obj_t *o1, trp_obj_t *o2 );
 trp_obj_t *trp_math_mod( trp_obj_t *o1, trp_obj_t *o2 );
 trp_obj_t *trp_math_sqrt( trp_obj_t *obj );
@@ -849,6 +936,7 @@ trp_obj_t *trp_cord_windows12522utf8( trp_obj_t *obj );
 trp_obj_t *trp_cord_str2num( trp_obj_t *obj );
 trp_obj_t *trp_cord_search_func( uns8b flags, trp_obj_t *obj, trp_obj_t *s );
 uns8b trp_cord_search_test( uns8b flags, trp_obj_t *obj, trp_obj_t *s, trp_obj_t **pos, trp_obj_t *nth );
+trp_obj_t *trp_cord_search_compile( uns8b flags, trp_obj_t *obj );
 trp_obj_t *trp_cord_lmatch_func( uns8b ignore_case, trp_obj_t *o, ... );
 trp_obj_t *trp_cord_rmatch_func( uns8b ignore_case, trp_obj_t *o, ... );
 uns8b trp_cord_match_test( uns8b flags, trp_obj_t **which, trp_obj_t **which_idx, trp_obj_t **o, ... );
@@ -872,6 +960,7 @@ trp_obj_t *trp_cord_subsequencep( trp_obj_t *s1, trp_obj_t *s2 );
 trp_obj_t *trp_cord_circular_eq( trp_obj_t *s1, trp_obj_t *s2 );
 trp_obj_t *trp_cord_hamming_distance( trp_obj_t *s1, trp_obj_t *s2 );
 trp_obj_t *trp_cord_edit_distance( trp_obj_t *s1, trp_obj_t *s2 );
+trp_obj_t *trp_cord_edit_distance_bounded( trp_obj_t *s1, trp_obj_t *s2, trp_obj_t *k );
 trp_obj_t *trp_cord_protein_weight( trp_obj_t *s );
 trp_obj_t *trp_cord_weight2amino( trp_obj_t *weight );
 trp_obj_t *trp_cord_alignment_score( trp_obj_t *s1, trp_obj_t *s2, trp_obj_t *gap_penalty, trp_obj_t *scoring_matrix );
@@ -948,6 +1037,17 @@ trp_obj_t *trp_dgraph_queue_pred( trp_obj_t *n );
 trp_obj_t *trp_dgraph_connected_cnt( trp_obj_t *n );
 trp_obj_t *trp_dgraph_is_connected( trp_obj_t *g );
 trp_obj_t *trp_dgraph_is_acyclic( trp_obj_t *g );
+trp_obj_t *trp_dgraph_freeze( trp_obj_t *g );
+trp_obj_t *trp_dgraph_frozen_id( trp_obj_t *s, trp_obj_t *n );
+trp_obj_t *trp_dgraph_frozen_node( trp_obj_t *s, trp_obj_t *id );
+trp_obj_t *trp_dgraph_bfs( trp_obj_t *s, trp_obj_t *src );
+trp_obj_t *trp_dgraph_dijkstra( trp_obj_t *s, trp_obj_t *src );
+trp_obj_t *trp_dgraph_path( trp_obj_t *s, trp_obj_t *src, trp_obj_t *dst );
+trp_obj_t *trp_dgraph_topo( trp_obj_t *s );
+trp_obj_t *trp_dgraph_scc( trp_obj_t *s );
+trp_obj_t *trp_dgraph_scc_cnt( trp_obj_t *s );
+trp_obj_t *trp_dgraph_reach( trp_obj_t *s, trp_obj_t *n1, trp_obj_t *n2 );
+trp_obj_t *trp_dgraph_reach_cnt( trp_obj_t *s, trp_obj_t *n );
 
 uns8b trp_assoc_print( trp_print_t *p, trp_assoc_t *obj );
 uns32b trp_assoc_size( trp_assoc_t *obj );
@@ -1023,5 +1123,41 @@ uns8b trp_fibo_delete( trp_obj_t *x );
 uns8b trp_fibo_set_key( trp_obj_t *x, trp_obj_t *key );
 uns8b trp_fibo_set_obj( trp_obj_t *x, trp_obj_t *obj );
 uns8b trp_fibo_merge( trp_obj_t *h1, trp_obj_t *h2 );
+uns8b trp_matrix_print( trp_print_t *p, trp_matrix_t *obj );
+uns32b trp_matrix_size( trp_matrix_t *obj );
+void trp_matrix_encode( trp_matrix_t *obj, uns8b **buf );
+trp_obj_t *trp_matrix_decode( uns8b **buf );
+trp_obj_t *trp_matrix_equal( trp_matrix_t *o1, trp_matrix_t *o2 );
+trp_obj_t *trp_matrix_length( trp_matrix_t *obj );
+trp_obj_t *trp_matrix_width( trp_matrix_t *obj );
+trp_obj_t *trp_matrix_height( trp_matrix_t *obj );
+trp_obj_t *trp_matrix( trp_obj_t *rows, trp_obj_t *cols, trp_obj_t *val );
+trp_obj_t *trp_matrix_ident( trp_obj_t *n );
+trp_obj_t *trp_matrix_from_array( trp_obj_t *a );
+trp_obj_t *trp_matrix_to_array( trp_obj_t *mx );
+trp_obj_t *trp_matrix_get( trp_obj_t *mx, trp_obj_t *i, trp_obj_t *j );
+uns8b trp_matrix_set( trp_obj_t *mx, trp_obj_t *i, trp_obj_t *j, trp_obj_t *val );
+trp_obj_t *trp_matrix_transpose( trp_obj_t *mx );
+trp_obj_t *trp_matrix_clone( trp_obj_t *mx );
+trp_obj_t *trp_matrix_mult( trp_obj_t *mx1, trp_obj_t *mx2 );
+trp_obj_t *trp_matrix_det( trp_obj_t *mx );
+trp_obj_t *trp_matrix_inverse( trp_obj_t *mx );
+trp_obj_t *trp_matrix_solve( trp_obj_t *a, trp_obj_t *b );
+uns8b trp_pcm_print( trp_print_t *p, trp_pcm_t *obj );
+uns32b trp_pcm_size( trp_pcm_t *obj );
+void trp_pcm_encode( trp_pcm_t *obj, uns8b **buf );
+trp_obj_t *trp_pcm_decode( uns8b **buf );
+trp_obj_t *trp_pcm_equal( trp_pcm_t *o1, trp_pcm_t *o2 );
+trp_obj_t *trp_pcm_length( trp_pcm_t *obj );
+trp_obj_t *trp_pcm_width( trp_pcm_t *obj );
+trp_obj_t *trp_pcm_read( trp_obj_t *src, trp_obj_t *pos, trp_obj_t *frames, trp_obj_t *channels, trp_obj_t *bps, trp_obj_t *frequency, trp_obj_t *format );
+trp_obj_t *trp_pcm_frequency( trp_obj_t *pcm );
+trp_obj_t *trp_pcm_bps( trp_obj_t *pcm );
+trp_obj_t *trp_pcm_get( trp_obj_t *pcm, trp_obj_t *frame, trp_obj_t *ch );
+trp_obj_t *trp_pcm_rms( trp_obj_t *pcm, trp_obj_t *ch, trp_obj_t *beg, trp_obj_t *len );
+trp_obj_t *trp_pcm_peak( trp_obj_t *pcm, trp_obj_t *ch, trp_obj_t *beg, trp_obj_t *len );
+trp_obj_t *trp_pcm_silence( trp_obj_t *pcm, trp_obj_t *thr, trp_obj_t *minlen );
+trp_obj_t *trp_pcm_resample( trp_obj_t *pcm, trp_obj_t *frequency );
+trp_obj_t *trp_pcm2raw( trp_obj_t *pcm );
 
 #endif /* !__trp__h */
@@ -112,6 +112,10 @@ uns8b trp_cast_flt64b( trp_obj_t *obj, flt64b *val )
         *val = (flt64b)( ((trp_sig64_t *)obj)->val );
         res = 0;
         break;
+    case TRP_MPI:
+        *val = mpz_get_d( ((trp_mpi_t *)obj)->val );
+        res = 0;
+        break;
     case TRP_RATIO:
         *val = mpq_get_d( ((trp_ratio_t *)obj)->val );
         res = 0;
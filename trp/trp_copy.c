@@ -0,0 +1,699 @@
+/*
+    TreeP Run Time Support
+    Copyright (C) 2008-2026 Frank Sinapsi
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trp.h"
+#ifdef MINGW
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#endif
+#endif
+
+#ifndef MINGW
+
+/*
+ la copia avviene nel kernel quando possibile: reflink (FICLONE),
+ poi copy_file_range, sendfile e infine read/write;
+ mkmirror accoda i file a un gruppo di thread mentre il thread
+ chiamante visita l'albero e chiama la callback di avanzamento
+ */
+
+#define TRP_COPY_CHUNK 0x40000000
+#define TRP_COPY_BUF 0x100000
+#define TRP_COPY_DENTS 0x10000
+#define TRP_COPY_QUEUE 1024
+#define TRP_COPY_MAX_THREADS 16
+#define TRP_COPY_PROGRESS_MS 200
+
+typedef struct {
+    uns64b d_ino;
+    sig64b d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} trp_copy_dirent64_t;
+
+typedef struct {
+    void **v;
+    uns32b len;
+    uns32b alloc;
+} trp_copy_list_t;
+
+typedef struct {
+    char *path;
+    struct stat st;
+} trp_copy_dir_t;
+
+typedef struct {
+    int sroot;
+    int droot;
+    struct timespec *ts;
+    trp_obj_t *cb;
+    uns8b *dents;
+    trp_copy_list_t dirs;
+    pthread_mutex_t mutex;
+    pthread_cond_t cwork;
+    pthread_cond_t cmain;
+    char **queue;
+    uns32b qbeg;
+    uns32b qlen;
+    uns32b nth;
+    uns32b running;
+    uns64b files;
+    uns64b bytes;
+    uns64b cb_files;
+    uns64b cb_bytes;
+    struct timespec cb_time;
+    uns8b closed;
+    uns8b err;
+} trp_copy_par_t;
+
+static uns8b trp_copy_fallback( int err );
+static int trp_copy_fast( int fi, int fo, off_t len );
+static int trp_copy_fd( int fi, int fo, off_t len, uns8b reg );
+static int trp_copy_file_at( int sdir, const char *sname, int ddir, const char *dname, struct timespec *ts, uns64b *size );
+static uns8b trp_copy_list_add( trp_copy_list_t *l, void *p );
+static char *trp_mirror_path( char *rel, char *name );
+static void trp_mirror_progress( trp_copy_par_t *par, uns8b force );
+static void trp_mirror_wait( trp_copy_par_t *par );
+static void trp_mirror_copy( trp_copy_par_t *par, char *path );
+static void *trp_mirror_routine( void *arg );
+static uns8b trp_mirror_push( trp_copy_par_t *par, char *path );
+static uns8b trp_mirror_entry( trp_copy_par_t *par, int fd, char *rel, char *name, unsigned char type, trp_copy_list_t *sub );
+static uns8b trp_mirror_walk( trp_copy_par_t *par, char *rel );
+
+static uns8b trp_copy_fallback( int err )
+{
+    return ( ( err == ENOSYS ) || ( err == EXDEV ) || ( err == EINVAL ) ||
+             ( err == EOPNOTSUPP ) || ( err == ENOTSUP ) || ( err == EBADF ) ||
+             ( err == EPERM ) ) ? 1 : 0;
+}
+
+static int trp_copy_fast( int fi, int fo, off_t len )
+/*
+ rende 0 se la copia è fatta, -1 in caso di errore,
+ 1 se bisogna ripiegare su read/write
+ */
+{
+    ssize_t n;
+    uns8b copied;
+
+#ifdef FICLONE
+    if ( ioctl( fo, FICLONE, fi ) == 0 )
+        return 0;
+#endif
+#ifdef SYS_copy_file_range
+    /*
+     su procfs e simili copy_file_range rende 0 anche se
+     il file non è vuoto: in quel caso si passa oltre
+     */
+    for ( copied = 0 ; ; copied = 1 ) {
+        n = syscall( SYS_copy_file_range, fi, NULL, fo, NULL, (size_t)TRP_COPY_CHUNK, 0 );
+        if ( n == 0 ) {
+            if ( copied || ( len == 0 ) )
+                return 0;
+            break;
+        }
+        if ( n < 0 ) {
+            if ( errno == EINTR )
+                continue;
+            if ( copied || ( trp_copy_fallback( errno ) == 0 ) )
+                return -1;
+            break;
+        }
+    }
+#endif
+#ifdef __linux__
+    for ( copied = 0 ; ; copied = 1 ) {
+        n = sendfile( fo, fi, NULL, (size_t)TRP_COPY_CHUNK );
+        if ( n == 0 ) {
+            if ( copied || ( len == 0 ) )
+                return 0;
+            break;
+        }
+        if ( n < 0 ) {
+            if ( errno == EINTR )
+                continue;
+            if ( copied || ( trp_copy_fallback( errno ) == 0 ) )
+                return -1;
+            break;
+        }
+    }
+#endif
+    return 1;
+}
+
+static int trp_copy_fd( int fi, int fo, off_t len, uns8b reg )
+/*
+ per sorgenti non regolari (fifo, dispositivi) solo read/write
+ */
+{
+    ssize_t n, m;
+    uns8b *buf, *p;
+    int res;
+
+    if ( reg )
+        if ( ( res = trp_copy_fast( fi, fo, len ) ) <= 0 )
+            return res;
+    if ( ( buf = malloc( TRP_COPY_BUF ) ) == NULL )
+        return -1;
+    for ( ; ; ) {
+        n = read( fi, buf, TRP_COPY_BUF );
+        if ( n == 0 )
+            break;
+        if ( n < 0 ) {
+            if ( errno == EINTR )
+                continue;
+            free( buf );
+            return -1;
+        }
+        for ( p = buf ; n ; ) {
+            m = write( fo, p, n );
+            if ( m < 0 ) {
+                if ( errno == EINTR )
+                    continue;
+                free( buf );
+                return -1;
+            }
+            p += m;
+            n -= m;
+        }
+    }
+    free( buf );
+    return 0;
+}
+
+static int trp_copy_file_at( int sdir, const char *sname, int ddir, const char *dname, struct timespec *ts, uns64b *size )
+/*
+ non usa memoria GC: è chiamata anche dai thread di mkmirror;
+ ts == NULL conserva i tempi del sorgente;
+ permessi e tempi sono copiati solo tra file regolari e solo
+ se il file system lo consente (vfat, exFAT, SMB, file di un
+ altro utente); fifo e dispositivi si copiano con read/write
+ */
+{
+    struct stat st, dst;
+    struct timespec t[ 2 ];
+    int fi, fo, res;
+    uns8b created = 1, reg;
+
+    if ( ( fi = openat( sdir, sname, O_RDONLY | O_NOCTTY ) ) < 0 )
+        return -1;
+    if ( fstat( fi, &st ) || S_ISDIR( st.st_mode ) ) {
+        close( fi );
+        return -1;
+    }
+    /*
+     in caso di errore si cancella la destinazione
+     solo se è stata creata da questa chiamata
+     */
+    fo = openat( ddir, dname, O_WRONLY | O_CREAT | O_EXCL | O_NOCTTY, ( st.st_mode & 0777 ) | S_IWUSR );
+    if ( ( fo < 0 ) && ( errno == EEXIST ) ) {
+        created = 0;
+        fo = openat( ddir, dname, O_WRONLY | O_CREAT | O_NOCTTY, ( st.st_mode & 0777 ) | S_IWUSR );
+    }
+    if ( fo < 0 ) {
+        close( fi );
+        return -1;
+    }
+    /*
+     il troncamento avviene solo dopo aver escluso
+     che destinazione e sorgente siano lo stesso file
+     */
+    if ( fstat( fo, &dst ) ||
+         ( ( dst.st_dev == st.st_dev ) && ( dst.st_ino == st.st_ino ) ) ) {
+        close( fo );
+        close( fi );
+        return -1;
+    }
+    reg = ( S_ISREG( st.st_mode ) && S_ISREG( dst.st_mode ) ) ? 1 : 0;
+    res = ( created || ( S_ISREG( dst.st_mode ) == 0 ) ) ? 0 : ftruncate( fo, 0 );
+#ifdef POSIX_FADV_SEQUENTIAL
+    if ( res == 0 )
+        (void)posix_fadvise( fi, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+    if ( res == 0 )
+        res = trp_copy_fd( fi, fo, st.st_size, reg );
+    if ( ( res == 0 ) && reg ) {
+        (void)fchmod( fo, st.st_mode & 07777 );
+        if ( ts == NULL ) {
+            t[ 0 ] = st.st_atim;
+            t[ 1 ] = st.st_mtim;
+            ts = t;
+        }
+        (void)futimens( fo, ts );
+    }
+    if ( close( fo ) )
+        res = -1;
+    close( fi );
+    if ( res && created )
+        (void)unlinkat( ddir, dname, 0 );
+    else if ( ( res == 0 ) && size )
+        *size = st.st_size;
+    return res;
+}
+
+uns8b trp_file_copy( trp_obj_t *src, trp_obj_t *dst )
+{
+    uns8b *csrc = trp_csprint( src ), *cdst = trp_csprint( dst );
+    int res;
+
+    res = trp_copy_file_at( AT_FDCWD, (char *)csrc, AT_FDCWD, (char *)cdst, NULL, NULL );
+    trp_csprint_free( csrc );
+    trp_csprint_free( cdst );
+    return res ? 1 : 0;
+}
+
+static uns8b trp_copy_list_add( trp_copy_list_t *l, void *p )
+{
+    if ( l->len == l->alloc ) {
+        uns32b alloc = l->alloc ? l->alloc << 1 : 64;
+        void **v = realloc( l->v, alloc * sizeof( void * ) );
+
+        if ( v == NULL )
+            return 1;
+        l->v = v;
+        l->alloc = alloc;
+    }
+    l->v[ l->len++ ] = p;
+    return 0;
+}
+
+static char *trp_mirror_path( char *rel, char *name )
+{
+    size_t l = rel ? strlen( rel ) + 1 : 0, m = strlen( name ) + 1;
+    char *path = malloc( l + m );
+
+    if ( path ) {
+        if ( rel ) {
+            memcpy( path, rel, l - 1 );
+            path[ l - 1 ] = '/';
+        }
+        memcpy( path + l, name, m );
+    }
+    return path;
+}
+
+static void trp_mirror_progress( trp_copy_par_t *par, uns8b force )
+/*
+ chiamata solo dal thread chiamante, senza il mutex:
+ la callback è codice TreeP e può allocare
+ */
+{
+    struct timespec now;
+    uns64b files, bytes;
+
+    if ( par->cb == NULL )
+        return;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    if ( ( force == 0 ) &&
+         ( ( now.tv_sec - par->cb_time.tv_sec ) * 1000 +
+           ( now.tv_nsec - par->cb_time.tv_nsec ) / 1000000 < TRP_COPY_PROGRESS_MS ) )
+        return;
+    pthread_mutex_lock( &par->mutex );
+    files = par->files;
+    bytes = par->bytes;
+    pthread_mutex_unlock( &par->mutex );
+    if ( ( force == 0 ) && ( files == par->cb_files ) && ( bytes == par->cb_bytes ) )
+        return;
+    par->cb_files = files;
+    par->cb_bytes = bytes;
+    par->cb_time = now;
+    (void)( ((trp_funptr_t *)( par->cb ))->f )( trp_sig64( files ), trp_sig64( bytes ) );
+}
+
+static void trp_mirror_wait( trp_copy_par_t *par )
+/*
+ va chiamata col mutex acquisito
+ */
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_REALTIME, &t );
+    t.tv_nsec += TRP_COPY_PROGRESS_MS * 1000000;
+    if ( t.tv_nsec >= 1000000000 ) {
+        t.tv_sec++;
+        t.tv_nsec -= 1000000000;
+    }
+    (void)pthread_cond_timedwait( &par->cmain, &par->mutex, &t );
+    pthread_mutex_unlock( &par->mutex );
+    trp_mirror_progress( par, 0 );
+    pthread_mutex_lock( &par->mutex );
+}
+
+static void trp_mirror_copy( trp_copy_par_t *par, char *path )
+{
+    uns64b size;
+    int res;
+
+    res = trp_copy_file_at( par->sroot, path, par->droot, path, par->ts, &size );
+    free( path );
+    pthread_mutex_lock( &par->mutex );
+    if ( res )
+        par->err = 1;
+    else {
+        par->files++;
+        par->bytes += size;
+    }
+    pthread_cond_signal( &par->cmain );
+    pthread_mutex_unlock( &par->mutex );
+}
+
+static void *trp_mirror_routine( void *arg )
+{
+    trp_copy_par_t *par = (trp_copy_par_t *)arg;
+    char *path;
+    uns8b skip;
+
+    pthread_mutex_lock( &par->mutex );
+    for ( ; ; ) {
+        while ( ( par->qlen == 0 ) && ( par->closed == 0 ) )
+            pthread_cond_wait( &par->cwork, &par->mutex );
+        if ( par->qlen == 0 )
+            break;
+        path = par->queue[ par->qbeg ];
+        par->qbeg = ( par->qbeg + 1 ) % TRP_COPY_QUEUE;
+        par->qlen--;
+        skip = par->err;
+        pthread_cond_signal( &par->cmain );
+        pthread_mutex_unlock( &par->mutex );
+        if ( skip )
+            free( path );
+        else
+            trp_mirror_copy( par, path );
+        pthread_mutex_lock( &par->mutex );
+    }
+    par->running--;
+    pthread_cond_signal( &par->cmain );
+    pthread_mutex_unlock( &par->mutex );
+    return NULL;
+}
+
+static uns8b trp_mirror_push( trp_copy_par_t *par, char *path )
+{
+    if ( par->nth == 0 ) {
+        trp_mirror_copy( par, path );
+        trp_mirror_progress( par, 0 );
+        return par->err;
+    }
+    pthread_mutex_lock( &par->mutex );
+    while ( ( par->qlen == TRP_COPY_QUEUE ) && ( par->err == 0 ) )
+        trp_mirror_wait( par );
+    if ( par->err ) {
+        pthread_mutex_unlock( &par->mutex );
+        free( path );
+        return 1;
+    }
+    par->queue[ ( par->qbeg + par->qlen ) % TRP_COPY_QUEUE ] = path;
+    par->qlen++;
+    pthread_cond_signal( &par->cwork );
+    pthread_mutex_unlock( &par->mutex );
+    trp_mirror_progress( par, 0 );
+    return 0;
+}
+
+static uns8b trp_mirror_entry( trp_copy_par_t *par, int fd, char *rel, char *name, unsigned char type, trp_copy_list_t *sub )
+{
+    struct stat st;
+    char *path;
+
+    if ( ( name[ 0 ] == '.' ) &&
+         ( ( name[ 1 ] == 0 ) || ( ( name[ 1 ] == '.' ) && ( name[ 2 ] == 0 ) ) ) )
+        return 0;
+    if ( type == DT_UNKNOWN ) {
+        if ( fstatat( fd, name, &st, AT_SYMLINK_NOFOLLOW ) )
+            return 1;
+        if ( S_ISDIR( st.st_mode ) )
+            type = DT_DIR;
+        else if ( S_ISREG( st.st_mode ) )
+            type = DT_REG;
+    }
+    /*
+     come la versione in TreeP: solo file regolari e directory
+     */
+    if ( ( type != DT_DIR ) && ( type != DT_REG ) )
+        return 0;
+    if ( ( path = trp_mirror_path( rel, name ) ) == NULL )
+        return 1;
+    if ( type == DT_REG )
+        return trp_mirror_push( par, path );
+    if ( trp_copy_list_add( sub, path ) ) {
+        free( path );
+        return 1;
+    }
+    return 0;
+}
+
+static uns8b trp_mirror_walk( trp_copy_par_t *par, char *rel )
+/*
+ rel (già allocato con malloc) passa in carico a par->dirs;
+ le sottodirectory sono visitate dopo aver chiuso fd
+ */
+{
+    trp_copy_list_t sub;
+    trp_copy_dir_t *d;
+    int fd;
+    uns32b i;
+    uns8b res = 0;
+
+    if ( ( d = malloc( sizeof( trp_copy_dir_t ) ) ) == NULL ) {
+        free( rel );
+        return 1;
+    }
+    if ( ( d->path = rel ? rel : strdup( "." ) ) == NULL ) {
+        free( d );
+        return 1;
+    }
+    if ( trp_copy_list_add( &( par->dirs ), d ) ) {
+        free( d->path );
+        free( d );
+        return 1;
+    }
+    if ( ( fd = openat( par->sroot, d->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW ) ) < 0 )
+        return 1;
+    if ( fstat( fd, &( d->st ) ) ||
+         ( rel && mkdirat( par->droot, rel, 0700 ) ) ) {
+        close( fd );
+        return 1;
+    }
+    sub.v = NULL;
+    sub.len = sub.alloc = 0;
+#ifdef SYS_getdents64
+    for ( ; res == 0 ; ) {
+        long n = syscall( SYS_getdents64, fd, par->dents, TRP_COPY_DENTS ), off;
+        trp_copy_dirent64_t *e;
+
+        if ( n == 0 )
+            break;
+        if ( n < 0 ) {
+            res = 1;
+            break;
+        }
+        for ( off = 0 ; ( off < n ) && ( res == 0 ) ; off += e->d_reclen ) {
+            e = (trp_copy_dirent64_t *)( par->dents + off );
+            res = trp_mirror_entry( par, fd, rel, e->d_name, e->d_type, &sub );
+        }
+    }
+    close( fd );
+#else
+    {
+        DIR *dir;
+        struct dirent *e;
+
+        if ( ( dir = fdopendir( fd ) ) == NULL ) {
+            close( fd );
+            res = 1;
+        } else {
+            while ( ( res == 0 ) && ( ( e = readdir( dir ) ) ) )
+                res = trp_mirror_entry( par, dirfd( dir ), rel, e->d_name, e->d_type, &sub );
+            closedir( dir );
+        }
+    }
+#endif
+    for ( i = 0 ; i < sub.len ; i++ )
+        if ( res )
+            free( sub.v[ i ] );
+        else
+            res = trp_mirror_walk( par, (char *)( sub.v[ i ] ) );
+    free( sub.v );
+    return res;
+}
+
+uns8b trp_mirror( trp_obj_t *src, trp_obj_t *dst, trp_obj_t *date, trp_obj_t *cb )
+{
+    trp_copy_par_t par;
+    struct timespec ts[ 2 ];
+    pthread_t th[ TRP_COPY_MAX_THREADS ];
+    uns8b *cpath, res;
+    uns32b nth, i;
+
+    if ( date == UNDEF )
+        date = NULL;
+    if ( cb == UNDEF )
+        cb = NULL;
+    if ( date ) {
+        if ( trp_date_time_t( date, &( ts[ 0 ].tv_sec ) ) )
+            return 1;
+        ts[ 0 ].tv_nsec = 0;
+        ts[ 1 ] = ts[ 0 ];
+        par.ts = ts;
+    } else
+        par.ts = NULL;
+    if ( cb ) {
+        if ( cb->tipo != TRP_FUNPTR )
+            return 1;
+        if ( ((trp_funptr_t *)cb)->nargs != 2 )
+            return 1;
+    }
+    cpath = trp_csprint( src );
+    par.sroot = open( (char *)cpath, O_RDONLY | O_DIRECTORY );
+    trp_csprint_free( cpath );
+    if ( par.sroot < 0 )
+        return 1;
+    cpath = trp_csprint( dst );
+    if ( mkdir( (char *)cpath, 0700 ) ) {
+        trp_csprint_free( cpath );
+        close( par.sroot );
+        return 1;
+    }
+    par.droot = open( (char *)cpath, O_RDONLY | O_DIRECTORY );
+    trp_csprint_free( cpath );
+    par.dents = malloc( TRP_COPY_DENTS );
+    par.queue = malloc( TRP_COPY_QUEUE * sizeof( char * ) );
+    if ( ( par.droot < 0 ) || ( par.dents == NULL ) || ( par.queue == NULL ) ) {
+        if ( par.droot >= 0 )
+            close( par.droot );
+        close( par.sroot );
+        free( par.dents );
+        free( par.queue );
+        return 1;
+    }
+    par.cb = cb;
+    par.dirs.v = NULL;
+    par.dirs.len = par.dirs.alloc = 0;
+    par.qbeg = par.qlen = 0;
+    par.files = par.bytes = 0;
+    par.cb_files = par.cb_bytes = 0;
+    clock_gettime( CLOCK_MONOTONIC, &( par.cb_time ) );
+    par.closed = par.err = 0;
+    pthread_mutex_init( &( par.mutex ), NULL );
+    pthread_cond_init( &( par.cwork ), NULL );
+    pthread_cond_init( &( par.cmain ), NULL );
+    /*
+     la copia è limitata dall'I/O: più thread che cpu
+     */
+    nth = trp_ncpus() << 1;
+    if ( nth > TRP_COPY_MAX_THREADS )
+        nth = TRP_COPY_MAX_THREADS;
+    for ( par.nth = 0 ; par.nth < nth ; par.nth++ )
+        if ( pthread_create( th + par.nth, NULL, trp_mirror_routine, (void *)( &par ) ) )
+            break;
+    par.running = par.nth;
+    res = trp_mirror_walk( &par, NULL );
+    pthread_mutex_lock( &( par.mutex ) );
+    if ( res )
+        par.err = 1;
+    par.closed = 1;
+    pthread_cond_broadcast( &( par.cwork ) );
+    while ( par.running )
+        trp_mirror_wait( &par );
+    pthread_mutex_unlock( &( par.mutex ) );
+    for ( i = 0 ; i < par.nth ; i++ )
+        (void)pthread_join( th[ i ], NULL );
+    if ( par.err )
+        res = 1;
+    /*
+     permessi e tempi delle directory alla fine,
+     dalle più profonde alla radice
+     */
+    for ( i = par.dirs.len ; i ; ) {
+        trp_copy_dir_t *d = (trp_copy_dir_t *)( par.dirs.v[ --i ] );
+
+        if ( res == 0 ) {
+            struct timespec t[ 2 ];
+
+            /*
+             come per i file, permessi e tempi sono best effort
+             */
+            (void)fchmodat( par.droot, d->path, d->st.st_mode & 07777, 0 );
+            if ( par.ts == NULL ) {
+                t[ 0 ] = d->st.st_atim;
+                t[ 1 ] = d->st.st_mtim;
+            }
+            (void)utimensat( par.droot, d->path, par.ts ? par.ts : t, 0 );
+        }
+        free( d->path );
+        free( d );
+    }
+    if ( res == 0 )
+        trp_mirror_progress( &par, 1 );
+    pthread_cond_destroy( &( par.cmain ) );
+    pthread_cond_destroy( &( par.cwork ) );
+    pthread_mutex_destroy( &( par.mutex ) );
+    free( par.dirs.v );
+    free( par.queue );
+    free( par.dents );
+    close( par.droot );
+    close( par.sroot );
+    return res;
+}
+
+#else
+
+uns8b trp_file_copy( trp_obj_t *src, trp_obj_t *dst )
+{
+    uns8b *cpath;
+    wchar_t *wsrc, *wdst;
+    uns8b res;
+
+    cpath = trp_csprint( src );
+    wsrc = trp_utf8_to_wc_path( cpath );
+    trp_csprint_free( cpath );
+    if ( wsrc == NULL )
+        return 1;
+    cpath = trp_csprint( dst );
+    wdst = trp_utf8_to_wc_path( cpath );
+    trp_csprint_free( cpath );
+    if ( wdst == NULL ) {
+        trp_gc_free( wsrc );
+        return 1;
+    }
+    res = CopyFileW( wsrc, wdst, FALSE ) ? 0 : 1;
+    trp_gc_free( wdst );
+    trp_gc_free( wsrc );
+    return res;
+}
+
+uns8b trp_mirror( trp_obj_t *src, trp_obj_t *dst, trp_obj_t *date, trp_obj_t *cb )
+/*
+ non disponibile: mkmirror ripiega sulla versione in TreeP
+ */
+{
+    return 1;
+}
+
+#endif
@@ -23,6 +23,7 @@ static uns8b trp_default_print( trp_print_t *p, trp_obj_t *obj );
 static uns8b trp_default_close( trp_obj_t *obj );
 static trp_obj_t *trp_default_nth( uns32b n, trp_obj_t *obj );
 static trp_obj_t *trp_default_sub( uns32b start, uns32b len, trp_obj_t *obj );
+trp_obj_t *trp_cat2( trp_obj_t *o1, trp_obj_t *o2 );
 static trp_obj_t *trp_default_cat( trp_obj_t *obj, va_list args );
 static uns8b trp_in_interv( trp_obj_t *obj, trp_obj_t *from, trp_obj_t *to );
 static uns8b trp_default_in( trp_obj_t *obj, trp_obj_t *seq, uns32b *pos, uns32b nth );
@@ -70,7 +71,11 @@ uns8b *_trp_tipo_descr[ TRP_MAX_T ] = {
     "TRP_CAIRO",
     "TRP_MHD",
     "TRP_DBF",
-    "TRP_SDL"
+    "TRP_SDL",
+    "TRP_CHAN",
+    "TRP_CPAT",
+    "TRP_MATRIX",
+    "TRP_PCM"
 };
 
 uns8bfun_t _trp_print_fun[ TRP_MAX_T ] = {
@@ -114,7 +119,11 @@ uns8bfun_t _trp_print_fun[ TRP_MAX_T ] = {
     trp_default_print, /* cairo */
     trp_default_print, /* mhd */
     trp_default_print, /* dbf */
-    trp_default_print  /* sdl */
+    trp_default_print, /* sdl */
+    trp_default_print, /* chan */
+    trp_default_print, /* cpat */
+    trp_matrix_print,
+    trp_pcm_print
 };
 
 uns32bfun_t _trp_size_fun[ TRP_MAX_T ] = {
@@ -158,7 +167,11 @@ uns32bfun_t _trp_size_fun[ TRP_MAX_T ] = {
     trp_special_size, /* cairo */
     trp_special_size, /* mhd */
     trp_special_size, /* dbf */
-    trp_special_size  /* sdl */
+    trp_special_size, /* sdl */
+    trp_special_size, /* chan */
+    trp_special_size, /* cpat */
+    trp_matrix_size,
+    trp_pcm_size
 };
 
 voidfun_t _trp_encode_fun[ TRP_MAX_T ] = {
@@ -202,7 +215,11 @@ voidfun_t _trp_encode_fun[ TRP_MAX_T ] = {
     trp_default_encode, /* cairo */
     trp_default_encode, /* mhd */
     trp_default_encode, /* dbf */
-    trp_default_encode  /* sdl */
+    trp_default_encode, /* sdl */
+    trp_default_encode, /* chan */
+    trp_default_encode, /* cpat */
+    trp_matrix_encode,
+    trp_pcm_encode
 };
 
 objfun_t _trp_decode_fun[ TRP_MAX_T ] = {
@@ -246,7 +263,11 @@ objfun_t _trp_decode_fun[ TRP_MAX_T ] = {
     trp_special_decode, /* cairo */
     trp_special_decode, /* mhd */
     trp_special_decode, /* dbf */
-    trp_special_decode  /* sdl */
+    trp_special_decode, /* sdl */
+    trp_special_decode, /* chan */
+    trp_special_decode, /* cpat */
+    trp_matrix_decode,
+    trp_pcm_decode
 };
 
 objfun_t _trp_equal_fun[ TRP_MAX_T ] = {
@@ -290,7 +311,11 @@ objfun_t _trp_equal_fun[ TRP_MAX_T ] = {
     trp_default_relation, /* cairo */
     trp_default_relation, /* mhd */
     trp_default_relation, /* dbf */
-    trp_default_relation  /* sdl */
+    trp_default_relation, /* sdl */
+    trp_default_relation, /* chan */
+    trp_default_relation, /* cpat */
+    trp_matrix_equal,
+    trp_pcm_equal
 };
 
 objfun_t _trp_less_fun[ TRP_MAX_T ] = {
@@ -334,7 +359,11 @@ objfun_t _trp_less_fun[ TRP_MAX_T ] = {
     trp_default_relation, /* cairo */
     trp_default_relation, /* mhd */
     trp_default_relation, /* dbf */
-    trp_default_relation  /* sdl */
+    trp_default_relation, /* sdl */
+    trp_default_relation, /* chan */
+    trp_default_relation, /* cpat */
+    trp_default_relation, /* matrix */
+    trp_default_relation  /* pcm */
 };
 
 uns8bfun_t _trp_close_fun[ TRP_MAX_T ] = {
@@ -378,7 +407,11 @@ uns8bfun_t _trp_close_fun[ TRP_MAX_T ] = {
     trp_default_close, /* cairo */
     trp_default_close, /* mhd */
     trp_default_close, /* dbf */
-    trp_default_close  /* sdl */
+    trp_default_close, /* sdl */
+    trp_default_close, /* chan */
+    trp_default_close, /* cpat */
+    trp_default_close, /* matrix */
+    trp_default_close  /* pcm */
 };
 
 objfun_t _trp_length_fun[ TRP_MAX_T ] = {
@@ -422,7 +455,11 @@ objfun_t _trp_length_fun[ TRP_MAX_T ] = {
     trp_default_obj, /* cairo */
     trp_default_obj, /* mhd */
     trp_default_obj, /* dbf */
-    trp_default_obj  /* sdl */
+    trp_default_obj, /* sdl */
+    trp_default_obj, /* chan */
+    trp_default_obj, /* cpat */
+    trp_matrix_length,
+    trp_pcm_length
 };
 
 objfun_t _trp_width_fun[ TRP_MAX_T ] = {
@@ -466,7 +503,11 @@ objfun_t _trp_width_fun[ TRP_MAX_T ] = {
     trp_default_obj, /* cairo */
     trp_default_obj, /* mhd */
     trp_default_obj, /* dbf */
-    trp_default_obj  /* sdl */
+    trp_default_obj, /* sdl */
+    trp_default_obj, /* chan */
+    trp_default_obj, /* cpat */
+    trp_matrix_width,
+    trp_pcm_width
 };
 
 objfun_t _trp_height_fun[ TRP_MAX_T ] = {
@@ -510,7 +551,11 @@ objfun_t _trp_height_fun[ TRP_MAX_T ] = {
     trp_default_obj, /* cairo */
     trp_default_obj, /* mhd */
     trp_default_obj, /* dbf */
-    trp_default_obj  /* sdl */
+    trp_default_obj, /* sdl */
+    trp_default_obj, /* chan */
+    trp_default_obj, /* cpat */
+    trp_matrix_height,
+    trp_default_obj  /* pcm */
 };
 
 objfun_t _trp_nth_fun[ TRP_MAX_T ] = {
@@ -554,7 +599,11 @@ objfun_t _trp_nth_fun[ TRP_MAX_T ] = {
     trp_default_nth, /* cairo */
     trp_default_nth, /* mhd */
     trp_default_nth, /* dbf */
-    trp_default_nth  /* sdl */
+    trp_default_nth, /* sdl */
+    trp_default_nth, /* chan */
+    trp_default_nth, /* cpat */
+    trp_default_nth, /* matrix */
+    trp_default_nth  /* pcm */
 };
 
 objfun_t _trp_sub_fun[ TRP_MAX_T ] = {
@@ -598,7 +647,11 @@ objfun_t _trp_sub_fun[ TRP_MAX_T ] = {
     trp_default_sub, /* cairo */
     trp_default_sub, /* mhd */
     trp_default_sub, /* dbf */
-    trp_default_sub  /* sdl */
+    trp_default_sub, /* sdl */
+    trp_default_sub, /* chan */
+    trp_default_sub, /* cpat */
+    trp_default_sub, /* matrix */
+    trp_default_sub  /* pcm */
 };
 
 objfun_t _trp_cat_fun[ TRP_MAX_T ] = {
@@ -642,7 +695,11 @@ objfun_t _trp_cat_fun[ TRP_MAX_T ] = {
     trp_default_cat, /* cairo */
     trp_default_cat, /* mhd */
     trp_default_cat, /* dbf */
-    trp_default_cat  /* sdl */
+    trp_default_cat, /* sdl */
+    trp_default_cat, /* chan */
+    trp_default_cat, /* cpat */
+    trp_default_cat, /* matrix */
+    trp_default_cat  /* pcm */
 };
 
 uns8bfun_t _trp_in_fun[ TRP_MAX_T ] = {
@@ -686,7 +743,11 @@ uns8bfun_t _trp_in_fun[ TRP_MAX_T ] = {
     trp_default_in, /* cairo */
     trp_default_in, /* mhd */
     trp_default_in, /* dbf */
-    trp_default_in  /* sdl */
+    trp_default_in, /* sdl */
+    trp_default_in, /* chan */
+    trp_default_in, /* cpat */
+    trp_default_in, /* matrix */
+    trp_default_in  /* pcm */
 };
 
 static trp_obj_t *trp_default_obj( trp_obj_t *obj )
@@ -787,6 +848,18 @@ static trp_obj_t *trp_default_sub( uns32b start, uns32b len, trp_obj_t *obj )
     return UNDEF;
 }
 
+trp_obj_t *trp_cat2( trp_obj_t *o1, trp_obj_t *o2 )
+{
+    sig64b res;
+
+    if ( ( o1->tipo == TRP_SIG64 ) && ( o2->tipo == TRP_SIG64 ) )
+        if ( !__builtin_add_overflow( ((trp_sig64_t *)o1)->val,
+                                      ((trp_sig64_t *)o2)->val,
+                                      &res ) )
+            return trp_sig64( res );
+    return trp_cat( o1, o2, NULL );
+}
+
 trp_obj_t *trp_cat( trp_obj_t *obj, ... )
 {
     trp_obj_t *res;
@@ -577,10 +577,35 @@ trp_obj_t *trp_fsize( trp_obj_t *path )
 
 #endif
 
+uns8b trp_date_time_t( trp_obj_t *date, time_t *t )
+/*
+ converte una data in time_t (ora locale)
+ */
+{
+    struct tm lt;
+
+    if ( date->tipo != TRP_DATE )
+        return 1;
+    if ( ((trp_date_t *)date)->anno < 1900 )
+        return 1;
+    lt.tm_sec = ( ((trp_date_t *)date)->secondi < 60 ) ? ((trp_date_t *)date)->secondi : 0;
+    lt.tm_min = ( ((trp_date_t *)date)->minuti < 60 ) ? ((trp_date_t *)date)->minuti : 0;
+    lt.tm_hour = ( ((trp_date_t *)date)->ore < 24 ) ? ((trp_date_t *)date)->ore : 0;
+    lt.tm_mday = ((trp_date_t *)date)->giorno ? ((trp_date_t *)date)->giorno : 1;
+    lt.tm_mon = ((trp_date_t *)date)->mese ? ((trp_date_t *)date)->mese - 1 : 0;
+    lt.tm_year = ((trp_date_t *)date)->anno - 1900;
+    lt.tm_wday = 0;
+    lt.tm_yday = 0;
+    lt.tm_isdst = -1;
+    if ( ( *t = mktime( &lt ) ) == (time_t)(-1) )
+        return 1;
+    return 0;
+}
+
 uns8b trp_utime( trp_obj_t *path, trp_obj_t *actime, trp_obj_t *modtime )
 {
     uns8b *cpath;
-    struct tm lt;
+    time_t t;
 #ifndef MINGW
     struct utimbuf timebuf;
 #else
@@ -590,34 +615,12 @@ uns8b trp_utime( trp_obj_t *path, trp_obj_t *actime, trp_obj_t *modtime )
 
     if ( modtime == NULL )
         modtime = actime;
-    if ( ( actime->tipo != TRP_DATE ) ||
-         ( modtime->tipo != TRP_DATE ) )
-        return 1;
-    if ( ( ((trp_date_t *)actime)->anno < 1900 ) ||
-         ( ((trp_date_t *)modtime)->anno < 1900 ) )
+    if ( trp_date_time_t( actime, &t ) )
         return 1;
-    lt.tm_sec = ( ((trp_date_t *)actime)->secondi < 60 ) ? ((trp_date_t *)actime)->secondi : 0;
-    lt.tm_min = ( ((trp_date_t *)actime)->minuti < 60 ) ? ((trp_date_t *)actime)->minuti : 0;
-    lt.tm_hour = ( ((trp_date_t *)actime)->ore < 24 ) ? ((trp_date_t *)actime)->ore : 0;
-    lt.tm_mday = ((trp_date_t *)actime)->giorno ? ((trp_date_t *)actime)->giorno : 1;
-    lt.tm_mon = ((trp_date_t *)actime)->mese ? ((trp_date_t *)actime)->mese - 1 : 0;
-    lt.tm_year = ((trp_date_t *)actime)->anno - 1900;
-    lt.tm_wday = 0;
-    lt.tm_yday = 0;
-    lt.tm_isdst = -1;
-    if ( ( timebuf.actime = mktime( &lt ) ) == (time_t)(-1) )
-        return 1;
-    lt.tm_sec = ( ((trp_date_t *)modtime)->secondi < 60 ) ? ((trp_date_t *)modtime)->secondi : 0;
-    lt.tm_min = ( ((trp_date_t *)modtime)->minuti < 60 ) ? ((trp_date_t *)modtime)->minuti : 0;
-    lt.tm_hour = ( ((trp_date_t *)modtime)->ore < 24 ) ? ((trp_date_t *)modtime)->ore : 0;
-    lt.tm_mday = ((trp_date_t *)modtime)->giorno ? ((trp_date_t *)modtime)->giorno : 1;
-    lt.tm_mon = ((trp_date_t *)modtime)->mese ? ((trp_date_t *)modtime)->mese - 1 : 0;
-    lt.tm_year = ((trp_date_t *)modtime)->anno - 1900;
-    lt.tm_wday = 0;
-    lt.tm_yday = 0;
-    lt.tm_isdst = -1;
-    if ( ( timebuf.modtime = mktime( &lt ) ) == (time_t)(-1) )
+    timebuf.actime = t;
+    if ( trp_date_time_t( modtime, &t ) )
         return 1;
+    timebuf.modtime = t;
     cpath = trp_csprint( path );
 #ifndef MINGW
     res =  utime( cpath, &timebuf ) ? 1 : 0;
@@ -1197,3 +1200,48 @@ void trp_print_rusage_diff( char *msg )
     }
 }
 
+
+uns32b trp_ncpus()
+{
+#ifdef MINGW
+    return 1;
+#else
+    static uns32b n = 0;
+
+    if ( n == 0 ) {
+        long l = sysconf( _SC_NPROCESSORS_ONLN );
+
+        n = ( l > 1 ) ? (uns32b)l : 1;
+    }
+    return n;
+#endif
+}
+
+/*
+ esegue routine su ciascuno dei parts elementi di par (di size byte;
+ con size 0 tutti ricevono lo stesso par): il primo lo esegue il
+ thread chiamante, così come quelli per cui pthread_create fallisce
+ */
+
+void trp_parallel_run( void *(*routine)( void * ), void *par, size_t size, uns32b parts )
+{
+    pthread_t *th;
+    uns8b *started;
+    uns32b i;
+
+    if ( ( parts <= 1 ) || ( ( th = malloc( ( sizeof( pthread_t ) + 1 ) * parts ) ) == NULL ) ) {
+        for ( i = 0 ; i < parts ; i++ )
+            (void)routine( (void *)( (uns8b *)par + i * size ) );
+        return;
+    }
+    started = (uns8b *)( th + parts );
+    for ( i = 1 ; i < parts ; i++ )
+        started[ i ] = ( pthread_create( th + i, NULL, routine, (void *)( (uns8b *)par + i * size ) ) == 0 ) ? 1 : 0;
+    (void)routine( par );
+    for ( i = 1 ; i < parts ; i++ )
+        if ( started[ i ] )
+            (void)pthread_join( th[ i ], NULL );
+        else
+            (void)routine( (void *)( (uns8b *)par + i * size ) );
+    free( th );
+}
@@ -30,13 +30,9 @@
 static uns8b trp_print_flush( trp_print_t *p );
 
 typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
-typedef struct {
-    struct avl_tree_node node;
     uns8b *key;
+    uns32b klen;
+    uns32b hash;
     trp_obj_t *val;
 } trp_assoc_item_t;
 
@@ -117,9 +113,7 @@ trp_obj_t *trp_sprint( trp_obj_t *obj, ... )
 trp_obj_t *trp_sprint_list( trp_obj_t *l, trp_obj_t *divider )
 {
     uns32b i;
-    trp_queue_elem *elem;
     trp_print_t p;
-    uns8b div = 0;
 
     if ( divider == NULL )
         divider = EMPTYCORD;
@@ -143,13 +137,10 @@ trp_obj_t *trp_sprint_list( trp_obj_t *l, trp_obj_t *divider )
         }
         break;
     case TRP_QUEUE:
-        for ( elem = (trp_queue_elem *)( ((trp_queue_t *)l)->first ) ;
-              elem ;
-              elem = (trp_queue_elem *)( elem->next ) ) {
-            if ( div )
+        for ( i = 0 ; i < ((trp_queue_t *)l)->len ; i++ ) {
+            if ( i )
                 trp_print_obj( &p, divider );
-            trp_print_obj( &p, elem->val );
-            div = 1;
+            trp_print_obj( &p, trp_queue_nth( i, (trp_queue_t *)l ) );
         }
         break;
     case TRP_ARRAY:
@@ -161,19 +152,17 @@ trp_obj_t *trp_sprint_list( trp_obj_t *l, trp_obj_t *divider )
         break;
     case TRP_ASSOC:
         {
-            struct avl_tree_node *node;
+            extern trp_assoc_item_t **trp_assoc_sorted( trp_assoc_t *obj );
+            trp_assoc_item_t **item = trp_assoc_sorted( (trp_assoc_t *)l );
 
-            node = avl_tree_first_in_order( (struct avl_tree_node *)(((trp_assoc_t *)l)->root) );
             for ( i = 0 ; i < ((trp_assoc_t *)l)->len ; i++ ) {
                 if ( i )
                     trp_print_obj( &p, divider );
                 trp_print_chars( &p, "[", 1 );
-                trp_print_chars( &p, ((trp_assoc_item_t *)(node->dummy))->key,
-                                     strlen( ((trp_assoc_item_t *)(node->dummy))->key ) );
+                trp_print_chars( &p, item[ i ]->key, item[ i ]->klen );
                 trp_print_chars( &p, " . ", 3 );
-                trp_print_obj( &p, ((trp_assoc_item_t *)(node->dummy))->val );
+                trp_print_obj( &p, item[ i ]->val );
                 trp_print_chars( &p, "]", 1 );
-                node = avl_tree_next_in_order( node );
             }
         }
         break;
@@ -26,6 +26,8 @@ trp_obj_t *trp_equal( trp_obj_t *o1, trp_obj_t *o2 )
         return TRP_TRUE;
     if ( o1->tipo != o2->tipo )
         return TRP_FALSE;
+    if ( o1->tipo == TRP_SIG64 )
+        return ( ((trp_sig64_t *)o1)->val == ((trp_sig64_t *)o2)->val ) ? TRP_TRUE : TRP_FALSE;
     return (_trp_equal_fun[ o1->tipo ])( o1, o2 );
 }
 
@@ -40,6 +42,8 @@ trp_obj_t *trp_less( trp_obj_t *o1, trp_obj_t *o2 )
 
     if ( o1 == o2 )
         return TRP_FALSE;
+    if ( ( o1->tipo == TRP_SIG64 ) && ( o2->tipo == TRP_SIG64 ) )
+        return ( ((trp_sig64_t *)o1)->val < ((trp_sig64_t *)o2)->val ) ? TRP_TRUE : TRP_FALSE;
     if ( o1->tipo != o2->tipo ) {
         if ( ( ( o1->tipo == TRP_SIG64 ) || ( o1->tipo == TRP_MPI ) ||
                ( o1->tipo == TRP_RATIO ) || ( o1->tipo == TRP_COMPLEX ) ) &&
@@ -23,14 +23,11 @@ static uns32b      _trp_const_n = 0;
 static trp_raw_t  *_trp_const_r = NULL;
 static uns8b     **_trp_const_c = NULL;
 static trp_obj_t **_trp_const = NULL;
+static uns32b     *_trp_const_cnt = NULL;
+static uns8b       _trp_const_mode = TRP_CONST_LAZY;
 static uns32b      _trp_glb_n = 0;
 static trp_obj_t **_trp_glb = NULL;
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
 typedef struct {
     uns8b tipo;
     uns8b sottotipo;
@@ -50,8 +47,9 @@ typedef struct {
 } trp_dgraph_link_out_t;
 
 typedef struct {
-    struct avl_tree_node node;
     uns8b *key;
+    uns32b klen;
+    uns32b hash;
     trp_obj_t *val;
 } trp_assoc_item_t;
 
@@ -74,14 +72,29 @@ typedef struct {
     sig16b chstep;
 } trp_for_t;
 
+/*
+ in modalità TRP_CONST_DROP, ad ogni collezione le costanti
+ decompresse di almeno TRP_CONST_DROP_MIN byte, usate meno di
+ TRP_CONST_DROP_USES volte dalla collezione precedente, vengono
+ dimenticate (e ridecompresse al prossimo accesso)
+ */
+#define TRP_CONST_DROP_MIN 65536
+#define TRP_CONST_DROP_USES 4
+
+static void trp_const_drop();
+static uns8b trp_const_env( uns8b *mode, uns8b warn );
+static void *trp_const_eager_routine( void *arg );
 static void trp_for_init_fibo_add_queue( trp_obj_t *q, trp_fibo_node_t *x, trp_fibo_node_t *x_first );
 static void trp_for_init_fibo_add_stack( trp_obj_t *s, trp_fibo_node_t *x, trp_fibo_node_t *x_first );
 
 void trp_const_init( uns32b n, trp_raw_t r[], uns8b *c[], uns64b cst_totsize )
 {
     void *root = (void *)( c[ 0 ] );
+    uns8b mode;
 
     _trp_const = trp_gc_malloc( sizeof( trp_obj_t * ) * n );
+    _trp_const_cnt = trp_gc_malloc_atomic( sizeof( uns32b ) * n );
+    memset( _trp_const_cnt, 0, sizeof( uns32b ) * n );
     _trp_const_n = n;
     _trp_const_r = r;
     _trp_const_c = c;
@@ -94,6 +107,102 @@ void trp_const_init( uns32b n, trp_raw_t r[], uns8b *c[], uns64b cst_totsize )
      considerare se si possono escludere altre aree...
      GC_exclude_static_roots(low_address,high_address_plus_1)
      */
+    if ( trp_const_env( &mode, 1 ) == 0 )
+        trp_const_set_mode( mode );
+}
+
+/*
+ legge la variabile d'ambiente TRP_CONST (eager, drop o lazy);
+ un valore diverso viene segnalato e ignorato
+ */
+
+static uns8b trp_const_env( uns8b *mode, uns8b warn )
+{
+    uns8b *s;
+
+    if ( ( s = getenv( "TRP_CONST" ) ) == NULL )
+        return 1;
+    if ( strcmp( s, "eager" ) == 0 )
+        *mode = TRP_CONST_EAGER;
+    else if ( strcmp( s, "drop" ) == 0 )
+        *mode = TRP_CONST_DROP;
+    else if ( strcmp( s, "lazy" ) == 0 )
+        *mode = TRP_CONST_LAZY;
+    else {
+        if ( warn )
+            fprintf( stderr, "TRP_CONST: invalid value `%s' ignored\n", s );
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ chiamata dal codice generato da trpc -eager o -drop;
+ la variabile d'ambiente TRP_CONST, se valida, ha la precedenza
+ */
+
+void trp_const_mode( uns8b mode )
+{
+    uns8b m;
+
+    if ( trp_const_env( &m, 0 ) )
+        trp_const_set_mode( mode );
+}
+
+void trp_const_set_mode( uns8b mode )
+{
+    _trp_const_mode = mode;
+    if ( mode == TRP_CONST_EAGER )
+        trp_const_eager();
+#if defined( GC_VERSION_MAJOR ) && ( ( GC_VERSION_MAJOR > 7 ) || ( ( GC_VERSION_MAJOR == 7 ) && ( GC_VERSION_MINOR >= 2 ) ) )
+    GC_set_start_callback( ( mode == TRP_CONST_DROP ) ? trp_const_drop : 0 );
+#endif
+}
+
+/*
+ decomprime subito tutte le costanti, in parallelo;
+ i thread si prendono le costanti una alla volta da un
+ contatore comune, così il carico si bilancia da solo
+ */
+
+void trp_const_eager()
+{
+    uns32b next = 0, parts;
+
+    if ( _trp_const_n == 0 )
+        return;
+    parts = trp_ncpus();
+    if ( parts > _trp_const_n )
+        parts = _trp_const_n;
+    trp_parallel_run( trp_const_eager_routine, (void *)( &next ), 0, parts );
+}
+
+static void *trp_const_eager_routine( void *arg )
+{
+    uns32b i;
+
+    while ( ( i = __sync_fetch_and_add( (uns32b *)arg, 1 ) ) < _trp_const_n )
+        (void)trp_const( i );
+    return NULL;
+}
+
+/*
+ gira con il lock del GC già preso e prima che parta la collezione:
+ non deve allocare; azzerare un puntatore qui è innocuo, perché chi
+ stesse usando la costante la tiene comunque raggiungibile
+ */
+
+static void trp_const_drop()
+{
+    uns32b i;
+
+    for ( i = 0 ; i < _trp_const_n ; i++ ) {
+        if ( _trp_const[ i ] &&
+             ( _trp_const_r[ i ].unc_len >= TRP_CONST_DROP_MIN ) &&
+             ( _trp_const_cnt[ i ] < TRP_CONST_DROP_USES ) )
+            _trp_const[ i ] = NULL;
+        _trp_const_cnt[ i ] = 0;
+    }
 }
 
 void trp_glb_init( uns32b n, trp_obj_t *glb[] )
@@ -108,15 +217,8 @@ void trp_glb_init( uns32b n, trp_obj_t *glb[] )
 
 void trp_gc()
 {
-    uns32b i;
-
-    for ( i = 0 ; i < _trp_const_n ; i++ ) {
-        /*
-         FIXME
-         prima di chiamare GC_gcollect() si potrebbe valutare
-         se vale la pena azzerare qualche costante...
-         */
-    }
+    if ( _trp_const_mode == TRP_CONST_DROP )
+        trp_const_drop();
     GC_gcollect();
 }
 
@@ -127,10 +229,11 @@ trp_obj_t *trp_const( uns32b i )
 
     if ( res ) {
         /*
-         FIXME
-         qui bisognerebbe incrementare un contatore associato alla costante
-         per valutare statisticamente il suo uso prima di chiamare GC_gcollect()
+         il contatore serve solo a trp_const_drop; non è atomico perché
+         qualche incremento perso fra thread diversi non cambia nulla
          */
+        if ( _trp_const_mode == TRP_CONST_DROP )
+            _trp_const_cnt[ i ]++;
     } else {
         /*
          potrebbe succedere che una costante venga decompressa da piu' thread
@@ -232,6 +335,67 @@ void trp_pop_env_void( uns32b n )
         (void)trp_stack_pop( stack );
 }
 
+/*
+ come sopra, ma salvando solo le globali il cui indice e' in glb
+ (glb[ 0 ] e' il loro numero); se glb e' NULL non ne viene salvata nessuna
+ */
+
+void trp_push_env_glb( uns32b *glb, trp_obj_t *obj, ... )
+{
+    extern objfun_t _trp_env_stack;
+    trp_obj_t *stack;
+    va_list args;
+
+    stack = (_trp_env_stack)();
+#ifdef TRP_ENV_STACK_GLB
+    if ( glb ) {
+        uns32b n;
+
+        for ( n = 1 ; n <= glb[ 0 ] ; n++ )
+            trp_stack_push( stack, _trp_glb[ glb[ n ] ] );
+    }
+#endif
+    va_start( args, obj );
+    for ( ; obj ; obj = va_arg( args, trp_obj_t * ) )
+        trp_stack_push( stack, obj );
+    va_end( args );
+}
+
+void trp_pop_env_glb( uns32b *glb, trp_obj_t **obj, ... )
+{
+    extern objfun_t _trp_env_stack;
+    trp_obj_t *stack;
+    va_list args;
+
+    stack = (_trp_env_stack)();
+    va_start( args, obj );
+    for ( ; obj ; obj = va_arg( args, trp_obj_t ** ) )
+        *obj = trp_stack_pop( stack );
+    va_end( args );
+#ifdef TRP_ENV_STACK_GLB
+    if ( glb ) {
+        uns32b n;
+
+        for ( n = glb[ 0 ] ; n ; n-- )
+            _trp_glb[ glb[ n ] ] = trp_stack_pop( stack );
+    }
+#endif
+}
+
+void trp_pop_env_void_glb( uns32b *glb, uns32b n )
+{
+    extern objfun_t _trp_env_stack;
+    trp_obj_t *stack;
+
+    stack = (_trp_env_stack)();
+#ifdef TRP_ENV_STACK_GLB
+    if ( glb )
+        n += glb[ 0 ];
+#endif
+    for ( ; n ; n-- )
+        (void)trp_stack_pop( stack );
+}
+
 /*
  supporto al costrutto 'for'
  */
@@ -304,6 +468,8 @@ uns8b trp_for_init( trp_obj_t **fst, trp_obj_t **var, trp_obj_t *from, trp_obj_t
     } else {
         if ( from->tipo == TRP_TREE )
             from = (trp_obj_t *)( ((trp_tree_t *)from)->children );
+        else if ( ( from->tipo == TRP_DGRAPH ) && ( ((trp_dgraph_t *)from)->sottotipo == 2 ) )
+            from = trp_dgraph_queue( from );
         switch ( from->tipo ) {
         case TRP_CONS:
             f = trp_gc_malloc( sizeof( trp_for_t ) );
@@ -338,30 +504,19 @@ uns8b trp_for_init( trp_obj_t **fst, trp_obj_t **var, trp_obj_t *from, trp_obj_t
             f = trp_gc_malloc( sizeof( trp_for_t ) );
             f->step = NULL;
             f->cordpos = NULL;
-            if ( rev ) {
-                trp_queue_elem *elem = (trp_queue_elem *)( ((trp_queue_t *)from)->first );
-
-                f->queue = NULL;
-                f->stack = trp_stack();
-                for ( ; ; ) {
-                    to = elem->val;
-                    elem = (trp_queue_elem *)( elem->next );
-                    if ( elem == NULL )
-                        break;
-                    trp_stack_push( f->stack, to );
-                }
-                f->act = to;
-            } else {
-                trp_queue_elem *elem = (trp_queue_elem *)( ((trp_queue_t *)from)->first );
+            {
+                uns32b i, l = ((trp_queue_t *)from)->len;
 
                 f->stack = NULL;
                 f->queue = trp_queue();
-                f->act = elem->val;
-                for ( ; ; ) {
-                    elem = (trp_queue_elem *)( elem->next );
-                    if ( elem == NULL )
-                        break;
-                    trp_queue_put( f->queue, elem->val );
+                if ( rev ) {
+                    f->act = trp_queue_nth( l - 1, (trp_queue_t *)from );
+                    for ( i = 1 ; i < l ; i++ )
+                        trp_queue_put( f->queue, trp_queue_nth( l - i - 1, (trp_queue_t *)from ) );
+                } else {
+                    f->act = trp_queue_nth( 0, (trp_queue_t *)from );
+                    for ( i = 1 ; i < l ; i++ )
+                        trp_queue_put( f->queue, trp_queue_nth( i, (trp_queue_t *)from ) );
                 }
             }
             break;
@@ -391,7 +546,9 @@ uns8b trp_for_init( trp_obj_t **fst, trp_obj_t **var, trp_obj_t *from, trp_obj_t
             if ( ((trp_assoc_t *)from)->len == 0 )
                 return 1;
             else {
-                struct avl_tree_node *node;
+                extern trp_assoc_item_t **trp_assoc_sorted( trp_assoc_t *obj );
+                trp_assoc_item_t **item = trp_assoc_sorted( (trp_assoc_t *)from );
+                uns32b i, l = ((trp_assoc_t *)from)->len;
 
                 f = trp_gc_malloc( sizeof( trp_for_t ) );
                 f->step = NULL;
@@ -399,27 +556,13 @@ uns8b trp_for_init( trp_obj_t **fst, trp_obj_t **var, trp_obj_t *from, trp_obj_t
                 f->queue = trp_queue();
                 f->stack = NULL;
                 if ( rev ) {
-                    node = avl_tree_last_in_order( (struct avl_tree_node *)(((trp_assoc_t *)from)->root) );
-                    f->act = trp_cons( trp_cord( ((trp_assoc_item_t *)(node->dummy))->key ),
-                                       ((trp_assoc_item_t *)(node->dummy))->val );
-                    for ( ; ; ) {
-                        node = avl_tree_prev_in_order( node );
-                        if ( node == NULL )
-                            break;
-                        trp_queue_put( f->queue, trp_cons( trp_cord( ((trp_assoc_item_t *)(node->dummy))->key ),
-                                                           ((trp_assoc_item_t *)(node->dummy))->val ) );
-                    }
+                    f->act = trp_cons( trp_cord( item[ l - 1 ]->key ), item[ l - 1 ]->val );
+                    for ( i = 1 ; i < l ; i++ )
+                        trp_queue_put( f->queue, trp_cons( trp_cord( item[ l - i - 1 ]->key ), item[ l - i - 1 ]->val ) );
                 } else {
-                    node = avl_tree_first_in_order( (struct avl_tree_node *)(((trp_assoc_t *)from)->root) );
-                    f->act = trp_cons( trp_cord( ((trp_assoc_item_t *)(node->dummy))->key ),
-                                       ((trp_assoc_item_t *)(node->dummy))->val );
-                    for ( ; ; ) {
-                        node = avl_tree_next_in_order( node );
-                        if ( node == NULL )
-                            break;
-                        trp_queue_put( f->queue, trp_cons( trp_cord( ((trp_assoc_item_t *)(node->dummy))->key ),
-                                                           ((trp_assoc_item_t *)(node->dummy))->val ) );
-                    }
+                    f->act = trp_cons( trp_cord( item[ 0 ]->key ), item[ 0 ]->val );
+                    for ( i = 1 ; i < l ; i++ )
+                        trp_queue_put( f->queue, trp_cons( trp_cord( item[ i ]->key ), item[ i ]->val ) );
                 }
             }
             break;
@@ -589,6 +732,19 @@ uns8b trp_for_next( trp_obj_t **fst )
     trp_for_t *f = *( (trp_for_t **)fst );
 
     if ( f->step ) {
+        sig64b v;
+
+        if ( ( f->act->tipo == TRP_SIG64 ) &&
+             ( f->step->tipo == TRP_SIG64 ) &&
+             ( f->target->tipo == TRP_SIG64 ) &&
+             ( ((trp_sig64_t *)(f->act))->val != ((trp_sig64_t *)(f->target))->val ) &&
+             ( !__builtin_add_overflow( ((trp_sig64_t *)(f->act))->val,
+                                        ((trp_sig64_t *)(f->step))->val,
+                                        &v ) ) ) {
+            *( f->var ) = f->act = trp_sig64( v );
+            f->pos++;
+            return 1;
+        }
         if ( trp_equal( f->act, f->target ) == TRP_FALSE ) {
             *( f->var ) = f->act = trp_cat( f->act, f->step, NULL );
             f->pos++;
@@ -20,6 +20,36 @@
 
 #define TRP_DEFAULT_SORT_ALG trp_array_quicksort_internal
 
+/*
+ sotto questa soglia l'ordinamento non viene diviso tra piu' thread;
+ ogni thread riceve almeno TRP_ARRAY_SORT_PAR_CHUNK elementi
+ */
+#define TRP_ARRAY_SORT_PAR_MIN 65536
+#define TRP_ARRAY_SORT_PAR_CHUNK 16384
+#define TRP_ARRAY_SORT_INS 24
+
+/*
+ elemento degli ordinamenti specializzati: key e' una chiave
+ numerica estratta una volta sola (il valore per i sig64,
+ i primi 8 byte big-endian per le cord piatte)
+ */
+
+typedef struct {
+    uns64b key;
+    trp_obj_t *obj;
+} trp_array_item_t;
+
+typedef uns8b (*trp_array_item_less_t)( trp_array_item_t *x, trp_array_item_t *y );
+
+typedef struct {
+    trp_array_item_t *src;
+    trp_array_item_t *dst;
+    trp_array_item_less_t less;
+    uns32b fr;
+    uns32b mid;
+    uns32b to;
+} trp_array_par_t;
+
 extern uns32b trp_size_internal( trp_obj_t *obj );
 extern void trp_encode_internal( trp_obj_t *obj, uns8b **buf );
 extern trp_obj_t *trp_decode_internal( uns8b **buf );
@@ -36,6 +66,15 @@ static void trp_array_quicksort_rec( trp_array_t *a, objfun_t cmp, uns32b fr, un
 static void trp_array_quicksort_perno( trp_array_t *a, objfun_t cmp, uns32b fr, uns32b to, uns32b *pos );
 static uns8b trp_array_heapsort_internal( trp_array_t *a, objfun_t cmp );
 static uns8b trp_array_mergesort_internal( trp_array_t *a, objfun_t cmp );
+static uns8b trp_array_sort_default( trp_array_t *a );
+static uns8b trp_array_radixsort_internal( trp_array_t *a );
+static uns8b trp_array_item_less_obj( trp_array_item_t *x, trp_array_item_t *y );
+static uns8b trp_array_item_less_cord( trp_array_item_t *x, trp_array_item_t *y );
+static void trp_array_item_merge( trp_array_item_t *src, trp_array_item_t *dst, trp_array_item_less_t less, uns32b fr, uns32b mid, uns32b to );
+static void trp_array_item_mergesort( trp_array_item_t *v, trp_array_item_t *tmp, trp_array_item_less_t less, uns32b fr, uns32b to );
+static void *trp_array_par_sort_routine( void *arg );
+static void *trp_array_par_merge_routine( void *arg );
+static void trp_array_par_mergesort( trp_array_item_t *v, uns32b n, trp_array_item_less_t less );
 
 uns8b trp_array_print( trp_print_t *p, trp_array_t *obj )
 {
@@ -511,13 +550,250 @@ uns8b trp_array_sort_internal( trp_array_t *a, objfun_t *cmp )
     return trp_array_sort_low_low( a, cmp, NULL );
 }
 
+/*
+ con il confronto di default (less) sort e mergesort usano
+ gli ordinamenti specializzati, che sono tutti stabili
+ */
+
 static uns8b trp_array_sort_low_low( trp_array_t *a, objfun_t *cmp, uns8bfun_t alg )
 {
+    if ( ( (void *)cmp == (void *)trp_less ) &&
+         ( ( alg == NULL ) || ( alg == trp_array_mergesort_internal ) ) )
+        return trp_array_sort_default( a );
     if ( alg == NULL )
         alg = TRP_DEFAULT_SORT_ALG;
     return (alg)( a, cmp );
 }
 
+static uns8b trp_array_sort_default( trp_array_t *a )
+{
+    trp_array_item_t *v;
+    trp_obj_t *obj;
+    uns32b n = a->len, i, j;
+    uns8b tipo, flat = 1;
+
+    if ( n <= 1 )
+        return 0;
+    tipo = a->data[ 0 ]->tipo;
+    for ( i = 0 ; i < n ; i++ ) {
+        obj = a->data[ i ];
+        if ( obj->tipo != tipo )
+            break;
+        if ( tipo == TRP_CORD )
+            if ( ((trp_cord_t *)obj)->len )
+                if ( !CORD_IS_STRING( ((trp_cord_t *)obj)->c ) )
+                    flat = 0;
+    }
+    if ( ( i == n ) && ( tipo == TRP_SIG64 ) )
+        return trp_array_radixsort_internal( a );
+    v = trp_gc_malloc( sizeof( trp_array_item_t ) * n );
+    if ( ( i == n ) && ( tipo == TRP_CORD ) && flat ) {
+        uns8b *c;
+
+        for ( i = 0 ; i < n ; i++ ) {
+            obj = a->data[ i ];
+            v[ i ].obj = obj;
+            v[ i ].key = 0;
+            c = ((trp_cord_t *)obj)->len ? (uns8b *)( ((trp_cord_t *)obj)->c ) : (uns8b *)"";
+            for ( j = 0 ; j < 8 ; j++ ) {
+                v[ i ].key <<= 8;
+                if ( *c )
+                    v[ i ].key |= *c++;
+            }
+        }
+        trp_array_par_mergesort( v, n, trp_array_item_less_cord );
+    } else {
+        for ( i = 0 ; i < n ; i++ ) {
+            v[ i ].obj = a->data[ i ];
+            v[ i ].key = 0;
+        }
+        trp_array_par_mergesort( v, n, trp_array_item_less_obj );
+    }
+    for ( i = 0 ; i < n ; i++ )
+        a->data[ i ] = v[ i ].obj;
+    trp_gc_free( v );
+    return 0;
+}
+
+/*
+ radix sort LSD a 8 bit sul valore con il bit di segno invertito;
+ i passi in cui tutti gli elementi hanno lo stesso byte si saltano
+ */
+
+static uns8b trp_array_radixsort_internal( trp_array_t *a )
+{
+    trp_array_item_t *v, *w, *t;
+    uns32b n = a->len, i, cnt[ 256 ], sum, c;
+    uns8b shift, b;
+
+    v = trp_gc_malloc( sizeof( trp_array_item_t ) * n );
+    w = trp_gc_malloc( sizeof( trp_array_item_t ) * n );
+    for ( i = 0 ; i < n ; i++ ) {
+        v[ i ].key = ((uns64b)( ((trp_sig64_t *)( a->data[ i ] ))->val )) ^ 0x8000000000000000ULL;
+        v[ i ].obj = a->data[ i ];
+    }
+    for ( shift = 0 ; shift < 64 ; shift += 8 ) {
+        memset( cnt, 0, sizeof( cnt ) );
+        for ( i = 0 ; i < n ; i++ )
+            cnt[ (uns8b)( v[ i ].key >> shift ) ]++;
+        b = (uns8b)( v[ 0 ].key >> shift );
+        if ( cnt[ b ] == n )
+            continue;
+        for ( i = 0, sum = 0 ; i < 256 ; i++ ) {
+            c = cnt[ i ];
+            cnt[ i ] = sum;
+            sum += c;
+        }
+        for ( i = 0 ; i < n ; i++ )
+            w[ cnt[ (uns8b)( v[ i ].key >> shift ) ]++ ] = v[ i ];
+        t = v;
+        v = w;
+        w = t;
+    }
+    for ( i = 0 ; i < n ; i++ )
+        a->data[ i ] = v[ i ].obj;
+    trp_gc_free( v );
+    trp_gc_free( w );
+    return 0;
+}
+
+static uns8b trp_array_item_less_obj( trp_array_item_t *x, trp_array_item_t *y )
+{
+    return ( trp_less( x->obj, y->obj ) == TRP_TRUE ) ? 1 : 0;
+}
+
+static uns8b trp_array_item_less_cord( trp_array_item_t *x, trp_array_item_t *y )
+{
+    if ( x->key != y->key )
+        return ( x->key < y->key ) ? 1 : 0;
+    if ( ( ((trp_cord_t *)( x->obj ))->len <= 8 ) ||
+         ( ((trp_cord_t *)( y->obj ))->len <= 8 ) )
+        return ( ((trp_cord_t *)( x->obj ))->len < ((trp_cord_t *)( y->obj ))->len ) ? 1 : 0;
+    return ( strcmp( ((trp_cord_t *)( x->obj ))->c + 8,
+                     ((trp_cord_t *)( y->obj ))->c + 8 ) < 0 ) ? 1 : 0;
+}
+
+/*
+ fusione stabile: a parita' vince l'elemento di sinistra
+ */
+
+static void trp_array_item_merge( trp_array_item_t *src, trp_array_item_t *dst, trp_array_item_less_t less, uns32b fr, uns32b mid, uns32b to )
+{
+    uns32b i = fr, j = mid, k = fr;
+
+    if ( ( i < mid ) && ( j < to ) )
+        if ( (less)( src + j, src + mid - 1 ) == 0 ) {
+            memcpy( dst + fr, src + fr, ( to - fr ) * sizeof( trp_array_item_t ) );
+            return;
+        }
+    while ( ( i < mid ) && ( j < to ) )
+        if ( (less)( src + j, src + i ) )
+            dst[ k++ ] = src[ j++ ];
+        else
+            dst[ k++ ] = src[ i++ ];
+    while ( i < mid )
+        dst[ k++ ] = src[ i++ ];
+    while ( j < to )
+        dst[ k++ ] = src[ j++ ];
+}
+
+/*
+ ordina v[fr..to) usando tmp[fr..to) come appoggio;
+ il risultato finisce sempre in v
+ */
+
+static void trp_array_item_mergesort( trp_array_item_t *v, trp_array_item_t *tmp, trp_array_item_less_t less, uns32b fr, uns32b to )
+{
+    trp_array_item_t *p1 = v, *p2 = tmp, *p3, x;
+    uns32b i, j, sz, mid, max;
+
+    for ( i = fr ; i < to ; i += TRP_ARRAY_SORT_INS ) {
+        max = ( to - i > TRP_ARRAY_SORT_INS ) ? i + TRP_ARRAY_SORT_INS : to;
+        for ( j = i + 1 ; j < max ; j++ ) {
+            x = v[ j ];
+            for ( mid = j ; ( mid > i ) && (less)( &x, v + mid - 1 ) ; mid-- )
+                v[ mid ] = v[ mid - 1 ];
+            v[ mid ] = x;
+        }
+    }
+    for ( sz = TRP_ARRAY_SORT_INS ; sz < to - fr ; sz <<= 1 ) {
+        for ( i = fr ; i < to ; i += sz << 1 ) {
+            mid = ( to - i > sz ) ? i + sz : to;
+            max = ( to - mid > sz ) ? mid + sz : to;
+            trp_array_item_merge( p1, p2, less, i, mid, max );
+        }
+        p3 = p1;
+        p1 = p2;
+        p2 = p3;
+    }
+    if ( p1 != v )
+        memcpy( v + fr, p1 + fr, ( to - fr ) * sizeof( trp_array_item_t ) );
+}
+
+static void *trp_array_par_sort_routine( void *arg )
+{
+    trp_array_par_t *p = (trp_array_par_t *)arg;
+
+    trp_array_item_mergesort( p->src, p->dst, p->less, p->fr, p->to );
+    return NULL;
+}
+
+static void *trp_array_par_merge_routine( void *arg )
+{
+    trp_array_par_t *p = (trp_array_par_t *)arg;
+
+    trp_array_item_merge( p->src, p->dst, p->less, p->fr, p->mid, p->to );
+    return NULL;
+}
+
+/*
+ le parti vengono ordinate in parallelo, poi fuse a coppie
+ (anche le fusioni dello stesso livello sono parallele);
+ se pthread_create fallisce il lavoro lo fa il thread chiamante
+ */
+
+static void trp_array_par_mergesort( trp_array_item_t *v, uns32b n, trp_array_item_less_t less )
+{
+    trp_array_item_t *tmp, *src, *dst;
+    trp_array_par_t *par;
+    uns32b parts, i, k, sz;
+
+    tmp = trp_gc_malloc( sizeof( trp_array_item_t ) * n );
+    parts = ( n >= TRP_ARRAY_SORT_PAR_MIN ) ? n / TRP_ARRAY_SORT_PAR_CHUNK : 1;
+    if ( parts > trp_ncpus() )
+        parts = trp_ncpus();
+    if ( parts <= 1 ) {
+        trp_array_item_mergesort( v, tmp, less, 0, n );
+        trp_gc_free( tmp );
+        return;
+    }
+    par = trp_gc_malloc( sizeof( trp_array_par_t ) * parts );
+    for ( i = 0 ; i < parts ; i++ ) {
+        par[ i ].src = v;
+        par[ i ].dst = tmp;
+        par[ i ].less = less;
+        par[ i ].fr = (uns32b)( ( (uns64b)n * i ) / parts );
+        par[ i ].to = (uns32b)( ( (uns64b)n * ( i + 1 ) ) / parts );
+    }
+    trp_parallel_run( trp_array_par_sort_routine, (void *)par, sizeof( trp_array_par_t ), parts );
+    for ( src = v, dst = tmp, sz = 1 ; sz < parts ; sz <<= 1 ) {
+        for ( i = 0, k = 0 ; i < parts ; i += sz << 1, k++ ) {
+            par[ k ].src = src;
+            par[ k ].dst = dst;
+            par[ k ].fr = (uns32b)( ( (uns64b)n * i ) / parts );
+            par[ k ].mid = ( i + sz < parts ) ? (uns32b)( ( (uns64b)n * ( i + sz ) ) / parts ) : n;
+            par[ k ].to = ( i + ( sz << 1 ) < parts ) ? (uns32b)( ( (uns64b)n * ( i + ( sz << 1 ) ) ) / parts ) : n;
+        }
+        trp_parallel_run( trp_array_par_merge_routine, (void *)par, sizeof( trp_array_par_t ), k );
+        src = ( src == v ) ? tmp : v;
+        dst = ( dst == v ) ? tmp : v;
+    }
+    if ( src != v )
+        memcpy( v, src, n * sizeof( trp_array_item_t ) );
+    trp_gc_free( par );
+    trp_gc_free( tmp );
+}
+
 static uns8b trp_array_quicksort_internal( trp_array_t *a, objfun_t cmp )
 {
     uns32b n;
@@ -624,8 +900,11 @@ static uns8b trp_array_mergesort_internal( trp_array_t *a, objfun_t cmp )
     if ( n <= 1 )
         return 0;
     nn = sizeof( trp_obj_t * ) * n;
-    if ( ( v = malloc( nn ) ) == NULL )
-        return 1;
+    /*
+     v non puo' essere allocato con malloc: durante le fusioni
+     alcuni oggetti sono referenziati solo da qui
+     */
+    v = trp_gc_malloc( nn );
     for ( p1 = a->data, p2 = v, sz = 1 ; ; ) {
         for ( x = 0, k = 0 ; ; x = max ) {
             if ( ( y = x + sz ) > n )
@@ -633,10 +912,10 @@ static uns8b trp_array_mergesort_internal( trp_array_t *a, objfun_t cmp )
             if ( ( max = y + sz ) > n )
                 max = n;
             for ( i = x, j = y ; ( i < y ) && ( j < max ) ; ++k )
-                if ( (cmp)( p1[ i ], p1[ j ] ) == TRP_TRUE )
-                    p2[ k ] = p1[ i++ ];
-                else
+                if ( (cmp)( p1[ j ], p1[ i ] ) == TRP_TRUE )
                     p2[ k ] = p1[ j++ ];
+                else
+                    p2[ k ] = p1[ i++ ];
             while ( i < y )
                 p2[ k++ ] = p1[ i++ ];
             while ( j < max )
@@ -653,7 +932,7 @@ static uns8b trp_array_mergesort_internal( trp_array_t *a, objfun_t cmp )
     }
     if ( p2 == v )
         memcpy( a->data, v, nn );
-    free( v );
+    trp_gc_free( v );
     return 0;
 }
 
@@ -17,16 +17,38 @@
 */
 
 #include "trp.h"
-#include "avl_tree.h"
+
+/*
+ tabella hash a indirizzamento aperto (linear probing);
+ la chiave e' la stampa dell'oggetto (come con trp_csprint, fino
+ all'eventuale primo carattere nullo), ma per cord, sig64 e char
+ viene calcolata direttamente, senza allocare nulla.
+ La vista ordinata per chiave (usata da encode, queue, for, ...)
+ viene costruita solo quando serve e invalidata da inserimenti
+ e cancellazioni.
+ */
+
+#define TRP_ASSOC_MIN_SIZE 16
+#define TRP_ASSOC_KEYBUF_SIZE 256
 
 typedef struct {
-    struct avl_tree_node node;
     uns8b *key;
+    uns32b klen;
+    uns32b hash;
     trp_obj_t *val;
 } trp_assoc_item_t;
 
-static int trp_assoc_less_i( const struct avl_tree_node *node1, const struct avl_tree_node *node2 );
-static int trp_assoc_less_l( const void *p, const struct avl_tree_node *node );
+static trp_assoc_item_t _trp_assoc_deleted;
+#define TRP_ASSOC_DELETED (&_trp_assoc_deleted)
+
+static uns32b trp_assoc_hash( uns8b *s, uns32b len );
+static uns8b *trp_assoc_key( trp_obj_t *key, uns8b *buf, uns32b *len, uns8b *allocated );
+static trp_assoc_item_t **trp_assoc_lookup( trp_assoc_t *obj, uns8b *s, uns32b len, uns32b hash );
+static trp_assoc_item_t **trp_assoc_lookup_low( trp_assoc_t *obj, uns8b *s, uns32b len, uns32b hash, uns8b ins );
+static void trp_assoc_resize( trp_assoc_t *obj, uns32b size );
+static uns8b trp_assoc_insert( trp_assoc_t *obj, uns8b *s, uns32b len, uns32b hash, trp_obj_t *val, uns8b allocated );
+static int trp_assoc_cmp( const void *p1, const void *p2 );
+trp_assoc_item_t **trp_assoc_sorted( trp_assoc_t *obj );
 
 uns8b trp_assoc_print( trp_print_t *p, trp_assoc_t *obj )
 {
@@ -40,34 +62,34 @@ uns8b trp_assoc_print( trp_print_t *p, trp_assoc_t *obj )
 uns32b trp_assoc_size( trp_assoc_t *obj )
 {
     extern uns32b trp_size_internal( trp_obj_t * );
-    struct avl_tree_node *node;
-    uns32b sz = 1 + 4;
-
-    for ( node = avl_tree_first_in_order( (struct avl_tree_node *)(obj->root) ) ;
-          node ;
-          node = avl_tree_next_in_order( node ) )
-        sz += strlen( ((trp_assoc_item_t *)(node->dummy))->key ) + 1 +
-              trp_size_internal( ((trp_assoc_item_t *)(node->dummy))->val );
+    trp_assoc_item_t **item;
+    uns32b sz = 1 + 4, i;
+
+    item = (trp_assoc_item_t **)( obj->table );
+    for ( i = 0 ; i < obj->size ; i++ )
+        if ( item[ i ] && ( item[ i ] != TRP_ASSOC_DELETED ) )
+            sz += item[ i ]->klen + 1 + trp_size_internal( item[ i ]->val );
     return sz;
 }
 
 void trp_assoc_encode( trp_assoc_t *obj, uns8b **buf )
 {
     extern void trp_encode_internal( trp_obj_t *, uns8b ** );
-    uns32b *p;
-    struct avl_tree_node *node;
+    uns32b *p, i;
+    trp_assoc_item_t **item;
 
     **buf = TRP_ASSOC;
     ++(*buf);
     p = (uns32b *)(*buf);
     *p = norm32( obj->len );
     (*buf) += 4;
-    for ( node = avl_tree_first_in_order( (struct avl_tree_node *)(obj->root) ) ;
-          node ;
-          node = avl_tree_next_in_order( node ) ) {
-        strcpy( *buf, ((trp_assoc_item_t *)(node->dummy))->key );
-        (*buf) += strlen( ((trp_assoc_item_t *)(node->dummy))->key ) + 1;
-        trp_encode_internal( ((trp_assoc_item_t *)(node->dummy))->val, buf );
+    item = trp_assoc_sorted( obj );
+    for ( i = 0 ; i < obj->len ; i++ ) {
+        memcpy( *buf, item[ i ]->key, item[ i ]->klen );
+        (*buf) += item[ i ]->klen;
+        **buf = 0;
+        ++(*buf);
+        trp_encode_internal( item[ i ]->val, buf );
     }
 }
 
@@ -75,42 +97,42 @@ trp_obj_t *trp_assoc_decode( uns8b **buf )
 {
     extern trp_obj_t *trp_decode_internal( uns8b ** );
     trp_obj_t *obj = trp_assoc();
-    trp_assoc_item_t *item;
     uns8b *c;
-    uns32b len;
-    int l;
+    uns32b len, l;
 
-    ((trp_assoc_t *)obj)->len = len = norm32( *((uns32b *)(*buf)) );
+    len = norm32( *((uns32b *)(*buf)) );
     (*buf) += 4;
+    if ( len > TRP_ASSOC_MIN_SIZE / 2 ) {
+        uns32b size;
+
+        for ( size = TRP_ASSOC_MIN_SIZE ; size < 2 * len ; size <<= 1 );
+        trp_assoc_resize( (trp_assoc_t *)obj, size );
+    }
     for ( ; len ; len-- ) {
-        l = strlen( *buf ) + 1;
-        c = trp_gc_malloc_atomic( l );
-        strcpy( c, *buf );
-        (*buf) += l;
-        item = trp_gc_malloc( sizeof( trp_assoc_item_t ) );
-        item->node.dummy = item;
-        item->key = c;
-        item->val = trp_decode_internal( buf );
-        avl_tree_insert( (struct avl_tree_node **)(&(((trp_assoc_t *)obj)->root)), &(item->node), trp_assoc_less_i );
+        l = strlen( *buf );
+        c = *buf;
+        (*buf) += l + 1;
+        (void)trp_assoc_insert( (trp_assoc_t *)obj, c, l, trp_assoc_hash( c, l ), trp_decode_internal( buf ), 0 );
     }
     return obj;
 }
 
 trp_obj_t *trp_assoc_equal( trp_assoc_t *o1, trp_assoc_t *o2 )
 {
-    struct avl_tree_node *node1, *node2;
+    trp_assoc_item_t **item, **other;
+    uns32b i;
 
     if ( o1->len != o2->len )
         return TRP_FALSE;
-    for ( node1 = avl_tree_first_in_order( (struct avl_tree_node *)(o1->root) ) ;
-          node1 ;
-          node1 = avl_tree_next_in_order( node1 ) ) {
-        node2 = avl_tree_lookup( (struct avl_tree_node *)(o2->root), (void *)(((trp_assoc_item_t *)(node1->dummy))->key), trp_assoc_less_l );
-        if ( node2 == NULL )
-            return TRP_FALSE;
-        if ( trp_equal( ((trp_assoc_item_t *)(node1->dummy))->val, ((trp_assoc_item_t *)(node2->dummy))->val ) != TRP_TRUE )
-            return TRP_FALSE;
-    }
+    item = (trp_assoc_item_t **)( o1->table );
+    for ( i = 0 ; i < o1->size ; i++ )
+        if ( item[ i ] && ( item[ i ] != TRP_ASSOC_DELETED ) ) {
+            other = trp_assoc_lookup( o2, item[ i ]->key, item[ i ]->klen, item[ i ]->hash );
+            if ( *other == NULL )
+                return TRP_FALSE;
+            if ( trp_equal( item[ i ]->val, (*other)->val ) != TRP_TRUE )
+                return TRP_FALSE;
+        }
     return TRP_TRUE;
 }
 
@@ -126,28 +148,199 @@ trp_obj_t *trp_assoc_height( trp_assoc_t *obj )
 
 uns8b trp_assoc_in( trp_obj_t *obj, trp_assoc_t *seq, uns32b *pos, uns32b nth )
 {
-    uns8b *c;
-    struct avl_tree_node *node;
+    uns8b buf[ TRP_ASSOC_KEYBUF_SIZE ], *c, allocated;
+    uns32b len;
+    trp_assoc_item_t *item;
 
     if ( nth || ( seq->len == 0 ) )
         return 1;
-    c = trp_csprint( obj );
-    node = avl_tree_lookup( (struct avl_tree_node *)(seq->root), (void *)c, trp_assoc_less_l );
-    trp_csprint_free( c );
-    if ( node == NULL )
+    c = trp_assoc_key( obj, buf, &len, &allocated );
+    item = *trp_assoc_lookup( seq, c, len, trp_assoc_hash( c, len ) );
+    if ( allocated == 1 )
+        trp_csprint_free( c );
+    if ( item == NULL )
         return 1;
     *pos = 0;
     return 0;
 }
 
-static int trp_assoc_less_i( const struct avl_tree_node *node1, const struct avl_tree_node *node2 )
+static uns32b trp_assoc_hash( uns8b *s, uns32b len )
+{
+    uns32b h = 2166136261U;
+
+    for ( ; len ; len-- ) {
+        h ^= (uns32b)( *s++ );
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/*
+ rende la chiave di key: in buf (di almeno TRP_ASSOC_KEYBUF_SIZE byte),
+ direttamente nella stringa di un cord piatto (allocated=2)
+ oppure in una stringa ottenuta con trp_csprint() (allocated=1)
+ */
+
+static uns8b *trp_assoc_key( trp_obj_t *key, uns8b *buf, uns32b *len, uns8b *allocated )
+{
+    uns8b *c;
+
+    *allocated = 0;
+    switch ( key->tipo ) {
+    case TRP_CORD:
+        if ( ((trp_cord_t *)key)->len == 0 ) {
+            *len = 0;
+            return buf;
+        }
+        if ( CORD_IS_STRING( ((trp_cord_t *)key)->c ) ) {
+            *len = strlen( ((trp_cord_t *)key)->c );
+            *allocated = 2;
+            return (uns8b *)( ((trp_cord_t *)key)->c );
+        }
+        if ( ((trp_cord_t *)key)->len < TRP_ASSOC_KEYBUF_SIZE ) {
+            CORD_pos i;
+            uns32b l = 0;
+
+            CORD_FOR( i, ((trp_cord_t *)key)->c ) {
+                if ( ( buf[ l ] = CORD_pos_fetch( i ) ) == 0 )
+                    break;
+                l++;
+            }
+            *len = l;
+            return buf;
+        }
+        break;
+    case TRP_SIG64:
+        *len = sprintf( buf, "%lld", ((trp_sig64_t *)key)->val );
+        return buf;
+    case TRP_CHAR:
+        buf[ 0 ] = ((trp_char_t *)key)->c;
+        *len = buf[ 0 ] ? 1 : 0;
+        return buf;
+    }
+    c = trp_csprint( key );
+    *len = strlen( c );
+    *allocated = 1;
+    return c;
+}
+
+/*
+ rende lo slot della chiave, oppure uno slot vuoto se la chiave manca;
+ i tombstone (TRP_ASSOC_DELETED) non sono mai resi
+ */
+
+static trp_assoc_item_t **trp_assoc_lookup( trp_assoc_t *obj, uns8b *s, uns32b len, uns32b hash )
+{
+    return trp_assoc_lookup_low( obj, s, len, hash, 0 );
+}
+
+/*
+ con ins, se la chiave manca, rende il primo tombstone incontrato
+ (la catena è già stata percorsa fino allo slot vuoto)
+ */
+
+static trp_assoc_item_t **trp_assoc_lookup_low( trp_assoc_t *obj, uns8b *s, uns32b len, uns32b hash, uns8b ins )
+{
+    static trp_assoc_item_t *empty = NULL;
+    trp_assoc_item_t **item = (trp_assoc_item_t **)( obj->table ), **del = NULL;
+    uns32b mask, i;
+
+    if ( obj->size == 0 )
+        return &empty;
+    mask = obj->size - 1;
+    for ( i = hash & mask ; ; i = ( i + 1 ) & mask ) {
+        if ( item[ i ] == NULL )
+            return ( ins && del ) ? del : &item[ i ];
+        if ( item[ i ] == TRP_ASSOC_DELETED ) {
+            if ( del == NULL )
+                del = &item[ i ];
+        } else if ( ( item[ i ]->hash == hash ) &&
+                    ( item[ i ]->klen == len ) &&
+                    ( memcmp( item[ i ]->key, s, len ) == 0 ) )
+            return &item[ i ];
+    }
+}
+
+static void trp_assoc_resize( trp_assoc_t *obj, uns32b size )
+{
+    trp_assoc_item_t **old = (trp_assoc_item_t **)( obj->table ), **item;
+    uns32b old_size = obj->size, mask = size - 1, i, j;
+
+    item = trp_gc_malloc( sizeof( trp_assoc_item_t * ) * size );
+    memset( item, 0, sizeof( trp_assoc_item_t * ) * size );
+    for ( i = 0 ; i < old_size ; i++ )
+        if ( old[ i ] && ( old[ i ] != TRP_ASSOC_DELETED ) ) {
+            for ( j = old[ i ]->hash & mask ; item[ j ] ; j = ( j + 1 ) & mask );
+            item[ j ] = old[ i ];
+        }
+    obj->table = (void *)item;
+    obj->size = size;
+    obj->used = obj->len;
+    trp_gc_free( old );
+}
+
+/*
+ allocated come in trp_assoc_key(); se e' 0, s viene copiata
+ */
+
+static uns8b trp_assoc_insert( trp_assoc_t *obj, uns8b *s, uns32b len, uns32b hash, trp_obj_t *val, uns8b allocated )
+{
+    trp_assoc_item_t **slot, *item;
+
+    slot = trp_assoc_lookup_low( obj, s, len, hash, 1 );
+    if ( *slot && ( *slot != TRP_ASSOC_DELETED ) ) {
+        (*slot)->val = val;
+        if ( allocated == 1 )
+            trp_csprint_free( s );
+        return 0;
+    }
+    if ( 4 * ( obj->used + 1 ) > 3 * obj->size ) {
+        trp_assoc_resize( obj, ( obj->size == 0 )
+                               ? TRP_ASSOC_MIN_SIZE
+                               : ( ( 2 * obj->len >= obj->size / 2 ) ? 2 * obj->size : obj->size ) );
+        slot = trp_assoc_lookup_low( obj, s, len, hash, 1 );
+    }
+    if ( allocated == 0 ) {
+        uns8b *c = trp_gc_malloc_atomic( len + 1 );
+
+        memcpy( c, s, len );
+        c[ len ] = 0;
+        s = c;
+    }
+    item = trp_gc_malloc( sizeof( trp_assoc_item_t ) );
+    item->key = s;
+    item->klen = len;
+    item->hash = hash;
+    item->val = val;
+    if ( *slot == NULL )
+        obj->used++;
+    *slot = item;
+    obj->len++;
+    obj->sorted = NULL;
+    return 0;
+}
+
+static int trp_assoc_cmp( const void *p1, const void *p2 )
 {
-    return strcmp( ((trp_assoc_item_t *)(node1->dummy))->key, ((trp_assoc_item_t *)(node2->dummy))->key );
+    return strcmp( (*((trp_assoc_item_t **)p1))->key, (*((trp_assoc_item_t **)p2))->key );
 }
 
-static int trp_assoc_less_l( const void *p, const struct avl_tree_node *node )
+trp_assoc_item_t **trp_assoc_sorted( trp_assoc_t *obj )
 {
-    return strcmp( (uns8b *)p, ((trp_assoc_item_t *)(node->dummy))->key );
+    trp_assoc_item_t **item, **res;
+    uns32b i, j;
+
+    if ( obj->sorted )
+        return (trp_assoc_item_t **)( obj->sorted );
+    res = trp_gc_malloc( sizeof( trp_assoc_item_t * ) * ( obj->len + 1 ) );
+    item = (trp_assoc_item_t **)( obj->table );
+    for ( i = j = 0 ; i < obj->size ; i++ )
+        if ( item[ i ] && ( item[ i ] != TRP_ASSOC_DELETED ) )
+            res[ j++ ] = item[ i ];
+    res[ j ] = NULL;
+    qsort( (void *)res, j, sizeof( trp_assoc_item_t * ), trp_assoc_cmp );
+    obj->sorted = (void *)res;
+    return res;
 }
 
 trp_obj_t *trp_assoc()
@@ -157,112 +350,104 @@ trp_obj_t *trp_assoc()
     obj = trp_gc_malloc( sizeof( trp_assoc_t ) );
     obj->tipo = TRP_ASSOC;
     obj->len = 0;
-    obj->root = NULL;
+    obj->size = 0;
+    obj->used = 0;
+    obj->table = NULL;
+    obj->sorted = NULL;
     return (trp_obj_t *)obj;
 }
 
 uns8b trp_assoc_set( trp_obj_t *obj, trp_obj_t *key, trp_obj_t *val )
 {
-    uns8b *c;
-    trp_assoc_item_t *item;
+    uns8b buf[ TRP_ASSOC_KEYBUF_SIZE ], *c, allocated;
+    uns32b len;
 
     if ( val == UNDEF )
         return trp_assoc_clr( obj, key );
     if ( obj->tipo != TRP_ASSOC )
         return 1;
-    c = trp_csprint( key );
-    if ( ((trp_assoc_t *)obj)->len ) {
-        struct avl_tree_node *node = avl_tree_lookup( (struct avl_tree_node *)(((trp_assoc_t *)obj)->root), (void *)c, trp_assoc_less_l );
-
-        if ( node ) {
-            ((trp_assoc_item_t *)(node->dummy))->val = val;
-            trp_csprint_free( c );
-            return 0;
-        }
-    }
-    item = trp_gc_malloc( sizeof( trp_assoc_item_t ) );
-    item->node.dummy = item;
-    item->key = c;
-    item->val = val;
-    if ( avl_tree_insert( (struct avl_tree_node **)(&(((trp_assoc_t *)obj)->root)), &(item->node), trp_assoc_less_i ) ) {
-        trp_gc_free( item );
-        trp_csprint_free( c );
-        return 1;
-    }
-    ((trp_assoc_t *)obj)->len++;
-    return 0;
+    c = trp_assoc_key( key, buf, &len, &allocated );
+    return trp_assoc_insert( (trp_assoc_t *)obj, c, len, trp_assoc_hash( c, len ), val, allocated );
 }
 
 uns8b trp_assoc_inc( trp_obj_t *obj, trp_obj_t *key, trp_obj_t *val )
 {
-    uns8b *c;
-    struct avl_tree_node *node;
+    uns8b buf[ TRP_ASSOC_KEYBUF_SIZE ], *c, allocated;
+    uns32b len, hash;
+    trp_assoc_item_t *item;
 
     if ( val == UNDEF )
         return trp_assoc_clr( obj, key );
+    if ( obj->tipo != TRP_ASSOC )
+        return 1;
     if ( val == NULL )
         val = UNO;
-    if ( ((trp_assoc_t *)obj)->len == 0 )
-        return trp_assoc_set( obj, key, val );
-    c = trp_csprint( key );
-    node = avl_tree_lookup( (struct avl_tree_node *)(((trp_assoc_t *)obj)->root), (void *)c, trp_assoc_less_l );
-    trp_csprint_free( c );
-    if ( node == NULL )
-        return trp_assoc_set( obj, key, val );
-    val = trp_cat( ((trp_assoc_item_t *)(node->dummy))->val, val, NULL );
+    c = trp_assoc_key( key, buf, &len, &allocated );
+    hash = trp_assoc_hash( c, len );
+    item = *trp_assoc_lookup( (trp_assoc_t *)obj, c, len, hash );
+    if ( item == NULL )
+        return trp_assoc_insert( (trp_assoc_t *)obj, c, len, hash, val, allocated );
+    if ( allocated == 1 )
+        trp_csprint_free( c );
+    val = trp_cat( item->val, val, NULL );
     if ( val != UNDEF )
-        ((trp_assoc_item_t *)(node->dummy))->val = val;
+        item->val = val;
     return 0;
 }
 
 uns8b trp_assoc_clr( trp_obj_t *obj, trp_obj_t *key )
 {
-    uns8b *c;
-    struct avl_tree_node *node;
+    uns8b buf[ TRP_ASSOC_KEYBUF_SIZE ], *c, allocated;
+    uns32b len;
+    trp_assoc_item_t **slot;
 
     if ( obj->tipo != TRP_ASSOC )
         return 1;
     if ( ((trp_assoc_t *)obj)->len == 0 )
         return 0;
-    c = trp_csprint( key );
-    node = avl_tree_lookup( (struct avl_tree_node *)(((trp_assoc_t *)obj)->root), (void *)c, trp_assoc_less_l );
-    trp_csprint_free( c );
-    if ( node == NULL )
+    c = trp_assoc_key( key, buf, &len, &allocated );
+    slot = trp_assoc_lookup( (trp_assoc_t *)obj, c, len, trp_assoc_hash( c, len ) );
+    if ( allocated == 1 )
+        trp_csprint_free( c );
+    if ( *slot == NULL )
         return 0;
-    avl_tree_remove( (struct avl_tree_node **)(&(((trp_assoc_t *)obj)->root)), node );
+    *slot = TRP_ASSOC_DELETED;
     ((trp_assoc_t *)obj)->len--;
+    ((trp_assoc_t *)obj)->sorted = NULL;
     return 0;
 }
 
 trp_obj_t *trp_assoc_get( trp_obj_t *obj, trp_obj_t *key )
 {
-    uns8b *c;
-    struct avl_tree_node *node;
+    uns8b buf[ TRP_ASSOC_KEYBUF_SIZE ], *c, allocated;
+    uns32b len;
+    trp_assoc_item_t *item;
 
     if ( obj->tipo != TRP_ASSOC )
         return UNDEF;
     if ( ((trp_assoc_t *)obj)->len == 0 )
         return UNDEF;
-    c = trp_csprint( key );
-    node = avl_tree_lookup( (struct avl_tree_node *)(((trp_assoc_t *)obj)->root), (void *)c, trp_assoc_less_l );
-    trp_csprint_free( c );
-    if ( node == NULL )
+    c = trp_assoc_key( key, buf, &len, &allocated );
+    item = *trp_assoc_lookup( (trp_assoc_t *)obj, c, len, trp_assoc_hash( c, len ) );
+    if ( allocated == 1 )
+        trp_csprint_free( c );
+    if ( item == NULL )
         return UNDEF;
-    return ((trp_assoc_item_t *)(node->dummy))->val;
+    return item->val;
 }
 
 trp_obj_t *trp_assoc_queue( trp_obj_t *obj )
 {
     trp_obj_t *res;
-    struct avl_tree_node *node;
+    trp_assoc_item_t **item;
+    uns32b i;
 
     if ( obj->tipo != TRP_ASSOC )
         return UNDEF;
-    res= trp_queue();
-    for ( node = avl_tree_first_in_order( (struct avl_tree_node *)(((trp_assoc_t *)obj)->root) ) ;
-          node ;
-          node = avl_tree_next_in_order( node ) )
-        trp_queue_put( res, trp_cons( trp_cord( ((trp_assoc_item_t *)(node->dummy))->key ), ((trp_assoc_item_t *)(node->dummy))->val ) );
+    res = trp_queue();
+    item = trp_assoc_sorted( (trp_assoc_t *)obj );
+    for ( i = 0 ; i < ((trp_assoc_t *)obj)->len ; i++ )
+        trp_queue_put( res, trp_cons( trp_cord( item[ i ]->key ), item[ i ]->val ) );
     return res;
 }
 
@@ -272,6 +457,5 @@ trp_obj_t *trp_assoc_root( trp_obj_t *obj )
         return UNDEF;
     if ( ((trp_assoc_t *)obj)->len == 0 )
         return UNDEF;
-    return trp_cord( ((trp_assoc_item_t *)(avl_tree_first_in_order( (struct avl_tree_node *)(((trp_assoc_t *)obj)->root) )->dummy))->key );
+    return trp_cord( trp_assoc_sorted( (trp_assoc_t *)obj )[ 0 ]->key );
 }
-
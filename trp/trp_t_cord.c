@@ -23,11 +23,6 @@
 
 #include "trp.h"
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
 typedef struct {
     sig32b pos;
     sig32b result;
@@ -41,9 +36,40 @@ typedef struct {
     trp_queue_t q;
 } trp_cord_trim_t;
 
+/*
+ oltre questo numero di celle le matrici complete della
+ programmazione dinamica lasciano il posto alla versione di Hirschberg
+ */
+#define TRP_CORD_DP_MAX_CELLS 4194304
+#define TRP_CORD_HIRSCH_BASE 4096
+
+/*
+ sotto questa lunghezza il pattern è cercato con memchr
+ sul primo carattere, sopra con Horspool
+ */
+#define TRP_CORD_SEARCH_SHORT 8
+
+typedef struct {
+    uns8b *a;
+    uns8b *b;
+    uns8b *ia;
+    uns8b *ib;
+    sig32b *sm;
+    sig32b gap;
+    sig32b *f;
+    sig32b *r;
+    uns32b k;
+    uns8b fail;
+    CORD_ec x1;
+    CORD_ec x2;
+} trp_cord_hirsch_t;
+
 extern void trp_queue_init_internal( trp_queue_t *q );
 
 static trp_obj_t *trp_cord_any2utf8( trp_obj_t *obj, uns8b *tbl );
+static void trp_cord_cpat_init( trp_cpat_t *cp, uns8b flags, uns8b *p, uns32b len );
+static uns8b trp_cord_cpat_scan( trp_cpat_t *cp, uns8b *t, uns32b n, uns32b lim, uns32b base, uns32b *pos, uns32b *nth, uns8b *res );
+static uns8b trp_cord_cpat_search( trp_cpat_t *cp, trp_cord_t *s, uns32b *pos, uns32b nth );
 static uns8b trp_cord_search_internal( uns8b flags, trp_obj_t *obj, trp_obj_t *s, uns32b *pos, uns32b nth );
 static int trp_cord_match_pre_cback( uns8b c, trp_cord_match_t *m );
 static int trp_cord_match_cback( uns8b c, trp_cord_match_t *m );
@@ -53,9 +79,20 @@ static void trp_cord_match_clear( trp_cord_match_t *m );
 static int trp_cord_trim_cback( uns8b c, trp_cord_trim_t *m );
 static trp_obj_t *trp_cord_trim_internal( uns8b flags, trp_obj_t *s, va_list args );
 static trp_obj_t *trp_cord_max_fix_basic( uns8b flags, trp_obj_t *s1, trp_obj_t *s2 );
+static uns8b *trp_cord_flat( trp_obj_t *s );
+static uns32b trp_cord_popcount( uns64b x );
+static uns64b *trp_cord_peq( uns8b *p, uns32b m, uns32b extra );
+static uns32b trp_cord_myers( uns8b *p, uns32b m, uns8b *t, uns32b n, uns32b k );
+static uns32b trp_cord_lcs_bitpar( uns8b *p, uns32b m, uns8b *t, uns32b n );
+static void trp_cord_hirsch_emit( trp_cord_hirsch_t *h, uns8b c1, uns8b c2, uns8b diag );
+static void trp_cord_hirsch_row( trp_cord_hirsch_t *h, uns32b a0, uns32b a1, uns32b b0, uns32b b1, sig32b *row, uns8b rev );
+static sig32b trp_cord_hirsch_base( trp_cord_hirsch_t *h, uns32b a0, uns32b a1, uns32b b0, uns32b b1 );
+static sig32b trp_cord_hirsch( trp_cord_hirsch_t *h, uns32b a0, uns32b a1, uns32b b0, uns32b b1 );
+static uns8b trp_cord_hirsch_run( trp_cord_hirsch_t *h, uns8b *a, uns32b n1, uns8b *b, uns32b n2, sig32b *sm, sig32b gap, sig32b *score );
 static uns8b trp_cord_decode_scoring_matrix( trp_obj_t *scoring_matrix, sig32b *sm );
 static sig32b trp_cord_amino_index( uns8b amino );
 static trp_obj_t *trp_cord_alignment_score_low( trp_obj_t *s1, trp_obj_t *s2, trp_obj_t *gap_opening_penalty, trp_obj_t *gap_extension_penalty, trp_obj_t *scoring_matrix );
+static uns8b trp_cord_global_alignment_score_linear( uns8b flags, uns8b *a, uns32b n1, uns8b *b, uns32b n2, sig32b gap_p, sig32b gap_e, sig32b *sm, sig32b *score );
 static uns8b trp_cord_global_alignment_affine_low( uns8b flags, trp_obj_t *s1, trp_obj_t *s2, trp_obj_t *gap_opening_penalty, trp_obj_t *gap_extension_penalty, sig32b *sm, sig32b *score, trp_obj_t **as1, trp_obj_t **as2 );
 static uns8b trp_cord_local_alignment_affine_low( trp_obj_t *s1, trp_obj_t *s2, trp_obj_t *gap_opening_penalty, trp_obj_t *gap_extension_penalty, sig32b *sm, sig32b *score, trp_obj_t **as1, trp_obj_t **as2 );
 
@@ -385,24 +422,14 @@ trp_obj_t *trp_cord_cat( trp_cord_t *obj, va_list args )
 
 uns8b trp_cord_in( trp_obj_t *obj, trp_cord_t *seq, uns32b *pos, uns32b nth )
 {
-    uns32b i = 0;
-    uns8b res = 1, d;
-    CORD_pos j;
+    trp_cpat_t cp;
+    uns8b d;
 
     if ( obj->tipo != TRP_CHAR )
         return trp_cord_search_internal( 0, obj, (trp_obj_t *)seq, pos, nth );
     d = ((trp_char_t *)obj)->c;
-    CORD_FOR( j, seq->c ) {
-        if ( CORD_pos_fetch( j ) == d ) {
-            res = 0;
-            *pos = i;
-            if ( nth == 0 )
-                break;
-            nth--;
-        }
-        i++;
-    }
-    return res;
+    trp_cord_cpat_init( &cp, 0, &d, 1 );
+    return trp_cord_cpat_search( &cp, seq, pos, nth );
 }
 
 trp_obj_t *trp_cord_reverse( trp_cord_t * obj )
@@ -701,88 +728,215 @@ trp_obj_t *trp_cord_str2num( trp_obj_t *obj )
     return res;
 }
 
-static uns8b trp_cord_search_internal( uns8b flags, trp_obj_t *obj, trp_obj_t *s, uns32b *pos, uns32b nth )
+/*
+ la ricerca lavora direttamente sulle foglie del cord; le
+ occorrenze a cavallo di due foglie sono cercate in un piccolo
+ buffer che contiene le ultime len-1 posizioni già viste;
+ per pattern corti si usa memchr sul primo carattere,
+ per quelli lunghi (o se si ignorano le maiuscole) Horspool
+ */
+
+static void trp_cord_cpat_init( trp_cpat_t *cp, uns8b flags, uns8b *p, uns32b len )
+{
+    uns32b i;
+
+    cp->tipo = TRP_CPAT;
+    cp->flags = flags;
+    cp->len = len;
+    cp->p = p;
+    cp->src = NULL;
+    if ( flags || ( len >= TRP_CORD_SEARCH_SHORT ) ) {
+        for ( i = 0 ; i < 256 ; i++ )
+            cp->shift[ i ] = len;
+        for ( i = 0 ; i + 1 < len ; i++ )
+            cp->shift[ p[ i ] ] = len - 1 - i;
+    }
+}
+
+static uns8b trp_cord_cpat_scan( trp_cpat_t *cp, uns8b *t, uns32b n, uns32b lim, uns32b base, uns32b *pos, uns32b *nth, uns8b *res )
+{
+    uns8b *p = cp->p, *q, c;
+    uns32b m = cp->len, last, i, k;
+
+    if ( ( n < m ) || ( lim == 0 ) )
+        return 0;
+    last = n - m;
+    if ( last > lim - 1 )
+        last = lim - 1;
+    if ( ( cp->flags == 0 ) && ( m < TRP_CORD_SEARCH_SHORT ) ) {
+        for ( i = 0 ; i <= last ; i++ ) {
+            if ( ( q = memchr( t + i, p[ 0 ], last - i + 1 ) ) == NULL )
+                break;
+            i = (uns32b)( q - t );
+            if ( memcmp( q + 1, p + 1, m - 1 ) == 0 ) {
+                *pos = base + i;
+                *res = 0;
+                if ( *nth == 0 )
+                    return 1;
+                (*nth)--;
+            }
+        }
+        return 0;
+    }
+    for ( i = 0 ; i <= last ; ) {
+        c = t[ i + m - 1 ];
+        if ( cp->flags )
+            c = trp_upcase( c );
+        if ( c == p[ m - 1 ] ) {
+            if ( cp->flags ) {
+                for ( k = 0 ; k + 1 < m ; k++ )
+                    if ( trp_upcase( t[ i + k ] ) != p[ k ] )
+                        break;
+            } else
+                k = memcmp( t + i, p, m - 1 ) ? 0 : m - 1;
+            if ( k + 1 == m ) {
+                *pos = base + i;
+                *res = 0;
+                if ( *nth == 0 )
+                    return 1;
+                (*nth)--;
+            }
+        }
+        i += cp->shift[ c ];
+    }
+    return 0;
+}
+
+static uns8b trp_cord_cpat_search( trp_cpat_t *cp, trp_cord_t *s, uns32b *pos, uns32b nth )
 {
-    uns32b pl, pi, pe, i, x, y;
-    int fl;
-    uns8b *p, *q, cs, res = 1;
     CORD_pos j;
+    uns8b *buf = NULL, *t, cs, res = 1;
+    uns32b m = cp->len, keep = 0, off = 0, k, r;
+    long l;
 
-    if ( ( obj->tipo != TRP_CORD ) ||
-         ( s->tipo != TRP_CORD ) )
-        return 1;
-    pl = ((trp_cord_t *)obj)->len;
-    if ( pl == 0 ) {
+    if ( m == 0 ) {
         *pos = 0;
         return 0;
     }
-
-    if (  pl > ((trp_cord_t *)s)->len )
+    if ( m > s->len )
         return 1;
-
-    p = trp_gc_malloc_atomic( pl );
-    q = trp_gc_malloc_atomic( pl );
-    i = 0;
-    CORD_FOR( j, ((trp_cord_t *)obj)->c ) {
-        cs =  CORD_pos_fetch( j );
-        if ( flags )
-            cs = trp_upcase( cs );
-        q[ i++ ] = cs;
-    }
-    i = 1;
-    x = 0;
-    pi = 0;
-    pe = 0;
-    CORD_FOR( j, ((trp_cord_t *)s)->c ) {
-        cs =  CORD_pos_fetch( j );
-        if ( flags )
-            cs = trp_upcase( cs );
-        p[ pi++ ] = cs; if ( pi == pl ) pi = 0;
-        if ( cs == q[ x ] ) {
-            x++;
-            if ( x == pl ) {
-                *pos = i - pl;
-                res = 0;
-                if ( nth == 0 )
-                    break;
-                nth--;
-                fl = 1;
-                x--;
-                pe++; if ( pe == pl ) pe = 0;
-            } else {
-                fl = 0;
-            }
+    if ( CORD_IS_STRING( s->c ) ) {
+        (void)trp_cord_cpat_scan( cp, (uns8b *)( s->c ), s->len, s->len, 0, pos, &nth, &res );
+        return res;
+    }
+    if ( m > 1 )
+        if ( ( buf = malloc( ( m - 1 ) << 1 ) ) == NULL )
+            return 1;
+    CORD_set_pos( j, s->c, 0 );
+    while ( CORD_pos_valid( j ) ) {
+        if ( ( l = CORD_pos_chars_left( j ) ) > 0 ) {
+            t = (uns8b *)CORD_pos_cur_char_addr( j );
+            k = (uns32b)l;
         } else {
-            x++;
-            fl = 1;
+            cs = CORD_pos_fetch( j );
+            t = &cs;
+            k = 1;
         }
-        if ( fl ) {
-            if ( x > 1 ) {
-                x--;
-                pe++; if ( pe == pl ) pe = 0;
-            }
-            for ( ; ; ) {
-                fl = 1;
-                for ( y = 0 ; y < x ; y++ )
-                    if ( p[ ( y + pe ) % pl ] != q[ y ] ) {
-                        fl = 0;
-                        break;
-                    }
-                if ( fl )
-                    break;
-                x--;
-                pe++; if ( pe == pl ) pe = 0;
-                if ( x == 0 )
-                    break;
+        if ( keep ) {
+            r = ( k < m - 1 ) ? k : m - 1;
+            memcpy( buf + keep, t, r );
+            if ( trp_cord_cpat_scan( cp, buf, keep + r, keep, off - keep, pos, &nth, &res ) )
+                break;
+        }
+        if ( trp_cord_cpat_scan( cp, t, k, k, off, pos, &nth, &res ) )
+            break;
+        if ( m > 1 ) {
+            if ( k >= m - 1 ) {
+                memcpy( buf, t + k - ( m - 1 ), m - 1 );
+                keep = m - 1;
+            } else {
+                if ( keep == 0 )
+                    memcpy( buf, t, k );
+                r = keep + k;
+                keep = ( r < m - 1 ) ? r : m - 1;
+                memmove( buf, buf + r - keep, keep );
             }
         }
+        off += k;
+        if ( t == &cs ) {
+            CORD_next( j );
+        } else {
+            CORD_pos_advance( j, k );
+        }
+    }
+    free( buf );
+    return res;
+}
+
+static uns8b trp_cord_search_internal( uns8b flags, trp_obj_t *obj, trp_obj_t *s, uns32b *pos, uns32b nth )
+{
+    trp_cpat_t cp;
+    CORD_pos j;
+    uns8b *p = NULL, res;
+    uns32b i;
+
+    if ( s->tipo != TRP_CORD )
+        return 1;
+    if ( obj->tipo == TRP_CPAT ) {
+        /*
+         compilato con l'altro flag: si riparte dal pattern originale
+         */
+        if ( ( flags ? 1 : 0 ) != ((trp_cpat_t *)obj)->flags )
+            return trp_cord_search_internal( flags, ((trp_cpat_t *)obj)->src, s, pos, nth );
+        return trp_cord_cpat_search( (trp_cpat_t *)obj, (trp_cord_t *)s, pos, nth );
+    }
+    if ( obj->tipo != TRP_CORD )
+        return 1;
+    if ( ( ((trp_cord_t *)obj)->len == 0 ) ||
+         ( ( flags == 0 ) && CORD_IS_STRING( ((trp_cord_t *)obj)->c ) ) ) {
+        trp_cord_cpat_init( &cp, flags, (uns8b *)( ((trp_cord_t *)obj)->c ), ((trp_cord_t *)obj)->len );
+        return trp_cord_cpat_search( &cp, (trp_cord_t *)s, pos, nth );
+    }
+    if ( ((trp_cord_t *)obj)->len > ((trp_cord_t *)s)->len )
+        return 1;
+    if ( ( p = malloc( ((trp_cord_t *)obj)->len ) ) == NULL )
+        return 1;
+    i = 0;
+    CORD_FOR( j, ((trp_cord_t *)obj)->c ) {
+        p[ i ] = CORD_pos_fetch( j );
+        if ( flags )
+            p[ i ] = trp_upcase( p[ i ] );
         i++;
     }
-    trp_gc_free( q );
-    trp_gc_free( p );
+    trp_cord_cpat_init( &cp, flags, p, i );
+    res = trp_cord_cpat_search( &cp, (trp_cord_t *)s, pos, nth );
+    free( p );
     return res;
 }
 
+trp_obj_t *trp_cord_search_compile( uns8b flags, trp_obj_t *obj )
+{
+    trp_cpat_t *cp;
+    uns8b *p;
+    CORD_pos j;
+    uns32b i;
+
+    if ( obj->tipo == TRP_CPAT ) {
+        if ( ( flags ? 1 : 0 ) == ((trp_cpat_t *)obj)->flags )
+            return obj;
+        obj = ((trp_cpat_t *)obj)->src;
+    }
+    if ( obj->tipo != TRP_CORD )
+        return UNDEF;
+    if ( ( flags == 0 ) && ((trp_cord_t *)obj)->len && CORD_IS_STRING( ((trp_cord_t *)obj)->c ) ) {
+        p = (uns8b *)( ((trp_cord_t *)obj)->c );
+    } else {
+        p = trp_gc_malloc_atomic( ((trp_cord_t *)obj)->len + 1 );
+        i = 0;
+        CORD_FOR( j, ((trp_cord_t *)obj)->c ) {
+            p[ i ] = CORD_pos_fetch( j );
+            if ( flags )
+                p[ i ] = trp_upcase( p[ i ] );
+            i++;
+        }
+        p[ i ] = 0;
+    }
+    cp = trp_gc_malloc( sizeof( trp_cpat_t ) );
+    trp_cord_cpat_init( cp, flags ? 1 : 0, p, ((trp_cord_t *)obj)->len );
+    cp->src = obj;
+    return (trp_obj_t *)cp;
+}
+
 trp_obj_t *trp_cord_search_func( uns8b flags, trp_obj_t *obj, trp_obj_t *s )
 {
     uns32b p;
@@ -989,12 +1143,10 @@ uns8b trp_cord_match_test( uns8b flags, trp_obj_t **which, trp_obj_t **which_idx
 static int trp_cord_trim_cback( uns8b c, trp_cord_trim_t *m )
 {
     int res = 1;
-    trp_queue_elem *elem;
+    uns32b i;
 
-    for ( elem = (trp_queue_elem *)( m->q.first ) ;
-          elem ;
-          elem = (trp_queue_elem *)( elem->next ) )
-        if ( ((trp_char_t *)elem->val)->c == c ) {
+    for ( i = 0 ; i < m->q.len ; i++ )
+        if ( ((trp_char_t *)trp_queue_nth( i, &( m->q ) ))->c == c ) {
             m->cnt = m->cnt + 1;
             res = 0;
             break;
@@ -1541,44 +1693,348 @@ trp_obj_t *trp_cord_hamming_distance( trp_obj_t *s1, trp_obj_t *s2 )
     return trp_sig64( cnt );
 }
 
+/*
+ i testi sono appiattiti una volta sola in buffer contigui
+ */
+
+static uns8b *trp_cord_flat( trp_obj_t *s )
+{
+    return (uns8b *)CORD_to_const_char_star( ((trp_cord_t *)s)->c );
+}
+
+static uns32b trp_cord_popcount( uns64b x )
+{
+#ifdef __GNUC__
+    return (uns32b)__builtin_popcountll( x );
+#else
+    uns32b n;
+
+    for ( n = 0 ; x ; n++ )
+        x &= x - 1;
+    return n;
+#endif
+}
+
+/*
+ per ciascun carattere c, la maschera (a blocchi di 64 bit)
+ delle posizioni di p in cui compare c; seguono extra blocchi azzerati
+ */
+
+static uns64b *trp_cord_peq( uns8b *p, uns32b m, uns32b extra )
+{
+    uns64b *peq;
+    uns32b w = ( m + 63 ) >> 6, i;
+
+    if ( ( peq = calloc( 256 * w + extra * w, sizeof( uns64b ) ) ) == NULL )
+        return NULL;
+    for ( i = 0 ; i < m ; i++ )
+        peq[ p[ i ] * w + ( i >> 6 ) ] |= ( (uns64b)1 ) << ( i & 63 );
+    return peq;
+}
+
+/*
+ distanza di edit bit-parallela (Myers/Hyyrö) fra p (m > 0) e t,
+ in O(n * m / 64) e con memoria lineare;
+ se la distanza supera sicuramente k si esce subito e si ritorna k + 1;
+ 0xffffffff se manca la memoria
+ */
+
+static uns32b trp_cord_myers( uns8b *p, uns32b m, uns8b *t, uns32b n, uns32b k )
+{
+    uns64b *peq, *pv, *mv, *e, eq, xv, xh, ph, mh, high, last;
+    uns32b w = ( m + 63 ) >> 6, score = m, i, j;
+    int hin, hout;
+
+    if ( ( peq = trp_cord_peq( p, m, 2 ) ) == NULL )
+        return 0xffffffff;
+    pv = peq + 256 * w;
+    mv = pv + w;
+    for ( i = 0 ; i < w ; i++ )
+        pv[ i ] = ~( (uns64b)0 );
+    last = ( (uns64b)1 ) << ( ( m - 1 ) & 63 );
+    for ( j = 0 ; j < n ; j++ ) {
+        e = peq + t[ j ] * w;
+        for ( i = 0, hin = 1 ; i < w ; i++, hin = hout ) {
+            high = ( i == w - 1 ) ? last : ( ( (uns64b)1 ) << 63 );
+            eq = e[ i ];
+            xv = eq | mv[ i ];
+            if ( hin < 0 )
+                eq |= 1;
+            xh = ( ( ( eq & pv[ i ] ) + pv[ i ] ) ^ pv[ i ] ) | eq;
+            ph = mv[ i ] | ~( xh | pv[ i ] );
+            mh = pv[ i ] & xh;
+            hout = ( ph & high ) ? 1 : ( ( mh & high ) ? -1 : 0 );
+            ph <<= 1;
+            mh <<= 1;
+            if ( hin < 0 )
+                mh |= 1;
+            else if ( hin > 0 )
+                ph |= 1;
+            pv[ i ] = mh | ~( xv | ph );
+            mv[ i ] = ph & xv;
+        }
+        score += hin;
+        /*
+         ogni colonna rimasta può abbassare la distanza al più di 1
+         */
+        if ( (uns64b)score > (uns64b)k + ( n - j - 1 ) ) {
+            score = k + 1;
+            break;
+        }
+    }
+    free( peq );
+    return score;
+}
+
+/*
+ lunghezza della LCS bit-parallela (Allison-Dix/Hyyrö):
+ v' = ( v + u ) | ( v - u ) con u = v & peq[ c ]; la sottrazione
+ non ha prestiti (u è contenuto in v), l'addizione propaga il riporto
+ */
+
+static uns32b trp_cord_lcs_bitpar( uns8b *p, uns32b m, uns8b *t, uns32b n )
+{
+    uns64b *peq, *v, *e, u, x, y, carry;
+    uns32b w = ( m + 63 ) >> 6, res, i, j;
+
+    if ( ( peq = trp_cord_peq( p, m, 1 ) ) == NULL )
+        return 0xffffffff;
+    v = peq + 256 * w;
+    for ( i = 0 ; i < w ; i++ )
+        v[ i ] = ~( (uns64b)0 );
+    for ( j = 0 ; j < n ; j++ ) {
+        e = peq + t[ j ] * w;
+        for ( i = 0, carry = 0 ; i < w ; i++ ) {
+            u = v[ i ] & e[ i ];
+            x = v[ i ] + u;
+            y = x + carry;
+            carry = ( ( x < u ) || ( y < x ) ) ? 1 : 0;
+            v[ i ] = y | ( v[ i ] & ~u );
+        }
+    }
+    for ( i = 0, res = 0 ; i + 1 < w ; i++ )
+        res += 64 - trp_cord_popcount( v[ i ] );
+    res += ( ( m - 1 ) & 63 ) + 1 - trp_cord_popcount( v[ w - 1 ] & ( ~( (uns64b)0 ) >> ( 63 - ( ( m - 1 ) & 63 ) ) ) );
+    free( peq );
+    return res;
+}
+
 trp_obj_t *trp_cord_edit_distance( trp_obj_t *s1, trp_obj_t *s2 )
 {
-#   define ed(i1,i2) edit[(i1)*n2p+(i2)]
-    uns32b d, t, j1, j2, n1, n2, n1p, n2p, *edit;
-    CORD_pos i1, i2;
+    uns32b n1, n2, d;
 
     if ( ( s1->tipo != TRP_CORD ) || ( s2->tipo != TRP_CORD ) )
         return UNDEF;
     n1 = ((trp_cord_t *)s1)->len;
     n2 = ((trp_cord_t *)s2)->len;
-    n1p = n1 + 1;
-    n2p = n2 + 1;
-    if ( ( edit = malloc( n1p * n2p * sizeof( uns32b ) ) ) == NULL )
+    if ( ( n1 == 0 ) || ( n2 == 0 ) )
+        return trp_sig64( n1 + n2 );
+    d = ( n1 <= n2 )
+        ? trp_cord_myers( trp_cord_flat( s1 ), n1, trp_cord_flat( s2 ), n2, 0xffffffff )
+        : trp_cord_myers( trp_cord_flat( s2 ), n2, trp_cord_flat( s1 ), n1, 0xffffffff );
+    if ( d == 0xffffffff )
         return UNDEF;
-    for ( j1 = 0 ; j1 <= n1 ; j1++ )
-        ed( j1, 0 ) = j1;
-    for ( j2 = 1 ; j2 <= n2 ; j2++ )
-        ed( 0, j2 ) = j2;
-    for ( CORD_set_pos( i1, ((trp_cord_t *)s1)->c, 0 ), j1 = 1 ;
-          j1 <= n1 ;
-          CORD_next( i1 ), j1++ )
-        for ( CORD_set_pos( i2, ((trp_cord_t *)s2)->c, 0 ), j2 = 1 ;
-              j2 <= n2 ;
-              CORD_next( i2 ), j2++ ) {
-            d = ed( j1 - 1, j2 ) + 1;
-            t = ed( j1, j2 - 1 ) + 1;
-            if ( t < d )
-                d = t;
-            t = ed( j1 - 1, j2 - 1 ) + ( ( CORD_pos_fetch( i1 ) == CORD_pos_fetch( i2 ) ) ? 0 : 1 );
-            if ( t < d )
-                d = t;
-            ed( j1, j2 ) = d;
-        }
-    d = ed( n1, n2 );
-    free( edit );
     return trp_sig64( d );
 }
 
+/*
+ come trp_cord_edit_distance, ma ritorna UNDEF appena
+ si sa che la distanza è maggiore di k
+ */
+
+trp_obj_t *trp_cord_edit_distance_bounded( trp_obj_t *s1, trp_obj_t *s2, trp_obj_t *k )
+{
+    uns32b n1, n2, kk, d;
+
+    if ( ( s1->tipo != TRP_CORD ) || ( s2->tipo != TRP_CORD ) ||
+         trp_cast_uns32b_range( k, &kk, 0, 0xfffffffe ) )
+        return UNDEF;
+    n1 = ((trp_cord_t *)s1)->len;
+    n2 = ((trp_cord_t *)s2)->len;
+    d = ( n1 <= n2 ) ? n2 - n1 : n1 - n2;
+    if ( d > kk )
+        return UNDEF;
+    if ( ( n1 == 0 ) || ( n2 == 0 ) )
+        return trp_sig64( d );
+    d = ( n1 <= n2 )
+        ? trp_cord_myers( trp_cord_flat( s1 ), n1, trp_cord_flat( s2 ), n2, kk )
+        : trp_cord_myers( trp_cord_flat( s2 ), n2, trp_cord_flat( s1 ), n1, kk );
+    if ( d > kk )
+        return UNDEF;
+    return trp_sig64( d );
+}
+
+/*
+ allineamento globale in spazio lineare (Hirschberg), con costo
+ dei gap lineare; se sm è NULL si calcola la LCS (match 1,
+ mismatch -1, gap 0) e in x1 si accumulano solo i caratteri comuni;
+ diag distingue le coppie allineate dai gap ('-' può essere un carattere vero)
+ */
+
+static void trp_cord_hirsch_emit( trp_cord_hirsch_t *h, uns8b c1, uns8b c2, uns8b diag )
+{
+    if ( h->sm ) {
+        CORD_ec_append( h->x1, c1 );
+        CORD_ec_append( h->x2, c2 );
+        h->k++;
+    } else if ( diag && ( c1 == c2 ) ) {
+        CORD_ec_append( h->x1, c1 );
+        h->k++;
+    }
+}
+
+#define trp_cord_hirsch_score(h,i,j) ((h)->sm ? (h)->sm[(h)->ia[i]*20+(h)->ib[j]] : (((h)->a[i]==(h)->b[j])?1:-1))
+
+/*
+ ultima riga della matrice per a[a0,a1) contro b[b0,b1)
+ (oppure per le due sottostringhe rovesciate se rev)
+ */
+
+static void trp_cord_hirsch_row( trp_cord_hirsch_t *h, uns32b a0, uns32b a1, uns32b b0, uns32b b1, sig32b *row, uns8b rev )
+{
+    uns32b m = b1 - b0, i, j, ii;
+    sig32b diag, up, v, t;
+
+    for ( j = 0 ; j <= m ; j++ )
+        row[ j ] = -(sig32b)j * h->gap;
+    for ( i = 0 ; i < a1 - a0 ; i++ ) {
+        ii = rev ? a1 - 1 - i : a0 + i;
+        diag = row[ 0 ];
+        row[ 0 ] -= h->gap;
+        for ( j = 1 ; j <= m ; j++ ) {
+            up = row[ j ];
+            v = diag + trp_cord_hirsch_score( h, ii, rev ? b1 - j : b0 + j - 1 );
+            if ( ( t = up - h->gap ) > v )
+                v = t;
+            if ( ( t = row[ j - 1 ] - h->gap ) > v )
+                v = t;
+            row[ j ] = v;
+            diag = up;
+        }
+    }
+}
+
+/*
+ caso base: matrice completa (piccola, oppure con una sola riga)
+ */
+
+static sig32b trp_cord_hirsch_base( trp_cord_hirsch_t *h, uns32b a0, uns32b a1, uns32b b0, uns32b b1 )
+{
+#   define hg(i,j) grid[(i)*(m+1)+(j)]
+#   define hm(i,j) gridmov[(i)*(m+1)+(j)]
+    uns32b n = a1 - a0, m = b1 - b0, i, j, l;
+    sig32b *grid, v, t, res;
+    uns8b *gridmov, *o, mov;
+
+    if ( ( grid = malloc( ( n + 1 ) * ( m + 1 ) * ( sizeof( sig32b ) + 1 ) + 3 * ( n + m ) ) ) == NULL ) {
+        h->fail = 1;
+        return 0;
+    }
+    gridmov = (uns8b *)( grid + ( n + 1 ) * ( m + 1 ) );
+    o = gridmov + ( n + 1 ) * ( m + 1 );
+    for ( j = 0 ; j <= m ; j++ ) {
+        hg( 0, j ) = -(sig32b)j * h->gap;
+        hm( 0, j ) = '<';
+    }
+    for ( i = 1 ; i <= n ; i++ ) {
+        hg( i, 0 ) = -(sig32b)i * h->gap;
+        hm( i, 0 ) = '^';
+        for ( j = 1 ; j <= m ; j++ ) {
+            v = hg( i - 1, j - 1 ) + trp_cord_hirsch_score( h, a0 + i - 1, b0 + j - 1 );
+            mov = '\\';
+            if ( ( t = hg( i - 1, j ) - h->gap ) > v ) {
+                v = t;
+                mov = '^';
+            }
+            if ( ( t = hg( i, j - 1 ) - h->gap ) > v ) {
+                v = t;
+                mov = '<';
+            }
+            hg( i, j ) = v;
+            hm( i, j ) = mov;
+        }
+    }
+    res = hg( n, m );
+    for ( i = n, j = m, l = 0 ; i || j ; l++ ) {
+        mov = hm( i, j );
+        if ( mov == '^' ) {
+            i--;
+            o[ 3 * l ] = h->a[ a0 + i ];
+            o[ 3 * l + 1 ] = '-';
+            o[ 3 * l + 2 ] = 0;
+        } else if ( mov == '<' ) {
+            j--;
+            o[ 3 * l ] = '-';
+            o[ 3 * l + 1 ] = h->b[ b0 + j ];
+            o[ 3 * l + 2 ] = 0;
+        } else {
+            i--;
+            j--;
+            o[ 3 * l ] = h->a[ a0 + i ];
+            o[ 3 * l + 1 ] = h->b[ b0 + j ];
+            o[ 3 * l + 2 ] = 1;
+        }
+    }
+    while ( l ) {
+        l--;
+        trp_cord_hirsch_emit( h, o[ 3 * l ], o[ 3 * l + 1 ], o[ 3 * l + 2 ] );
+    }
+    free( grid );
+    return res;
+#   undef hg
+#   undef hm
+}
+
+static sig32b trp_cord_hirsch( trp_cord_hirsch_t *h, uns32b a0, uns32b a1, uns32b b0, uns32b b1 )
+{
+    uns32b n = a1 - a0, m = b1 - b0, mid, j, bj;
+    sig32b best, t;
+
+    if ( h->fail )
+        return 0;
+    if ( ( n <= 1 ) || ( m == 0 ) || ( (uns64b)n * (uns64b)m <= TRP_CORD_HIRSCH_BASE ) )
+        return trp_cord_hirsch_base( h, a0, a1, b0, b1 );
+    mid = a0 + ( n >> 1 );
+    trp_cord_hirsch_row( h, a0, mid, b0, b1, h->f, 0 );
+    trp_cord_hirsch_row( h, mid, a1, b0, b1, h->r, 1 );
+    for ( j = 0, bj = 0, best = h->f[ 0 ] + h->r[ m ] ; j <= m ; j++ )
+        if ( ( t = h->f[ j ] + h->r[ m - j ] ) > best ) {
+            best = t;
+            bj = j;
+        }
+    (void)trp_cord_hirsch( h, a0, mid, b0, b0 + bj );
+    (void)trp_cord_hirsch( h, mid, a1, b0 + bj, b1 );
+    return best;
+}
+
+static uns8b trp_cord_hirsch_run( trp_cord_hirsch_t *h, uns8b *a, uns32b n1, uns8b *b, uns32b n2, sig32b *sm, sig32b gap, sig32b *score )
+{
+    uns32b i;
+
+    h->a = a;
+    h->b = b;
+    h->sm = sm;
+    h->gap = gap;
+    h->k = 0;
+    h->fail = 0;
+    if ( ( h->f = malloc( 2 * ( n2 + 1 ) * sizeof( sig32b ) + ( sm ? n1 + n2 : 0 ) ) ) == NULL )
+        return 1;
+    h->r = h->f + n2 + 1;
+    if ( sm ) {
+        h->ia = (uns8b *)( h->r + n2 + 1 );
+        h->ib = h->ia + n1;
+        for ( i = 0 ; i < n1 ; i++ )
+            h->ia[ i ] = (uns8b)trp_cord_amino_index( a[ i ] );
+        for ( i = 0 ; i < n2 ; i++ )
+            h->ib[ i ] = (uns8b)trp_cord_amino_index( b[ i ] );
+    }
+    CORD_ec_init( h->x1 );
+    CORD_ec_init( h->x2 );
+    *score = trp_cord_hirsch( h, 0, n1, 0, n2 );
+    free( h->f );
+    return h->fail;
+}
+
 static uns8b trp_cord_decode_scoring_matrix( trp_obj_t *scoring_matrix, sig32b *sm )
 {
     if ( scoring_matrix ) {
@@ -1726,6 +2182,14 @@ trp_obj_t *trp_cord_lcs( trp_obj_t *s1, trp_obj_t *s2 )
     n2 = ((trp_cord_t *)s2)->len;
     n1p = n1 + 1;
     n2p = n2 + 1;
+    if ( (uns64b)n1p * (uns64b)n2p > TRP_CORD_DP_MAX_CELLS ) {
+        trp_cord_hirsch_t h;
+        sig32b score;
+
+        if ( trp_cord_hirsch_run( &h, trp_cord_flat( s1 ), n1, trp_cord_flat( s2 ), n2, NULL, 0, &score ) )
+            return UNDEF;
+        return trp_cord_cons( CORD_balance( CORD_ec_to_cord( h.x1 ) ), h.k );
+    }
     if ( ( gridmov = malloc( n1p * n2p * ( sizeof( uns8b ) + sizeof( uns32b ) ) ) ) == NULL )
         return UNDEF;
     gridlen = (uns32b *)( gridmov + n1p * n2p );
@@ -1786,40 +2250,84 @@ trp_obj_t *trp_cord_lcs( trp_obj_t *s1, trp_obj_t *s2 )
 
 trp_obj_t *trp_cord_lcs_length( trp_obj_t *s1, trp_obj_t *s2 )
 {
-#   define grl(i1,i2) gridlen[(i1)*n2p+(i2)]
-    uns32b left, over, j1, j2, n1, n2, n1p, n2p, *gridlen;
-    CORD_pos i1, i2;
+    uns32b n1, n2, l;
 
     if ( ( s1->tipo != TRP_CORD ) || ( s2->tipo != TRP_CORD ) )
         return UNDEF;
     n1 = ((trp_cord_t *)s1)->len;
     n2 = ((trp_cord_t *)s2)->len;
-    n1p = n1 + 1;
-    n2p = n2 + 1;
-    if ( ( gridlen = malloc( n1p * n2p * sizeof( uns32b ) ) ) == NULL )
+    if ( ( n1 == 0 ) || ( n2 == 0 ) )
+        return trp_sig64( 0 );
+    l = ( n1 <= n2 )
+        ? trp_cord_lcs_bitpar( trp_cord_flat( s1 ), n1, trp_cord_flat( s2 ), n2 )
+        : trp_cord_lcs_bitpar( trp_cord_flat( s2 ), n2, trp_cord_flat( s1 ), n1 );
+    if ( l == 0xffffffff )
         return UNDEF;
-    grl( 0, 0 ) = 0;
-    for ( j2 = 1 ; j2 <= n2 ; j2++ )
-        grl( 0, j2 ) = 0;
-    for ( CORD_set_pos( i1, ((trp_cord_t *)s1)->c, 0 ), j1 = 1 ;
-          j1 <= n1 ;
-          CORD_next( i1 ), j1++ ) {
-        grl( j1, 0 ) = 0;
-        for ( CORD_set_pos( i2, ((trp_cord_t *)s2)->c, 0 ), j2 = 1 ;
-              j2 <= n2 ;
-              CORD_next( i2 ), j2++ ) {
-            if ( CORD_pos_fetch( i1 ) == CORD_pos_fetch( i2 ) ) {
-                grl( j1, j2 ) = grl( j1 - 1, j2 - 1 ) + 1;
-            } else {
-                left = grl( j1, j2 - 1 );
-                over = grl( j1 - 1, j2 );
-                grl( j1, j2 ) = ( left < over ) ? over : left;
-            }
+    return trp_sig64( l );
+}
+
+/*
+ solo il punteggio, tenendo due righe della matrice
+ */
+
+static uns8b trp_cord_global_alignment_score_linear( uns8b flags, uns8b *a, uns32b n1, uns8b *b, uns32b n2, sig32b gap_p, sig32b gap_e, sig32b *sm, sig32b *score )
+{
+    sig32b *buf, *prevl, *prevg1, *curl, *curg1, *tmp, *sm1, k, g2, sc, bsc, t;
+    uns32b j1, j2;
+    uns8b *ib;
+
+    if ( ( buf = malloc( 4 * ( n2 + 1 ) * sizeof( sig32b ) + n2 ) ) == NULL )
+        return 1;
+    prevl = buf;
+    prevg1 = prevl + n2 + 1;
+    curl = prevg1 + n2 + 1;
+    curg1 = curl + n2 + 1;
+    ib = (uns8b *)( curg1 + n2 + 1 );
+    for ( j2 = 0 ; j2 < n2 ; j2++ )
+        ib[ j2 ] = (uns8b)trp_cord_amino_index( b[ n2 - 1 - j2 ] );
+    prevl[ 0 ] = 0;
+    for ( k = gap_e, j2 = 1 ; j2 <= n2 ; j2++, k += gap_e ) {
+        prevl[ j2 ] = -gap_p - k;
+        prevg1[ j2 ] = -2000000000;
+    }
+    *score = -2000000000;
+    for ( k = gap_e, j1 = 1 ; j1 <= n1 ; j1++, k += gap_e ) {
+        curl[ 0 ] = ( flags & 1 ) ? 0 : ( -gap_p - k );
+        g2 = -2000000000;
+        bsc = curl[ 0 ];
+        sm1 = sm + trp_cord_amino_index( a[ n1 - j1 ] ) * 20;
+        for ( j2 = 1 ; j2 <= n2 ; j2++ ) {
+            bsc = prevl[ j2 - 1 ] + sm1[ ib[ j2 - 1 ] ];
+            sc = prevl[ j2 ] - gap_p;
+            t = prevg1[ j2 ];
+            if ( t > sc )
+                sc = t;
+            sc -= gap_e;
+            curg1[ j2 ] = sc;
+            if ( sc > bsc )
+                bsc = sc;
+            sc = curl[ j2 - 1 ] - gap_p;
+            if ( g2 > sc )
+                sc = g2;
+            sc -= gap_e;
+            g2 = sc;
+            if ( sc > bsc )
+                bsc = sc;
+            curl[ j2 ] = bsc;
         }
+        if ( bsc > *score )
+            *score = bsc;
+        tmp = prevl;
+        prevl = curl;
+        curl = tmp;
+        tmp = prevg1;
+        prevg1 = curg1;
+        curg1 = tmp;
     }
-    left = grl( n1, n2 );
-    free( gridlen );
-    return trp_sig64( left );
+    if ( ( flags & 1 ) == 0 )
+        *score = prevl[ n2 ];
+    free( buf );
+    return 0;
 }
 
 static uns8b trp_cord_global_alignment_affine_low( uns8b flags, trp_obj_t *s1, trp_obj_t *s2, trp_obj_t *gap_opening_penalty, trp_obj_t *gap_extension_penalty, sig32b *sm, sig32b *score, trp_obj_t **as1, trp_obj_t **as2 )
@@ -1843,6 +2351,18 @@ static uns8b trp_cord_global_alignment_affine_low( uns8b flags, trp_obj_t *s1, t
     n2 = ((trp_cord_t *)s2)->len;
     n1p = n1 + 1;
     n2p = n2 + 1;
+    if ( flags & 2 )
+        return trp_cord_global_alignment_score_linear( flags, trp_cord_flat( s1 ), n1, trp_cord_flat( s2 ), n2, gap_p, gap_e, sm, score );
+    if ( ( (uns64b)n1p * (uns64b)n2p > TRP_CORD_DP_MAX_CELLS ) &&
+         ( ( flags & 1 ) == 0 ) && ( gap_p == 0 ) ) {
+        trp_cord_hirsch_t h;
+
+        if ( trp_cord_hirsch_run( &h, trp_cord_flat( s1 ), n1, trp_cord_flat( s2 ), n2, sm, gap_e, score ) )
+            return 1;
+        *as1 = trp_cord_cons( CORD_balance( CORD_ec_to_cord( h.x1 ) ), h.k );
+        *as2 = trp_cord_cons( CORD_balance( CORD_ec_to_cord( h.x2 ) ), h.k );
+        return 0;
+    }
     if ( ( gridmov = malloc( n1p * n2p * ( sizeof( uns8b ) + sizeof( sig32b ) * 3 ) ) ) == NULL )
         return 1;
     gridlen = (sig32b *)( gridmov + n1p * n2p );
@@ -1896,10 +2416,6 @@ static uns8b trp_cord_global_alignment_affine_low( uns8b flags, trp_obj_t *s1, t
     }
     if ( ( flags & 1 ) == 0 )
         *score = grl( n1, n2 );
-    if ( flags & 2 ) {
-        free( gridmov );
-        return 0;
-    }
     CORD_ec_init( x1 );
     CORD_ec_init( x2 );
     CORD_set_pos( i1, c1, ( flags & 1 ) ? ( n1 - fit1 ) : 0 );
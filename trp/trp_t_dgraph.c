@@ -43,6 +43,21 @@ typedef struct {
     trp_obj_t *val;
 } trp_dgraph_link_in_t;
 
+typedef struct {
+    uns8b tipo;
+    uns8b sottotipo;
+    uns8b intw;
+    uns8b badw;
+    uns32b len;
+    uns32b link_cnt;
+    uns32b ncomp;
+    trp_obj_t **nodes;
+    uns32b *off;
+    uns32b *adj;
+    flt64b *w;
+    uns32b *comp;
+} trp_dgraph_csr_t;
+
 #define trp_dgraph_root_nodes(g) ((struct avl_tree_node *)(((trp_dgraph_t *)(g))->root_nodes))
 #define trp_dgraph_root_nodes_ptr(g) ((struct avl_tree_node **)&(((trp_dgraph_t *)(g))->root_nodes))
 #define trp_dgraph_link_out_is_member(n,r) (avl_tree_lookup((struct avl_tree_node *)(r),(void *)(n),trp_dgraph_less2l))
@@ -72,12 +87,28 @@ static void trp_dgraph_queue_pred_low_low( trp_obj_t *q, trp_dgraph_node_t *n, s
 static uns32b trp_dgraph_connected_cnt_low( trp_dgraph_node_t *n );
 static uns32b trp_dgraph_connected_cnt_low_low( trp_dgraph_node_t *n, struct avl_tree_node **root );
 static uns8b trp_dgraph_detect_a_cycle( uns8b flags, trp_dgraph_node_t *n, struct avl_tree_node **root_local, struct avl_tree_node **root_global );
+static uns8b trp_dgraph_csr_check( trp_obj_t *s );
+static uns8b trp_dgraph_csr_id( trp_dgraph_csr_t *s, trp_obj_t *n, uns32b *id );
+static uns8b trp_dgraph_dijkstra_low( trp_dgraph_csr_t *c, uns32b src, uns32b dst, flt64b *dist, uns32b *pred );
+static trp_obj_t *trp_dgraph_csr_weight( trp_dgraph_csr_t *c, flt64b d );
+static void trp_dgraph_scc_low( trp_dgraph_csr_t *c );
+static uns32b trp_dgraph_reach_low( trp_dgraph_csr_t *c, uns32b u, uns32b dst, uns32b *mark, uns32b stamp, uns32b *q );
+static void *trp_dgraph_reach_routine( void *arg );
 
 uns8b trp_dgraph_print( trp_print_t *p, trp_dgraph_t *obj )
 {
     if ( trp_print_char_star( p, "#dgraph " ) )
         return 1;
-    if ( obj->sottotipo ) {
+    if ( obj->sottotipo == 2 ) {
+        if ( trp_print_char_star( p, "frozen (nodes=" ) )
+            return 1;
+        if ( trp_print_sig64( p, ((trp_dgraph_csr_t *)obj)->len ) )
+            return 1;
+        if ( trp_print_char_star( p, ", links=" ) )
+            return 1;
+        if ( trp_print_sig64( p, ((trp_dgraph_csr_t *)obj)->link_cnt ) )
+            return 1;
+    } else if ( obj->sottotipo ) {
         trp_dgraph_t *g = (trp_dgraph_t *)(((trp_dgraph_node_t *)obj)->dgraph);
 
         if ( trp_print_char_star( p, "node" ) )
@@ -176,7 +207,9 @@ trp_obj_t *trp_dgraph_length( trp_dgraph_t *obj )
 {
     uns32b len;
 
-    if ( obj->sottotipo )
+    if ( obj->sottotipo == 2 )
+        len = ((trp_dgraph_csr_t *)obj)->len;
+    else if ( obj->sottotipo )
         len = ((trp_dgraph_node_t *)obj)->len_out;
     else
         len = obj->len;
@@ -194,7 +227,7 @@ static uns8b trp_dgraph_node_check( trp_obj_t *g )
 {
     if ( g->tipo != TRP_DGRAPH )
         return 1;
-    return ( ((trp_dgraph_t *)g)->sottotipo ) ? 0 : 1;
+    return ( ((trp_dgraph_t *)g)->sottotipo == 1 ) ? 0 : 1;
 }
 
 static int trp_dgraph_less1i( const struct avl_tree_node *node1, const struct avl_tree_node *node2 )
@@ -283,8 +316,15 @@ trp_obj_t *trp_dgraph_queue( trp_obj_t *g )
 {
     trp_obj_t *res;
     struct avl_tree_node *node;
+    uns32b i;
 
     if ( trp_dgraph_check( g ) ) {
+        if ( trp_dgraph_csr_check( g ) == 0 ) {
+            res = trp_queue();
+            for ( i = 0 ; i < ((trp_dgraph_csr_t *)g)->len ; i++ )
+                trp_queue_put( res, ((trp_dgraph_csr_t *)g)->nodes[ i ] );
+            return res;
+        }
         if ( trp_dgraph_node_check( g ) )
             return UNDEF;
         return trp_dgraph_queue_out( g );
@@ -955,3 +995,548 @@ trp_obj_t *trp_dgraph_is_acyclic( trp_obj_t *g )
     return TRP_TRUE;
 }
 
+/*
+ * fotografia immutabile del grafo in formato CSR: i nodi hanno
+ * id 0..len-1 (nell'ordine dell'avl dei nodi, cioè per indirizzo,
+ * quindi anche le liste di adiacenza risultano ordinate per id);
+ * i link uscenti dal nodo i sono adj[ off[ i ] .. off[ i + 1 ] - 1 ]
+ * con i pesi in w (val del link: UNDEF vale 1)
+ */
+
+trp_obj_t *trp_dgraph_freeze( trp_obj_t *g )
+{
+    trp_dgraph_csr_t *s;
+    trp_dgraph_node_t *n;
+    struct avl_tree_node *node;
+    trp_obj_t *val;
+    uns32b *pos, len, i, j, k;
+    flt64b d;
+
+    if ( trp_dgraph_check( g ) )
+        return UNDEF;
+    len = ((trp_dgraph_t *)g)->len;
+    s = trp_gc_malloc( sizeof( trp_dgraph_csr_t ) );
+    s->tipo = TRP_DGRAPH;
+    s->sottotipo = 2;
+    s->intw = 1;
+    s->badw = 0;
+    s->len = len;
+    s->link_cnt = ((trp_dgraph_t *)g)->link_cnt;
+    s->ncomp = 0;
+    s->nodes = trp_gc_malloc( sizeof( trp_obj_t * ) * ( len + 1 ) );
+    s->off = trp_gc_malloc_atomic( sizeof( uns32b ) * ( len + 1 ) );
+    s->adj = trp_gc_malloc_atomic( sizeof( uns32b ) * ( s->link_cnt + 1 ) );
+    s->w = trp_gc_malloc_atomic( sizeof( flt64b ) * ( s->link_cnt + 1 ) );
+    s->comp = NULL;
+    s->off[ 0 ] = 0;
+    for ( node = avl_tree_first_in_order( trp_dgraph_root_nodes( g ) ), i = 0 ; node ; node = avl_tree_next_in_order( node ), i++ ) {
+        s->nodes[ i ] = (trp_obj_t *)( node->dummy );
+        s->off[ i + 1 ] = s->off[ i ] + ((trp_dgraph_node_t *)( node->dummy ))->len_out;
+    }
+    /*
+     * i pesi stanno nei link entranti: si scorrono quelli,
+     * nell'ordine degli id di destinazione
+     */
+    pos = trp_gc_malloc_atomic( sizeof( uns32b ) * ( len + 1 ) );
+    memcpy( pos, s->off, sizeof( uns32b ) * ( len + 1 ) );
+    for ( j = 0 ; j < len ; j++ ) {
+        n = (trp_dgraph_node_t *)( s->nodes[ j ] );
+        for ( node = avl_tree_first_in_order( n->root_in ) ; node ; node = avl_tree_next_in_order( node ) ) {
+            (void)trp_dgraph_csr_id( s, ((trp_dgraph_link_in_t *)( node->dummy ))->n, &i );
+            k = pos[ i ]++;
+            s->adj[ k ] = j;
+            val = ((trp_dgraph_link_in_t *)( node->dummy ))->val;
+            if ( val == UNDEF ) {
+                s->w[ k ] = 1.0;
+                continue;
+            }
+            if ( val->tipo != TRP_SIG64 )
+                s->intw = 0;
+            if ( trp_cast_flt64b( val, &d ) || ( d < 0.0 ) ) {
+                s->badw = 1;
+                d = 1.0;
+            }
+            s->w[ k ] = d;
+        }
+    }
+    trp_gc_free( pos );
+    return (trp_obj_t *)s;
+}
+
+static uns8b trp_dgraph_csr_check( trp_obj_t *s )
+{
+    if ( s->tipo != TRP_DGRAPH )
+        return 1;
+    return ( ((trp_dgraph_t *)s)->sottotipo == 2 ) ? 0 : 1;
+}
+
+/*
+ * n può essere l'id o il nodo del grafo da cui è stata fatta la
+ * fotografia (i nodi sono ordinati per indirizzo: ricerca binaria)
+ */
+
+static uns8b trp_dgraph_csr_id( trp_dgraph_csr_t *s, trp_obj_t *n, uns32b *id )
+{
+    uns32b lo, hi, mid;
+
+    if ( s->len == 0 )
+        return 1;
+    if ( trp_dgraph_node_check( n ) )
+        return trp_cast_uns32b_range( n, id, 0, s->len - 1 );
+    for ( lo = 0, hi = s->len ; lo < hi ; ) {
+        mid = ( lo + hi ) >> 1;
+        if ( (void *)( s->nodes[ mid ] ) < (void *)n )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if ( ( lo == s->len ) || ( s->nodes[ lo ] != n ) )
+        return 1;
+    *id = lo;
+    return 0;
+}
+
+trp_obj_t *trp_dgraph_frozen_id( trp_obj_t *s, trp_obj_t *n )
+{
+    uns32b id;
+
+    if ( trp_dgraph_csr_check( s ) || trp_dgraph_node_check( n ) )
+        return UNDEF;
+    if ( trp_dgraph_csr_id( (trp_dgraph_csr_t *)s, n, &id ) )
+        return UNDEF;
+    return trp_sig64( id );
+}
+
+trp_obj_t *trp_dgraph_frozen_node( trp_obj_t *s, trp_obj_t *id )
+{
+    uns32b i;
+
+    if ( trp_dgraph_csr_check( s ) )
+        return UNDEF;
+    if ( trp_dgraph_csr_id( (trp_dgraph_csr_t *)s, id, &i ) )
+        return UNDEF;
+    return ((trp_dgraph_csr_t *)s)->nodes[ i ];
+}
+
+/*
+ * distanze (numero di link) da src; UNDEF per i nodi non raggiungibili
+ */
+
+trp_obj_t *trp_dgraph_bfs( trp_obj_t *s, trp_obj_t *src )
+{
+    trp_dgraph_csr_t *c = (trp_dgraph_csr_t *)s;
+    trp_obj_t *res;
+    uns32b *dist, *q, qh, qt, u, v, k;
+
+    if ( trp_dgraph_csr_check( s ) )
+        return UNDEF;
+    if ( trp_dgraph_csr_id( c, src, &u ) )
+        return UNDEF;
+    dist = trp_gc_malloc_atomic( sizeof( uns32b ) * c->len );
+    q = trp_gc_malloc_atomic( sizeof( uns32b ) * c->len );
+    memset( dist, 0xff, sizeof( uns32b ) * c->len );
+    dist[ u ] = 0;
+    q[ 0 ] = u;
+    for ( qh = 0, qt = 1 ; qh < qt ; ) {
+        u = q[ qh++ ];
+        for ( k = c->off[ u ] ; k < c->off[ u + 1 ] ; k++ ) {
+            v = c->adj[ k ];
+            if ( dist[ v ] == 0xffffffff ) {
+                dist[ v ] = dist[ u ] + 1;
+                q[ qt++ ] = v;
+            }
+        }
+    }
+    res = trp_array_ext_internal( UNDEF, 10, c->len );
+    for ( k = 0 ; k < c->len ; k++ )
+        if ( dist[ k ] != 0xffffffff )
+            ((trp_array_t *)res)->data[ k ] = trp_sig64( dist[ k ] );
+    trp_gc_free( q );
+    trp_gc_free( dist );
+    return res;
+}
+
+/*
+ * Dijkstra con la coda di priorità trp_fibo; se dst < len ci si
+ * ferma appena dst viene estratto; rende 1 se un peso non è valido
+ */
+
+static uns8b trp_dgraph_dijkstra_low( trp_dgraph_csr_t *c, uns32b src, uns32b dst, flt64b *dist, uns32b *pred )
+{
+    trp_obj_t *h, **fn, *x;
+    uns8b *done;
+    uns32b u, v, k;
+    flt64b d;
+
+    if ( c->badw )
+        return 1;
+    h = trp_fibo( NULL );
+    fn = trp_gc_malloc( sizeof( trp_obj_t * ) * c->len );
+    done = trp_gc_malloc_atomic( c->len );
+    memset( done, 0, c->len );
+    for ( k = 0 ; k < c->len ; k++ ) {
+        fn[ k ] = NULL;
+        pred[ k ] = 0xffffffff;
+    }
+    dist[ src ] = 0.0;
+    fn[ src ] = trp_fibo_insert( h, trp_double( 0.0 ), trp_sig64( src ) );
+    while ( ( x = trp_fibo_extract( h ) ) != UNDEF ) {
+        u = (uns32b)( ((trp_sig64_t *)( ((trp_fibo_node_t *)x)->obj ))->val );
+        done[ u ] = 1;
+        if ( u == dst )
+            break;
+        for ( k = c->off[ u ] ; k < c->off[ u + 1 ] ; k++ ) {
+            v = c->adj[ k ];
+            if ( done[ v ] )
+                continue;
+            d = dist[ u ] + c->w[ k ];
+            if ( fn[ v ] == NULL ) {
+                dist[ v ] = d;
+                pred[ v ] = u;
+                fn[ v ] = trp_fibo_insert( h, trp_double( d ), trp_sig64( v ) );
+            } else if ( d < dist[ v ] ) {
+                dist[ v ] = d;
+                pred[ v ] = u;
+                (void)trp_fibo_decrease_key( fn[ v ], trp_double( d ) );
+            }
+        }
+    }
+    for ( k = 0 ; k < c->len ; k++ )
+        if ( !done[ k ] )
+            pred[ k ] = 0xfffffffe;
+    trp_gc_free( done );
+    trp_gc_free( fn );
+    return 0;
+}
+
+static trp_obj_t *trp_dgraph_csr_weight( trp_dgraph_csr_t *c, flt64b d )
+{
+    return c->intw ? trp_sig64( (sig64b)d ) : trp_double( d );
+}
+
+/*
+ * lunghezze dei cammini minimi da src (i pesi sono i val dei link,
+ * che devono essere numeri non negativi); UNDEF se non raggiungibili
+ */
+
+trp_obj_t *trp_dgraph_dijkstra( trp_obj_t *s, trp_obj_t *src )
+{
+    trp_dgraph_csr_t *c = (trp_dgraph_csr_t *)s;
+    trp_obj_t *res;
+    flt64b *dist;
+    uns32b *pred, u, k;
+
+    if ( trp_dgraph_csr_check( s ) )
+        return UNDEF;
+    if ( trp_dgraph_csr_id( c, src, &u ) )
+        return UNDEF;
+    dist = trp_gc_malloc_atomic( sizeof( flt64b ) * c->len );
+    pred = trp_gc_malloc_atomic( sizeof( uns32b ) * c->len );
+    if ( trp_dgraph_dijkstra_low( c, u, c->len, dist, pred ) ) {
+        res = UNDEF;
+    } else {
+        res = trp_array_ext_internal( UNDEF, 10, c->len );
+        for ( k = 0 ; k < c->len ; k++ )
+            if ( pred[ k ] != 0xfffffffe )
+                ((trp_array_t *)res)->data[ k ] = trp_dgraph_csr_weight( c, dist[ k ] );
+    }
+    trp_gc_free( pred );
+    trp_gc_free( dist );
+    return res;
+}
+
+/*
+ * rende ( lunghezza . lista degli id ) del cammino minimo
+ * da src a dst, UNDEF se non esiste
+ */
+
+trp_obj_t *trp_dgraph_path( trp_obj_t *s, trp_obj_t *src, trp_obj_t *dst )
+{
+    trp_dgraph_csr_t *c = (trp_dgraph_csr_t *)s;
+    trp_obj_t *res = UNDEF, *l;
+    flt64b *dist;
+    uns32b *pred, u, v;
+
+    if ( trp_dgraph_csr_check( s ) )
+        return UNDEF;
+    if ( trp_dgraph_csr_id( c, src, &u ) || trp_dgraph_csr_id( c, dst, &v ) )
+        return UNDEF;
+    dist = trp_gc_malloc_atomic( sizeof( flt64b ) * c->len );
+    pred = trp_gc_malloc_atomic( sizeof( uns32b ) * c->len );
+    if ( trp_dgraph_dijkstra_low( c, u, v, dist, pred ) == 0 )
+        if ( pred[ v ] != 0xfffffffe ) {
+            res = trp_dgraph_csr_weight( c, dist[ v ] );
+            for ( l = NIL ; ; v = pred[ v ] ) {
+                l = trp_cons( trp_sig64( v ), l );
+                if ( v == u )
+                    break;
+            }
+            res = trp_cons( res, l );
+        }
+    trp_gc_free( pred );
+    trp_gc_free( dist );
+    return res;
+}
+
+/*
+ * ordine topologico (algoritmo di Kahn): array degli id,
+ * UNDEF se il grafo ha un ciclo
+ */
+
+trp_obj_t *trp_dgraph_topo( trp_obj_t *s )
+{
+    trp_dgraph_csr_t *c = (trp_dgraph_csr_t *)s;
+    trp_obj_t *res;
+    uns32b *indeg, *q, qh, qt, u, v, k;
+
+    if ( trp_dgraph_csr_check( s ) )
+        return UNDEF;
+    indeg = trp_gc_malloc_atomic( sizeof( uns32b ) * ( c->len + 1 ) );
+    q = trp_gc_malloc_atomic( sizeof( uns32b ) * ( c->len + 1 ) );
+    memset( indeg, 0, sizeof( uns32b ) * c->len );
+    for ( k = 0 ; k < c->link_cnt ; k++ )
+        indeg[ c->adj[ k ] ]++;
+    for ( u = 0, qt = 0 ; u < c->len ; u++ )
+        if ( indeg[ u ] == 0 )
+            q[ qt++ ] = u;
+    for ( qh = 0 ; qh < qt ; ) {
+        u = q[ qh++ ];
+        for ( k = c->off[ u ] ; k < c->off[ u + 1 ] ; k++ ) {
+            v = c->adj[ k ];
+            if ( --indeg[ v ] == 0 )
+                q[ qt++ ] = v;
+        }
+    }
+    if ( qt < c->len ) {
+        res = UNDEF;
+    } else {
+        res = trp_array_ext_internal( UNDEF, 10, c->len );
+        for ( k = 0 ; k < c->len ; k++ )
+            ((trp_array_t *)res)->data[ k ] = trp_sig64( q[ k ] );
+    }
+    trp_gc_free( q );
+    trp_gc_free( indeg );
+    return res;
+}
+
+/*
+ * componenti fortemente connesse (Tarjan, senza ricorsione);
+ * le componenti sono numerate in ordine topologico, cioè se da a
+ * si arriva a b allora comp[ a ] <= comp[ b ]; il risultato
+ * rimane nella fotografia, perché serve anche a trp_dgraph_reach
+ */
+
+static void trp_dgraph_scc_low( trp_dgraph_csr_t *c )
+{
+    uns32b *idx, *low, *st, *cs, *ck, *comp, sp, csp, cnt, ncomp, u, v, r;
+
+    if ( c->comp )
+        return;
+    comp = trp_gc_malloc_atomic( sizeof( uns32b ) * ( c->len + 1 ) );
+    memset( comp, 0xff, sizeof( uns32b ) * c->len );
+    idx = trp_gc_malloc_atomic( sizeof( uns32b ) * ( c->len + 1 ) * 5 );
+    low = idx + c->len + 1;
+    st = low + c->len + 1;
+    cs = st + c->len + 1;
+    ck = cs + c->len + 1;
+    memset( idx, 0xff, sizeof( uns32b ) * c->len );
+    for ( r = 0, cnt = 0, ncomp = 0, sp = 0 ; r < c->len ; r++ ) {
+        if ( idx[ r ] != 0xffffffff )
+            continue;
+        idx[ r ] = low[ r ] = cnt++;
+        st[ sp++ ] = r;
+        cs[ 0 ] = r;
+        ck[ 0 ] = c->off[ r ];
+        for ( csp = 1 ; csp ; ) {
+            u = cs[ csp - 1 ];
+            if ( ck[ csp - 1 ] < c->off[ u + 1 ] ) {
+                v = c->adj[ ck[ csp - 1 ]++ ];
+                if ( idx[ v ] == 0xffffffff ) {
+                    idx[ v ] = low[ v ] = cnt++;
+                    st[ sp++ ] = v;
+                    cs[ csp ] = v;
+                    ck[ csp++ ] = c->off[ v ];
+                } else if ( ( comp[ v ] == 0xffffffff ) && ( idx[ v ] < low[ u ] ) ) {
+                    low[ u ] = idx[ v ];
+                }
+                continue;
+            }
+            if ( low[ u ] == idx[ u ] ) {
+                do {
+                    v = st[ --sp ];
+                    comp[ v ] = ncomp;
+                } while ( v != u );
+                ncomp++;
+            }
+            if ( --csp ) {
+                v = cs[ csp - 1 ];
+                if ( low[ u ] < low[ v ] )
+                    low[ v ] = low[ u ];
+            }
+        }
+    }
+    /*
+     * Tarjan chiude le componenti in ordine topologico inverso
+     */
+    for ( u = 0 ; u < c->len ; u++ )
+        comp[ u ] = ncomp - 1 - comp[ u ];
+    trp_gc_free( idx );
+    c->ncomp = ncomp;
+    c->comp = comp;
+}
+
+trp_obj_t *trp_dgraph_scc( trp_obj_t *s )
+{
+    trp_dgraph_csr_t *c = (trp_dgraph_csr_t *)s;
+    trp_obj_t *res;
+    uns32b k;
+
+    if ( trp_dgraph_csr_check( s ) )
+        return UNDEF;
+    trp_dgraph_scc_low( c );
+    res = trp_array_ext_internal( UNDEF, 10, c->len );
+    for ( k = 0 ; k < c->len ; k++ )
+        ((trp_array_t *)res)->data[ k ] = trp_sig64( c->comp[ k ] );
+    return res;
+}
+
+trp_obj_t *trp_dgraph_scc_cnt( trp_obj_t *s )
+{
+    if ( trp_dgraph_csr_check( s ) )
+        return UNDEF;
+    trp_dgraph_scc_low( (trp_dgraph_csr_t *)s );
+    return trp_sig64( ((trp_dgraph_csr_t *)s)->ncomp );
+}
+
+/*
+ * visita in ampiezza da u usando mark/stamp come insieme dei
+ * visitati (così non va azzerato ad ogni visita); se dst < len si
+ * ferma appena lo trova e non entra nelle componenti successive
+ * a quella di dst; rende il numero di nodi visitati, 0 se ha trovato dst
+ */
+
+static uns32b trp_dgraph_reach_low( trp_dgraph_csr_t *c, uns32b u, uns32b dst, uns32b *mark, uns32b stamp, uns32b *q )
+{
+    uns32b qh, qt, v, k, cmax;
+
+    cmax = ( dst < c->len ) ? c->comp[ dst ] : c->ncomp;
+    mark[ u ] = stamp;
+    q[ 0 ] = u;
+    for ( qh = 0, qt = 1 ; qh < qt ; ) {
+        u = q[ qh++ ];
+        for ( k = c->off[ u ] ; k < c->off[ u + 1 ] ; k++ ) {
+            v = c->adj[ k ];
+            if ( mark[ v ] == stamp )
+                continue;
+            if ( v == dst )
+                return 0;
+            if ( c->comp[ v ] > cmax )
+                continue;
+            mark[ v ] = stamp;
+            q[ qt++ ] = v;
+        }
+    }
+    return qt;
+}
+
+trp_obj_t *trp_dgraph_reach( trp_obj_t *s, trp_obj_t *n1, trp_obj_t *n2 )
+{
+    trp_dgraph_csr_t *c = (trp_dgraph_csr_t *)s;
+    uns32b *mark, u, v, res;
+
+    if ( trp_dgraph_csr_check( s ) )
+        return TRP_FALSE;
+    if ( trp_dgraph_csr_id( c, n1, &u ) || trp_dgraph_csr_id( c, n2, &v ) )
+        return TRP_FALSE;
+    trp_dgraph_scc_low( c );
+    if ( c->comp[ u ] == c->comp[ v ] )
+        return TRP_TRUE;
+    if ( c->comp[ u ] > c->comp[ v ] )
+        return TRP_FALSE;
+    mark = trp_gc_malloc_atomic( sizeof( uns32b ) * c->len * 2 );
+    memset( mark, 0, sizeof( uns32b ) * c->len );
+    res = trp_dgraph_reach_low( c, u, v, mark, 1, mark + c->len );
+    trp_gc_free( mark );
+    return res ? TRP_FALSE : TRP_TRUE;
+}
+
+typedef struct {
+    trp_dgraph_csr_t *c;
+    uns32b *rep;
+    uns32b *cnt;
+    uns32b nrep;
+    uns32b next;
+} trp_dgraph_reach_par_t;
+
+static void *trp_dgraph_reach_routine( void *arg )
+{
+    trp_dgraph_reach_par_t *p = (trp_dgraph_reach_par_t *)arg;
+    uns32b *mark, i;
+
+    /*
+     se manca la memoria le componenti restano agli altri thread;
+     se mancasse a tutti next resta minore di nrep
+     */
+    if ( ( mark = calloc( p->c->len, sizeof( uns32b ) * 2 ) ) == NULL )
+        return NULL;
+    while ( ( i = __sync_fetch_and_add( &( p->next ), 1 ) ) < p->nrep )
+        p->cnt[ p->rep[ i ] ] = trp_dgraph_reach_low( p->c, p->rep[ i ], p->c->len, mark, i + 1, mark + p->c->len );
+    free( mark );
+    return NULL;
+}
+
+/*
+ * numero di nodi raggiungibili da n (incluso); senza n rende
+ * l'array dei conteggi di tutti i nodi: basta una visita per
+ * componente fortemente connessa (i nodi della stessa componente
+ * raggiungono gli stessi nodi) e le visite sono divise fra più
+ * thread, che si prendono le componenti da un contatore comune
+ */
+
+trp_obj_t *trp_dgraph_reach_cnt( trp_obj_t *s, trp_obj_t *n )
+{
+    trp_dgraph_csr_t *c = (trp_dgraph_csr_t *)s;
+    trp_dgraph_reach_par_t par;
+    trp_obj_t *res;
+    uns32b *mark, parts, u, i;
+
+    if ( trp_dgraph_csr_check( s ) )
+        return UNDEF;
+    trp_dgraph_scc_low( c );
+    if ( n ) {
+        if ( trp_dgraph_csr_id( c, n, &u ) )
+            return UNDEF;
+        mark = trp_gc_malloc_atomic( sizeof( uns32b ) * c->len * 2 );
+        memset( mark, 0, sizeof( uns32b ) * c->len );
+        i = trp_dgraph_reach_low( c, u, c->len, mark, 1, mark + c->len );
+        trp_gc_free( mark );
+        return trp_sig64( i );
+    }
+    par.c = c;
+    par.rep = trp_gc_malloc_atomic( sizeof( uns32b ) * ( c->ncomp + 1 ) );
+    par.cnt = trp_gc_malloc_atomic( sizeof( uns32b ) * ( c->len + 1 ) );
+    par.nrep = c->ncomp;
+    par.next = 0;
+    memset( par.rep, 0xff, sizeof( uns32b ) * c->ncomp );
+    for ( u = 0 ; u < c->len ; u++ )
+        if ( par.rep[ c->comp[ u ] ] == 0xffffffff )
+            par.rep[ c->comp[ u ] ] = u;
+    parts = trp_ncpus();
+    if ( parts > par.nrep )
+        parts = par.nrep;
+    if ( parts == 0 )
+        parts = 1;
+    trp_parallel_run( trp_dgraph_reach_routine, (void *)( &par ), 0, parts );
+    if ( par.next < par.nrep ) {
+        trp_gc_free( par.cnt );
+        trp_gc_free( par.rep );
+        return UNDEF;
+    }
+    res = trp_array_ext_internal( UNDEF, 10, c->len );
+    for ( u = 0 ; u < c->len ; u++ )
+        ((trp_array_t *)res)->data[ u ] = trp_sig64( par.cnt[ par.rep[ c->comp[ u ] ] ] );
+    trp_gc_free( par.cnt );
+    trp_gc_free( par.rep );
+    return res;
+}
+
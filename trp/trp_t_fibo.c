@@ -319,7 +319,10 @@ static void trp_fibo_link( trp_fibo_node_t *y, trp_fibo_node_t *x )
 
 static void trp_fibo_consolidate( trp_fibo_t *h )
 {
-    int dn = (int)( log( h->len ) / log( 2 ) ) + 1, i, d;
+    /*
+     il grado massimo è log in base phi (non 2) del numero di nodi
+     */
+    int dn = (int)( log( h->len ) / log( 1.618 ) ) + 2, i, d;
     trp_obj_t *min_key;
     trp_fibo_node_t *w  = h->min; /* the first node we will consolidate */
     trp_fibo_node_t *f = w->left; /* the final node in this heap we will consolidate */
@@ -407,11 +410,11 @@ trp_obj_t *trp_fibo_extract( trp_obj_t *h )
             sibling->right = min_right;
             min_right->left = sibling;
 
-            min_right = sibling;
-            sibling = sibling_right;
-
             // update the p
             sibling->p = NULL;
+
+            min_right = sibling;
+            sibling = sibling_right;
         }
     }
     // remove z from the root list
@@ -17,6 +17,7 @@
 */
 
 #include "trp.h"
+#include <sys/stat.h>
 #ifndef MINGW
 #include <netdb.h>
 #endif
@@ -29,9 +30,32 @@
 #define trp_off_t off_t
 #endif
 
+/*
+ dimensione del buffer di lettura (socket e file regolari in sola lettura)
+ */
+#define TRP_FILE_RBUF_SIZE 16384
+
+/*
+ flags: 1 lettura, 2 scrittura, 4 socket, 8 popen,
+ 16 file regolare letto a blocchi in rbuf
+ */
+#define TRP_FILE_BUFFERED(f) ( (f)->flags & 20 )
+
 static void trp_file_finalize( void *obj, void *data );
 static trp_obj_t *trp_file_internal( FILE *fp, uns8b flags );
 static uns8b trp_file_read_char( FILE *fp, uns8b *c );
+static uns8b trp_file_fill( trp_file_t *f );
+static uns8b trp_file_read_char2( trp_file_t *f, uns8b *c );
+static int trp_file_getc( trp_file_t *f );
+static trp_file_t *trp_file_readable( trp_obj_t *stream );
+static void trp_file_count_line( trp_file_t *f, uns8b c );
+static void trp_file_sync( trp_file_t *f );
+static uns8b *trp_file_eol( uns8b *p, uns32b n );
+static trp_obj_t *trp_file_read_line_internal( trp_file_t *f );
+uns32b trp_file_read_chars_internal( trp_obj_t *stream, uns8b *buf, uns32b n );
+uns8b trp_file_readable_internal( trp_obj_t *stream );
+uns8b *trp_file_peek_internal( trp_obj_t *stream, uns32b *n );
+void trp_file_skip_internal( trp_obj_t *stream, uns32b n );
 
 uns8b trp_file_print( trp_print_t *p, trp_file_t *obj )
 {
@@ -59,8 +83,12 @@ trp_obj_t *trp_file_length( trp_file_t *obj )
     FILE *fp;
     sig64b i, j;
 
-    if ( ( fp = trp_file_readable_fp( (trp_obj_t *)obj ) ) == NULL )
+    /*
+     si torna alla posizione di stdio: rbuf resta valido
+     */
+    if ( trp_file_readable( (trp_obj_t *)obj ) == NULL )
         return UNDEF;
+    fp = obj->fp;
     i = (sig64b)ftello( fp );
     if ( i < 0 )
         return UNDEF;
@@ -89,6 +117,9 @@ uns8b trp_file_close( trp_file_t *obj )
         } else
             fclose( obj->fp );
         obj->fp = NULL;
+        free( obj->rbuf );
+        obj->rbuf = NULL;
+        obj->rpos = obj->rlen = 0;
         trp_gc_remove_finalizer( (trp_obj_t *)obj );
     }
     return res;
@@ -112,6 +143,9 @@ static trp_obj_t *trp_file_internal( FILE *fp, uns8b flags )
     obj->fp = fp;
     obj->line = 0;
     obj->last = 0;
+    obj->rbuf = NULL;
+    obj->rpos = 0;
+    obj->rlen = 0;
     return (trp_obj_t *)obj;
 }
 
@@ -142,13 +176,48 @@ trp_obj_t *trp_stderr()
     return c;
 }
 
+/*
+ chi usa direttamente il FILE * non vede i byte gia' letti in rbuf,
+ quindi prima di renderlo si riallinea la posizione del file
+ */
+
 FILE *trp_file_readable_fp( trp_obj_t *stream )
+{
+    trp_file_t *f;
+
+    if ( ( f = trp_file_readable( stream ) ) == NULL )
+        return NULL;
+    trp_file_sync( f );
+    return f->fp;
+}
+
+/*
+ come trp_file_readable_fp, ma senza scartare rbuf: per chi
+ poi legge con trp_file_read_chars_internal
+ */
+
+uns8b trp_file_readable_internal( trp_obj_t *stream )
+{
+    return ( trp_file_readable( stream ) == NULL ) ? 1 : 0;
+}
+
+static trp_file_t *trp_file_readable( trp_obj_t *stream )
 {
     if ( stream->tipo != TRP_FILE )
         return NULL;
     if ( ~(((trp_file_t *)stream)->flags) & 1 )
         return NULL;
-    return ((trp_file_t *)stream)->fp;
+    if ( ((trp_file_t *)stream)->fp == NULL )
+        return NULL;
+    return (trp_file_t *)stream;
+}
+
+static void trp_file_sync( trp_file_t *f )
+{
+    if ( ( f->flags & 16 ) && ( f->rpos < f->rlen ) )
+        (void)fseeko( f->fp, -(trp_off_t)( f->rlen - f->rpos ), SEEK_CUR );
+    if ( f->flags & 16 )
+        f->rpos = f->rlen = 0;
 }
 
 FILE *trp_file_writable_fp( trp_obj_t *stream )
@@ -163,9 +232,16 @@ FILE *trp_file_writable_fp( trp_obj_t *stream )
 trp_obj_t *trp_file_openro( trp_obj_t *path )
 {
     trp_obj_t *res;
+    FILE *fp;
+    struct stat st;
+    uns8b flags = 1;
     uns8b *cpath = trp_csprint( path );
 
-    res = trp_file_internal( trp_fopen( cpath, "rb" ), 1 );
+    if ( fp = trp_fopen( cpath, "rb" ) )
+        if ( fstat( fileno( fp ), &st ) == 0 )
+            if ( S_ISREG( st.st_mode ) )
+                flags |= 16;
+    res = trp_file_internal( fp, flags );
     trp_csprint_free( cpath );
     return res;
 }
@@ -283,22 +359,25 @@ uns8b trp_file_set_pos( trp_obj_t *pos, trp_obj_t *obj )
 
 trp_obj_t *trp_file_pos( trp_obj_t *obj )
 {
-    FILE *fp;
+    trp_file_t *f;
     sig64b i;
 
-    if ( ( fp = trp_file_readable_fp( (trp_obj_t *)obj ) ) == NULL )
+    /*
+     la posizione logica si ricava da rbuf senza scartarlo
+     */
+    if ( ( f = trp_file_readable( obj ) ) == NULL )
         return UNDEF;
-    i = (sig64b)ftello( fp );
+    i = (sig64b)ftello( f->fp );
     if ( i < 0 )
         return UNDEF;
+    if ( f->flags & 16 )
+        i -= (sig64b)( f->rlen - f->rpos );
     return trp_sig64( i );
 }
 
 trp_obj_t *trp_file_pos_line( trp_obj_t *obj )
 {
-    FILE *fp;
-
-    if ( ( fp = trp_file_readable_fp( (trp_obj_t *)obj ) ) == NULL )
+    if ( trp_file_readable( obj ) == NULL )
         return UNDEF;
     if ( ((trp_file_t *)obj)->line == 0xffffffff )
         return UNDEF;
@@ -334,102 +413,303 @@ static uns8b trp_file_read_char( FILE *fp, uns8b *c )
     return ( trp_file_read_chars( fp, c, 1 ) == 1 ) ? 0 : 1;
 }
 
-static uns8b trp_file_read_char2( FILE *fp, uns8b *c, uns8b issocket )
+/*
+ i socket e i file regolari aperti in sola lettura vengono letti
+ a blocchi in un buffer (allocato con malloc perche' trp_file_t e' atomico);
+ per i socket, se read() rende 0 si aspetta con poll() e si fallisce all'hangup
+ */
+
+static uns8b trp_file_fill( trp_file_t *f )
 {
     int i;
 
+    if ( f->rbuf == NULL )
+        if ( ( f->rbuf = malloc( TRP_FILE_RBUF_SIZE ) ) == NULL )
+            return 1;
+    if ( f->flags & 16 ) {
+        i = (int)fread( f->rbuf, 1, TRP_FILE_RBUF_SIZE, f->fp );
+        if ( i == 0 )
+            return 1;
+        f->rpos = 0;
+        f->rlen = (uns32b)i;
+        return 0;
+    }
+#ifdef MINGW
+    return 1;
+#else
     for ( ; ; ) {
-        if ( issocket ) {
-            i = read( fileno( fp ), c, 1 );
-        } else
-            i = fread( c, 1, 1, fp );
-        if ( i == 1 )
+        i = read( fileno( f->fp ), f->rbuf, TRP_FILE_RBUF_SIZE );
+        if ( i > 0 )
             break;
         if ( i < 0 )
             return 1;
-        if ( issocket ) {
-#ifdef MINGW
-            return 1;
-#else
+        {
             struct pollfd ufds[ 1 ];
 
-            ufds[ 0 ].fd = fileno( fp );
+            ufds[ 0 ].fd = fileno( f->fp );
             ufds[ 0 ].events = POLLHUP;
             if ( poll( ufds, 1, -1 ) == 1 )
                 if ( ufds[ 0 ].revents & POLLHUP )
                     return 1;
-#endif
-        } else if ( feof( fp ) )
-            return 1;
+        }
     }
+    f->rpos = 0;
+    f->rlen = (uns32b)i;
     return 0;
+#endif
+}
+
+static uns8b trp_file_read_char2( trp_file_t *f, uns8b *c )
+{
+    if ( TRP_FILE_BUFFERED( f ) ) {
+        if ( f->rpos == f->rlen )
+            if ( trp_file_fill( f ) )
+                return 1;
+        *c = f->rbuf[ f->rpos++ ];
+        return 0;
+    }
+    return trp_file_read_char( f->fp, c );
+}
+
+static int trp_file_getc( trp_file_t *f )
+{
+    uns8b c;
+
+    if ( TRP_FILE_BUFFERED( f ) )
+        return trp_file_read_char2( f, &c ) ? EOF : (int)c;
+    return getc( f->fp );
+}
+
+uns32b trp_file_read_chars_internal( trp_obj_t *stream, uns8b *buf, uns32b n )
+{
+    trp_file_t *f = (trp_file_t *)stream;
+    uns32b i, off = 0;
+
+    if ( TRP_FILE_BUFFERED( f ) == 0 )
+        return trp_file_read_chars( f->fp, buf, n );
+    while ( n ) {
+        if ( f->rpos == f->rlen )
+            if ( trp_file_fill( f ) )
+                break;
+        i = f->rlen - f->rpos;
+        if ( i > n )
+            i = n;
+        memcpy( buf + off, f->rbuf + f->rpos, i );
+        f->rpos += i;
+        n -= i;
+        off += i;
+    }
+    return off;
+}
+
+/*
+ per i parser che leggono a blocchi: rende i byte già disponibili
+ senza consumarli (NULL alla fine del file), che vanno poi consumati
+ con trp_file_skip_internal; per i file senza buffer si rende un
+ carattere alla volta (in un rbuf di un solo byte), rimettendolo
+ nel FILE * con ungetc
+ */
+
+uns8b *trp_file_peek_internal( trp_obj_t *stream, uns32b *n )
+{
+    trp_file_t *f;
+    int c;
+
+    if ( ( f = trp_file_readable( stream ) ) == NULL )
+        return NULL;
+    if ( TRP_FILE_BUFFERED( f ) ) {
+        if ( f->rpos == f->rlen )
+            if ( trp_file_fill( f ) )
+                return NULL;
+        *n = f->rlen - f->rpos;
+        return f->rbuf + f->rpos;
+    }
+    if ( f->rbuf == NULL )
+        if ( ( f->rbuf = malloc( 1 ) ) == NULL )
+            return NULL;
+    if ( ( c = getc( f->fp ) ) == EOF )
+        return NULL;
+    (void)ungetc( c, f->fp );
+    f->rbuf[ 0 ] = (uns8b)c;
+    *n = 1;
+    return f->rbuf;
+}
+
+void trp_file_skip_internal( trp_obj_t *stream, uns32b n )
+{
+    trp_file_t *f = (trp_file_t *)stream;
+    int c;
+
+    if ( TRP_FILE_BUFFERED( f ) ) {
+        for ( ; n ; n-- )
+            trp_file_count_line( f, f->rbuf[ f->rpos++ ] );
+        return;
+    }
+    for ( ; n ; n-- )
+        if ( ( c = getc( f->fp ) ) != EOF )
+            trp_file_count_line( f, (uns8b)c );
+}
+
+/*
+ aggiorna il numero di riga come se c fosse stato letto con read-char
+ */
+
+static void trp_file_count_line( trp_file_t *f, uns8b c )
+{
+    if ( ( ( c == '\n' ) && ( f->last != '\r' ) ) ||
+         ( ( c == '\r' ) && ( f->last != '\n' ) ) ) {
+        if ( f->line < 0xffffffff )
+            (f->line)++;
+        f->last = c;
+    } else {
+        f->last = 0;
+    }
 }
 
 trp_obj_t *trp_read_char( trp_obj_t *stream )
 {
-    FILE *fp;
-    uns8b c, issocket;
+    uns8b c;
 
-    if ( ( fp = trp_file_readable_fp( stream ) ) == NULL )
+    if ( trp_file_readable( stream ) == NULL )
         return UNDEF;
-   issocket = ( (((trp_file_t* )stream)->flags) & 4 ) ? 1 : 0;
-    if ( trp_file_read_char2( fp, &c, issocket ) )
+    if ( trp_file_read_char2( (trp_file_t *)stream, &c ) )
         return UNDEF;
-    if ( ( ( c == '\n' ) && ( ((trp_file_t *)stream)->last != '\r' ) ) ||
-         ( ( c == '\r' ) && ( ((trp_file_t *)stream)->last != '\n' ) ) ) {
-        if ( ((trp_file_t *)stream)->line < 0xffffffff )
-            (((trp_file_t *)stream)->line)++;
-        ((trp_file_t *)stream)->last = c;
-    } else {
-        ((trp_file_t *)stream)->last = 0;
-    }
+    trp_file_count_line( (trp_file_t *)stream, c );
     return trp_char( c );
 }
 
-trp_obj_t *trp_read_line( trp_obj_t *stream )
+/*
+ cerca il primo terminatore di riga ('\n', '\r' o '\0') tra p e p + n;
+ se non c'e' rende p + n
+ */
+
+static uns8b *trp_file_eol( uns8b *p, uns32b n )
 {
-    uns32b cnt = 0;
-    FILE *fp;
-    CORD_ec x;
-    uns8b c, issocket;
+    uns8b *q;
 
-    if ( ( fp = trp_file_readable_fp( stream ) ) == NULL )
-        return UNDEF;
-    issocket = ( (((trp_file_t* )stream)->flags) & 4 ) ? 1 : 0;
-    if ( trp_file_read_char2( fp, &c, issocket ) )
+    if ( q = memchr( p, '\n', n ) )
+        n = (uns32b)( q - p );
+    if ( q = memchr( p, '\r', n ) )
+        n = (uns32b)( q - p );
+    if ( q = memchr( p, 0, n ) )
+        n = (uns32b)( q - p );
+    return p + n;
+}
+
+/*
+ la riga viene accumulata in un'unica stringa atomica
+ che diventa una cord piatta (una sola foglia)
+ */
+
+static trp_obj_t *trp_file_read_line_internal( trp_file_t *f )
+{
+    uns8b *s = NULL, *p, *q;
+    uns32b cnt = 0, max = 0, n;
+    uns8b c;
+
+    if ( trp_file_read_char2( f, &c ) )
         return UNDEF;
-    if ( ( ( c == '\n' ) && ( ((trp_file_t *)stream)->last == '\r' ) ) ||
-         ( ( c == '\r' ) && ( ((trp_file_t *)stream)->last == '\n' ) ) )
-        if ( trp_file_read_char2( fp, &c, issocket ) )
+    if ( ( ( c == '\n' ) && ( f->last == '\r' ) ) ||
+         ( ( c == '\r' ) && ( f->last == '\n' ) ) )
+        if ( trp_file_read_char2( f, &c ) )
             return UNDEF;
-    CORD_ec_init( x );
-    while( c && ( c != '\n' ) && ( c != '\r' ) ) {
-        cnt++;
-        CORD_ec_append( x, c );
-        if ( trp_file_read_char2( fp, &c, issocket ) )
-            c = 0;
+    if ( TRP_FILE_BUFFERED( f ) ) {
+        /*
+         c e' ancora nel buffer
+         */
+        f->rpos--;
+        for ( ; ; ) {
+            p = f->rbuf + f->rpos;
+            n = f->rlen - f->rpos;
+            q = trp_file_eol( p, n );
+            if ( q > p ) {
+                if ( cnt + (uns32b)( q - p ) + 1 > max ) {
+                    max = cnt + (uns32b)( q - p ) + 1;
+                    if ( s ) {
+                        max <<= 1;
+                        s = trp_gc_realloc( s, max );
+                    } else
+                        s = trp_gc_malloc_atomic( max );
+                }
+                memcpy( s + cnt, p, q - p );
+                cnt += (uns32b)( q - p );
+                f->rpos += (uns32b)( q - p );
+            }
+            if ( q < p + n ) {
+                c = *q;
+                f->rpos++;
+                break;
+            }
+            if ( trp_file_fill( f ) ) {
+                c = 0;
+                break;
+            }
+        }
+    } else {
+        while ( c && ( c != '\n' ) && ( c != '\r' ) ) {
+            if ( cnt + 1 >= max ) {
+                max = max ? max << 1 : 128;
+                s = s ? trp_gc_realloc( s, max ) : trp_gc_malloc_atomic( max );
+            }
+            s[ cnt++ ] = c;
+            if ( trp_file_read_char2( f, &c ) )
+                c = 0;
+        }
     }
-    ((trp_file_t *)stream)->last = c;
-    (((trp_file_t *)stream)->line)++;
+    f->last = c;
+    (f->line)++;
     if ( cnt == 0 )
         return EMPTYCORD;
-    return trp_cord_cons( CORD_balance( CORD_ec_to_cord( x ) ), cnt );
+    if ( max > cnt + 1 )
+        s = trp_gc_realloc( s, cnt + 1 );
+    s[ cnt ] = 0;
+    return trp_cord_cons( s, cnt );
+}
+
+trp_obj_t *trp_read_line( trp_obj_t *stream )
+{
+    if ( trp_file_readable( stream ) == NULL )
+        return UNDEF;
+    return trp_file_read_line_internal( (trp_file_t *)stream );
+}
+
+/*
+ legge fino a cnt righe e le rende in un array;
+ UNDEF se non si riesce a leggere neanche una riga
+ */
+
+trp_obj_t *trp_read_lines( trp_obj_t *stream, trp_obj_t *cnt )
+{
+    trp_obj_t *a, *l;
+    uns32b n;
+
+    if ( ( trp_file_readable( stream ) == NULL ) ||
+         trp_cast_uns32b( cnt, &n ) )
+        return UNDEF;
+    a = trp_array_ext_internal( NULL, ( n < 1024 ) ? ( n ? n : 1 ) : 1024, 0 );
+    for ( ; n ; n-- ) {
+        if ( ( l = trp_file_read_line_internal( (trp_file_t *)stream ) ) == UNDEF )
+            break;
+        trp_array_insert( a, NULL, l, NULL );
+    }
+    if ( ((trp_array_t *)a)->len == 0 )
+        return UNDEF;
+    return a;
 }
 
 trp_obj_t *trp_read_str( trp_obj_t *stream, trp_obj_t *cnt )
 {
-    FILE *fp;
     uns32b n, i;
     int c;
     CORD_ec x;
 
-    if ( ( ( fp = trp_file_readable_fp( stream ) ) == NULL ) ||
+    if ( ( trp_file_readable( stream ) == NULL ) ||
          trp_cast_uns32b( cnt, &n ) )
         return UNDEF;
     CORD_ec_init( x );
     for ( i = n ; i ; ) {
         i--;
-        c = getc( fp );
+        c = trp_file_getc( (trp_file_t *)stream );
         if ( c == 0 ) {
             /* Append the right number of NULs */
             /* Note that any string of NULs is represented in 4 words, */
@@ -439,7 +719,7 @@ trp_obj_t *trp_read_str( trp_obj_t *stream, trp_obj_t *cnt )
             CORD_ec_flush_buf( x );
             while ( i ) {
                 i--;
-                if ( c = getc( fp ) )
+                if ( c = trp_file_getc( (trp_file_t *)stream ) )
                     break;
                 count++;
             }
@@ -456,18 +736,17 @@ trp_obj_t *trp_read_str( trp_obj_t *stream, trp_obj_t *cnt )
 
 trp_obj_t *trp_read_uint_le( trp_obj_t *stream, trp_obj_t *cnt )
 {
-    FILE *fp;
     uns32b n;
     uns64b c64;
 
-    if ( ( ( fp = trp_file_readable_fp( stream ) ) == NULL ) ||
+    if ( ( trp_file_readable( stream ) == NULL ) ||
          trp_cast_uns32b( cnt, &n ) )
         return UNDEF;
     if ( ( n == 0 ) || ( n > 64 ) || ( n & 7 ) )
         return UNDEF;
     n >>= 3;
     c64 = 0;
-    if ( trp_file_read_chars( fp, (uns8b *)(&c64), n ) != n )
+    if ( trp_file_read_chars_internal( stream, (uns8b *)(&c64), n ) != n )
         return UNDEF;
 #ifdef TRP_BIG_ENDIAN
     c64 = trp_swap_endian64( c64 );
@@ -477,18 +756,17 @@ trp_obj_t *trp_read_uint_le( trp_obj_t *stream, trp_obj_t *cnt )
 
 trp_obj_t *trp_read_uint_be( trp_obj_t *stream, trp_obj_t *cnt )
 {
-    FILE *fp;
     uns32b n;
     uns64b c64;
 
-    if ( ( ( fp = trp_file_readable_fp( stream ) ) == NULL ) ||
+    if ( ( trp_file_readable( stream ) == NULL ) ||
          trp_cast_uns32b( cnt, &n ) )
         return UNDEF;
     if ( ( n == 0 ) || ( n > 64 ) || ( n & 7 ) )
         return UNDEF;
     n >>= 3;
     c64 = 0;
-    if ( trp_file_read_chars( fp, ( (uns8b *)(&c64) ) + ( 8 - n ), n ) != n )
+    if ( trp_file_read_chars_internal( stream, ( (uns8b *)(&c64) ) + ( 8 - n ), n ) != n )
         return UNDEF;
 #ifdef TRP_LITTLE_ENDIAN
     c64 = trp_swap_endian64( c64 );
@@ -498,19 +776,18 @@ trp_obj_t *trp_read_uint_be( trp_obj_t *stream, trp_obj_t *cnt )
 
 trp_obj_t *trp_read_sint_le( trp_obj_t *stream, trp_obj_t *cnt )
 {
-    FILE *fp;
     uns32b n, i;
     uns64b v, m;
     sig64b c64;
     uns8b c[ 8 ];
 
-    if ( ( ( fp = trp_file_readable_fp( stream ) ) == NULL ) ||
+    if ( ( trp_file_readable( stream ) == NULL ) ||
          trp_cast_uns32b( cnt, &n ) )
         return UNDEF;
     if ( ( n == 0 ) || ( n > 64 ) || ( n & 7 ) )
         return UNDEF;
     n >>= 3;
-    if ( trp_file_read_chars( fp, c, n ) != n )
+    if ( trp_file_read_chars_internal( stream, c, n ) != n )
         return UNDEF;
     for ( i = 0, v = 0, m = 0 ; i < n ; i++ ) {
 #ifdef TRP_LITTLE_ENDIAN
@@ -534,19 +811,18 @@ trp_obj_t *trp_read_sint_le( trp_obj_t *stream, trp_obj_t *cnt )
 
 trp_obj_t *trp_read_sint_be( trp_obj_t *stream, trp_obj_t *cnt )
 {
-    FILE *fp;
     uns32b n, i;
     uns64b v, m;
     sig64b c64;
     uns8b c[ 8 ];
 
-    if ( ( ( fp = trp_file_readable_fp( stream ) ) == NULL ) ||
+    if ( ( trp_file_readable( stream ) == NULL ) ||
          trp_cast_uns32b( cnt, &n ) )
         return UNDEF;
     if ( ( n == 0 ) || ( n > 64 ) || ( n & 7 ) )
         return UNDEF;
     n >>= 3;
-    if ( trp_file_read_chars( fp, c, n ) != n )
+    if ( trp_file_read_chars_internal( stream, c, n ) != n )
         return UNDEF;
     for ( i = 0, v = 0, m = 0 ; i < n ; i++ ) {
 #ifdef TRP_LITTLE_ENDIAN
@@ -570,37 +846,36 @@ trp_obj_t *trp_read_sint_be( trp_obj_t *stream, trp_obj_t *cnt )
 
 trp_obj_t *trp_read_float_le( trp_obj_t *stream, trp_obj_t *cnt )
 {
-    FILE *fp;
     uns32b n;
     uns64b c64;
     uns32b c32;
     flt64b d64;
     flt32b d32;
 
-    if ( ( ( fp = trp_file_readable_fp( stream ) ) == NULL ) ||
+    if ( ( trp_file_readable( stream ) == NULL ) ||
          trp_cast_uns32b( cnt, &n ) )
         return UNDEF;
     switch ( n ) {
     case 32:
 #ifdef TRP_BIG_ENDIAN
-        if ( trp_file_read_chars( fp, (uns8b *)(&c32), 4 ) != 4 )
+        if ( trp_file_read_chars_internal( stream, (uns8b *)(&c32), 4 ) != 4 )
             return UNDEF;
         c32 = trp_swap_endian32( c32 );
         d32 = *((flt32b *)(&c32));
 #else
-        if ( trp_file_read_chars( fp, (uns8b *)(&d32), 4 ) != 4 )
+        if ( trp_file_read_chars_internal( stream, (uns8b *)(&d32), 4 ) != 4 )
             return UNDEF;
 #endif
         d64 = (flt64b)d32;
         break;
     case 64:
 #ifdef TRP_BIG_ENDIAN
-        if ( trp_file_read_chars( fp, (uns8b *)(&c64), 8 ) != 8 )
+        if ( trp_file_read_chars_internal( stream, (uns8b *)(&c64), 8 ) != 8 )
             return UNDEF;
         c64 = trp_swap_endian64( c64 );
         d64 = *((flt64b *)(&c64));
 #else
-        if ( trp_file_read_chars( fp, (uns8b *)(&d64), 8 ) != 8 )
+        if ( trp_file_read_chars_internal( stream, (uns8b *)(&d64), 8 ) != 8 )
             return UNDEF;
 #endif
         break;
@@ -612,37 +887,36 @@ trp_obj_t *trp_read_float_le( trp_obj_t *stream, trp_obj_t *cnt )
 
 trp_obj_t *trp_read_float_be( trp_obj_t *stream, trp_obj_t *cnt )
 {
-    FILE *fp;
     uns32b n;
     uns64b c64;
     uns32b c32;
     flt64b d64;
     flt32b d32;
 
-    if ( ( ( fp = trp_file_readable_fp( stream ) ) == NULL ) ||
+    if ( ( trp_file_readable( stream ) == NULL ) ||
          trp_cast_uns32b( cnt, &n ) )
         return UNDEF;
     switch ( n ) {
     case 32:
 #ifdef TRP_LITTLE_ENDIAN
-        if ( trp_file_read_chars( fp, (uns8b *)(&c32), 4 ) != 4 )
+        if ( trp_file_read_chars_internal( stream, (uns8b *)(&c32), 4 ) != 4 )
             return UNDEF;
         c32 = trp_swap_endian32( c32 );
         d32 = *((flt32b *)(&c32));
 #else
-        if ( trp_file_read_chars( fp, (uns8b *)(&d32), 4 ) != 4 )
+        if ( trp_file_read_chars_internal( stream, (uns8b *)(&d32), 4 ) != 4 )
             return UNDEF;
 #endif
         d64 = (flt64b)d32;
         break;
     case 64:
 #ifdef TRP_LITTLE_ENDIAN
-        if ( trp_file_read_chars( fp, (uns8b *)(&c64), 8 ) != 8 )
+        if ( trp_file_read_chars_internal( stream, (uns8b *)(&c64), 8 ) != 8 )
             return UNDEF;
         c64 = trp_swap_endian64( c64 );
         d64 = *((flt64b *)(&c64));
 #else
-        if ( trp_file_read_chars( fp, (uns8b *)(&d64), 8 ) != 8 )
+        if ( trp_file_read_chars_internal( stream, (uns8b *)(&d64), 8 ) != 8 )
             return UNDEF;
 #endif
         break;
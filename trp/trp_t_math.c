@@ -48,6 +48,12 @@ static void trp_math_sqrt_internal( mpq_t op, mpq_t res );
 #define LLMAXINT 0x7fffffffffffffffLL
 #define LLMININT 0x8000000000000000LL
 
+#if ( TRP_SIG64_CACHE_MIN > 0 ) || ( TRP_SIG64_CACHE_MAX < 10 )
+#error "TRP_SIG64_CACHE_MIN..TRP_SIG64_CACHE_MAX deve contenere 0, 1 e 10"
+#endif
+
+static trp_sig64_t *_trp_sig64 = NULL;
+
 uns8b trp_sig64_print( trp_print_t *p, trp_sig64_t *obj )
 {
     return trp_print_sig64( p, obj->val );
@@ -483,16 +489,25 @@ trp_obj_t *trp_math_gmp_version()
     return trp_cord( (uns8b *)gmp_version );
 }
 
+void trp_sig64_init()
+{
+    if ( _trp_sig64 == NULL ) {
+        sig64b i;
+
+        _trp_sig64 = trp_gc_malloc_atomic( sizeof( trp_sig64_t ) * ( TRP_SIG64_CACHE_MAX - TRP_SIG64_CACHE_MIN + 1 ) );
+        for ( i = TRP_SIG64_CACHE_MIN ; i <= TRP_SIG64_CACHE_MAX ; i++ ) {
+            _trp_sig64[ i - TRP_SIG64_CACHE_MIN ].tipo = TRP_SIG64;
+            _trp_sig64[ i - TRP_SIG64_CACHE_MIN ].val = i;
+        }
+    }
+}
+
 trp_obj_t *trp_sig64( sig64b val )
 {
     trp_sig64_t *obj;
 
-    if ( val == 0 )
-        return ZERO;
-    if ( val == 1 )
-        return UNO;
-    if ( val == 10 )
-        return DIECI;
+    if ( ( val >= TRP_SIG64_CACHE_MIN ) && ( val <= TRP_SIG64_CACHE_MAX ) )
+        return (trp_obj_t *)( &( _trp_sig64[ val - TRP_SIG64_CACHE_MIN ] ) );
     obj = trp_gc_malloc_atomic( sizeof( trp_sig64_t ) );
     obj->tipo = TRP_SIG64;
     obj->val = val;
@@ -528,38 +543,17 @@ trp_obj_t *trp_complex( trp_obj_t *re, trp_obj_t *im )
 
 trp_obj_t *trp_zero()
 {
-    static trp_obj_t *zero = NULL;
-
-    if ( zero == NULL ) {
-        zero = trp_gc_malloc_atomic( sizeof( trp_sig64_t ) );
-        zero->tipo = TRP_SIG64;
-        ((trp_sig64_t *)zero)->val = 0;
-    }
-    return zero;
+    return (trp_obj_t *)( &( _trp_sig64[ 0 - TRP_SIG64_CACHE_MIN ] ) );
 }
 
 trp_obj_t *trp_uno()
 {
-    static trp_obj_t *uno = NULL;
-
-    if ( uno == NULL ) {
-        uno = trp_gc_malloc_atomic( sizeof( trp_sig64_t ) );
-        uno->tipo = TRP_SIG64;
-        ((trp_sig64_t *)uno)->val = 1;
-    }
-    return uno;
+    return (trp_obj_t *)( &( _trp_sig64[ 1 - TRP_SIG64_CACHE_MIN ] ) );
 }
 
 trp_obj_t *trp_dieci()
 {
-    static trp_obj_t *dieci = NULL;
-
-    if ( dieci == NULL ) {
-        dieci = trp_gc_malloc_atomic( sizeof( trp_sig64_t ) );
-        dieci->tipo = TRP_SIG64;
-        ((trp_sig64_t *)dieci)->val = 10;
-    }
-    return dieci;
+    return (trp_obj_t *)( &( _trp_sig64[ 10 - TRP_SIG64_CACHE_MIN ] ) );
 }
 
 trp_obj_t *trp_maxint()
@@ -1216,11 +1210,30 @@ trp_obj_t *trp_math_cat( trp_obj_t *obj, va_list args )
 {
     mpq_t re, im, qtmp;
     mpz_t ztmp;
+    sig64b acc = 0, t;
 
+    /*
+     finche' gli operandi sono sig64 e non c'e' overflow,
+     si evita del tutto gmp
+     */
+    while ( obj ) {
+        if ( obj->tipo != TRP_SIG64 )
+            break;
+        if ( __builtin_add_overflow( acc, ((trp_sig64_t *)obj)->val, &t ) )
+            break;
+        acc = t;
+        obj = va_arg( args, trp_obj_t * );
+    }
+    if ( obj == NULL )
+        return trp_sig64( acc );
     mpq_init( re );
     mpq_init( im );
     mpq_init( qtmp );
     mpz_init( ztmp );
+    if ( acc ) {
+        trp_math_sig64_to_mpz( acc, ztmp );
+        mpq_set_z( re, ztmp );
+    }
     while ( obj ) {
         switch ( obj->tipo ) {
         case TRP_SIG64:
@@ -1286,11 +1299,39 @@ trp_obj_t *trp_math_minus( trp_obj_t *obj, ... )
         va_end( args );
         return obj;
     }
-    mpq_init( re );
-    mpq_init( im );
-    mpq_init( qtmp );
-    mpz_init( ztmp );
     op = mpq_add;
+    if ( obj->tipo == TRP_SIG64 ) {
+        sig64b acc = ((trp_sig64_t *)obj)->val, t;
+
+        /*
+         finche' gli operandi sono sig64 e non c'e' overflow,
+         si evita del tutto gmp
+         */
+        for ( ; ; ) {
+            obj = va_arg( args, trp_obj_t * );
+            if ( obj == NULL ) {
+                va_end( args );
+                return trp_sig64( acc );
+            }
+            if ( obj->tipo != TRP_SIG64 )
+                break;
+            if ( __builtin_sub_overflow( acc, ((trp_sig64_t *)obj)->val, &t ) )
+                break;
+            acc = t;
+        }
+        mpq_init( re );
+        mpq_init( im );
+        mpq_init( qtmp );
+        mpz_init( ztmp );
+        trp_math_sig64_to_mpz( acc, ztmp );
+        mpq_set_z( re, ztmp );
+        op = mpq_sub;
+    } else {
+        mpq_init( re );
+        mpq_init( im );
+        mpq_init( qtmp );
+        mpz_init( ztmp );
+    }
     while ( obj ) {
         switch ( obj->tipo ) {
         case TRP_SIG64:
@@ -1395,14 +1436,33 @@ trp_obj_t *trp_math_times( trp_obj_t *obj, ... )
     mpz_t ztmp;
     va_list args;
 
+    sig64b acc = 1, t;
+
+    va_start( args, obj );
+    /*
+     finche' gli operandi sono sig64 e non c'e' overflow,
+     si evita del tutto gmp
+     */
+    while ( obj ) {
+        if ( obj->tipo != TRP_SIG64 )
+            break;
+        if ( __builtin_mul_overflow( acc, ((trp_sig64_t *)obj)->val, &t ) )
+            break;
+        acc = t;
+        obj = va_arg( args, trp_obj_t * );
+    }
+    if ( obj == NULL ) {
+        va_end( args );
+        return trp_sig64( acc );
+    }
     mpq_init( re );
     mpq_init( im );
     mpq_init( qtmp );
     mpq_init( qaux1 );
     mpq_init( qaux2 );
     mpz_init( ztmp );
-    mpq_set_ui( re, 1, 1 );
-    va_start( args, obj );
+    trp_math_sig64_to_mpz( acc, ztmp );
+    mpq_set_z( re, ztmp );
     for ( ; obj ; obj = va_arg( args, trp_obj_t * ) ) {
         switch ( obj->tipo ) {
         case TRP_SIG64:
@@ -1601,8 +1661,44 @@ trp_obj_t *trp_math_ratio( trp_obj_t *obj, ... )
     return trp_math_result_from_complex( re, im );
 }
 
+trp_obj_t *trp_math_minus2( trp_obj_t *o1, trp_obj_t *o2 )
+{
+    sig64b res;
+
+    if ( ( o1->tipo == TRP_SIG64 ) && ( o2->tipo == TRP_SIG64 ) )
+        if ( !__builtin_sub_overflow( ((trp_sig64_t *)o1)->val,
+                                      ((trp_sig64_t *)o2)->val,
+                                      &res ) )
+            return trp_sig64( res );
+    return trp_math_minus( o1, o2, NULL );
+}
+
+trp_obj_t *trp_math_times2( trp_obj_t *o1, trp_obj_t *o2 )
+{
+    sig64b res;
+
+    if ( ( o1->tipo == TRP_SIG64 ) && ( o2->tipo == TRP_SIG64 ) )
+        if ( !__builtin_mul_overflow( ((trp_sig64_t *)o1)->val,
+                                      ((trp_sig64_t *)o2)->val,
+                                      &res ) )
+            return trp_sig64( res );
+    return trp_math_times( o1, o2, NULL );
+}
+
 trp_obj_t *trp_math_div( trp_obj_t *o1, trp_obj_t *o2 )
 {
+    if ( ( o1->tipo == TRP_SIG64 ) && ( o2->tipo == TRP_SIG64 ) ) {
+        sig64b a = ((trp_sig64_t *)o1)->val, b = ((trp_sig64_t *)o2)->val, q;
+
+        if ( b == 0 )
+            return UNDEF;
+        if ( ( b != -1 ) || ( a != (sig64b)LLMININT ) ) {
+            q = a / b;
+            if ( ( a % b ) && ( ( a < 0 ) != ( b < 0 ) ) )
+                q--;
+            return trp_sig64( q );
+        }
+    }
     /*
      FIXME
      andrebbe riscritto meglio
@@ -1612,6 +1708,18 @@ trp_obj_t *trp_math_div( trp_obj_t *o1, trp_obj_t *o2 )
 
 trp_obj_t *trp_math_mod( trp_obj_t *o1, trp_obj_t *o2 )
 {
+    if ( ( o1->tipo == TRP_SIG64 ) && ( o2->tipo == TRP_SIG64 ) ) {
+        sig64b a = ((trp_sig64_t *)o1)->val, b = ((trp_sig64_t *)o2)->val, r;
+
+        if ( b == 0 )
+            return UNDEF;
+        if ( b == -1 )
+            return ZERO;
+        r = a % b;
+        if ( r && ( ( r < 0 ) != ( b < 0 ) ) )
+            r += b;
+        return trp_sig64( r );
+    }
     /*
      FIXME
      andrebbe riscritto meglio
@@ -0,0 +1,706 @@
+/*
+    TreeP Run Time Support
+    Copyright (C) 2008-2026 Frank Sinapsi
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trp.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ blocchi del prodotto: una fascia di TRP_MATRIX_BK righe per
+ TRP_MATRIX_BJ colonne del secondo fattore (256 KB) resta in cache
+ */
+
+#define TRP_MATRIX_BK 128
+#define TRP_MATRIX_BJ 256
+#define TRP_MATRIX_NB 64
+#define TRP_MATRIX_PAR_MIN 0x400000
+#define TRP_MATRIX_MAX_LEN 0x1ffffff0
+
+typedef struct {
+    flt64b *a;
+    flt64b *b;
+    flt64b *c;
+    uns32b a_rs;
+    uns32b a_cs;
+    uns32b ldb;
+    uns32b ldc;
+    uns32b n;
+    uns32b p;
+    uns32b r0;
+    uns32b r1;
+    uns8b neg;
+} trp_matrix_mult_par_t;
+
+typedef struct {
+    flt64b *lu;
+    flt64b *x;
+    uns32b n;
+    uns32b m;
+    uns32b c0;
+    uns32b c1;
+} trp_matrix_solve_par_t;
+
+static trp_matrix_t *trp_matrix_new( uns32b rows, uns32b cols );
+static trp_obj_t *trp_matrix_val( flt64b val );
+static flt64b *trp_matrix_dense( trp_matrix_t *mx );
+static void trp_matrix_axpy( flt64b *y, flt64b a, flt64b *x, uns32b n );
+static uns32b trp_matrix_parts( uns64b work, uns32b len );
+static void *trp_matrix_mult_routine( void *arg );
+static void trp_matrix_mult_low( trp_matrix_mult_par_t *par, uns32b m );
+static uns8b trp_matrix_lu( flt64b *a, uns32b n, uns32b *perm, sig32b *sign );
+static void *trp_matrix_solve_routine( void *arg );
+static trp_obj_t *trp_matrix_solve_low( flt64b *lu, uns32b *perm, uns32b n, trp_matrix_t *b );
+static uns8b trp_matrix_check( trp_obj_t *mx );
+
+uns8b trp_matrix_print( trp_print_t *p, trp_matrix_t *obj )
+{
+    if ( trp_print_char_star( p, "#matrix (rows=" ) )
+        return 1;
+    if ( trp_print_sig64( p, obj->rows ) )
+        return 1;
+    if ( trp_print_char_star( p, ", cols=" ) )
+        return 1;
+    if ( trp_print_sig64( p, obj->cols ) )
+        return 1;
+    return trp_print_char_star( p, ")#" );
+}
+
+uns32b trp_matrix_size( trp_matrix_t *obj )
+{
+    return 1 + 4 + 4 + 8 * obj->rows * obj->cols;
+}
+
+void trp_matrix_encode( trp_matrix_t *obj, uns8b **buf )
+{
+    uns32b *p, i, j;
+    uns64b *q, v;
+
+    **buf = TRP_MATRIX;
+    ++(*buf);
+    p = (uns32b *)(*buf);
+    *p = norm32( obj->rows );
+    (*buf) += 4;
+    p = (uns32b *)(*buf);
+    *p = norm32( obj->cols );
+    (*buf) += 4;
+    for ( i = 0 ; i < obj->rows ; i++ )
+        for ( j = 0 ; j < obj->cols ; j++ ) {
+            memcpy( &v, obj->data + (uns64b)i * obj->rs + (uns64b)j * obj->cs, 8 );
+            q = (uns64b *)(*buf);
+            *q = norm64( v );
+            (*buf) += 8;
+        }
+}
+
+trp_obj_t *trp_matrix_decode( uns8b **buf )
+{
+    trp_matrix_t *res;
+    uns32b rows, cols, i, n;
+    uns64b v;
+
+    rows = norm32( *((uns32b *)(*buf)) );
+    (*buf) += 4;
+    cols = norm32( *((uns32b *)(*buf)) );
+    (*buf) += 4;
+    res = trp_matrix_new( rows, cols );
+    if ( res == NULL )
+        return UNDEF;
+    for ( i = 0, n = rows * cols ; i < n ; i++ ) {
+        v = norm64( *((uns64b *)(*buf)) );
+        (*buf) += 8;
+        memcpy( res->data + i, &v, 8 );
+    }
+    return (trp_obj_t *)res;
+}
+
+trp_obj_t *trp_matrix_equal( trp_matrix_t *o1, trp_matrix_t *o2 )
+{
+    uns32b i, j;
+
+    if ( ( o1->rows != o2->rows ) || ( o1->cols != o2->cols ) )
+        return TRP_FALSE;
+    for ( i = 0 ; i < o1->rows ; i++ )
+        for ( j = 0 ; j < o1->cols ; j++ )
+            if ( o1->data[ (uns64b)i * o1->rs + (uns64b)j * o1->cs ] !=
+                 o2->data[ (uns64b)i * o2->rs + (uns64b)j * o2->cs ] )
+                return TRP_FALSE;
+    return TRP_TRUE;
+}
+
+trp_obj_t *trp_matrix_length( trp_matrix_t *obj )
+{
+    return trp_sig64( obj->rows );
+}
+
+trp_obj_t *trp_matrix_width( trp_matrix_t *obj )
+{
+    return trp_sig64( obj->cols );
+}
+
+trp_obj_t *trp_matrix_height( trp_matrix_t *obj )
+{
+    return trp_sig64( obj->rows );
+}
+
+static trp_matrix_t *trp_matrix_new( uns32b rows, uns32b cols )
+{
+    trp_matrix_t *mx;
+
+    if ( ( rows == 0 ) || ( cols == 0 ) ||
+         ( (uns64b)rows * (uns64b)cols > TRP_MATRIX_MAX_LEN ) )
+        return NULL;
+    mx = trp_gc_malloc( sizeof( trp_matrix_t ) );
+    mx->tipo = TRP_MATRIX;
+    mx->rows = rows;
+    mx->cols = cols;
+    mx->rs = cols;
+    mx->cs = 1;
+    mx->data = trp_gc_malloc_atomic( sizeof( flt64b ) * rows * cols );
+    return mx;
+}
+
+static trp_obj_t *trp_matrix_val( flt64b val )
+{
+    return isfinite( val ) ? trp_double( val ) : UNDEF;
+}
+
+static uns8b trp_matrix_check( trp_obj_t *mx )
+{
+    return ( mx->tipo == TRP_MATRIX ) ? 0 : 1;
+}
+
+/*
+ copia densa per righe (rs == cols, cs == 1)
+ */
+
+static flt64b *trp_matrix_dense( trp_matrix_t *mx )
+{
+    flt64b *res = trp_gc_malloc_atomic( sizeof( flt64b ) * mx->rows * mx->cols ), *r, *s;
+    uns32b i, j;
+
+    for ( i = 0, r = res ; i < mx->rows ; i++ ) {
+        s = mx->data + (uns64b)i * mx->rs;
+        if ( mx->cs == 1 ) {
+            memcpy( r, s, sizeof( flt64b ) * mx->cols );
+            r += mx->cols;
+        } else
+            for ( j = 0 ; j < mx->cols ; j++, s += mx->cs )
+                *r++ = *s;
+    }
+    return res;
+}
+
+trp_obj_t *trp_matrix( trp_obj_t *rows, trp_obj_t *cols, trp_obj_t *val )
+{
+    trp_matrix_t *mx;
+    uns32b r, c, i;
+    flt64b v;
+
+    if ( trp_cast_uns32b_range( rows, &r, 1, 0xffffffff ) ||
+         trp_cast_uns32b_range( cols, &c, 1, 0xffffffff ) )
+        return UNDEF;
+    if ( val ) {
+        if ( trp_cast_flt64b( val, &v ) )
+            return UNDEF;
+    } else
+        v = 0.0;
+    if ( ( mx = trp_matrix_new( r, c ) ) == NULL )
+        return UNDEF;
+    if ( v == 0.0 )
+        memset( mx->data, 0, sizeof( flt64b ) * r * c );
+    else
+        for ( i = 0 ; i < r * c ; i++ )
+            mx->data[ i ] = v;
+    return (trp_obj_t *)mx;
+}
+
+trp_obj_t *trp_matrix_ident( trp_obj_t *n )
+{
+    trp_matrix_t *mx;
+    uns32b i;
+
+    if ( ( mx = (trp_matrix_t *)trp_matrix( n, n, NULL ) ) == (trp_matrix_t *)UNDEF )
+        return UNDEF;
+    for ( i = 0 ; i < mx->rows ; i++ )
+        mx->data[ (uns64b)i * ( mx->cols + 1 ) ] = 1.0;
+    return (trp_obj_t *)mx;
+}
+
+/*
+ da array di array (righe tutte della stessa lunghezza)
+ */
+
+trp_obj_t *trp_matrix_from_array( trp_obj_t *a )
+{
+    trp_matrix_t *mx;
+    trp_obj_t *row;
+    uns32b r, c, i, j;
+
+    if ( a->tipo != TRP_ARRAY )
+        return UNDEF;
+    if ( ( r = ((trp_array_t *)a)->len ) == 0 )
+        return UNDEF;
+    row = ((trp_array_t *)a)->data[ 0 ];
+    if ( row->tipo != TRP_ARRAY )
+        return UNDEF;
+    c = ((trp_array_t *)row)->len;
+    if ( ( mx = trp_matrix_new( r, c ) ) == NULL )
+        return UNDEF;
+    for ( i = 0 ; i < r ; i++ ) {
+        row = ((trp_array_t *)a)->data[ i ];
+        if ( ( row->tipo != TRP_ARRAY ) || ( ((trp_array_t *)row)->len != c ) ) {
+            trp_gc_free( mx->data );
+            trp_gc_free( mx );
+            return UNDEF;
+        }
+        for ( j = 0 ; j < c ; j++ )
+            if ( trp_cast_flt64b( ((trp_array_t *)row)->data[ j ], mx->data + (uns64b)i * c + j ) ) {
+                trp_gc_free( mx->data );
+                trp_gc_free( mx );
+                return UNDEF;
+            }
+    }
+    return (trp_obj_t *)mx;
+}
+
+trp_obj_t *trp_matrix_to_array( trp_obj_t *mx )
+{
+    trp_matrix_t *m = (trp_matrix_t *)mx;
+    trp_obj_t *res, *row;
+    uns32b i, j;
+
+    if ( trp_matrix_check( mx ) )
+        return UNDEF;
+    res = trp_array_ext_internal( UNDEF, 10, m->rows );
+    for ( i = 0 ; i < m->rows ; i++ ) {
+        row = trp_array_ext_internal( UNDEF, 10, m->cols );
+        for ( j = 0 ; j < m->cols ; j++ )
+            ((trp_array_t *)row)->data[ j ] = trp_matrix_val( m->data[ (uns64b)i * m->rs + (uns64b)j * m->cs ] );
+        ((trp_array_t *)res)->data[ i ] = row;
+    }
+    return res;
+}
+
+trp_obj_t *trp_matrix_get( trp_obj_t *mx, trp_obj_t *i, trp_obj_t *j )
+{
+    trp_matrix_t *m = (trp_matrix_t *)mx;
+    uns32b ii, jj;
+
+    if ( trp_matrix_check( mx ) )
+        return UNDEF;
+    if ( trp_cast_uns32b_range( i, &ii, 0, m->rows - 1 ) ||
+         trp_cast_uns32b_range( j, &jj, 0, m->cols - 1 ) )
+        return UNDEF;
+    return trp_matrix_val( m->data[ (uns64b)ii * m->rs + (uns64b)jj * m->cs ] );
+}
+
+uns8b trp_matrix_set( trp_obj_t *mx, trp_obj_t *i, trp_obj_t *j, trp_obj_t *val )
+{
+    trp_matrix_t *m = (trp_matrix_t *)mx;
+    uns32b ii, jj;
+    flt64b v;
+
+    if ( trp_matrix_check( mx ) )
+        return 1;
+    if ( trp_cast_uns32b_range( i, &ii, 0, m->rows - 1 ) ||
+         trp_cast_uns32b_range( j, &jj, 0, m->cols - 1 ) ||
+         trp_cast_flt64b( val, &v ) )
+        return 1;
+    m->data[ (uns64b)ii * m->rs + (uns64b)jj * m->cs ] = v;
+    return 0;
+}
+
+/*
+ la trasposta è una vista: condivide i dati con mx
+ */
+
+trp_obj_t *trp_matrix_transpose( trp_obj_t *mx )
+{
+    trp_matrix_t *m = (trp_matrix_t *)mx, *res;
+
+    if ( trp_matrix_check( mx ) )
+        return UNDEF;
+    res = trp_gc_malloc( sizeof( trp_matrix_t ) );
+    res->tipo = TRP_MATRIX;
+    res->rows = m->cols;
+    res->cols = m->rows;
+    res->rs = m->cs;
+    res->cs = m->rs;
+    res->data = m->data;
+    return (trp_obj_t *)res;
+}
+
+trp_obj_t *trp_matrix_clone( trp_obj_t *mx )
+{
+    trp_matrix_t *m = (trp_matrix_t *)mx, *res;
+
+    if ( trp_matrix_check( mx ) )
+        return UNDEF;
+    res = trp_gc_malloc( sizeof( trp_matrix_t ) );
+    res->tipo = TRP_MATRIX;
+    res->rows = m->rows;
+    res->cols = m->cols;
+    res->rs = m->cols;
+    res->cs = 1;
+    res->data = trp_matrix_dense( m );
+    return (trp_obj_t *)res;
+}
+
+/*
+ y += a * x
+ */
+
+static void trp_matrix_axpy( flt64b *y, flt64b a, flt64b *x, uns32b n )
+{
+    uns32b j = 0;
+
+#ifdef __SSE2__
+    __m128d va = _mm_set1_pd( a );
+
+    for ( ; j + 4 <= n ; j += 4 ) {
+        _mm_storeu_pd( y + j, _mm_add_pd( _mm_loadu_pd( y + j ),
+                                          _mm_mul_pd( va, _mm_loadu_pd( x + j ) ) ) );
+        _mm_storeu_pd( y + j + 2, _mm_add_pd( _mm_loadu_pd( y + j + 2 ),
+                                              _mm_mul_pd( va, _mm_loadu_pd( x + j + 2 ) ) ) );
+    }
+#endif
+    for ( ; j < n ; j++ )
+        y[ j ] += a * x[ j ];
+}
+
+/*
+ numero di thread per un lavoro di work operazioni
+ diviso in fasce di almeno 32 fra len
+ */
+
+static uns32b trp_matrix_parts( uns64b work, uns32b len )
+{
+    uns32b parts;
+
+    if ( work < TRP_MATRIX_PAR_MIN )
+        return 1;
+    parts = trp_ncpus();
+    if ( parts > len / 32 )
+        parts = len / 32;
+    return parts ? parts : 1;
+}
+
+/*
+ C[r0..r1) (+/-)= A * B, a blocchi di TRP_MATRIX_BK x TRP_MATRIX_BJ di B;
+ A può avere passi qualsiasi, B è per righe
+ */
+
+static void *trp_matrix_mult_routine( void *arg )
+{
+    trp_matrix_mult_par_t *par = (trp_matrix_mult_par_t *)arg;
+    flt64b *ai, *ci, aik;
+    uns32b kk, jj, kmax, jmax, i, k;
+
+    for ( kk = 0 ; kk < par->n ; kk += TRP_MATRIX_BK ) {
+        kmax = ( par->n - kk > TRP_MATRIX_BK ) ? kk + TRP_MATRIX_BK : par->n;
+        for ( jj = 0 ; jj < par->p ; jj += TRP_MATRIX_BJ ) {
+            jmax = ( par->p - jj > TRP_MATRIX_BJ ) ? jj + TRP_MATRIX_BJ : par->p;
+            for ( i = par->r0 ; i < par->r1 ; i++ ) {
+                ai = par->a + (uns64b)i * par->a_rs;
+                ci = par->c + (uns64b)i * par->ldc + jj;
+                for ( k = kk ; k < kmax ; k++ ) {
+                    aik = ai[ (uns64b)k * par->a_cs ];
+                    if ( aik != 0.0 )
+                        trp_matrix_axpy( ci, par->neg ? -aik : aik,
+                                         par->b + (uns64b)k * par->ldb + jj, jmax - jj );
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ divide le m righe di C fra i thread
+ */
+
+static void trp_matrix_mult_low( trp_matrix_mult_par_t *par, uns32b m )
+{
+    trp_matrix_mult_par_t *pp;
+    uns32b parts, i;
+
+    parts = trp_matrix_parts( (uns64b)m * par->n * par->p, m );
+    if ( parts == 1 ) {
+        par->r0 = 0;
+        par->r1 = m;
+        (void)trp_matrix_mult_routine( (void *)par );
+        return;
+    }
+    pp = trp_gc_malloc( sizeof( trp_matrix_mult_par_t ) * parts );
+    for ( i = 0 ; i < parts ; i++ ) {
+        pp[ i ] = *par;
+        pp[ i ].r0 = (uns32b)( ( (uns64b)m * i ) / parts );
+        pp[ i ].r1 = (uns32b)( ( (uns64b)m * ( i + 1 ) ) / parts );
+    }
+    trp_parallel_run( trp_matrix_mult_routine, (void *)pp, sizeof( trp_matrix_mult_par_t ), parts );
+    trp_gc_free( pp );
+}
+
+trp_obj_t *trp_matrix_mult( trp_obj_t *mx1, trp_obj_t *mx2 )
+{
+    trp_matrix_t *a = (trp_matrix_t *)mx1, *b = (trp_matrix_t *)mx2, *res;
+    trp_matrix_mult_par_t par;
+
+    if ( trp_matrix_check( mx1 ) || trp_matrix_check( mx2 ) )
+        return UNDEF;
+    if ( a->cols != b->rows )
+        return UNDEF;
+    if ( ( res = trp_matrix_new( a->rows, b->cols ) ) == NULL )
+        return UNDEF;
+    memset( res->data, 0, sizeof( flt64b ) * a->rows * b->cols );
+    par.a = a->data;
+    par.a_rs = a->rs;
+    par.a_cs = a->cs;
+    if ( b->cs == 1 ) {
+        par.b = b->data;
+        par.ldb = b->rs;
+    } else {
+        par.b = trp_matrix_dense( b );
+        par.ldb = b->cols;
+    }
+    par.c = res->data;
+    par.ldc = b->cols;
+    par.n = a->cols;
+    par.p = b->cols;
+    par.neg = 0;
+    trp_matrix_mult_low( &par, a->rows );
+    if ( par.b != b->data )
+        trp_gc_free( par.b );
+    return (trp_obj_t *)res;
+}
+
+/*
+ fattorizzazione LU a blocchi con pivoting parziale, in loco
+ su una copia densa n x n: L (diagonale unitaria) sotto,
+ U sopra; il grosso del lavoro è l'aggiornamento
+ A22 -= L21 * U12, fatto col prodotto a blocchi;
+ rende 1 se la matrice è singolare
+ */
+
+static uns8b trp_matrix_lu( flt64b *a, uns32b n, uns32b *perm, sig32b *sign )
+{
+    trp_matrix_mult_par_t par;
+    flt64b *r, *s, d, t;
+    uns32b kb, ke, k, i, j, piv;
+
+    for ( i = 0 ; i < n ; i++ )
+        perm[ i ] = i;
+    *sign = 1;
+    for ( kb = 0 ; kb < n ; kb = ke ) {
+        ke = ( n - kb > TRP_MATRIX_NB ) ? kb + TRP_MATRIX_NB : n;
+        /*
+         pannello: colonne kb..ke
+         */
+        for ( k = kb ; k < ke ; k++ ) {
+            piv = k;
+            d = fabs( a[ (uns64b)k * n + k ] );
+            for ( i = k + 1 ; i < n ; i++ )
+                if ( fabs( a[ (uns64b)i * n + k ] ) > d ) {
+                    d = fabs( a[ (uns64b)i * n + k ] );
+                    piv = i;
+                }
+            if ( d == 0.0 )
+                return 1;
+            if ( piv != k ) {
+                r = a + (uns64b)k * n;
+                s = a + (uns64b)piv * n;
+                for ( j = 0 ; j < n ; j++ ) {
+                    t = r[ j ];
+                    r[ j ] = s[ j ];
+                    s[ j ] = t;
+                }
+                j = perm[ k ];
+                perm[ k ] = perm[ piv ];
+                perm[ piv ] = j;
+                *sign = -*sign;
+            }
+            r = a + (uns64b)k * n;
+            d = r[ k ];
+            for ( i = k + 1 ; i < n ; i++ ) {
+                s = a + (uns64b)i * n;
+                s[ k ] /= d;
+                if ( s[ k ] != 0.0 )
+                    trp_matrix_axpy( s + k + 1, -s[ k ], r + k + 1, ke - k - 1 );
+            }
+        }
+        if ( ke == n )
+            break;
+        /*
+         U12 = L11^-1 * A12
+         */
+        for ( k = kb ; k < ke ; k++ )
+            for ( i = k + 1 ; i < ke ; i++ ) {
+                s = a + (uns64b)i * n;
+                if ( s[ k ] != 0.0 )
+                    trp_matrix_axpy( s + ke, -s[ k ], a + (uns64b)k * n + ke, n - ke );
+            }
+        /*
+         A22 -= L21 * U12
+         */
+        par.a = a + (uns64b)ke * n + kb;
+        par.a_rs = n;
+        par.a_cs = 1;
+        par.b = a + (uns64b)kb * n + ke;
+        par.ldb = n;
+        par.c = a + (uns64b)ke * n + ke;
+        par.ldc = n;
+        par.n = ke - kb;
+        par.p = n - ke;
+        par.neg = 1;
+        trp_matrix_mult_low( &par, n - ke );
+    }
+    return 0;
+}
+
+/*
+ sostituzioni in avanti e all'indietro sulle colonne c0..c1 di x
+ */
+
+static void *trp_matrix_solve_routine( void *arg )
+{
+    trp_matrix_solve_par_t *par = (trp_matrix_solve_par_t *)arg;
+    flt64b *lu = par->lu, *xi, *l;
+    uns32b n = par->n, m = par->m, c0 = par->c0, w = par->c1 - par->c0, i, k;
+    flt64b d;
+
+    for ( i = 1 ; i < n ; i++ ) {
+        xi = par->x + (uns64b)i * m + c0;
+        l = lu + (uns64b)i * n;
+        for ( k = 0 ; k < i ; k++ )
+            if ( l[ k ] != 0.0 )
+                trp_matrix_axpy( xi, -l[ k ], par->x + (uns64b)k * m + c0, w );
+    }
+    for ( i = n ; i ; ) {
+        i--;
+        xi = par->x + (uns64b)i * m + c0;
+        l = lu + (uns64b)i * n;
+        for ( k = i + 1 ; k < n ; k++ )
+            if ( l[ k ] != 0.0 )
+                trp_matrix_axpy( xi, -l[ k ], par->x + (uns64b)k * m + c0, w );
+        d = 1.0 / l[ i ];
+        for ( k = 0 ; k < w ; k++ )
+            xi[ k ] *= d;
+    }
+    return NULL;
+}
+
+/*
+ risolve A X = B dati i fattori LU di A;
+ b == NULL sta per l'identità
+ */
+
+static trp_obj_t *trp_matrix_solve_low( flt64b *lu, uns32b *perm, uns32b n, trp_matrix_t *b )
+{
+    trp_matrix_t *res;
+    trp_matrix_solve_par_t *pp;
+    flt64b *s;
+    uns32b m = b ? b->cols : n, parts, i, j;
+
+    if ( ( res = trp_matrix_new( n, m ) ) == NULL )
+        return UNDEF;
+    if ( b == NULL ) {
+        memset( res->data, 0, sizeof( flt64b ) * n * n );
+        for ( i = 0 ; i < n ; i++ )
+            res->data[ (uns64b)i * n + perm[ i ] ] = 1.0;
+    } else
+        for ( i = 0 ; i < n ; i++ ) {
+            s = b->data + (uns64b)perm[ i ] * b->rs;
+            for ( j = 0 ; j < m ; j++, s += b->cs )
+                res->data[ (uns64b)i * m + j ] = *s;
+        }
+    parts = trp_matrix_parts( (uns64b)n * n * m, m );
+    pp = trp_gc_malloc( sizeof( trp_matrix_solve_par_t ) * parts );
+    for ( i = 0 ; i < parts ; i++ ) {
+        pp[ i ].lu = lu;
+        pp[ i ].x = res->data;
+        pp[ i ].n = n;
+        pp[ i ].m = m;
+        pp[ i ].c0 = (uns32b)( ( (uns64b)m * i ) / parts );
+        pp[ i ].c1 = (uns32b)( ( (uns64b)m * ( i + 1 ) ) / parts );
+    }
+    trp_parallel_run( trp_matrix_solve_routine, (void *)pp, sizeof( trp_matrix_solve_par_t ), parts );
+    trp_gc_free( pp );
+    return (trp_obj_t *)res;
+}
+
+trp_obj_t *trp_matrix_det( trp_obj_t *mx )
+{
+    trp_matrix_t *m = (trp_matrix_t *)mx;
+    flt64b *lu, d;
+    uns32b *perm, i;
+    sig32b sign;
+
+    if ( trp_matrix_check( mx ) )
+        return UNDEF;
+    if ( m->rows != m->cols )
+        return UNDEF;
+    lu = trp_matrix_dense( m );
+    perm = trp_gc_malloc_atomic( sizeof( uns32b ) * m->rows );
+    if ( trp_matrix_lu( lu, m->rows, perm, &sign ) )
+        d = 0.0;
+    else
+        for ( i = 0, d = (flt64b)sign ; i < m->rows ; i++ )
+            d *= lu[ (uns64b)i * m->rows + i ];
+    trp_gc_free( perm );
+    trp_gc_free( lu );
+    return trp_matrix_val( d );
+}
+
+trp_obj_t *trp_matrix_inverse( trp_obj_t *mx )
+{
+    return trp_matrix_solve( mx, NULL );
+}
+
+/*
+ soluzione di a X = b; senza b l'inversa di a
+ */
+
+trp_obj_t *trp_matrix_solve( trp_obj_t *a, trp_obj_t *b )
+{
+    trp_matrix_t *m = (trp_matrix_t *)a;
+    trp_obj_t *res;
+    flt64b *lu;
+    uns32b *perm;
+    sig32b sign;
+
+    if ( trp_matrix_check( a ) )
+        return UNDEF;
+    if ( m->rows != m->cols )
+        return UNDEF;
+    if ( b ) {
+        if ( trp_matrix_check( b ) )
+            return UNDEF;
+        if ( ((trp_matrix_t *)b)->rows != m->rows )
+            return UNDEF;
+    }
+    lu = trp_matrix_dense( m );
+    perm = trp_gc_malloc_atomic( sizeof( uns32b ) * m->rows );
+    if ( trp_matrix_lu( lu, m->rows, perm, &sign ) )
+        res = UNDEF;
+    else
+        res = trp_matrix_solve_low( lu, perm, m->rows, (trp_matrix_t *)b );
+    trp_gc_free( perm );
+    trp_gc_free( lu );
+    return res;
+}
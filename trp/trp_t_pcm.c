@@ -0,0 +1,713 @@
+/*
+    TreeP Run Time Support
+    Copyright (C) 2008-2026 Frank Sinapsi
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trp.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TRP_PCM_CHUNK 65536
+
+static trp_pcm_t *trp_pcm_new( uns8b fmt, uns8b bps, uns32b channels, uns32b frequency, uns32b len );
+static uns32b trp_pcm_ssize( trp_pcm_t *pcm );
+static uns64b trp_pcm_bytes( trp_pcm_t *pcm );
+static void trp_pcm_convert( trp_pcm_t *pcm, uns64b off, uns8b *s, uns32b n );
+static void trp_pcm_store( trp_pcm_t *pcm, uns8b *d );
+static flt64b trp_pcm_sample( trp_pcm_t *pcm, uns64b i );
+static uns8b trp_pcm_range( trp_obj_t *pcm, trp_obj_t *ch, trp_obj_t *beg, trp_obj_t *len, uns32b *c, uns32b *b, uns32b *l );
+static flt64b trp_pcm_sumsq( trp_pcm_t *pcm, uns64b i, uns64b n, uns32b step );
+static flt64b trp_pcm_max( trp_pcm_t *pcm, uns64b i, uns64b n, uns32b step );
+static uns64b trp_pcm_find( trp_pcm_t *pcm, uns64b i, uns64b n, flt64b thr, uns8b loud );
+
+uns8b trp_pcm_print( trp_print_t *p, trp_pcm_t *obj )
+{
+    if ( trp_print_char_star( p, "#pcm (channels=" ) )
+        return 1;
+    if ( trp_print_sig64( p, obj->channels ) )
+        return 1;
+    if ( trp_print_char_star( p, ", frames=" ) )
+        return 1;
+    if ( trp_print_sig64( p, obj->len ) )
+        return 1;
+    return trp_print_char_star( p, ")#" );
+}
+
+uns32b trp_pcm_size( trp_pcm_t *obj )
+{
+    uns64b sz = 1 + 1 + 1 + 4 + 4 + 4 + trp_pcm_bytes( obj );
+
+    if ( sz > 0xffffffff )
+        return trp_special_size( (trp_special_t *)UNDEF );
+    return (uns32b)sz;
+}
+
+void trp_pcm_encode( trp_pcm_t *obj, uns8b **buf )
+{
+    uns32b *p;
+
+    if ( trp_pcm_bytes( obj ) > 0xffffffff - 15 ) {
+        trp_special_encode( (trp_special_t *)UNDEF, buf );
+        return;
+    }
+    **buf = TRP_PCM;
+    ++(*buf);
+    **buf = obj->fmt;
+    ++(*buf);
+    **buf = obj->bps;
+    ++(*buf);
+    p = (uns32b *)(*buf);
+    *p = norm32( obj->channels );
+    (*buf) += 4;
+    p = (uns32b *)(*buf);
+    *p = norm32( obj->frequency );
+    (*buf) += 4;
+    p = (uns32b *)(*buf);
+    *p = norm32( obj->len );
+    (*buf) += 4;
+    trp_pcm_store( obj, *buf );
+    (*buf) += trp_pcm_bytes( obj );
+}
+
+trp_obj_t *trp_pcm_decode( uns8b **buf )
+{
+    trp_pcm_t *res;
+    uns32b channels, frequency, len;
+    uns8b fmt, bps;
+
+    fmt = **buf;
+    ++(*buf);
+    bps = **buf;
+    ++(*buf);
+    channels = norm32( *((uns32b *)(*buf)) );
+    (*buf) += 4;
+    frequency = norm32( *((uns32b *)(*buf)) );
+    (*buf) += 4;
+    len = norm32( *((uns32b *)(*buf)) );
+    (*buf) += 4;
+    /*
+     i campioni codificati sono a 16 o 32 bit
+     */
+    res = trp_pcm_new( fmt, ( fmt == TRP_PCM_S16 ) ? 16 : 32, channels, frequency, len );
+    trp_pcm_convert( res, 0, *buf, len * channels );
+    res->bps = bps;
+    (*buf) += trp_pcm_bytes( res );
+    return (trp_obj_t *)res;
+}
+
+trp_obj_t *trp_pcm_equal( trp_pcm_t *o1, trp_pcm_t *o2 )
+{
+    if ( ( o1->fmt != o2->fmt ) || ( o1->bps != o2->bps ) || ( o1->channels != o2->channels ) ||
+         ( o1->frequency != o2->frequency ) || ( o1->len != o2->len ) )
+        return TRP_FALSE;
+    return memcmp( o1->data, o2->data, trp_pcm_bytes( o1 ) ) ? TRP_FALSE : TRP_TRUE;
+}
+
+trp_obj_t *trp_pcm_length( trp_pcm_t *obj )
+{
+    return trp_sig64( obj->len );
+}
+
+trp_obj_t *trp_pcm_width( trp_pcm_t *obj )
+{
+    return trp_sig64( obj->channels );
+}
+
+static trp_pcm_t *trp_pcm_new( uns8b fmt, uns8b bps, uns32b channels, uns32b frequency, uns32b len )
+{
+    trp_pcm_t *pcm;
+
+    pcm = trp_gc_malloc( sizeof( trp_pcm_t ) );
+    pcm->tipo = TRP_PCM;
+    pcm->fmt = fmt;
+    pcm->bps = bps;
+    pcm->channels = channels;
+    pcm->frequency = frequency;
+    pcm->len = len;
+    pcm->data = trp_gc_malloc_atomic( trp_pcm_bytes( pcm ) );
+    return pcm;
+}
+
+static uns32b trp_pcm_ssize( trp_pcm_t *pcm )
+{
+    return ( pcm->fmt == TRP_PCM_S16 ) ? 2 : 4;
+}
+
+static uns64b trp_pcm_bytes( trp_pcm_t *pcm )
+{
+    return (uns64b)( pcm->len ) * pcm->channels * trp_pcm_ssize( pcm );
+}
+
+/*
+ n campioni little endian del sorgente (bps bit ciascuno) in
+ data a partire dal campione off; gli 8 bit (senza segno nei WAV)
+ vengono centrati sullo zero, i 24 bit estesi col segno
+ */
+
+static void trp_pcm_convert( trp_pcm_t *pcm, uns64b off, uns8b *s, uns32b n )
+{
+    sig16b *d16 = (sig16b *)( pcm->data ) + off;
+    sig32b *d32 = (sig32b *)( pcm->data ) + off;
+    uns32b u;
+
+    switch ( pcm->bps ) {
+    case 8:
+        for ( ; n ; n--, s++ )
+            *d16++ = (sig16b)( (sig32b)( *s ) - 128 );
+        break;
+    case 16:
+        for ( ; n ; n--, s += 2 )
+            *d16++ = (sig16b)( (uns16b)( s[ 0 ] ) | ( (uns16b)( s[ 1 ] ) << 8 ) );
+        break;
+    case 24:
+        for ( ; n ; n--, s += 3 )
+            *d32++ = ( (sig32b)( ( (uns32b)( s[ 0 ] ) << 8 ) |
+                                 ( (uns32b)( s[ 1 ] ) << 16 ) |
+                                 ( (uns32b)( s[ 2 ] ) << 24 ) ) ) >> 8;
+        break;
+    case 32:
+        for ( ; n ; n--, s += 4 ) {
+            u = (uns32b)( s[ 0 ] ) | ( (uns32b)( s[ 1 ] ) << 8 ) |
+                ( (uns32b)( s[ 2 ] ) << 16 ) | ( (uns32b)( s[ 3 ] ) << 24 );
+            memcpy( d32++, &u, 4 );
+        }
+        break;
+    }
+}
+
+/*
+ i campioni in d, little endian, nel formato di data
+ */
+
+static void trp_pcm_store( trp_pcm_t *pcm, uns8b *d )
+{
+    uns64b n = (uns64b)( pcm->len ) * pcm->channels, i;
+    uns32b u;
+
+    if ( pcm->fmt == TRP_PCM_S16 ) {
+        sig16b *s = (sig16b *)( pcm->data );
+
+        for ( i = 0 ; i < n ; i++ ) {
+            u = (uns16b)( s[ i ] );
+            *d++ = (uns8b)u;
+            *d++ = (uns8b)( u >> 8 );
+        }
+    } else {
+        uns8b *s = (uns8b *)( pcm->data );
+
+        for ( i = 0 ; i < n ; i++, s += 4 ) {
+            memcpy( &u, s, 4 );
+            *d++ = (uns8b)u;
+            *d++ = (uns8b)( u >> 8 );
+            *d++ = (uns8b)( u >> 16 );
+            *d++ = (uns8b)( u >> 24 );
+        }
+    }
+}
+
+static flt64b trp_pcm_sample( trp_pcm_t *pcm, uns64b i )
+{
+    switch ( pcm->fmt ) {
+    case TRP_PCM_S16:
+        return (flt64b)( ((sig16b *)( pcm->data ))[ i ] );
+    case TRP_PCM_S32:
+        return (flt64b)( ((sig32b *)( pcm->data ))[ i ] );
+    }
+    return (flt64b)( ((flt32b *)( pcm->data ))[ i ] );
+}
+
+/*
+ legge frames frame di channels campioni a bps bit dalla posizione
+ pos di un file o di un raw (non compresso); format 3 indica
+ campioni float a 32 bit (WAVE_FORMAT_IEEE_FLOAT); se il
+ sorgente finisce prima si rendono i frame letti
+ */
+
+trp_obj_t *trp_pcm_read( trp_obj_t *src, trp_obj_t *pos, trp_obj_t *frames, trp_obj_t *channels, trp_obj_t *bps, trp_obj_t *frequency, trp_obj_t *format )
+{
+    trp_pcm_t *pcm;
+    uns8b *buf, fmt;
+    sig64b p, l;
+    uns32b nf, ch, b, fr, f = 1, fb, cf, got, n, na;
+
+    if ( trp_cast_sig64b_range( pos, &p, 0, 0x7fffffffffffffffLL ) ||
+         trp_cast_uns32b( frames, &nf ) ||
+         trp_cast_uns32b_range( channels, &ch, 1, 0xffff ) ||
+         trp_cast_uns32b( bps, &b ) ||
+         trp_cast_uns32b_range( frequency, &fr, 1, 0xffffffff ) )
+        return UNDEF;
+    if ( format )
+        if ( trp_cast_uns32b( format, &f ) )
+            return UNDEF;
+    if ( f == 3 ) {
+        if ( b != 32 )
+            return UNDEF;
+        fmt = TRP_PCM_F32;
+    } else if ( ( b == 8 ) || ( b == 16 ) )
+        fmt = TRP_PCM_S16;
+    else if ( ( b == 24 ) || ( b == 32 ) )
+        fmt = TRP_PCM_S32;
+    else
+        return UNDEF;
+    fb = ch * ( b >> 3 );
+    if ( (uns64b)nf * ch > 0xffffffff )
+        nf = 0xffffffff / ch;
+    if ( src->tipo == TRP_RAW ) {
+        trp_raw_t *raw = (trp_raw_t *)src;
+
+        if ( raw->mode )
+            return UNDEF;
+        if ( (uns64b)p >= raw->len )
+            return UNDEF;
+        if ( nf > ( raw->len - (uns32b)p ) / fb )
+            nf = ( raw->len - (uns32b)p ) / fb;
+        if ( nf == 0 )
+            return UNDEF;
+        pcm = trp_pcm_new( fmt, b, ch, fr, nf );
+        trp_pcm_convert( pcm, 0, raw->data + p, nf * ch );
+        return (trp_obj_t *)pcm;
+    }
+    if ( trp_file_readable_fp( src ) == NULL )
+        return UNDEF;
+    if ( trp_file_set_pos( pos, src ) )
+        return UNDEF;
+    cf = ( fb < TRP_PCM_CHUNK ) ? TRP_PCM_CHUNK / fb : 1;
+    /*
+     frames può essere più grande del file ("fino alla fine"):
+     se la lunghezza è nota si limita nf, altrimenti (pipe, socket)
+     il buffer cresce man mano
+     */
+    if ( trp_cast_sig64b( trp_file_length( (trp_file_t *)src ), &l ) == 0 ) {
+        l = ( l > p ) ? ( l - p ) / fb : 0;
+        if ( (uns64b)l < nf )
+            nf = (uns32b)l;
+        na = nf;
+    } else
+        na = ( nf < cf ) ? nf : cf;
+    if ( nf == 0 )
+        return UNDEF;
+    pcm = trp_pcm_new( fmt, b, ch, fr, na );
+    buf = trp_gc_malloc_atomic( cf * fb );
+    for ( n = 0 ; n < nf ; n += got ) {
+        if ( cf > nf - n )
+            cf = nf - n;
+        if ( n + cf > pcm->len ) {
+            pcm->len = ( pcm->len > nf - pcm->len ) ? nf : pcm->len << 1;
+            pcm->data = trp_gc_realloc( pcm->data, trp_pcm_bytes( pcm ) );
+        }
+        got = trp_file_read_chars_internal( src, buf, cf * fb ) / fb;
+        trp_pcm_convert( pcm, (uns64b)n * ch, buf, got * ch );
+        if ( got < cf ) {
+            n += got;
+            break;
+        }
+    }
+    trp_gc_free( buf );
+    if ( n == 0 ) {
+        trp_gc_free( pcm->data );
+        trp_gc_free( pcm );
+        return UNDEF;
+    }
+    if ( n < pcm->len ) {
+        pcm->len = n;
+        pcm->data = trp_gc_realloc( pcm->data, trp_pcm_bytes( pcm ) );
+    }
+    return (trp_obj_t *)pcm;
+}
+
+trp_obj_t *trp_pcm_frequency( trp_obj_t *pcm )
+{
+    if ( pcm->tipo != TRP_PCM )
+        return UNDEF;
+    return trp_sig64( ((trp_pcm_t *)pcm)->frequency );
+}
+
+trp_obj_t *trp_pcm_bps( trp_obj_t *pcm )
+{
+    if ( pcm->tipo != TRP_PCM )
+        return UNDEF;
+    return trp_sig64( ((trp_pcm_t *)pcm)->bps );
+}
+
+trp_obj_t *trp_pcm_get( trp_obj_t *pcm, trp_obj_t *frame, trp_obj_t *ch )
+{
+    trp_pcm_t *q = (trp_pcm_t *)pcm;
+    uns32b f, c;
+    flt64b v;
+
+    if ( pcm->tipo != TRP_PCM )
+        return UNDEF;
+    /*
+     un buffer decodificato può essere vuoto
+     */
+    if ( ( q->len == 0 ) || ( q->channels == 0 ) )
+        return UNDEF;
+    if ( trp_cast_uns32b_range( frame, &f, 0, q->len - 1 ) ||
+         trp_cast_uns32b_range( ch, &c, 0, q->channels - 1 ) )
+        return UNDEF;
+    v = trp_pcm_sample( q, (uns64b)f * q->channels + c );
+    if ( q->fmt != TRP_PCM_F32 )
+        return trp_sig64( (sig64b)v );
+    return isfinite( v ) ? trp_double( v ) : UNDEF;
+}
+
+/*
+ canale (undef o assente: tutti) e intervallo di frame [b, b + l)
+ */
+
+static uns8b trp_pcm_range( trp_obj_t *pcm, trp_obj_t *ch, trp_obj_t *beg, trp_obj_t *len, uns32b *c, uns32b *b, uns32b *l )
+{
+    trp_pcm_t *q = (trp_pcm_t *)pcm;
+
+    if ( pcm->tipo != TRP_PCM )
+        return 1;
+    if ( ( q->len == 0 ) || ( q->channels == 0 ) )
+        return 1;
+    if ( ( ch == NULL ) || ( ch == UNDEF ) )
+        *c = 0xffffffff;
+    else if ( trp_cast_uns32b_range( ch, c, 0, q->channels - 1 ) )
+        return 1;
+    *b = 0;
+    if ( beg )
+        if ( trp_cast_uns32b_range( beg, b, 0, q->len ) )
+            return 1;
+    *l = q->len - *b;
+    if ( len ) {
+        uns32b ll;
+
+        if ( trp_cast_uns32b( len, &ll ) )
+            return 1;
+        if ( ll < *l )
+            *l = ll;
+    }
+    return ( *l == 0 ) ? 1 : 0;
+}
+
+/*
+ somma dei quadrati di n campioni a passo step da i
+ */
+
+static flt64b trp_pcm_sumsq( trp_pcm_t *pcm, uns64b i, uns64b n, uns32b step )
+{
+    flt64b acc = 0.0;
+    uns64b k;
+
+    if ( pcm->fmt == TRP_PCM_S16 ) {
+        sig16b *s = (sig16b *)( pcm->data ) + i;
+        uns64b sum = 0;
+
+        k = 0;
+#ifdef __SSE2__
+        if ( step == 1 ) {
+            __m128i zero = _mm_setzero_si128(), vacc = zero, x;
+            uns64b tmp[ 2 ];
+
+            /*
+             _mm_madd_epi16 somma due quadrati (al più 2^31,
+             senza segno) che si accumulano a 64 bit
+             */
+            for ( ; k + 8 <= n ; k += 8 ) {
+                x = _mm_loadu_si128( (__m128i *)( s + k ) );
+                x = _mm_madd_epi16( x, x );
+                vacc = _mm_add_epi64( vacc, _mm_unpacklo_epi32( x, zero ) );
+                vacc = _mm_add_epi64( vacc, _mm_unpackhi_epi32( x, zero ) );
+            }
+            _mm_storeu_si128( (__m128i *)tmp, vacc );
+            sum = tmp[ 0 ] + tmp[ 1 ];
+        }
+#endif
+        for ( ; k < n ; k++ )
+            sum += (uns64b)( (sig32b)( s[ k * step ] ) * (sig32b)( s[ k * step ] ) );
+        return (flt64b)sum;
+    }
+    for ( k = 0 ; k < n ; k++, i += step )
+        acc += trp_pcm_sample( pcm, i ) * trp_pcm_sample( pcm, i );
+    return acc;
+}
+
+/*
+ massimo valore assoluto di n campioni a passo step da i
+ */
+
+static flt64b trp_pcm_max( trp_pcm_t *pcm, uns64b i, uns64b n, uns32b step )
+{
+    flt64b m = 0.0, v;
+    uns64b k;
+
+    if ( pcm->fmt == TRP_PCM_S16 ) {
+        sig16b *s = (sig16b *)( pcm->data ) + i;
+        sig32b mx = 0, mn = 0;
+
+        k = 0;
+#ifdef __SSE2__
+        if ( step == 1 ) {
+            __m128i vmx = _mm_setzero_si128(), vmn = vmx, x;
+            sig16b tmp[ 8 ];
+            int j;
+
+            for ( ; k + 8 <= n ; k += 8 ) {
+                x = _mm_loadu_si128( (__m128i *)( s + k ) );
+                vmx = _mm_max_epi16( vmx, x );
+                vmn = _mm_min_epi16( vmn, x );
+            }
+            _mm_storeu_si128( (__m128i *)tmp, vmx );
+            for ( j = 0 ; j < 8 ; j++ )
+                if ( tmp[ j ] > mx )
+                    mx = tmp[ j ];
+            _mm_storeu_si128( (__m128i *)tmp, vmn );
+            for ( j = 0 ; j < 8 ; j++ )
+                if ( tmp[ j ] < mn )
+                    mn = tmp[ j ];
+        }
+#endif
+        for ( ; k < n ; k++ ) {
+            if ( s[ k * step ] > mx )
+                mx = s[ k * step ];
+            if ( s[ k * step ] < mn )
+                mn = s[ k * step ];
+        }
+        return ( -mn > mx ) ? (flt64b)( -mn ) : (flt64b)mx;
+    }
+    for ( k = 0 ; k < n ; k++, i += step ) {
+        v = fabs( trp_pcm_sample( pcm, i ) );
+        if ( v > m )
+            m = v;
+    }
+    return m;
+}
+
+trp_obj_t *trp_pcm_rms( trp_obj_t *pcm, trp_obj_t *ch, trp_obj_t *beg, trp_obj_t *len )
+{
+    trp_pcm_t *q = (trp_pcm_t *)pcm;
+    uns32b c, b, l;
+    flt64b v;
+
+    if ( trp_pcm_range( pcm, ch, beg, len, &c, &b, &l ) )
+        return UNDEF;
+    if ( c == 0xffffffff )
+        v = trp_pcm_sumsq( q, (uns64b)b * q->channels, (uns64b)l * q->channels, 1 ) / ( (flt64b)l * q->channels );
+    else
+        v = trp_pcm_sumsq( q, (uns64b)b * q->channels + c, l, q->channels ) / (flt64b)l;
+    v = sqrt( v );
+    return isfinite( v ) ? trp_double( v ) : UNDEF;
+}
+
+trp_obj_t *trp_pcm_peak( trp_obj_t *pcm, trp_obj_t *ch, trp_obj_t *beg, trp_obj_t *len )
+{
+    trp_pcm_t *q = (trp_pcm_t *)pcm;
+    uns32b c, b, l;
+    flt64b v;
+
+    if ( trp_pcm_range( pcm, ch, beg, len, &c, &b, &l ) )
+        return UNDEF;
+    if ( c == 0xffffffff )
+        v = trp_pcm_max( q, (uns64b)b * q->channels, (uns64b)l * q->channels, 1 );
+    else
+        v = trp_pcm_max( q, (uns64b)b * q->channels + c, l, q->channels );
+    if ( q->fmt != TRP_PCM_F32 )
+        return trp_sig64( (sig64b)v );
+    return isfinite( v ) ? trp_double( v ) : UNDEF;
+}
+
+/*
+ primo campione in [i, n) forte (loud) o debole rispetto a thr
+ (forte se il valore assoluto supera thr); n se non c'è
+ */
+
+static uns64b trp_pcm_find( trp_pcm_t *pcm, uns64b i, uns64b n, flt64b thr, uns8b loud )
+{
+    if ( pcm->fmt == TRP_PCM_S16 ) {
+        sig16b *s = (sig16b *)( pcm->data );
+        sig32b t = ( thr >= 32767.0 ) ? 32767 : (sig32b)thr, v;
+
+#ifdef __SSE2__
+        __m128i vt = _mm_set1_epi16( (sig16b)t ), vnt = _mm_set1_epi16( (sig16b)( -t ) ), x;
+        int mask;
+
+        for ( ; i + 8 <= n ; i += 8 ) {
+            x = _mm_loadu_si128( (__m128i *)( s + i ) );
+            mask = _mm_movemask_epi8( _mm_or_si128( _mm_cmpgt_epi16( x, vt ),
+                                                    _mm_cmplt_epi16( x, vnt ) ) );
+            if ( loud == 0 )
+                mask ^= 0xffff;
+            if ( mask )
+                break;
+        }
+#endif
+        for ( ; i < n ; i++ ) {
+            v = s[ i ];
+            if ( ( ( v > t ) || ( v < -t ) ) == loud )
+                break;
+        }
+        return i;
+    }
+    for ( ; i < n ; i++ )
+        if ( ( fabs( trp_pcm_sample( pcm, i ) ) > thr ) == loud )
+            break;
+    return i;
+}
+
+/*
+ tratti di almeno minlen frame in cui nessun canale supera
+ in valore assoluto thr: array di [inizio lunghezza]
+ */
+
+trp_obj_t *trp_pcm_silence( trp_obj_t *pcm, trp_obj_t *thr, trp_obj_t *minlen )
+{
+    trp_pcm_t *q = (trp_pcm_t *)pcm;
+    trp_obj_t *res, *seg;
+    uns32b *segs = NULL, nsegs = 0, asegs = 0, ml, f, g, k;
+    uns64b ch, n, s;
+    flt64b t;
+
+    if ( pcm->tipo != TRP_PCM )
+        return UNDEF;
+    if ( trp_cast_flt64b( thr, &t ) || trp_cast_uns32b_range( minlen, &ml, 1, 0xffffffff ) )
+        return UNDEF;
+    if ( t < 0.0 )
+        return UNDEF;
+    ch = q->channels;
+    n = (uns64b)( q->len ) * ch;
+    for ( f = 0 ; f < q->len ; ) {
+        s = trp_pcm_find( q, (uns64b)f * ch, n, t, 1 );
+        g = (uns32b)( s / ch );
+        if ( g - f >= ml ) {
+            if ( nsegs == asegs ) {
+                if ( asegs ) {
+                    asegs <<= 1;
+                    segs = trp_gc_realloc( segs, sizeof( uns32b ) * 2 * asegs );
+                } else {
+                    asegs = 64;
+                    segs = trp_gc_malloc_atomic( sizeof( uns32b ) * 2 * asegs );
+                }
+            }
+            segs[ 2 * nsegs ] = f;
+            segs[ 2 * nsegs + 1 ] = g - f;
+            nsegs++;
+        }
+        if ( g >= q->len )
+            break;
+        /*
+         il prossimo frame tutto debole
+         */
+        for ( f = g + 1 ; f < q->len ; f++ ) {
+            s = trp_pcm_find( q, (uns64b)f * ch, n, t, 0 );
+            if ( s == n ) {
+                f = q->len;
+                break;
+            }
+            f = (uns32b)( s / ch );
+            if ( trp_pcm_find( q, (uns64b)f * ch, (uns64b)( f + 1 ) * ch, t, 1 ) == (uns64b)( f + 1 ) * ch )
+                break;
+        }
+    }
+    res = trp_array_ext_internal( UNDEF, 10, nsegs );
+    for ( k = 0 ; k < nsegs ; k++ ) {
+        seg = trp_array_ext_internal( UNDEF, 10, 2 );
+        ((trp_array_t *)seg)->data[ 0 ] = trp_sig64( segs[ 2 * k ] );
+        ((trp_array_t *)seg)->data[ 1 ] = trp_sig64( segs[ 2 * k + 1 ] );
+        ((trp_array_t *)res)->data[ k ] = seg;
+    }
+    trp_gc_free( segs );
+    return res;
+}
+
+/*
+ ricampionamento per interpolazione lineare (senza filtro
+ anti-aliasing); la posizione nel sorgente è tenuta in
+ aritmetica intera per non accumulare errori
+ */
+
+trp_obj_t *trp_pcm_resample( trp_obj_t *pcm, trp_obj_t *frequency )
+{
+    trp_pcm_t *q = (trp_pcm_t *)pcm, *res;
+    uns64b nf, i, p, idx, ch, c;
+    uns32b fr;
+    flt64b frac, x0, x1, y, lo, hi;
+
+    if ( pcm->tipo != TRP_PCM )
+        return UNDEF;
+    if ( trp_cast_uns32b_range( frequency, &fr, 1, 0xffffffff ) )
+        return UNDEF;
+    /*
+     dati decodificati (anche corrotti) possono avere frequency 0
+     o nessun frame
+     */
+    if ( ( q->frequency == 0 ) || ( q->len == 0 ) || ( q->channels == 0 ) )
+        return UNDEF;
+    nf = ( (uns64b)( q->len ) * fr ) / q->frequency;
+    if ( nf == 0 )
+        nf = 1;
+    ch = q->channels;
+    if ( nf * ch > 0xffffffff )
+        return UNDEF;
+    res = trp_pcm_new( q->fmt, q->bps, q->channels, fr, (uns32b)nf );
+    if ( fr == q->frequency ) {
+        memcpy( res->data, q->data, trp_pcm_bytes( q ) );
+        return (trp_obj_t *)res;
+    }
+    if ( q->fmt == TRP_PCM_S16 ) {
+        lo = -32768.0;
+        hi = 32767.0;
+    } else {
+        lo = -2147483648.0;
+        hi = 2147483647.0;
+    }
+    for ( i = 0 ; i < nf ; i++ ) {
+        p = i * q->frequency;
+        idx = p / fr;
+        frac = (flt64b)( p % fr ) / (flt64b)fr;
+        for ( c = 0 ; c < ch ; c++ ) {
+            x0 = trp_pcm_sample( q, idx * ch + c );
+            x1 = ( idx + 1 < q->len ) ? trp_pcm_sample( q, ( idx + 1 ) * ch + c ) : x0;
+            y = x0 + ( x1 - x0 ) * frac;
+            switch ( q->fmt ) {
+            case TRP_PCM_S16:
+                y = rint( y );
+                ((sig16b *)( res->data ))[ i * ch + c ] = (sig16b)( ( y < lo ) ? lo : ( ( y > hi ) ? hi : y ) );
+                break;
+            case TRP_PCM_S32:
+                y = rint( y );
+                ((sig32b *)( res->data ))[ i * ch + c ] = (sig32b)( ( y < lo ) ? lo : ( ( y > hi ) ? hi : y ) );
+                break;
+            default:
+                ((flt32b *)( res->data ))[ i * ch + c ] = (flt32b)y;
+                break;
+            }
+        }
+    }
+    return (trp_obj_t *)res;
+}
+
+/*
+ i campioni come raw little endian (16 bit per i sorgenti a
+ 8 e 16 bit, 32 per gli altri)
+ */
+
+trp_obj_t *trp_pcm2raw( trp_obj_t *pcm )
+{
+    trp_obj_t *raw;
+    uns64b sz;
+
+    if ( pcm->tipo != TRP_PCM )
+        return UNDEF;
+    if ( ( sz = trp_pcm_bytes( (trp_pcm_t *)pcm ) ) > 0xffffffff )
+        return UNDEF;
+    raw = trp_raw_internal( (uns32b)sz, 0 );
+    trp_pcm_store( (trp_pcm_t *)pcm, ((trp_raw_t *)raw)->data );
+    return raw;
+}
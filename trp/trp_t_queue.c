@@ -22,12 +22,18 @@ extern uns32b trp_size_internal( trp_obj_t *obj );
 extern void trp_encode_internal( trp_obj_t *obj, uns8b **buf );
 extern trp_obj_t *trp_decode_internal( uns8b **buf );
 
-void trp_queue_init_internal( trp_queue_t *q );
+/*
+ la coda e' un buffer circolare di dimensione potenza di 2,
+ che raddoppia quando e' pieno e si dimezza quando e' occupato
+ per meno di un quarto
+ */
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
+#define TRP_QUEUE_MIN_SIZE 16
+#define TRP_QUEUE_SLOT(q,n) (((trp_obj_t **)((q)->data))[((q)->first+(n))&((q)->size-1)])
+
+void trp_queue_init_internal( trp_queue_t *q );
+void trp_queue_del_internal( trp_queue_t *q, uns32b n );
+static void trp_queue_resize( trp_queue_t *q, uns32b size );
 
 uns8b trp_queue_print( trp_print_t *p, trp_queue_t *obj )
 {
@@ -43,39 +49,37 @@ uns8b trp_queue_print( trp_print_t *p, trp_queue_t *obj )
 
 uns32b trp_queue_size( trp_queue_t *obj )
 {
-    uns32b sz = 1 + 4;
-    trp_queue_elem *elem;
+    uns32b sz = 1 + 4, i;
 
-    for ( elem = (trp_queue_elem *)( obj->first ) ;
-          elem ;
-          elem = (trp_queue_elem *)( elem->next ) )
-        sz += trp_size_internal( elem->val );
+    for ( i = 0 ; i < obj->len ; i++ )
+        sz += trp_size_internal( TRP_QUEUE_SLOT( obj, i ) );
     return sz;
 }
 
 void trp_queue_encode( trp_queue_t *obj, uns8b **buf )
 {
-    trp_queue_elem *elem;
-    uns32b *p;
+    uns32b *p, i;
 
     **buf = TRP_QUEUE;
     ++(*buf);
     p = (uns32b *)(*buf);
     *p = norm32( obj->len );
     (*buf) += 4;
-    for ( elem = (trp_queue_elem *)( obj->first ) ;
-          elem ;
-          elem = (trp_queue_elem *)( elem->next ) )
-        trp_encode_internal( elem->val, buf );
+    for ( i = 0 ; i < obj->len ; i++ )
+        trp_encode_internal( TRP_QUEUE_SLOT( obj, i ), buf );
 }
 
 trp_obj_t *trp_queue_decode( uns8b **buf )
 {
-    uns32b len;
+    uns32b len, size;
     trp_obj_t *res = trp_queue();
 
     len = norm32( *((uns32b *)(*buf)) );
     (*buf) += 4;
+    if ( len ) {
+        for ( size = TRP_QUEUE_MIN_SIZE ; size < len ; size <<= 1 );
+        trp_queue_resize( (trp_queue_t *)res, size );
+    }
     for ( ; len ; len-- )
         trp_queue_put( res, trp_decode_internal( buf ) );
     return res;
@@ -83,14 +87,12 @@ trp_obj_t *trp_queue_decode( uns8b **buf )
 
 trp_obj_t *trp_queue_equal( trp_queue_t *o1, trp_queue_t *o2 )
 {
-    trp_queue_elem *elem1, *elem2;
+    uns32b i;
 
     if ( o1->len != o2->len )
         return TRP_FALSE;
-    for ( elem1 = (trp_queue_elem *)( o1->first ), elem2 = (trp_queue_elem *)( o2->first ) ;
-          elem1 ;
-          elem1 = (trp_queue_elem *)( elem1->next ), elem2 = (trp_queue_elem *)( elem2->next ) )
-        if ( trp_equal( elem1->val, elem2->val ) == TRP_FALSE )
+    for ( i = 0 ; i < o1->len ; i++ )
+        if ( trp_equal( TRP_QUEUE_SLOT( o1, i ), TRP_QUEUE_SLOT( o2, i ) ) == TRP_FALSE )
             return TRP_FALSE;
     return TRP_TRUE;
 }
@@ -102,8 +104,8 @@ trp_obj_t *trp_queue_less( trp_queue_t *o1, trp_queue_t *o2 )
 
 uns8b trp_queue_close( trp_queue_t *obj )
 {
-    while ( obj->len )
-        trp_queue_get( (trp_obj_t *)obj );
+    trp_gc_free( obj->data );
+    trp_queue_init_internal( obj );
     return 0;
 }
 
@@ -114,26 +116,18 @@ trp_obj_t *trp_queue_length( trp_queue_t *obj )
 
 trp_obj_t *trp_queue_nth( uns32b n, trp_queue_t *obj )
 {
-    trp_queue_elem *elem;
-
     if ( n >= obj->len )
         return UNDEF;
-    for ( elem = (trp_queue_elem *)( obj->first ) ;
-          n ;
-          elem = (trp_queue_elem *)( elem->next ), n-- );
-    return elem->val;
+    return TRP_QUEUE_SLOT( obj, n );
 }
 
 uns8b trp_queue_in( trp_obj_t *obj, trp_queue_t *seq, uns32b *pos, uns32b nth )
 {
-    trp_queue_elem *elem;
-    uns32b i = 0;
+    uns32b i;
     uns8b res = 1;
 
-    for ( elem = (trp_queue_elem *)( seq->first ) ;
-          elem ;
-          elem = (trp_queue_elem *)( elem->next ), i++ )
-        if ( trp_equal( elem->val, obj ) == TRP_TRUE ) {
+    for ( i = 0 ; i < seq->len ; i++ )
+        if ( trp_equal( TRP_QUEUE_SLOT( seq, i ), obj ) == TRP_TRUE ) {
             res = 0;
             *pos = i;
             if ( nth == 0 )
@@ -147,8 +141,48 @@ void trp_queue_init_internal( trp_queue_t *q )
 {
     q->tipo = TRP_QUEUE;
     q->len = 0;
-    q->first = NULL;
-    q->last = NULL;
+    q->size = 0;
+    q->first = 0;
+    q->data = NULL;
+}
+
+/*
+ toglie l'n-esimo elemento (che deve esistere),
+ spostando la parte piu' corta della coda
+ */
+
+void trp_queue_del_internal( trp_queue_t *q, uns32b n )
+{
+    uns32b i;
+
+    if ( n < q->len / 2 ) {
+        for ( i = n ; i ; i-- )
+            TRP_QUEUE_SLOT( q, i ) = TRP_QUEUE_SLOT( q, i - 1 );
+        TRP_QUEUE_SLOT( q, 0 ) = NULL;
+        q->first = ( q->first + 1 ) & ( q->size - 1 );
+    } else {
+        for ( i = n + 1 ; i < q->len ; i++ )
+            TRP_QUEUE_SLOT( q, i - 1 ) = TRP_QUEUE_SLOT( q, i );
+        TRP_QUEUE_SLOT( q, q->len - 1 ) = NULL;
+    }
+    q->len--;
+    if ( ( q->size > TRP_QUEUE_MIN_SIZE ) && ( q->len < q->size / 4 ) )
+        trp_queue_resize( q, q->size / 2 );
+}
+
+static void trp_queue_resize( trp_queue_t *q, uns32b size )
+{
+    trp_obj_t **data;
+    uns32b i;
+
+    data = trp_gc_malloc( size * sizeof( trp_obj_t * ) );
+    for ( i = 0 ; i < q->len ; i++ )
+        data[ i ] = TRP_QUEUE_SLOT( q, i );
+    memset( data + q->len, 0, ( size - q->len ) * sizeof( trp_obj_t * ) );
+    trp_gc_free( q->data );
+    q->data = (void *)data;
+    q->size = size;
+    q->first = 0;
 }
 
 trp_obj_t *trp_queue()
@@ -162,38 +196,28 @@ trp_obj_t *trp_queue()
 
 uns8b trp_queue_put( trp_obj_t *queue, trp_obj_t *obj )
 {
-    trp_queue_elem *p;
+    trp_queue_t *q = (trp_queue_t *)queue;
 
     if ( queue->tipo != TRP_QUEUE )
         return 1;
-    p = trp_gc_malloc( sizeof( trp_queue_elem ) );
-    p->val = obj;
-    p->next = NULL;
-    if ( ((trp_queue_t *)queue)->len )
-        ((trp_queue_elem *)(((trp_queue_t *)queue)->last))->next = p;
-    else
-        ((trp_queue_t *)queue)->first = p;
-    ((trp_queue_t *)queue)->last = p;
-    ((trp_queue_t *)queue)->len++;
+    if ( q->len == q->size )
+        trp_queue_resize( q, q->size ? 2 * q->size : TRP_QUEUE_MIN_SIZE );
+    TRP_QUEUE_SLOT( q, q->len ) = obj;
+    q->len++;
     return 0;
 }
 
 trp_obj_t *trp_queue_get( trp_obj_t *queue )
 {
+    trp_queue_t *q = (trp_queue_t *)queue;
     trp_obj_t *res;
-    trp_queue_elem *p;
 
     if ( queue->tipo != TRP_QUEUE )
         return UNDEF;
-    if ( ((trp_queue_t *)queue)->len == 0 )
+    if ( q->len == 0 )
         return UNDEF;
-    ((trp_queue_t *)queue)->len--;
-    p = (trp_queue_elem *)(((trp_queue_t *)queue)->first);
-    res = p->val;
-    ((trp_queue_t *)queue)->first = p->next;
-    if ( ((trp_queue_t *)queue)->len == 0 )
-        ((trp_queue_t *)queue)->last = NULL;
-    trp_gc_free( p );
+    res = TRP_QUEUE_SLOT( q, 0 );
+    trp_queue_del_internal( q, 0 );
     return res;
 }
 
@@ -209,23 +233,10 @@ uns8b trp_queue_swap( trp_obj_t *obj,  trp_obj_t *i,  trp_obj_t *j )
          ( jj >= ((trp_queue_t *)obj)->len ) )
         return 1;
     if ( ii != jj ) {
-        trp_queue_elem *p1, *p2;
+        trp_obj_t *tmp = TRP_QUEUE_SLOT( (trp_queue_t *)obj, ii );
 
-        if ( jj < ii ) {
-            uns32b k = ii;
-            ii = jj;
-            jj = k;
-        }
-        jj -= ii;
-        for ( p1 = (trp_queue_elem *)(((trp_queue_t *)obj)->first) ;
-              ii ;
-              p1 = (trp_queue_elem *)( p1->next ), ii-- );
-        for ( p2 = p1 ;
-              jj ;
-              p2 = (trp_queue_elem *)( p2->next ), jj-- );
-        obj = p1->val;
-        p1->val = p2->val;
-        p2->val = obj;
+        TRP_QUEUE_SLOT( (trp_queue_t *)obj, ii ) = TRP_QUEUE_SLOT( (trp_queue_t *)obj, jj );
+        TRP_QUEUE_SLOT( (trp_queue_t *)obj, jj ) = tmp;
     }
     return 0;
 }
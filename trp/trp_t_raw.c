@@ -18,18 +18,35 @@
 
 #include "trp.h"
 #include <zlib.h>
+#include <lz4.h>
+#include <lz4hc.h>
+#include <zstd.h>
 
 #ifdef MINGW
 #define fseeko fseeko64
 #define ftello ftello64
 #endif
 
+/*
+ valori di mode:
+ 0 = non compresso,
+ 1 = memorizzato senza compressione (compression_level = 0),
+ 2 = zlib, 3 = LZ4, 4 = Zstd
+ */
+#define TRP_RAW_ZLIB 2
+#define TRP_RAW_LZ4  3
+#define TRP_RAW_ZSTD 4
+
 uns32b trp_size_internal( trp_obj_t *obj );
 void trp_encode_internal( trp_obj_t *obj, uns8b **buf );
 trp_obj_t *trp_decode_internal( uns8b **buf );
 trp_obj_t *trp_raw_internal( uns32b sz, uns8b use_malloc );
 
 static void trp_raw_realloc_internal( trp_raw_t *obj, uns32b sz );
+static uns8b trp_compress_parse( trp_obj_t *level, uns8b *mode, int *lv );
+static unsigned long trp_compress_bound( uns8b mode, unsigned long slen );
+static unsigned long trp_compress_low( uns8b mode, int cl, uns8b *dst, unsigned long dlen, uns8b *src, unsigned long slen );
+static uns8b trp_uncompress_low( uns8b mode, uns8b *dst, unsigned long dlen, uns8b *src, unsigned long slen );
 
 uns8b trp_raw_print( trp_print_t *p, trp_raw_t *obj )
 {
@@ -59,6 +76,12 @@ uns8b trp_raw_print( trp_print_t *p, trp_raw_t *obj )
         t = _trp_tipo_descr[ obj->unc_tipo ];
         if ( trp_print_char_star( p, t ) )
             return 1;
+        if ( obj->mode == TRP_RAW_LZ4 )
+            if ( trp_print_char_star( p, ", lz4" ) )
+                return 1;
+        if ( obj->mode == TRP_RAW_ZSTD )
+            if ( trp_print_char_star( p, ", zstd" ) )
+                return 1;
     }
     return trp_print_char_star( p, ")#" );
 }
@@ -275,22 +298,127 @@ trp_obj_t *trp_decode_internal( uns8b **buf )
     return (_trp_decode_fun[ tipo ])( buf );
 }
 
-trp_obj_t *trp_compress( trp_obj_t *obj, trp_obj_t *level )
+/*
+ level può essere il livello (0..10, codec zlib), il nome del codec
+ ("zlib", "lz4", "zstd", con il suo livello di default) oppure la
+ coppia (codec . livello); il livello 10 usa la compressione massima
+ del codec e lascia l'oggetto non compresso se non si guadagna nulla;
+ per LZ4 i livelli da 3 in su usano LZ4HC, che comprime meglio
+ senza rallentare la decompressione
+ */
+
+static uns8b trp_compress_parse( trp_obj_t *level, uns8b *mode, int *lv )
 {
-    int lv;
-    unsigned long slen, dlen;
-    trp_raw_t *raw, *res;
+    trp_obj_t *codec = NULL;
 
+    *mode = TRP_RAW_ZLIB;
+    *lv = 6;
+    if ( level == NULL )
+        return 0;
+    if ( level->tipo == TRP_CONS ) {
+        codec = ((trp_cons_t *)level)->car;
+        level = ((trp_cons_t *)level)->cdr;
+    } else if ( level->tipo == TRP_CORD ) {
+        codec = level;
+        level = NULL;
+    }
+    if ( codec ) {
+        uns8b *s;
+
+        if ( codec->tipo != TRP_CORD )
+            return 1;
+        s = trp_csprint( codec );
+        if ( strcmp( s, "zlib" ) == 0 ) {
+            *mode = TRP_RAW_ZLIB;
+            *lv = 6;
+        } else if ( strcmp( s, "lz4" ) == 0 ) {
+            *mode = TRP_RAW_LZ4;
+            *lv = 1;
+        } else if ( strcmp( s, "zstd" ) == 0 ) {
+            *mode = TRP_RAW_ZSTD;
+            *lv = 3;
+        } else {
+            trp_csprint_free( s );
+            return 1;
+        }
+        trp_csprint_free( s );
+    }
     if ( level ) {
         if ( level->tipo != TRP_SIG64 )
-            return UNDEF;
+            return 1;
         if ( ( ((trp_sig64_t *)level)->val < 0 ) ||
              ( ((trp_sig64_t *)level)->val > 10 ) )
-            return UNDEF;
-        lv = ((trp_sig64_t *)level)->val;
-    } else {
-        lv = 6;
+            return 1;
+        *lv = ((trp_sig64_t *)level)->val;
+    }
+    return 0;
+}
+
+static unsigned long trp_compress_bound( uns8b mode, unsigned long slen )
+{
+    switch ( mode ) {
+    case TRP_RAW_LZ4:
+        if ( slen > LZ4_MAX_INPUT_SIZE )
+            return 0;
+        return (unsigned long)LZ4_compressBound( (int)slen );
+    case TRP_RAW_ZSTD:
+        return (unsigned long)ZSTD_compressBound( (size_t)slen );
+    }
+    return compressBound( slen );
+}
+
+/*
+ rende la lunghezza del risultato, 0 in caso di errore
+ */
+
+static unsigned long trp_compress_low( uns8b mode, int cl, uns8b *dst, unsigned long dlen, uns8b *src, unsigned long slen )
+{
+    size_t r;
+    int k;
+
+    switch ( mode ) {
+    case TRP_RAW_LZ4:
+        if ( cl == 1 )
+            k = LZ4_compress_default( (const char *)src, (char *)dst, (int)slen, (int)dlen );
+        else
+            k = LZ4_compress_HC( (const char *)src, (char *)dst, (int)slen, (int)dlen, cl );
+        return ( k > 0 ) ? (unsigned long)k : 0;
+    case TRP_RAW_ZSTD:
+        r = ZSTD_compress( dst, (size_t)dlen, src, (size_t)slen, cl );
+        return ZSTD_isError( r ) ? 0 : (unsigned long)r;
     }
+    if ( compress2( dst, &dlen, src, slen, cl ) != Z_OK )
+        return 0;
+    return dlen;
+}
+
+static uns8b trp_uncompress_low( uns8b mode, uns8b *dst, unsigned long dlen, uns8b *src, unsigned long slen )
+{
+    size_t r;
+
+    switch ( mode ) {
+    case TRP_RAW_LZ4:
+        if ( ( slen > LZ4_MAX_INPUT_SIZE ) || ( dlen > 0x7fffffff ) )
+            return 1;
+        return ( LZ4_decompress_safe( (const char *)src, (char *)dst, (int)slen, (int)dlen ) == (int)dlen ) ? 0 : 1;
+    case TRP_RAW_ZSTD:
+        r = ZSTD_decompress( dst, (size_t)dlen, src, (size_t)slen );
+        return ( ZSTD_isError( r ) || ( r != (size_t)dlen ) ) ? 1 : 0;
+    case TRP_RAW_ZLIB:
+        return ( uncompress( dst, &dlen, src, slen ) != Z_OK ) ? 1 : 0;
+    }
+    return 1;
+}
+
+trp_obj_t *trp_compress( trp_obj_t *obj, trp_obj_t *level )
+{
+    int lv, cl;
+    unsigned long slen, dlen;
+    trp_raw_t *raw, *res;
+    uns8b mode;
+
+    if ( trp_compress_parse( level, &mode, &lv ) )
+        return UNDEF;
     if ( obj->tipo == TRP_RAW ) {
         /*
          per il momento, un raw compresso non si puo' ricomprimere...
@@ -317,12 +445,29 @@ trp_obj_t *trp_compress( trp_obj_t *obj, trp_obj_t *level )
         raw->unc_len = raw->len;
         return (trp_obj_t *)raw;
     }
+    switch ( mode ) {
+    case TRP_RAW_LZ4:
+        cl = ( lv < 3 ) ? 1 : ( ( lv < 10 ) ? lv : LZ4HC_CLEVEL_MAX );
+        break;
+    case TRP_RAW_ZSTD:
+        cl = ( lv < 10 ) ? lv : 19;
+        break;
+    default:
+        cl = ( lv < 10 ) ? lv : 9;
+        break;
+    }
     slen = raw->len;
-    dlen = compressBound( slen );
-    res = (trp_raw_t *)trp_raw_internal( dlen, 0 );
-    if ( compress2( res->data, &dlen, raw->data, slen, ( lv < 10 ) ? lv : 9 ) != Z_OK ) {
-        trp_gc_free( res->data );
-        trp_gc_free( res );
+    dlen = trp_compress_bound( mode, slen );
+    res = NULL;
+    if ( dlen ) {
+        res = (trp_raw_t *)trp_raw_internal( dlen, 0 );
+        dlen = trp_compress_low( mode, cl, res->data, dlen, raw->data, slen );
+    }
+    if ( dlen == 0 ) {
+        if ( res ) {
+            trp_gc_free( res->data );
+            trp_gc_free( res );
+        }
         if ( obj->tipo != TRP_RAW ) {
             trp_gc_free( raw->data );
             trp_gc_free( raw );
@@ -343,9 +488,9 @@ trp_obj_t *trp_compress( trp_obj_t *obj, trp_obj_t *level )
         trp_gc_free( raw );
     }
     trp_raw_realloc_internal( res, dlen );
-    res->mode = 2;
+    res->mode = mode;
     res->unc_tipo = obj->tipo;
-    res->compression_level = (uns8b)( ( lv < 10 ) ? lv : 9 );
+    res->compression_level = (uns8b)cl;
     res->unc_len = slen;
     return (trp_obj_t *)res;
 }
@@ -376,7 +521,7 @@ trp_obj_t *trp_uncompress( trp_obj_t *obj )
     slen = ((trp_raw_t *)obj)->len;
     dlen = ((trp_raw_t *)obj)->unc_len;
     raw = (trp_raw_t *)trp_raw_internal( dlen, unc_tipo_is_raw ? 0 : 1 );
-    if ( uncompress( raw->data, &dlen, ((trp_raw_t *)obj)->data, slen ) != Z_OK ) {
+    if ( trp_uncompress_low( ((trp_raw_t *)obj)->mode, raw->data, dlen, ((trp_raw_t *)obj)->data, slen ) ) {
         if ( unc_tipo_is_raw )
             trp_gc_free( raw->data );
         else
@@ -397,10 +542,9 @@ trp_obj_t *trp_uncompress( trp_obj_t *obj )
 
 trp_obj_t *trp_raw_read( trp_obj_t *raw, trp_obj_t *stream, trp_obj_t *cnt )
 {
-    FILE *fp;
     uns32b c;
 
-    if ( ( fp = trp_file_readable_fp( stream ) ) == NULL )
+    if ( trp_file_readable_internal( stream ) )
         return UNDEF;
     if ( raw->tipo != TRP_RAW )
         return UNDEF;
@@ -424,7 +568,7 @@ trp_obj_t *trp_raw_read( trp_obj_t *raw, trp_obj_t *stream, trp_obj_t *cnt )
     ((trp_raw_t *)raw)->unc_tipo = 0;
     ((trp_raw_t *)raw)->compression_level = 0;
     ((trp_raw_t *)raw)->unc_len = 0;
-    return trp_sig64( trp_file_read_chars( fp, ((trp_raw_t *)raw)->data, c ) );
+    return trp_sig64( trp_file_read_chars_internal( stream, ((trp_raw_t *)raw)->data, c ) );
 }
 
 trp_obj_t *trp_raw_write( trp_obj_t *raw, trp_obj_t *stream, trp_obj_t *cnt )
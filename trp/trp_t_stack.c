@@ -22,10 +22,22 @@ extern uns32b trp_size_internal( trp_obj_t *obj );
 extern void trp_encode_internal( trp_obj_t *obj, uns8b **buf );
 extern trp_obj_t *trp_decode_internal( uns8b **buf );
 
+/*
+ lo stack e' una lista di blocchi di dimensione crescente
+ (data punta al blocco in cima, top e' il numero di elementi
+ occupati nel blocco in cima); l'ultimo blocco svuotato viene
+ tenuto da parte in spare, per evitare di continuare ad allocare
+ e liberare quando si fanno push e pop a cavallo di due blocchi
+ */
+
+#define TRP_STACK_MIN_CHUNK 16
+#define TRP_STACK_MAX_CHUNK 65536
+
 typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_stack_elem;
+    void *prev;
+    uns32b size;
+    trp_obj_t *val[ 1 ];
+} trp_stack_chunk;
 
 uns8b trp_stack_print( trp_print_t *p, trp_stack_t *obj )
 {
@@ -41,59 +53,61 @@ uns8b trp_stack_print( trp_print_t *p, trp_stack_t *obj )
 
 uns32b trp_stack_size( trp_stack_t *obj )
 {
-    uns32b sz = 1 + 4;
-    trp_stack_elem *elem;
-
-    for ( elem = (trp_stack_elem *)( obj->data ) ;
-          elem ;
-          elem = (trp_stack_elem *)( elem->next ) )
-        sz += trp_size_internal( elem->val );
+    uns32b sz = 1 + 4, i;
+    trp_stack_chunk *c;
+
+    for ( c = (trp_stack_chunk *)( obj->data ), i = obj->top ;
+          c ;
+          c = (trp_stack_chunk *)( c->prev ), i = c ? c->size : 0 )
+        while ( i )
+            sz += trp_size_internal( c->val[ --i ] );
     return sz;
 }
 
 void trp_stack_encode( trp_stack_t *obj, uns8b **buf )
 {
-    trp_stack_elem *elem;
-    uns32b *p;
+    trp_stack_chunk *c;
+    uns32b *p, i;
 
     **buf = TRP_STACK;
     ++(*buf);
     p = (uns32b *)(*buf);
     *p = norm32( obj->len );
     (*buf) += 4;
-    for ( elem = (trp_stack_elem *)( obj->data ) ;
-          elem ;
-          elem = (trp_stack_elem *)( elem->next ) )
-        trp_encode_internal( elem->val, buf );
+    for ( c = (trp_stack_chunk *)( obj->data ), i = obj->top ;
+          c ;
+          c = (trp_stack_chunk *)( c->prev ), i = c ? c->size : 0 )
+        while ( i )
+            trp_encode_internal( c->val[ --i ], buf );
 }
 
 trp_obj_t *trp_stack_decode( uns8b **buf )
 {
-    uns32b len;
-    trp_obj_t *res, *tmp;
+    uns32b len, i;
+    trp_obj_t *res, **tmp;
 
     len = norm32( *((uns32b *)(*buf)) );
     (*buf) += 4;
     res = trp_stack();
-    tmp = trp_stack();
-    for ( ; len ; len-- )
-        trp_stack_push( tmp, trp_decode_internal( buf ) );
-    while ( ((trp_stack_t *)tmp)->len )
-        trp_stack_push( res, trp_stack_pop( tmp ) );
-    trp_gc_free( tmp );
+    if ( len ) {
+        tmp = trp_gc_malloc( len * sizeof( trp_obj_t * ) );
+        for ( i = 0 ; i < len ; i++ )
+            tmp[ i ] = trp_decode_internal( buf );
+        while ( i )
+            trp_stack_push( res, tmp[ --i ] );
+        trp_gc_free( tmp );
+    }
     return res;
 }
 
 trp_obj_t *trp_stack_equal( trp_stack_t *o1, trp_stack_t *o2 )
 {
-    trp_stack_elem *elem1, *elem2;
+    uns32b i;
 
     if ( o1->len != o2->len )
         return TRP_FALSE;
-    for ( elem1 = (trp_stack_elem *)( o1->data ), elem2 = (trp_stack_elem *)( o2->data ) ;
-          elem1 ;
-          elem1 = (trp_stack_elem *)( elem1->next ), elem2 = (trp_stack_elem *)( elem2->next ) )
-        if ( trp_equal( elem1->val, elem2->val ) == TRP_FALSE )
+    for ( i = 0 ; i < o1->len ; i++ )
+        if ( trp_equal( trp_stack_nth( i, o1 ), trp_stack_nth( i, o2 ) ) == TRP_FALSE )
             return TRP_FALSE;
     return TRP_TRUE;
 }
@@ -105,32 +119,34 @@ trp_obj_t *trp_stack_length( trp_stack_t *obj )
 
 trp_obj_t *trp_stack_nth( uns32b n, trp_stack_t *obj )
 {
-    trp_stack_elem *elem;
+    trp_stack_chunk *c;
+    uns32b i;
 
     if ( n >= obj->len )
         return UNDEF;
-    for ( elem = (trp_stack_elem *)( obj->data ) ;
-          n ;
-          elem = (trp_stack_elem *)( elem->next ), n-- );
-    return elem->val;
+    for ( c = (trp_stack_chunk *)( obj->data ), i = obj->top ;
+          n >= i ;
+          n -= i, c = (trp_stack_chunk *)( c->prev ), i = c->size );
+    return c->val[ i - n - 1 ];
 }
 
 uns8b trp_stack_in( trp_obj_t *obj, trp_stack_t *seq, uns32b *pos, uns32b nth )
 {
-    trp_stack_elem *elem;
-    uns32b i = 0;
+    trp_stack_chunk *c;
+    uns32b i, j = 0;
     uns8b res = 1;
 
-    for ( elem = (trp_stack_elem *)( seq->data ) ;
-          elem ;
-          elem = (trp_stack_elem *)( elem->next ), i++ )
-        if ( trp_equal( elem->val, obj ) == TRP_TRUE ) {
-            res = 0;
-            *pos = i;
-            if ( nth == 0 )
-                break;
-            nth--;
-        }
+    for ( c = (trp_stack_chunk *)( seq->data ), i = seq->top ;
+          c ;
+          c = (trp_stack_chunk *)( c->prev ), i = c ? c->size : 0 )
+        for ( ; i ; j++ )
+            if ( trp_equal( c->val[ --i ], obj ) == TRP_TRUE ) {
+                res = 0;
+                *pos = j;
+                if ( nth == 0 )
+                    return 0;
+                nth--;
+            }
     return res;
 }
 
@@ -141,38 +157,64 @@ trp_obj_t *trp_stack()
     obj = trp_gc_malloc( sizeof( trp_stack_t ) );
     obj->tipo = TRP_STACK;
     obj->len = 0;
+    obj->top = 0;
     obj->data = NULL;
+    obj->spare = NULL;
     return (trp_obj_t *)obj;
 }
 
 uns8b trp_stack_push( trp_obj_t *stack, trp_obj_t *obj )
 {
-    trp_stack_elem *p;
+    trp_stack_t *s = (trp_stack_t *)stack;
+    trp_stack_chunk *c;
 
     if ( stack->tipo != TRP_STACK )
         return 1;
-    p = trp_gc_malloc( sizeof( trp_stack_elem ) );
-    p->val = obj;
-    p->next = ((trp_stack_t *)stack)->data;
-    ((trp_stack_t *)stack)->data = (void *)p;
-    ((trp_stack_t *)stack)->len++;
+    c = (trp_stack_chunk *)( s->data );
+    if ( ( c == NULL ) || ( s->top == c->size ) ) {
+        if ( s->spare ) {
+            c = (trp_stack_chunk *)( s->spare );
+            s->spare = NULL;
+        } else {
+            uns32b size = TRP_STACK_MIN_CHUNK;
+
+            if ( s->data ) {
+                size = 2 * ((trp_stack_chunk *)( s->data ))->size;
+                if ( size > TRP_STACK_MAX_CHUNK )
+                    size = TRP_STACK_MAX_CHUNK;
+            }
+            c = trp_gc_malloc( sizeof( trp_stack_chunk ) + ( size - 1 ) * sizeof( trp_obj_t * ) );
+            c->size = size;
+        }
+        c->prev = s->data;
+        s->data = (void *)c;
+        s->top = 0;
+    }
+    c->val[ s->top++ ] = obj;
+    s->len++;
     return 0;
 }
 
 trp_obj_t *trp_stack_pop( trp_obj_t *stack )
 {
+    trp_stack_t *s = (trp_stack_t *)stack;
+    trp_stack_chunk *c;
     trp_obj_t *res;
-    trp_stack_elem *p;
 
     if ( stack->tipo != TRP_STACK )
         return UNDEF;
-    if ( ((trp_stack_t *)stack)->len == 0 )
+    if ( s->len == 0 )
         return UNDEF;
-    ((trp_stack_t *)stack)->len--;
-    p = (trp_stack_elem *)(((trp_stack_t *)stack)->data);
-    res = p->val;
-    ((trp_stack_t *)stack)->data = p->next;
-    trp_gc_free( p );
+    c = (trp_stack_chunk *)( s->data );
+    res = c->val[ --s->top ];
+    c->val[ s->top ] = NULL;
+    s->len--;
+    if ( ( s->top == 0 ) && c->prev ) {
+        trp_gc_free( s->spare );
+        s->spare = (void *)c;
+        s->data = c->prev;
+        s->top = ((trp_stack_chunk *)( s->data ))->size;
+    }
     return res;
 }
 
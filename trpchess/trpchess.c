@@ -62,11 +62,6 @@ typedef struct {
     uns16b idx2;
 } trp_chess_move_t;
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
 /* ****************************************************************************************************************************************************************************
    ****************************************************************************************************************************************************************************
    ***                                                                                                                                                                      ***
@@ -2693,26 +2688,24 @@ trp_obj_t *trp_chess_perft( trp_obj_t *st, trp_obj_t *depth, trp_obj_t *net )
 trp_obj_t *trp_chess_qmoves_raw( trp_obj_t *qmoves )
 {
     extern trp_obj_t *trp_raw_internal( uns32b sz, uns8b use_malloc );
-    trp_obj_t *raw;
-    trp_queue_elem *elem;
+    trp_obj_t *raw, *elem;
     uns16b *d;
-    uns32b idx1, idx2;
+    uns32b idx1, idx2, i;
 
     if ( qmoves->tipo != TRP_QUEUE )
         return UNDEF;
     if ( ( raw = trp_raw_internal( ((trp_queue_t *)qmoves)->len << 1, 0 ) ) == UNDEF )
         return UNDEF;
     d = (uns16b *)( ((trp_raw_t *)raw)->data );
-    for ( elem = (trp_queue_elem *)( ((trp_queue_t *)qmoves)->first ) ;
-          elem ;
-          elem = (trp_queue_elem *)( elem->next ) ) {
-        if ( elem->val->tipo != TRP_CONS ) {
+    for ( i = 0 ; i < ((trp_queue_t *)qmoves)->len ; i++ ) {
+        elem = trp_queue_nth( i, (trp_queue_t *)qmoves );
+        if ( elem->tipo != TRP_CONS ) {
             trp_gc_free( ((trp_raw_t *)raw)->data );
             trp_gc_free( raw );
             return UNDEF;
         }
-        if ( trp_cast_uns32b_range( trp_car( elem->val ), &idx1, 0, 63 ) ||
-             trp_cast_uns32b_range( trp_cdr( elem->val ), &idx2, 0, 511 ) ) {
+        if ( trp_cast_uns32b_range( trp_car( elem ), &idx1, 0, 63 ) ||
+             trp_cast_uns32b_range( trp_cdr( elem ), &idx2, 0, 511 ) ) {
             trp_gc_free( ((trp_raw_t *)raw)->data );
             trp_gc_free( raw );
             return UNDEF;
@@ -28,11 +28,6 @@ typedef struct {
 
 typedef Ihandle * (*ihandle_t)( ... );
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
 static trp_obj_t *_trp_iup_post_call_queue = NULL;
 
 static uns8b trp_iup_print( trp_print_t *p, trp_iup_t *obj );
@@ -839,13 +834,11 @@ static trp_obj_t *trp_iup_container_low_low( uns8b flags, ihandle_t f, trp_obj_t
             }
             h[ n ] = NULL;
         } else if ( child->tipo == TRP_QUEUE ) {
-            trp_queue_elem *elem;
-
             trp_gc_free( l );
             if ( ( h = trp_gc_malloc_atomic( ( ((trp_queue_t *)child)->len + 1 ) * sizeof( Ihandle * ) ) ) == NULL )
                 return UNDEF;
-            for ( elem = (trp_queue_elem *)( ((trp_queue_t *)child)->first ), n = 0 ; elem ; elem = (trp_queue_elem *)( elem->next ), n++ ) {
-                l = elem->val;
+            for ( n = 0 ; n < ((trp_queue_t *)child)->len ; n++ ) {
+                l = trp_queue_nth( n, (trp_queue_t *)child );
                 if ( ( e = trp_iup_check( l ) ) == NULL ) {
                     trp_gc_free( h );
                     return UNDEF;
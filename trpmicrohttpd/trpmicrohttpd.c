@@ -18,8 +18,10 @@
 
 #include "../trp/trp.h"
 #include "./trpmicrohttpd.h"
+#include "../trpthread/trpthread.h"
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <zlib.h>
 #ifdef MINGW
 #include <ws2tcpip.h>
 #else
@@ -33,17 +35,97 @@ typedef struct {
         struct MHD_Daemon *daemon;
         struct MHD_Connection *connection;
     };
+    void *req;
 } trp_mhd_t;
 
+/*
+ stato di una richiesta: viene allocato con GC_malloc_uncollectable
+ perche' il puntatore e' custodito da libmicrohttpd (memoria che
+ il GC non vede) e liberato alla notifica di fine richiesta
+ */
+
+typedef struct {
+    trp_mhd_t *conn;
+    trp_raw_t *body;
+    uns64b bodymax;
+    uns8b toolarge;
+    uns32b status;
+    trp_obj_t *headers;
+} trp_mhd_req_t;
+
+/*
+ sorgente di una risposta letta a pezzi da libmicrohttpd:
+ una cord, un raw, oppure un funptr che produce i blocchi
+ (risposta chunked); base è l'inizio dell'intervallo richiesto
+ (Range), pos la posizione nella cord dove si è arrivati, così
+ le letture successive non ripartono dalla radice
+ */
+
+typedef struct {
+    trp_obj_t *obj;
+    trp_obj_t *chunk;
+    uns32b off;
+    uns32b cnt;
+    uns64b base;
+    uns64b next;
+    uns8b pos_valid;
+    CORD_pos pos;
+} trp_mhd_src_t;
+
+#ifndef MHD_HTTP_RANGE_NOT_SATISFIABLE
+#define MHD_HTTP_RANGE_NOT_SATISFIABLE MHD_HTTP_REQUESTED_RANGE_NOT_SATISFIABLE
+#endif
+#ifndef MHD_HTTP_CONTENT_TOO_LARGE
+#define MHD_HTTP_CONTENT_TOO_LARGE 413
+#endif
+
+/*
+ dimensione massima del corpo di una richiesta accumulato per
+ le callback a 4 argomenti (quelle a 5 lo ricevono a pezzi);
+ oltre si risponde 413 senza chiamare la callback
+ */
+#define TRP_MHD_BODY_MAX 0x10000000
+
+/*
+ cache degli ETag delle cord (che sono immutabili): il riferimento
+ tiene viva la cord, ma le voci sono poche e vengono rimpiazzate
+ */
+
+#define TRP_MHD_ETAG_CACHE 64
+
+typedef struct {
+    trp_obj_t *obj;
+    uns32b crc;
+    uns32b adler;
+} trp_mhd_etag_t;
+
+static trp_mhd_etag_t *_trp_mhd_etag = NULL;
+static pthread_mutex_t _trp_mhd_etag_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static uns8b trp_mhd_close( trp_mhd_t *obj );
 static uns8b trp_mhd_close_basic( uns8b flags, trp_mhd_t *obj );
 static void trp_mhd_finalize( void *obj, void *data );
+static void trp_mhd_completed( void *cls, struct MHD_Connection *connection,
+                               void **ptr, enum MHD_RequestTerminationCode toe );
+static uns32b trp_mhd_cord_copy( CORD c, uns64b pos, uns8b *buf, uns32b max );
+static uns32b trp_mhd_cord_copy_pos( CORD_pos p, uns8b *buf, uns32b max );
+static ssize_t trp_mhd_reader( void *cls, uint64_t pos, char *buf, size_t max );
+static ssize_t trp_mhd_reader_chunked( void *cls, uint64_t pos, char *buf, size_t max );
+static void trp_mhd_reader_free( void *cls );
+static void trp_mhd_etag_obj( trp_obj_t *obj, uns8b *etag );
+static uns8b trp_mhd_etag_match( const char *list, uns8b *etag );
+static uns8b trp_mhd_conditional( trp_mhd_req_t *req, uns8b *etag, uns64b len, uns64b *fr, uns64b *to );
+static trp_obj_t *trp_mhd_user_header( trp_mhd_req_t *req, uns8b *name );
+static void trp_mhd_add_range_headers( struct MHD_Response *response, uns8b res, uns8b *etag, uns8b user_etag, uns64b len, uns64b fr, uns64b to );
+static struct MHD_Response *trp_mhd_response( trp_mhd_req_t *req, const char *method, trp_obj_t *page, uns32b *status );
+static trp_mhd_req_t *trp_mhd_req( trp_obj_t *conn );
 
 uns8b trp_mhd_init()
 {
     extern uns8bfun_t _trp_close_fun[];
 
     _trp_close_fun[ TRP_MHD ] = trp_mhd_close;
+    _trp_mhd_etag = GC_malloc_uncollectable( sizeof( trp_mhd_etag_t ) * TRP_MHD_ETAG_CACHE );
     return 0;
 }
 
@@ -84,56 +166,369 @@ trp_obj_t *trp_mhd_is_feature_supported( trp_obj_t *feat )
     return ( MHD_is_feature_supported( (enum MHD_FEATURE)ffeat ) == MHD_YES ) ? TRP_TRUE : TRP_FALSE;
 }
 
-static enum MHD_Result trp_mhd_cback( void *cls,
-                                      struct MHD_Connection *connection,
-                                      const char *url,
-                                      const char *method,
-                                      const char *version,
-                                      const char *upload_data,
-                                      size_t *upload_data_size,
-                                      void **ptr )
+static void trp_mhd_completed( void *cls, struct MHD_Connection *connection,
+                               void **ptr, enum MHD_RequestTerminationCode toe )
 {
-    static int dummy;
-    trp_mhd_t *conn;
-    trp_obj_t *page;
-    struct MHD_Response *response = NULL;
-    enum MHD_Result ret;
+    trp_mhd_req_t *req = (trp_mhd_req_t *)( *ptr );
 
-    if ( strcmp( method, "GET" ) )
-        return MHD_NO; /* unexpected method */
-    if ( *ptr != &dummy ) {
-        /*
-         * The first time only the headers are valid,
-         * do not respond in the first round...
-         */
-        *ptr = &dummy;
-        return MHD_YES;
+    if ( req ) {
+        req->conn->connection = NULL;
+        req->conn->req = NULL;
+        GC_free( req );
+        *ptr = NULL;
+    }
+}
+
+static uns32b trp_mhd_cord_copy( CORD c, uns64b pos, uns8b *buf, uns32b max )
+{
+    CORD_pos p;
+
+    if ( CORD_IS_STRING( c ) ) {
+        (void)memcpy( buf, c + pos, max );
+        return max;
+    }
+    CORD_set_pos( p, c, (size_t)pos );
+    return trp_mhd_cord_copy_pos( p, buf, max );
+}
+
+static uns32b trp_mhd_cord_copy_pos( CORD_pos p, uns8b *buf, uns32b max )
+{
+    uns32b n = 0;
+    long k;
+
+    while ( ( n < max ) && CORD_pos_valid( p ) ) {
+        k = CORD_pos_chars_left( p );
+        if ( k > 0 ) {
+            if ( k > (long)( max - n ) )
+                k = (long)( max - n );
+            (void)memcpy( buf + n, CORD_pos_cur_char_addr( p ), k );
+            n += (uns32b)k;
+            CORD_pos_advance( p, k );
+        } else {
+            buf[ n++ ] = CORD_pos_fetch( p );
+            CORD_next( p );
+        }
+    }
+    return n;
+}
+
+static ssize_t trp_mhd_reader( void *cls, uint64_t pos, char *buf, size_t max )
+{
+    trp_mhd_src_t *src = (trp_mhd_src_t *)cls;
+    trp_obj_t *obj = src->obj;
+    CORD c;
+    uns32b len, n;
+
+    len = ( obj->tipo == TRP_CORD ) ? ((trp_cord_t *)obj)->len : ((trp_raw_t *)obj)->len;
+    if ( src->base + pos >= len )
+        return MHD_CONTENT_READER_END_OF_STREAM;
+    if ( max > len - src->base - pos )
+        max = len - src->base - pos;
+    if ( obj->tipo == TRP_RAW ) {
+        (void)memcpy( buf, ((trp_raw_t *)obj)->data + src->base + pos, max );
+        return (ssize_t)max;
+    }
+    c = ((trp_cord_t *)obj)->c;
+    if ( CORD_IS_STRING( c ) ) {
+        (void)memcpy( buf, c + src->base + pos, max );
+        return (ssize_t)max;
+    }
+    if ( ( src->pos_valid == 0 ) || ( src->next != pos ) ) {
+        CORD_set_pos( src->pos, c, (size_t)( src->base + pos ) );
+        src->pos_valid = 1;
+    }
+    n = trp_mhd_cord_copy_pos( src->pos, buf, (uns32b)max );
+    src->next = pos + n;
+    return (ssize_t)n;
+}
+
+/*
+ il funptr riceve il numero progressivo del blocco e rende
+ una cord o un raw; qualunque altra cosa chiude lo stream
+ */
+
+static ssize_t trp_mhd_reader_chunked( void *cls, uint64_t pos, char *buf, size_t max )
+{
+    trp_mhd_src_t *src = (trp_mhd_src_t *)cls;
+    uns32b len, n;
+
+    (void)trp_thread_register_my_thread_auto();
+    for ( ; ; ) {
+        if ( src->chunk ) {
+            len = ( src->chunk->tipo == TRP_CORD )
+                ? ((trp_cord_t *)( src->chunk ))->len
+                : ((trp_raw_t *)( src->chunk ))->len;
+            if ( src->off < len )
+                break;
+        }
+        src->chunk = (((trp_funptr_t *)( src->obj ))->f)( trp_sig64( src->cnt++ ) );
+        src->off = 0;
+        if ( ( src->chunk->tipo != TRP_CORD ) && ( src->chunk->tipo != TRP_RAW ) )
+            return MHD_CONTENT_READER_END_OF_STREAM;
+    }
+    n = len - src->off;
+    if ( n > max )
+        n = (uns32b)max;
+    if ( src->chunk->tipo == TRP_CORD )
+        n = trp_mhd_cord_copy( ((trp_cord_t *)( src->chunk ))->c, src->off, buf, n );
+    else
+        (void)memcpy( buf, ((trp_raw_t *)( src->chunk ))->data + src->off, n );
+    src->off += n;
+    return (ssize_t)n;
+}
+
+static void trp_mhd_reader_free( void *cls )
+{
+    GC_free( cls );
+}
+
+/*
+ l'ETag di cord e raw è dato da crc32 e adler32 del contenuto,
+ calcolati scorrendo le foglie della cord senza appiattirla
+ */
+
+static void trp_mhd_etag_obj( trp_obj_t *obj, uns8b *etag )
+{
+    trp_mhd_etag_t *e = NULL;
+    uns32b crc, adler;
+
+    if ( obj->tipo == TRP_CORD ) {
+        e = _trp_mhd_etag + ( ( (size_t)obj >> 4 ) % TRP_MHD_ETAG_CACHE );
+        pthread_mutex_lock( &_trp_mhd_etag_mutex );
+        if ( e->obj == obj ) {
+            crc = e->crc;
+            adler = e->adler;
+            pthread_mutex_unlock( &_trp_mhd_etag_mutex );
+            sprintf( etag, "\"%08x%08x\"", crc, adler );
+            return;
+        }
+        pthread_mutex_unlock( &_trp_mhd_etag_mutex );
+    }
+    crc = crc32( 0L, Z_NULL, 0 );
+    adler = adler32( 0L, Z_NULL, 0 );
+    if ( obj->tipo == TRP_RAW ) {
+        crc = crc32( crc, ((trp_raw_t *)obj)->data, ((trp_raw_t *)obj)->len );
+        adler = adler32( adler, ((trp_raw_t *)obj)->data, ((trp_raw_t *)obj)->len );
+    } else if ( ((trp_cord_t *)obj)->len ) {
+        CORD c = ((trp_cord_t *)obj)->c;
+
+        if ( CORD_IS_STRING( c ) ) {
+            crc = crc32( crc, c, ((trp_cord_t *)obj)->len );
+            adler = adler32( adler, c, ((trp_cord_t *)obj)->len );
+        } else {
+            CORD_pos p;
+            long k;
+            uns8b ch;
+
+            CORD_set_pos( p, c, 0 );
+            while ( CORD_pos_valid( p ) ) {
+                k = CORD_pos_chars_left( p );
+                if ( k > 0 ) {
+                    crc = crc32( crc, CORD_pos_cur_char_addr( p ), k );
+                    adler = adler32( adler, CORD_pos_cur_char_addr( p ), k );
+                    CORD_pos_advance( p, k );
+                } else {
+                    ch = CORD_pos_fetch( p );
+                    crc = crc32( crc, &ch, 1 );
+                    adler = adler32( adler, &ch, 1 );
+                    CORD_next( p );
+                }
+            }
+        }
+    }
+    if ( e ) {
+        pthread_mutex_lock( &_trp_mhd_etag_mutex );
+        e->obj = obj;
+        e->crc = crc;
+        e->adler = adler;
+        pthread_mutex_unlock( &_trp_mhd_etag_mutex );
+    }
+    sprintf( etag, "\"%08x%08x\"", crc, adler );
+}
+
+/*
+ confronto debole, come vuole If-None-Match
+ */
+
+static uns8b trp_mhd_etag_match( const char *list, uns8b *etag )
+{
+    size_t l = strlen( etag );
+    const char *p;
+
+    if ( list == NULL )
+        return 0;
+    for ( p = list ; *p ; ) {
+        while ( ( *p == ' ' ) || ( *p == '\t' ) || ( *p == ',' ) )
+            p++;
+        if ( *p == '*' )
+            return 1;
+        if ( strncmp( p, "W/", 2 ) == 0 )
+            p += 2;
+        if ( strncmp( p, etag, l ) == 0 )
+            if ( ( p[ l ] == 0 ) || ( p[ l ] == ',' ) || ( p[ l ] == ' ' ) || ( p[ l ] == '\t' ) )
+                return 1;
+        while ( *p && ( *p != ',' ) )
+            p++;
     }
-    if ( *upload_data_size )
-        return MHD_NO; /* upload data in a GET!? */
-    *ptr = NULL; /* clear context pointer */
+    return 0;
+}
+
+/*
+ rende 0 (tutto il contenuto), 1 (intervallo [fr,to)),
+ 2 (intervallo non soddisfacibile) oppure 3 (non modificato);
+ si gestisce un solo intervallo: con più intervalli si manda tutto
+ */
 
-    conn = trp_gc_malloc_atomic( sizeof( trp_mhd_t ) );
-    conn->tipo = TRP_MHD;
-    conn->sottotipo = 1;
-    conn->connection = connection;
+static uns8b trp_mhd_conditional( trp_mhd_req_t *req, uns8b *etag, uns64b len, uns64b *fr, uns64b *to )
+{
+    struct MHD_Connection *connection = req->conn->connection;
+    const char *r, *ir;
+    char *e;
+    uns64b a, b;
 
-    page = ( (objfun_t)cls )( (trp_obj_t *)conn, trp_cord( url ), trp_cord( method ), trp_cord( version ) );
+    *fr = 0;
+    *to = len;
+    if ( trp_mhd_etag_match( MHD_lookup_connection_value( connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH ), etag ) )
+        return 3;
+    r = MHD_lookup_connection_value( connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_RANGE );
+    if ( ( r == NULL ) || strncmp( r, "bytes=", 6 ) || strchr( r, ',' ) )
+        return 0;
+    ir = MHD_lookup_connection_value( connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_RANGE );
+    if ( ir && strcmp( ir, etag ) )
+        return 0;
+    for ( r += 6 ; *r == ' ' ; r++ );
+    if ( *r == '-' ) {
+        b = strtoull( r + 1, &e, 10 );
+        if ( ( e == r + 1 ) || *e )
+            return 0;
+        if ( ( b == 0 ) || ( len == 0 ) )
+            return 2;
+        *fr = ( b < len ) ? len - b : 0;
+        return 1;
+    }
+    a = strtoull( r, &e, 10 );
+    if ( ( e == r ) || ( *e != '-' ) )
+        return 0;
+    r = e + 1;
+    if ( *r ) {
+        b = strtoull( r, &e, 10 );
+        if ( ( e == r ) || *e || ( b < a ) )
+            return 0;
+        b++;
+    } else
+        b = len;
+    if ( a >= len )
+        return 2;
+    *fr = a;
+    *to = ( b < len ) ? b : len;
+    return 1;
+}
+
+static trp_obj_t *trp_mhd_user_header( trp_mhd_req_t *req, uns8b *name )
+{
+    trp_obj_t *l, *h;
+    uns8b *n;
+    int cmp;
+
+    for ( l = req->headers ; l != NIL ; l = ((trp_cons_t *)l)->cdr ) {
+        h = ((trp_cons_t *)l)->car;
+        n = trp_csprint( ((trp_cons_t *)h)->car );
+        cmp = strcasecmp( n, name );
+        trp_csprint_free( n );
+        if ( cmp == 0 )
+            return ((trp_cons_t *)h)->cdr;
+    }
+    return NULL;
+}
+
+static void trp_mhd_add_range_headers( struct MHD_Response *response, uns8b res, uns8b *etag, uns8b user_etag, uns64b len, uns64b fr, uns64b to )
+{
+    uns8b buf[ 64 ];
+
+    if ( user_etag == 0 )
+        (void)MHD_add_response_header( response, MHD_HTTP_HEADER_ETAG, etag );
+    (void)MHD_add_response_header( response, MHD_HTTP_HEADER_ACCEPT_RANGES, "bytes" );
+    if ( res == 1 ) {
+        sprintf( buf, "bytes %llu-%llu/%llu", (unsigned long long)fr, (unsigned long long)( to - 1 ), (unsigned long long)len );
+        (void)MHD_add_response_header( response, MHD_HTTP_HEADER_CONTENT_RANGE, buf );
+    } else if ( res == 2 ) {
+        sprintf( buf, "bytes */%llu", (unsigned long long)len );
+        (void)MHD_add_response_header( response, MHD_HTTP_HEADER_CONTENT_RANGE, buf );
+    }
+}
+
+/*
+ cord e raw vengono letti direttamente (le cord foglia per foglia)
+ da libmicrohttpd, senza copie intermedie; per GET e HEAD con stato
+ 200 si gestiscono ETag (calcolato, o quello messo con mhd-add-header),
+ If-None-Match e Range, anche per i file (ETag da inode, dimensione
+ e data di modifica)
+ */
+
+static struct MHD_Response *trp_mhd_response( trp_mhd_req_t *req, const char *method, trp_obj_t *page, uns32b *status )
+{
+    struct MHD_Response *response = NULL;
+    trp_mhd_src_t *src;
+    trp_obj_t *user_etag = NULL;
+    uns8b etagbuf[ 64 ], *etag = etagbuf, cond, res = 0;
+    uns64b len = 0, fr = 0, to = 0;
+
+    cond = ( ( *status == MHD_HTTP_OK ) &&
+             ( ( strcmp( method, "GET" ) == 0 ) || ( strcmp( method, "HEAD" ) == 0 ) ) ) ? 1 : 0;
+    if ( cond )
+        if ( user_etag = trp_mhd_user_header( req, MHD_HTTP_HEADER_ETAG ) )
+            etag = trp_csprint( user_etag );
     switch ( page->tipo ) {
         case TRP_CORD:
-            response = MHD_create_response_from_buffer( ( (trp_cord_t *)page )->len,
-                                                        (void *)( CORD_to_char_star( ( (trp_cord_t *)page )->c ) ),
-                                                        MHD_RESPMEM_MUST_COPY );
-            break;
         case TRP_RAW:
-            response = MHD_create_response_from_buffer( ( (trp_raw_t *)page )->len,
-                                                        ( (trp_raw_t *)page )->data,
-                                                        MHD_RESPMEM_MUST_COPY );
+            len = ( page->tipo == TRP_CORD ) ? ((trp_cord_t *)page)->len : ((trp_raw_t *)page)->len;
+            to = len;
+            if ( cond ) {
+                if ( user_etag == NULL )
+                    trp_mhd_etag_obj( page, etag );
+                res = trp_mhd_conditional( req, etag, len, &fr, &to );
+            }
+            if ( res >= 2 ) {
+                response = MHD_create_response_from_buffer( 0, NULL, MHD_RESPMEM_PERSISTENT );
+                break;
+            }
+            src = GC_malloc_uncollectable( sizeof( trp_mhd_src_t ) );
+            src->obj = page;
+            src->chunk = NULL;
+            src->base = fr;
+            src->next = 0;
+            src->pos_valid = 0;
+            response = MHD_create_response_from_callback( to - fr,
+                                                          32 * 1024,
+                                                          &trp_mhd_reader,
+                                                          (void *)src,
+                                                          &trp_mhd_reader_free );
+            if ( response == NULL )
+                GC_free( src );
+            break;
+        case TRP_FUNPTR:
+            cond = 0;
+            if ( ( (trp_funptr_t *)page )->nargs != 1 )
+                break;
+            src = GC_malloc_uncollectable( sizeof( trp_mhd_src_t ) );
+            src->obj = page;
+            src->chunk = NULL;
+            src->off = 0;
+            src->cnt = 0;
+            response = MHD_create_response_from_callback( MHD_SIZE_UNKNOWN,
+                                                          32 * 1024,
+                                                          &trp_mhd_reader_chunked,
+                                                          (void *)src,
+                                                          &trp_mhd_reader_free );
+            if ( response == NULL )
+                GC_free( src );
             break;
         case TRP_CONS:
             page = trp_car( page );
             if ( page->tipo == TRP_CORD ) {
                 uns8b *path = CORD_to_char_star( ( (trp_cord_t *)page )->c );
+                uns64b ino = 0, mtime = 0;
+                uns8b ok = 0;
                 int fd;
 
                 fd = trp_open( path, O_RDONLY );
@@ -142,58 +537,239 @@ static enum MHD_Result trp_mhd_cback( void *cls,
                     struct _stati64 st;
 
                     if ( _fstati64( fd, &st ) == 0 )
-                        if ( ( st.st_mode & S_IFMT ) == S_IFREG )
-                            response = MHD_create_response_from_fd64( st.st_size, fd );
+                        if ( ( st.st_mode & S_IFMT ) == S_IFREG ) {
+                            len = st.st_size;
+                            ino = st.st_ino;
+                            mtime = st.st_mtime;
+                            ok = 1;
+                        }
                 }
 #else
                 if ( fd >= 0 ) {
                     struct stat st;
 
                     if ( fstat( fd, &st ) == 0 )
-                        if ( ( st.st_mode & S_IFMT ) == S_IFREG )
-                            response = MHD_create_response_from_fd64( st.st_size, fd );
+                        if ( ( st.st_mode & S_IFMT ) == S_IFREG ) {
+                            len = st.st_size;
+                            ino = st.st_ino;
+                            mtime = st.st_mtime;
+                            ok = 1;
+                        }
                 }
 #endif
+                if ( ok ) {
+                    to = len;
+                    if ( cond ) {
+                        if ( user_etag == NULL )
+                            sprintf( etag, "\"%llx-%llx-%llx\"", (unsigned long long)ino,
+                                     (unsigned long long)len, (unsigned long long)mtime );
+                        res = trp_mhd_conditional( req, etag, len, &fr, &to );
+                    }
+                    if ( res >= 2 ) {
+                        (void)close( fd );
+                        fd = -1;
+                        response = MHD_create_response_from_buffer( 0, NULL, MHD_RESPMEM_PERSISTENT );
+                    } else
+                        response = MHD_create_response_from_fd_at_offset64( to - fr, fd, fr );
+                }
+                if ( ( response == NULL ) && ( fd >= 0 ) )
+                    (void)close( fd );
             }
             break;
         default:
+            cond = 0;
             break;
     }
-    if ( response == NULL )
+    if ( response && cond ) {
+        trp_mhd_add_range_headers( response, res, etag, user_etag ? 1 : 0, len, fr, to );
+        switch ( res ) {
+            case 1:
+                *status = MHD_HTTP_PARTIAL_CONTENT;
+                break;
+            case 2:
+                *status = MHD_HTTP_RANGE_NOT_SATISFIABLE;
+                break;
+            case 3:
+                *status = MHD_HTTP_NOT_MODIFIED;
+                break;
+        }
+    }
+    if ( user_etag )
+        trp_csprint_free( etag );
+    return response;
+}
+
+/*
+ cls e' il funptr di callback: con 4 argomenti (conn url method version)
+ il corpo di POST/PUT viene accumulato e si legge con mhd-get-upload-data;
+ con 5 argomenti la callback viene chiamata anche per ogni blocco
+ ricevuto (quinto argomento: il blocco come raw; se non rende true la
+ connessione viene chiusa) e infine con il quinto argomento undef
+ */
+
+static enum MHD_Result trp_mhd_cback( void *cls,
+                                      struct MHD_Connection *connection,
+                                      const char *url,
+                                      const char *method,
+                                      const char *version,
+                                      const char *upload_data,
+                                      size_t *upload_data_size,
+                                      void **ptr )
+{
+    extern trp_obj_t *trp_raw_internal( uns32b sz, uns8b use_malloc );
+    trp_funptr_t *cb = (trp_funptr_t *)cls;
+    trp_mhd_req_t *req;
+    trp_obj_t *page;
+    struct MHD_Response *response;
+    enum MHD_Result ret;
+    uns32b status;
+
+    if ( trp_thread_register_my_thread_auto() )
         return MHD_NO;
-    ret = MHD_queue_response( connection, MHD_HTTP_OK, response );
+    if ( *ptr == NULL ) {
+        /*
+         * The first time only the headers are valid,
+         * do not respond in the first round...
+         */
+        req = GC_malloc_uncollectable( sizeof( trp_mhd_req_t ) );
+        req->conn = trp_gc_malloc( sizeof( trp_mhd_t ) );
+        req->conn->tipo = TRP_MHD;
+        req->conn->sottotipo = 1;
+        req->conn->connection = connection;
+        req->conn->req = (void *)req;
+        req->body = NULL;
+        req->bodymax = 0;
+        req->toolarge = 0;
+        req->status = MHD_HTTP_OK;
+        req->headers = NIL;
+        *ptr = (void *)req;
+        return MHD_YES;
+    }
+    req = (trp_mhd_req_t *)( *ptr );
+    if ( *upload_data_size ) {
+        uns32b n = (uns32b)( *upload_data_size );
+
+        if ( cb->nargs == 5 ) {
+            trp_obj_t *raw = trp_raw_internal( n, 0 );
+
+            (void)memcpy( ((trp_raw_t *)raw)->data, upload_data, n );
+            if ( (cb->f)( (trp_obj_t *)( req->conn ), trp_cord( url ), trp_cord( method ),
+                          trp_cord( version ), raw ) != TRP_TRUE )
+                return MHD_NO;
+        } else if ( req->toolarge == 0 ) {
+            if ( req->body == NULL ) {
+                req->body = (trp_raw_t *)trp_raw_internal( 0, 0 );
+                req->bodymax = 0;
+            }
+            if ( (uns64b)( req->body->len ) + n > TRP_MHD_BODY_MAX ) {
+                /*
+                 il resto del corpo viene letto e scartato
+                 */
+                req->toolarge = 1;
+                req->body = NULL;
+                *upload_data_size = 0;
+                return MHD_YES;
+            }
+            if ( req->body->len + n > req->bodymax ) {
+                req->bodymax = ( (uns64b)( req->body->len ) + n ) << 1;
+                if ( req->bodymax > TRP_MHD_BODY_MAX )
+                    req->bodymax = TRP_MHD_BODY_MAX;
+                req->body->data = req->body->data
+                    ? trp_gc_realloc( req->body->data, req->bodymax )
+                    : trp_gc_malloc_atomic( req->bodymax );
+            }
+            (void)memcpy( req->body->data + req->body->len, upload_data, n );
+            req->body->len += n;
+        }
+        *upload_data_size = 0;
+        return MHD_YES;
+    }
+    if ( req->toolarge ) {
+        if ( ( response = MHD_create_response_from_buffer( 0, NULL, MHD_RESPMEM_PERSISTENT ) ) == NULL )
+            return MHD_NO;
+        (void)MHD_add_response_header( response, MHD_HTTP_HEADER_CONNECTION, "close" );
+        ret = MHD_queue_response( connection, MHD_HTTP_CONTENT_TOO_LARGE, response );
+        MHD_destroy_response( response );
+        return ret;
+    }
+    if ( cb->nargs == 5 )
+        page = (cb->f)( (trp_obj_t *)( req->conn ), trp_cord( url ), trp_cord( method ),
+                        trp_cord( version ), UNDEF );
+    else
+        page = (cb->f)( (trp_obj_t *)( req->conn ), trp_cord( url ), trp_cord( method ),
+                        trp_cord( version ) );
+    status = req->status;
+    if ( ( response = trp_mhd_response( req, method, page, &status ) ) == NULL )
+        return MHD_NO;
+    for ( page = req->headers ; page != NIL ; page = ((trp_cons_t *)page)->cdr ) {
+        trp_obj_t *h = ((trp_cons_t *)page)->car;
+        uns8b *name = trp_csprint( ((trp_cons_t *)h)->car );
+        uns8b *value = trp_csprint( ((trp_cons_t *)h)->cdr );
+
+        (void)MHD_add_response_header( response, name, value );
+        trp_csprint_free( name );
+        trp_csprint_free( value );
+    }
+    ret = MHD_queue_response( connection, status, response );
     MHD_destroy_response( response );
     return ret;
 }
 
-trp_obj_t *trp_mhd_start_daemon( trp_obj_t *cbfun, trp_obj_t *port )
+/*
+ threads (opzionale): se maggiore di zero il demone gira su un pool
+ di threads thread interni (epoll dove disponibile) e mhd-run-wait
+ non serve piu'; i thread di libmicrohttpd vengono registrati nel GC
+ alla prima richiesta che servono
+ */
+
+trp_obj_t *trp_mhd_start_daemon( trp_obj_t *cbfun, trp_obj_t *port, trp_obj_t *threads )
 {
     trp_mhd_t *obj;
     struct MHD_Daemon *daemon;
-    uns32b pport;
+    uns32b pport, nthreads = 0;
 
     if ( cbfun->tipo != TRP_FUNPTR )
         return UNDEF;
-    if ( ( (trp_funptr_t *)cbfun )->nargs != 4 )
+    if ( ( ( (trp_funptr_t *)cbfun )->nargs != 4 ) &&
+         ( ( (trp_funptr_t *)cbfun )->nargs != 5 ) )
         return UNDEF;
     if ( port ) {
         if ( trp_cast_uns32b( port, &pport ) )
             return UNDEF;
     } else
         pport = 8888;
-    daemon = MHD_start_daemon( 0, /* MHD_USE_THREAD_PER_CONNECTION */
-                               (uint16_t)pport,
-                               NULL,
-                               NULL,
-                               &trp_mhd_cback,
-                               (void *)( ( (trp_funptr_t *)cbfun )->f ),
-                               MHD_OPTION_END );
+    if ( threads )
+        if ( trp_cast_uns32b( threads, &nthreads ) )
+            return UNDEF;
+    if ( nthreads )
+        daemon = MHD_start_daemon( MHD_USE_AUTO_INTERNAL_THREAD,
+                                   (uint16_t)pport,
+                                   NULL,
+                                   NULL,
+                                   &trp_mhd_cback,
+                                   (void *)cbfun,
+                                   MHD_OPTION_NOTIFY_COMPLETED, &trp_mhd_completed, NULL,
+                                   MHD_OPTION_THREAD_POOL_SIZE, (unsigned int)nthreads,
+                                   MHD_OPTION_END );
+    else
+        daemon = MHD_start_daemon( 0,
+                                   (uint16_t)pport,
+                                   NULL,
+                                   NULL,
+                                   &trp_mhd_cback,
+                                   (void *)cbfun,
+                                   MHD_OPTION_NOTIFY_COMPLETED, &trp_mhd_completed, NULL,
+                                   MHD_OPTION_END );
     if ( daemon == NULL )
         return UNDEF;
-    obj = trp_gc_malloc_atomic_finalize( sizeof( trp_mhd_t ), trp_mhd_finalize );
+    /*
+     il funptr di callback deve restare vivo quanto il demone
+     */
+    obj = trp_gc_malloc_finalize( sizeof( trp_mhd_t ), trp_mhd_finalize );
     obj->tipo = TRP_MHD;
     obj->sottotipo = 0;
     obj->daemon = daemon;
+    obj->req = (void *)cbfun;
     return (trp_obj_t *)obj;
 }
 
@@ -246,3 +822,76 @@ trp_obj_t *trp_mhd_get_connection_info_client_address( trp_obj_t *conn )
     return trp_cord( buf );
 }
 
+
+static trp_mhd_req_t *trp_mhd_req( trp_obj_t *conn )
+{
+    if ( conn->tipo != TRP_MHD )
+        return NULL;
+    if ( ((trp_mhd_t *)conn)->sottotipo != 1 )
+        return NULL;
+    return (trp_mhd_req_t *)( ((trp_mhd_t *)conn)->req );
+}
+
+trp_obj_t *trp_mhd_get_upload_data( trp_obj_t *conn )
+{
+    trp_mhd_req_t *req = trp_mhd_req( conn );
+
+    if ( req == NULL )
+        return UNDEF;
+    if ( req->body == NULL )
+        return UNDEF;
+    return (trp_obj_t *)( req->body );
+}
+
+trp_obj_t *trp_mhd_get_header( trp_obj_t *conn, trp_obj_t *name )
+{
+    trp_mhd_req_t *req = trp_mhd_req( conn );
+    const char *v;
+    uns8b *n;
+
+    if ( req == NULL )
+        return UNDEF;
+    n = trp_csprint( name );
+    v = MHD_lookup_connection_value( req->conn->connection, MHD_HEADER_KIND, n );
+    trp_csprint_free( n );
+    return v ? trp_cord( v ) : UNDEF;
+}
+
+trp_obj_t *trp_mhd_get_argument( trp_obj_t *conn, trp_obj_t *name )
+{
+    trp_mhd_req_t *req = trp_mhd_req( conn );
+    const char *v;
+    uns8b *n;
+
+    if ( req == NULL )
+        return UNDEF;
+    n = trp_csprint( name );
+    v = MHD_lookup_connection_value( req->conn->connection, MHD_GET_ARGUMENT_KIND, n );
+    trp_csprint_free( n );
+    return v ? trp_cord( v ) : UNDEF;
+}
+
+uns8b trp_mhd_set_status( trp_obj_t *conn, trp_obj_t *status )
+{
+    trp_mhd_req_t *req = trp_mhd_req( conn );
+    uns32b s;
+
+    if ( req == NULL )
+        return 1;
+    if ( trp_cast_uns32b( status, &s ) )
+        return 1;
+    if ( ( s < 100 ) || ( s > 999 ) )
+        return 1;
+    req->status = s;
+    return 0;
+}
+
+uns8b trp_mhd_add_header( trp_obj_t *conn, trp_obj_t *name, trp_obj_t *value )
+{
+    trp_mhd_req_t *req = trp_mhd_req( conn );
+
+    if ( req == NULL )
+        return 1;
+    req->headers = trp_cons( trp_cons( name, value ), req->headers );
+    return 0;
+}
@@ -24,9 +24,14 @@
 uns8b trp_mhd_init();
 trp_obj_t *trp_mhd_version();
 trp_obj_t *trp_mhd_is_feature_supported( trp_obj_t *feat );
-trp_obj_t *trp_mhd_start_daemon( trp_obj_t *cbfun, trp_obj_t *port );
+trp_obj_t *trp_mhd_start_daemon( trp_obj_t *cbfun, trp_obj_t *port, trp_obj_t *threads );
 uns8b trp_mhd_run_wait( trp_obj_t *obj, trp_obj_t *timeout );
 uns8b trp_mhd_stop_daemon( trp_obj_t *obj );
 trp_obj_t *trp_mhd_get_connection_info_client_address( trp_obj_t *conn );
+trp_obj_t *trp_mhd_get_upload_data( trp_obj_t *conn );
+trp_obj_t *trp_mhd_get_header( trp_obj_t *conn, trp_obj_t *name );
+trp_obj_t *trp_mhd_get_argument( trp_obj_t *conn, trp_obj_t *name );
+uns8b trp_mhd_set_status( trp_obj_t *conn, trp_obj_t *status );
+uns8b trp_mhd_add_header( trp_obj_t *conn, trp_obj_t *name, trp_obj_t *value );
 
 #endif /* !__trpmicrohttpd__h */
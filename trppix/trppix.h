@@ -99,10 +99,13 @@ uns8b trp_pix_contrast_rgb( trp_obj_t *pix, trp_obj_t *val_r, trp_obj_t *val_g,
 uns8b trp_pix_gamma( trp_obj_t *pix, trp_obj_t *val );
 uns8b trp_pix_gamma_rgb( trp_obj_t *pix, trp_obj_t *val_r, trp_obj_t *val_g, trp_obj_t *val_b );
 trp_obj_t *trp_pix_mse( trp_obj_t *pix1, trp_obj_t *pix2 );
+trp_obj_t *trp_pix_mse_multi( trp_obj_t *ref, trp_obj_t *pixs );
 trp_obj_t *trp_pix_text( trp_obj_t *s, ... );
 trp_obj_t *trp_pix_ssim( trp_obj_t *pix1, trp_obj_t *pix2, trp_obj_t *weights );
 trp_obj_t *trp_pix_ssim_linear( trp_obj_t *pix1, trp_obj_t *pix2 );
 trp_obj_t *trp_pix_ssim_gaussian( trp_obj_t *pix1, trp_obj_t *pix2 );
+trp_obj_t *trp_pix_ssim_linear_multi( trp_obj_t *ref, trp_obj_t *pixs );
+trp_obj_t *trp_pix_ssim_gaussian_multi( trp_obj_t *ref, trp_obj_t *pixs );
 trp_obj_t *trp_pix_scd( trp_obj_t *pix, trp_obj_t *ref, trp_obj_t *dimblock, trp_obj_t *radius );
 trp_obj_t *trp_pix_scd_histogram( trp_obj_t *pix1, trp_obj_t *pix2 );
 uns8b trp_pix_scd_histogram_set( trp_obj_t *pix, trp_obj_t *raw );
@@ -51,6 +51,9 @@ typedef struct {
     } color;
 } trp_pix_t;
 
+typedef void (*trp_pix_multi_fun_t)( void *ctx, trp_pix_color_t *ref, trp_pix_color_t *map, uns32b w, uns32b h, void *res );
+typedef trp_obj_t *(*trp_pix_multi_obj_t)( void *ctx, void *res, uns32b w, uns32b h );
+
 /* la somma deve essere 1000 */
 #define TRP_PIX_WEIGHT_RED 299
 #define TRP_PIX_WEIGHT_GREEN 587
@@ -110,5 +113,8 @@ void trp_pix_fclamp_rgb( flt64b *r, flt64b *g, flt64b *b );
 trp_obj_t *trp_pix_clone( trp_obj_t *pix );
 flt64b pix_color_diff( uns8b r1, uns8b g1, uns8b b1, uns8b r2, uns8b g2, uns8b b2 );
 flt64b pix_color_diff_color( uns8b r, uns8b g, uns8b b, trp_pix_color_t *c );
+trp_obj_t *trp_pix_multi( trp_obj_t *ref, trp_obj_t *pixs, uns32b minw, uns32b minh,
+                          void *ctx, size_t ctxsize, trp_pix_multi_fun_t f,
+                          size_t rsize, trp_pix_multi_obj_t mk );
 
 #endif /* !__trppix_internal__h */
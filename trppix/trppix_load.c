@@ -76,11 +76,6 @@ static uns8b *_trp_pix_decoder[ TRP_PIX_MAX ] = {
     "cv"
 };
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
 static trp_obj_t *trp_pix_load_thumbnail_memory_low( trp_obj_t *raw, uns32b sw, uns32b sh, trp_obj_t *w, trp_obj_t *h );
 
 trp_obj_t *trp_pix_loader( trp_obj_t *pix )
@@ -114,12 +109,10 @@ trp_obj_t *trp_pix_load_multiple( trp_obj_t *path )
     }
     trp_csprint_free( cpath );
     if ( res != UNDEF ) {
-        trp_queue_elem *elem;
+        uns32b i;
 
-        for ( elem = (trp_queue_elem *)( (trp_queue_t *)( ((trp_queue_t *)res)->first ) ) ;
-              elem ;
-              elem = (trp_queue_elem *)( elem->next ) )
-            ((trp_pix_t *)( ((trp_cons_t *)( elem->val ))->car ))->sottotipo = sottotipo;
+        for ( i = 0 ; i < ((trp_queue_t *)res)->len ; i++ )
+            ((trp_pix_t *)( ((trp_cons_t *)( trp_queue_nth( i, (trp_queue_t *)res ) ))->car ))->sottotipo = sottotipo;
     }
     return res;
 }
@@ -17,13 +17,32 @@
 */
 
 #include "./trppix_internal.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define trp_pix_cast(x) ((uns32b)((x)+0.5))
 
+#define TRP_PIX_MSE_PAR_MIN 262144
+#define TRP_PIX_MSE_PAR_CHUNK 65536
+
+typedef struct {
+    trp_pix_color_t *map1;
+    trp_pix_color_t *map2;
+    uns32b fr;
+    uns32b to;
+    sig64b tot;
+} trp_pix_mse_par_t;
+
 static trp_obj_t *trp_pix_top_bottom_field( uns8b bottom, trp_obj_t *pix );
 static uns8b trp_pix_top_bottom_field_test( uns8b bottom, trp_obj_t *pix );
 static void trp_pix_colormod_set_table( uns8b tipo, uns8b *t, flt64b v );
 static void trp_pix_colormod_basic( uns8b tipo, trp_pix_color_t *map, uns32b w, uns32b h, flt64b vr, flt64b vg, flt64b vb );
+static sig64b trp_pix_mse_range( trp_pix_color_t *map1, trp_pix_color_t *map2, uns32b fr, uns32b to );
+static void *trp_pix_mse_routine( void *arg );
+static sig64b trp_pix_mse_low( trp_pix_color_t *map1, trp_pix_color_t *map2, uns32b n, uns32b parts );
+static void trp_pix_mse_multi_fun( void *ctx, trp_pix_color_t *ref, trp_pix_color_t *map, uns32b w, uns32b h, void *res );
+static trp_obj_t *trp_pix_mse_multi_obj( void *ctx, void *res, uns32b w, uns32b h );
 
 trp_obj_t *trp_pix_point( trp_obj_t *pix, trp_obj_t *x, trp_obj_t *y )
 {
@@ -364,6 +383,78 @@ uns8b trp_pix_gamma_rgb( trp_obj_t *pix, trp_obj_t *val_r, trp_obj_t *val_g, trp
     return 0;
 }
 
+static sig64b trp_pix_mse_range( trp_pix_color_t *map1, trp_pix_color_t *map2, uns32b fr, uns32b to )
+{
+    sig64b tot = 0, j;
+    uns32b i = fr;
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128(), acc = zero, a, b, m, mask;
+    __m128i wt = _mm_set_epi16( 0, TRP_PIX_WEIGHT_BLUE, TRP_PIX_WEIGHT_GREEN, TRP_PIX_WEIGHT_RED,
+                                0, TRP_PIX_WEIGHT_BLUE, TRP_PIX_WEIGHT_GREEN, TRP_PIX_WEIGHT_RED );
+    sig64b t[ 2 ];
+
+    /*
+     4 pixel alla volta: le differenze pesate (|j| <= 255000) si ottengono
+     con madd a 16 bit, i quadrati con mul_epu32 a 64 bit
+     */
+    for ( ; i + 4 <= to ; i += 4 ) {
+        a = _mm_loadu_si128( (__m128i *)( map1 + i ) );
+        b = _mm_loadu_si128( (__m128i *)( map2 + i ) );
+        m = _mm_madd_epi16( _mm_sub_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ) ), wt );
+        m = _mm_add_epi32( m, _mm_srli_epi64( m, 32 ) );
+        mask = _mm_srai_epi32( m, 31 );
+        m = _mm_sub_epi32( _mm_xor_si128( m, mask ), mask );
+        acc = _mm_add_epi64( acc, _mm_mul_epu32( m, m ) );
+        m = _mm_madd_epi16( _mm_sub_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ) ), wt );
+        m = _mm_add_epi32( m, _mm_srli_epi64( m, 32 ) );
+        mask = _mm_srai_epi32( m, 31 );
+        m = _mm_sub_epi32( _mm_xor_si128( m, mask ), mask );
+        acc = _mm_add_epi64( acc, _mm_mul_epu32( m, m ) );
+    }
+    _mm_storeu_si128( (__m128i *)t, acc );
+    tot = t[ 0 ] + t[ 1 ];
+#endif
+    for ( ; i < to ; i++ ) {
+        j = ( ( (sig32b)( map1[ i ].red ) ) - ( (sig32b)( map2[ i ].red ) ) ) * TRP_PIX_WEIGHT_RED +
+            ( ( (sig32b)( map1[ i ].green ) ) - ( (sig32b)( map2[ i ].green ) ) ) * TRP_PIX_WEIGHT_GREEN +
+            ( ( (sig32b)( map1[ i ].blue ) ) - ( (sig32b)( map2[ i ].blue ) ) ) * TRP_PIX_WEIGHT_BLUE;
+        tot += j * j;
+    }
+    return tot;
+}
+
+static void *trp_pix_mse_routine( void *arg )
+{
+    trp_pix_mse_par_t *p = (trp_pix_mse_par_t *)arg;
+
+    p->tot = trp_pix_mse_range( p->map1, p->map2, p->fr, p->to );
+    return NULL;
+}
+
+static sig64b trp_pix_mse_low( trp_pix_color_t *map1, trp_pix_color_t *map2, uns32b n, uns32b parts )
+{
+    trp_pix_mse_par_t *par;
+    sig64b tot;
+    uns32b i;
+
+    if ( parts > n / TRP_PIX_MSE_PAR_CHUNK )
+        parts = n / TRP_PIX_MSE_PAR_CHUNK;
+    if ( ( n < TRP_PIX_MSE_PAR_MIN ) || ( parts <= 1 ) ||
+         ( ( par = malloc( sizeof( trp_pix_mse_par_t ) * parts ) ) == NULL ) )
+        return trp_pix_mse_range( map1, map2, 0, n );
+    for ( i = 0 ; i < parts ; i++ ) {
+        par[ i ].map1 = map1;
+        par[ i ].map2 = map2;
+        par[ i ].fr = (uns32b)( ( (uns64b)n * i ) / parts );
+        par[ i ].to = (uns32b)( ( (uns64b)n * ( i + 1 ) ) / parts );
+    }
+    trp_parallel_run( trp_pix_mse_routine, par, sizeof( trp_pix_mse_par_t ), parts );
+    for ( i = 0, tot = 0 ; i < parts ; i++ )
+        tot += par[ i ].tot;
+    free( par );
+    return tot;
+}
+
 /*
  questa implementazione di trp_pix_mse è corretta per immagini
  fino a una risoluzione massima di 11909 x 11909
@@ -372,8 +463,7 @@ uns8b trp_pix_gamma_rgb( trp_obj_t *pix, trp_obj_t *val_r, trp_obj_t *val_g, trp
 trp_obj_t *trp_pix_mse( trp_obj_t *pix1, trp_obj_t *pix2 )
 {
     trp_pix_color_t *map1 = trp_pix_get_mapc( pix1 ), *map2 = trp_pix_get_mapc( pix2 );
-    sig64b tot, j;
-    uns32b w, h, n, i;
+    uns32b w, h, n;
 
     if ( ( map1 == NULL ) || ( map2 == NULL ) )
         return UNDEF;
@@ -383,13 +473,24 @@ trp_obj_t *trp_pix_mse( trp_obj_t *pix1, trp_obj_t *pix2 )
          ( h != ((trp_pix_t *)pix2)->h ) )
         return UNDEF;
     n = w * h;
-    for ( i = n, tot = 0 ; i ; ) {
-        i--;
-        j = ( ( (sig32b)( map1[ i ].red ) ) - ( (sig32b)( map2[ i ].red ) ) ) * TRP_PIX_WEIGHT_RED +
-            ( ( (sig32b)( map1[ i ].green ) ) - ( (sig32b)( map2[ i ].green ) ) ) * TRP_PIX_WEIGHT_GREEN +
-            ( ( (sig32b)( map1[ i ].blue ) ) - ( (sig32b)( map2[ i ].blue ) ) ) * TRP_PIX_WEIGHT_BLUE;
-        tot += j * j;
-    }
-    return trp_math_ratio( trp_sig64( tot ), trp_sig64( 65025000000LL * (sig64b)n ), NULL );
+    return trp_math_ratio( trp_sig64( trp_pix_mse_low( map1, map2, n, trp_ncpus() ) ),
+                           trp_sig64( 65025000000LL * (sig64b)n ), NULL );
+}
+
+static void trp_pix_mse_multi_fun( void *ctx, trp_pix_color_t *ref, trp_pix_color_t *map, uns32b w, uns32b h, void *res )
+{
+    *((sig64b *)res) = trp_pix_mse_low( map, ref, w * h, 1 );
+}
+
+static trp_obj_t *trp_pix_mse_multi_obj( void *ctx, void *res, uns32b w, uns32b h )
+{
+    return trp_math_ratio( trp_sig64( *((sig64b *)res) ),
+                           trp_sig64( 65025000000LL * (sig64b)( w * h ) ), NULL );
+}
+
+trp_obj_t *trp_pix_mse_multi( trp_obj_t *ref, trp_obj_t *pixs )
+{
+    return trp_pix_multi( ref, pixs, 1, 1, NULL, 0,
+                          trp_pix_mse_multi_fun, sizeof( sig64b ), trp_pix_mse_multi_obj );
 }
 
@@ -17,6 +17,27 @@
 */
 
 #include "./trppix_internal.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TRP_PIX_SCALE_PAR_MIN 262144
+#define TRP_PIX_SCALE_PAR_ROWS 16
+
+typedef struct {
+    uns8b *idata;
+    uns8b *odata;
+    uns32b *minj;
+    uns32b wi;
+    uns32b hi;
+    uns32b wo;
+    uns32b ho;
+    uns32b fr;
+    uns32b to;
+} trp_pix_scale_par_t;
+
+static void trp_pix_scale_rows( trp_pix_scale_par_t *p );
+static void *trp_pix_scale_routine( void *arg );
 
 uns8b trp_pix_scale_test( trp_obj_t *pix_i, trp_obj_t *pix_o )
 {
@@ -64,31 +85,106 @@ trp_obj_t *trp_pix_scale( trp_obj_t *pix, trp_obj_t *w, trp_obj_t *h )
     return res;
 }
 
+/*
+ le tabelle dei pesi sono calcolate ad ogni chiamata (costano
+ O(wo+ho)), quindi non serve alcun mutex; le righe di output
+ sono divise fra più thread se l'immagine è abbastanza grande
+ */
+
 uns8b trp_pix_scale_low( uns32b wi, uns32b hi, uns8b *idata, uns32b wo, uns32b ho, uns8b **odata )
 {
-    static pthread_mutex_t mut = PTHREAD_MUTEX_INITIALIZER;
-    static uns32b *minj = NULL;
-    static uns32b prev_wi = 0, prev_hi = 0, prev_wo = 0, prev_ho = 0;
-    uns64b tcol[ 4 ];
-    uns8b *q, *r, *pre_r, *pre_pre_r;
-    uns32b *maxj, *mini, *maxi, *pesominj, *pesomaxj, *pesomini, *pesomaxi;
-    uns32b btpp = 4, btppwi, area, aream, peso, pesoy,
-        pesointermedio, pesomassimo, x, y, i, j;
+    trp_pix_scale_par_t *par;
+    uns32b *minj, *maxj, *mini, *maxi, *pesominj, *pesomaxj, *pesomini, *pesomaxi;
+    uns32b parts, x, y, i;
 
     if ( *odata == NULL )
-        if ( ( *odata = malloc( ( wo * ho ) << 2 ) ) == NULL )
+        if ( ( *odata = malloc( ( (size_t)wo * ho ) << 2 ) ) == NULL )
             return 1;
     if ( ( wo == wi ) && ( ho == hi ) ) {
-        memcpy( *odata, idata, ( wo * ho ) << 2 );
+        memcpy( *odata, idata, ( (size_t)wo * ho ) << 2 );
         return 0;
     }
-    pthread_mutex_lock( &mut );
-    if ( ( wo != prev_wo ) || ( ho != prev_ho ) ) {
-        if ( minj )
-            minj = trp_gc_realloc( minj, ( sizeof( uns32b ) * ( wo + ho ) ) << 2 );
+    if ( ( minj = malloc( ( sizeof( uns32b ) * ( wo + ho ) ) << 2 ) ) == NULL )
+        return 1;
+    maxj = minj + ho;
+    mini = maxj + ho;
+    maxi = mini + wo;
+    pesominj = maxi + wo;
+    pesomaxj = pesominj + ho;
+    pesomini = pesomaxj + ho;
+    pesomaxi = pesomini + wo;
+    for ( y = 0 ; y < ho ; y++ ) {
+        minj[ y ] = ( y * hi ) / ho;
+        maxj[ y ] = ( ( y + 1 ) * hi + ho - 1 ) / ho - 1;
+        pesominj[ y ] = ho + ho * minj[ y ] - y * hi;
+        if ( minj[ y ] < maxj[ y ] )
+            pesomaxj[ y ] = ( y + 1 ) * hi - ho * maxj[ y ];
+        else
+            pesomaxj[ y ] = pesominj[ y ] + ( y + 1 ) * hi - ho * maxj[ y ] - ho;
+    }
+    for ( x = 0 ; x < wo ; x++ ) {
+        mini[ x ] = ( x * wi ) / wo;
+        maxi[ x ] = ( ( x + 1 ) * wi + wo - 1 ) / wo - 1;
+        pesomini[ x ] = wo + wo * mini[ x ] - x * wi;
+        if ( mini[ x ] < maxi[ x ] )
+            pesomaxi[ x ] = ( x + 1 ) * wi - wo * maxi[ x ];
         else
-            minj = trp_gc_malloc_atomic( ( sizeof( uns32b ) * ( wo + ho ) ) << 2 );
+            pesomaxi[ x ] = pesomini[ x ] + ( x + 1 ) * wi - wo * maxi[ x ] - wo;
+    }
+    parts = ( (uns64b)wi * (uns64b)hi + (uns64b)wo * (uns64b)ho >= TRP_PIX_SCALE_PAR_MIN ) ? ho / TRP_PIX_SCALE_PAR_ROWS : 1;
+    if ( parts > trp_ncpus() )
+        parts = trp_ncpus();
+    if ( parts == 0 )
+        parts = 1;
+    if ( ( par = malloc( sizeof( trp_pix_scale_par_t ) * parts ) ) == NULL ) {
+        free( minj );
+        return 1;
     }
+    for ( i = 0 ; i < parts ; i++ ) {
+        par[ i ].idata = idata;
+        par[ i ].odata = *odata;
+        par[ i ].minj = minj;
+        par[ i ].wi = wi;
+        par[ i ].hi = hi;
+        par[ i ].wo = wo;
+        par[ i ].ho = ho;
+        par[ i ].fr = (uns32b)( ( (uns64b)ho * i ) / parts );
+        par[ i ].to = (uns32b)( ( (uns64b)ho * ( i + 1 ) ) / parts );
+    }
+    trp_parallel_run( trp_pix_scale_routine, par, sizeof( trp_pix_scale_par_t ), parts );
+    free( par );
+    free( minj );
+    return 0;
+}
+
+static void *trp_pix_scale_routine( void *arg )
+{
+    trp_pix_scale_rows( (trp_pix_scale_par_t *)arg );
+    return NULL;
+}
+
+/*
+ calcola le righe di output [fr,to);
+ pesi e prodotti peso * componente sono a 64 bit
+ (con SSE2 i 4 canali sono accumulati in 2 registri; la parte
+ alta del peso, che c'è solo per immagini molto grandi, richiede
+ una seconda moltiplicazione)
+ */
+
+static void trp_pix_scale_rows( trp_pix_scale_par_t *p )
+{
+#ifdef __SSE2__
+    __m128i acc02, acc13, vpx, vpeso, zero = _mm_setzero_si128();
+    uns64b tmp[ 2 ];
+    int px;
+#endif
+    uns64b tcol[ 4 ];
+    uns8b *q, *r, *pre_r, *pre_pre_r;
+    uns32b *minj, *maxj, *mini, *maxi, *pesominj, *pesomaxj, *pesomini, *pesomaxi;
+    uns64b area, aream, peso, pesointermedio, pesomassimo;
+    uns32b btpp = 4, btppwi, wi = p->wi, wo = p->wo, ho = p->ho, pesoy, x, y, i, j;
+
+    minj = p->minj;
     maxj = minj + ho;
     mini = maxj + ho;
     maxi = mini + wo;
@@ -96,57 +192,50 @@ uns8b trp_pix_scale_low( uns32b wi, uns32b hi, uns8b *idata, uns32b wo, uns32b h
     pesomaxj = pesominj + ho;
     pesomini = pesomaxj + ho;
     pesomaxi = pesomini + wo;
-    area = wi * hi;
+    area = (uns64b)wi * p->hi;
     aream = area >> 1;
-    if ( ( wo != prev_wo ) || ( ho != prev_ho ) ||
-         ( wi != prev_wi ) || ( hi != prev_hi ) ) {
-        for ( y = 0 ; y < ho ; y++ ) {
-            minj[ y ] = ( y * hi ) / ho;
-            maxj[ y ] = ( ( y + 1 ) * hi + ho - 1 ) / ho - 1;
-            pesominj[ y ] = ho + ho * minj[ y ] - y * hi;
-            if ( minj[ y ] < maxj[ y ] )
-                pesomaxj[ y ] = ( y + 1 ) * hi - ho * maxj[ y ];
-            else
-                pesomaxj[ y ] = pesominj[ y ] + ( y + 1 ) * hi - ho * maxj[ y ] - ho;
-        }
-        for ( x = 0 ; x < wo ; x++ ) {
-            mini[ x ] = ( x * wi ) / wo;
-            maxi[ x ] = ( ( x + 1 ) * wi + wo - 1 ) / wo - 1;
-            pesomini[ x ] = wo + wo * mini[ x ] - x * wi;
-            if ( mini[ x ] < maxi[ x ] )
-                pesomaxi[ x ] = ( x + 1 ) * wi - wo * maxi[ x ];
-            else
-                pesomaxi[ x ] = pesomini[ x ] + ( x + 1 ) * wi - wo * maxi[ x ] - wo;
-        }
-        prev_wo = wo;
-        prev_ho = ho;
-        prev_wi = wi;
-        prev_hi = hi;
-    }
-    pesomassimo = wo * ho;
+    pesomassimo = (uns64b)wo * ho;
     btppwi = btpp * wi;
-    q = *odata;
-    for ( y = 0 ; y < ho ; y++ ) {
-        pre_pre_r = idata + btpp * minj[ y ] * wi;
+    q = p->odata + ( ( (size_t)( p->fr ) * wo ) << 2 );
+    for ( y = p->fr ; y < p->to ; y++ ) {
+        pre_pre_r = p->idata + (size_t)btpp * minj[ y ] * wi;
         for ( x = 0 ; x < wo ; x++ ) {
+#ifdef __SSE2__
+            acc02 = acc13 = _mm_set_epi64x( (sig64b)aream, (sig64b)aream );
+#else
             tcol[ 0 ] = tcol[ 1 ] = tcol[ 2 ] = tcol[ 3 ] = aream;
+#endif
             pesoy = pesominj[ y ];
-            pesointermedio = wo * pesoy;
+            pesointermedio = (uns64b)wo * pesoy;
             pre_r = pre_pre_r + btpp * mini[ x ];
             for ( j = minj[ y ] ; ; j++ ) {
                 if ( j == maxj[ y ] ) {
                     pesoy = pesomaxj[ y ];
-                    pesointermedio = wo * pesoy;
+                    pesointermedio = (uns64b)wo * pesoy;
                 }
-                peso = pesomini[ x ] * pesoy;
+                peso = (uns64b)pesomini[ x ] * pesoy;
                 r = pre_r;
                 for ( i = mini[ x ] ; ; i++ ) {
                     if ( i == maxi[ x ] )
-                        peso = pesomaxi[ x ] * pesoy;
-                    tcol[ 0 ] += peso * (uns32b)( *r++ );
-                    tcol[ 1 ] += peso * (uns32b)( *r++ );
-                    tcol[ 2 ] += peso * (uns32b)( *r++ );
-                    tcol[ 3 ] += peso * (uns32b)( *r++ );
+                        peso = (uns64b)pesomaxi[ x ] * pesoy;
+#ifdef __SSE2__
+                    memcpy( &px, r, 4 );
+                    r += 4;
+                    vpx = _mm_unpacklo_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( px ), zero ), zero );
+                    vpeso = _mm_set1_epi32( (int)( peso & 0xffffffff ) );
+                    acc02 = _mm_add_epi64( acc02, _mm_mul_epu32( vpx, vpeso ) );
+                    acc13 = _mm_add_epi64( acc13, _mm_mul_epu32( _mm_srli_epi64( vpx, 32 ), vpeso ) );
+                    if ( peso >> 32 ) {
+                        vpeso = _mm_set1_epi32( (int)( peso >> 32 ) );
+                        acc02 = _mm_add_epi64( acc02, _mm_slli_epi64( _mm_mul_epu32( vpx, vpeso ), 32 ) );
+                        acc13 = _mm_add_epi64( acc13, _mm_slli_epi64( _mm_mul_epu32( _mm_srli_epi64( vpx, 32 ), vpeso ), 32 ) );
+                    }
+#else
+                    tcol[ 0 ] += peso * (uns64b)( *r++ );
+                    tcol[ 1 ] += peso * (uns64b)( *r++ );
+                    tcol[ 2 ] += peso * (uns64b)( *r++ );
+                    tcol[ 3 ] += peso * (uns64b)( *r++ );
+#endif
                     if ( i == maxi[ x ] )
                         break;
                     peso = pesointermedio;
@@ -157,13 +246,19 @@ uns8b trp_pix_scale_low( uns32b wi, uns32b hi, uns8b *idata, uns32b wo, uns32b h
                 pesointermedio = pesomassimo;
                 pre_r += btppwi;
             }
+#ifdef __SSE2__
+            _mm_storeu_si128( (__m128i *)tmp, acc02 );
+            tcol[ 0 ] = tmp[ 0 ];
+            tcol[ 2 ] = tmp[ 1 ];
+            _mm_storeu_si128( (__m128i *)tmp, acc13 );
+            tcol[ 1 ] = tmp[ 0 ];
+            tcol[ 3 ] = tmp[ 1 ];
+#endif
             *q++ = tcol[ 0 ] / area;
             *q++ = tcol[ 1 ] / area;
             *q++ = tcol[ 2 ] / area;
             *q++ = tcol[ 3 ] / area;
         }
     }
-    pthread_mutex_unlock( &mut );
-    return 0;
 }
 
@@ -17,19 +17,57 @@
 */
 
 #include "./trppix_internal.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define trp_pix_cast(x) ((uns32b)((x)+0.5))
 #define trp_pix_dist(x,y) (((x)>=(y))?((x)-(y)):((y)-(x)))
 
+#define TRP_PIX_SCD_PAR_MIN 65536
+
+typedef struct {
+    trp_pix_color_t *c;
+    trp_pix_color_t *ref;
+    uns32b w, h;
+    int b, r;
+    uns32b fr, to;
+    uns64b n;
+} trp_pix_scd_par_t;
+
 static uns32b trp_pix_sadb( trp_pix_color_t *c, trp_pix_color_t *ref, uns32b w, int b );
 static uns32b trp_pix_sadb_min( trp_pix_color_t *c, trp_pix_color_t *ref, int x, int y, uns32b w, uns32b h, int b, int r );
+static void *trp_pix_scd_routine( void *arg );
 static trp_obj_t *trp_pix_scd_basic( trp_pix_color_t *c, trp_pix_color_t *ref, uns32b w, uns32b h, int b, int r );
 
+/*
+ con SSE2 le righe del blocco si elaborano 4 pixel alla volta
+ con psadbw, azzerando prima l'alfa
+ */
+
 static uns32b trp_pix_sadb( trp_pix_color_t *c, trp_pix_color_t *ref, uns32b w, int b )
 {
     uns32b res = 0;
     int i, j;
+#ifdef __SSE2__
+    trp_pix_color_t m;
+    __m128i mask, acc = _mm_setzero_si128();
+    int b4 = b & ~3;
 
+    m.red = m.green = m.blue = 0xff;
+    m.alpha = 0;
+    mask = _mm_set1_epi32( (int)( m.rgba ) );
+    for ( j = b ; j ; j--, c += w, ref += w ) {
+        for ( i = 0 ; i < b4 ; i += 4 )
+            acc = _mm_add_epi64( acc, _mm_sad_epu8( _mm_and_si128( _mm_loadu_si128( (__m128i *)( c + i ) ), mask ),
+                                                    _mm_and_si128( _mm_loadu_si128( (__m128i *)( ref + i ) ), mask ) ) );
+        for ( ; i < b ; i++ )
+            res += trp_pix_dist( c[ i ].red, ref[ i ].red ) +
+                trp_pix_dist( c[ i ].green, ref[ i ].green ) +
+                trp_pix_dist( c[ i ].blue, ref[ i ].blue );
+    }
+    res += (uns32b)_mm_cvtsi128_si32( acc ) + (uns32b)_mm_cvtsi128_si32( _mm_srli_si128( acc, 8 ) );
+#else
     for ( j = b ; j ; j--, c += w, ref += w )
         for ( i = b ; i ; ) {
             i--;
@@ -37,6 +75,7 @@ static uns32b trp_pix_sadb( trp_pix_color_t *c, trp_pix_color_t *ref, uns32b w,
                 trp_pix_dist( c[ i ].green, ref[ i ].green ) +
                 trp_pix_dist( c[ i ].blue, ref[ i ].blue );
         }
+#endif
     return res;
 }
 
@@ -77,37 +116,67 @@ static uns32b trp_pix_sadb_min( trp_pix_color_t *c, trp_pix_color_t *ref, int x,
     return smin;
 }
 
+/*
+ elabora le righe di blocchi [fr,to); l'ultima riga e l'ultima
+ colonna di blocchi sono allineate al bordo dell'immagine
+ */
+
+static void *trp_pix_scd_routine( void *arg )
+{
+    trp_pix_scd_par_t *p = (trp_pix_scd_par_t *)arg;
+    uns32b cols = ( p->w + p->b - 1 ) / p->b, k, l;
+    int x, y;
+
+    p->n = 0;
+    for ( k = p->fr ; k < p->to ; k++ ) {
+        y = k * p->b;
+        if ( y + p->b > p->h )
+            y = p->h - p->b;
+        for ( l = 0 ; l < cols ; l++ ) {
+            x = l * p->b;
+            if ( x + p->b > p->w )
+                x = p->w - p->b;
+            p->n += trp_pix_sadb_min( p->c + x + p->w * y, p->ref, x, y, p->w, p->h, p->b, p->r );
+        }
+    }
+    return NULL;
+}
+
 static trp_obj_t *trp_pix_scd_basic( trp_pix_color_t *c, trp_pix_color_t *ref, uns32b w, uns32b h, int b, int r )
 {
-    trp_pix_color_t *cc;
-    uns32b ww = w * b, n = 0, d = 0;
-    int x, y, nx, ny;
+    trp_pix_scd_par_t *par, p;
+    uns64b n;
+    uns32b rows, parts, i;
 
     if ( ( w < b ) || ( h < b ) )
         return UNDEF;
-    for ( y = 0 ; ; y = ny, c += ww ) {
-        ny = y + b;
-        if ( ny > h ) {
-            c -= w * ( ny - h );
-            y = h - b;
-            ny = h;
-        }
-        for ( x = 0, cc = c ; ; x = nx, cc += b ) {
-            nx = x + b;
-            if ( nx > w ) {
-                cc -= ( nx - w );
-                x = w - b;
-                nx = w;
-            }
-            n += trp_pix_sadb_min( cc, ref, x, y, w, h, b, r );
-            d++;
-            if ( nx == w )
-                break;
+    rows = ( h + b - 1 ) / b;
+    p.c = c;
+    p.ref = ref;
+    p.w = w;
+    p.h = h;
+    p.b = b;
+    p.r = r;
+    p.fr = 0;
+    p.to = rows;
+    parts = ( w * h >= TRP_PIX_SCD_PAR_MIN ) ? trp_ncpus() : 1;
+    if ( parts > rows )
+        parts = rows;
+    if ( ( parts <= 1 ) || ( ( par = malloc( sizeof( trp_pix_scd_par_t ) * parts ) ) == NULL ) ) {
+        (void)trp_pix_scd_routine( (void *)( &p ) );
+        n = p.n;
+    } else {
+        for ( i = 0 ; i < parts ; i++ ) {
+            memcpy( par + i, &p, sizeof( trp_pix_scd_par_t ) );
+            par[ i ].fr = (uns32b)( ( (uns64b)rows * i ) / parts );
+            par[ i ].to = (uns32b)( ( (uns64b)rows * ( i + 1 ) ) / parts );
         }
-        if ( ny == h )
-            break;
+        trp_parallel_run( trp_pix_scd_routine, par, sizeof( trp_pix_scd_par_t ), parts );
+        for ( i = 0, n = 0 ; i < parts ; i++ )
+            n += par[ i ].n;
+        free( par );
     }
-    return trp_math_ratio( trp_sig64( n ), trp_sig64( d * b * b * 765 ), NULL );
+    return trp_math_ratio( trp_sig64( n ), trp_sig64( (sig64b)rows * (sig64b)( ( w + b - 1 ) / b ) * b * b * 765 ), NULL );
 }
 
 trp_obj_t *trp_pix_scd( trp_obj_t *pix, trp_obj_t *ref, trp_obj_t *dimblock, trp_obj_t *radius )
@@ -18,16 +18,26 @@
 
 #include "./trppix_internal.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TRP_PIX_SSIM_PAR_MIN 65536
+#define TRP_PIX_SSIM_PAR_ROWS 8
+
 typedef struct {
-    uns32b w, h, win_w, win_h, x, y, win_cnt;
+    uns32b w, h, win_w, win_h, x, y, yend, win_cnt;
     trp_pix_color_t *map1, *map2;
     double *weights;
     double c1, c2;
     double ssim_r, ssim_g, ssim_b;
     voidfun_t calculate;
-    uns32b pmur1[ 8 ], pmur2[ 8 ], pmug1[ 8 ], pmug2[ 8 ], pmub1[ 8 ], pmub2[ 8 ];
-    uns32b pzir1[ 8 ], pzir2[ 8 ], pzig1[ 8 ], pzig2[ 8 ], pzib1[ 8 ], pzib2[ 8 ];
-    uns32b pzir12[ 8 ], pzig12[ 8 ], pzib12[ 8 ];
+    /*
+     per ciascuna delle 8 colonne della finestra lineare:
+     somme di x1, x2, x1*x1, x2*x2, x1*x2 (rgba, 4 valori ciascuna)
+     */
+    uns32b pcol[ 8 ][ 20 ];
+    uns32b ptot[ 20 ];
 } trp_pix_ssim_t;
 
 static double _ssim_linear_8x8[] = {
@@ -57,10 +67,18 @@ static double _ssim_gaussian_11x11[] = {
 
 static void trp_pix_ssim_normalize_weights( trp_pix_ssim_t *s );
 static int trp_pix_ssim_next( trp_pix_ssim_t *s );
+static void trp_pix_ssim_add( trp_pix_ssim_t *s, double *mu1, double *mu2, double *z1, double *z2, double *z12 );
 static void trp_pix_ssim_calculate( trp_pix_ssim_t *s );
+static void trp_pix_ssim_column_8( trp_pix_ssim_t *s, trp_pix_color_t *p1, trp_pix_color_t *p2, uns32b *col );
 static void trp_pix_ssim_calculate_linear_8x8( trp_pix_ssim_t *s );
 static void trp_pix_ssim_calculate_gaussian_11x11( trp_pix_ssim_t *s );
+static void *trp_pix_ssim_routine( void *arg );
+static void trp_pix_ssim_run( trp_pix_ssim_t *s, trp_pix_color_t *map1, trp_pix_color_t *map2, uns32b parts );
+static double trp_pix_ssim_low( trp_pix_ssim_t *s, trp_pix_color_t *map1, trp_pix_color_t *map2, uns32b w, uns32b h, uns32b parts );
 static trp_obj_t *trp_pix_ssim_index_basic( trp_obj_t *pix1, trp_obj_t *pix2, trp_pix_ssim_t *s );
+static void trp_pix_ssim_multi_fun( void *ctx, trp_pix_color_t *ref, trp_pix_color_t *map, uns32b w, uns32b h, void *res );
+static trp_obj_t *trp_pix_ssim_multi_obj( void *ctx, void *res, uns32b w, uns32b h );
+static trp_obj_t *trp_pix_ssim_multi_basic( trp_obj_t *ref, trp_obj_t *pixs, trp_pix_ssim_t *s );
 
 static void trp_pix_ssim_normalize_weights( trp_pix_ssim_t *s )
 {
@@ -86,7 +104,7 @@ static int trp_pix_ssim_next( trp_pix_ssim_t *s )
         (s->map2)++;
         return 1;
     }
-    if ( s->y + s->win_h < s->h ) {
+    if ( s->y + 1 < s->yend ) {
         s->y++;
         s->x = 0;
         s->win_cnt++;
@@ -97,6 +115,29 @@ static int trp_pix_ssim_next( trp_pix_ssim_t *s )
     return 0;
 }
 
+/*
+ aggiunge l'indice della finestra corrente a partire dalle medie
+ pesate di x1, x2, x1*x1, x2*x2, x1*x2 (per i canali r, g, b)
+ */
+
+static void trp_pix_ssim_add( trp_pix_ssim_t *s, double *mu1, double *mu2, double *z1, double *z2, double *z12 )
+{
+    double t1, t2, t12, v[ 3 ];
+    int i;
+
+    for ( i = 0 ; i < 3 ; i++ ) {
+        t1 = mu1[ i ] * mu1[ i ];
+        t2 = mu2[ i ] * mu2[ i ];
+        t12 = mu1[ i ] * mu2[ i ];
+        v[ i ] =
+            ( ( 2.0 * t12 + s->c1 ) * ( 2.0 * ( z12[ i ] - t12 ) + s->c2 ) ) /
+            ( ( t1 + t2 + s->c1 ) * ( ( z1[ i ] - t1 ) + ( z2[ i ] - t2 ) + s->c2 ) );
+    }
+    s->ssim_r += v[ 0 ];
+    s->ssim_g += v[ 1 ];
+    s->ssim_b += v[ 2 ];
+}
+
 /*
  calcola l'indice della finestra corrente
  */
@@ -105,10 +146,20 @@ static void trp_pix_ssim_calculate( trp_pix_ssim_t *s )
 {
     uns32b i, j;
     trp_pix_color_t *map1, *map2, *p1, *p2;
-    double *weights, t1, t2, t12, w;
-    double dmur1 = 0.0, dmur2 = 0.0, dmug1 = 0.0, dmug2 = 0.0, dmub1 = 0.0, dmub2 = 0.0;
-    double dzir1 = 0.0, dzir2 = 0.0, dzig1 = 0.0, dzig2 = 0.0, dzib1 = 0.0, dzib2 = 0.0;
-    double dzir12 = 0.0, dzig12 = 0.0, dzib12 = 0.0;
+    double *weights;
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128(), v;
+    __m128d w, x1lo, x1hi, x2lo, x2hi, t;
+    __m128d mu1lo = _mm_setzero_pd(), mu1hi = _mm_setzero_pd(), mu2lo = _mm_setzero_pd(), mu2hi = _mm_setzero_pd();
+    __m128d z1lo = _mm_setzero_pd(), z1hi = _mm_setzero_pd(), z2lo = _mm_setzero_pd(), z2hi = _mm_setzero_pd();
+    __m128d z12lo = _mm_setzero_pd(), z12hi = _mm_setzero_pd();
+#else
+    double w, t1, t2, wt1;
+    int c;
+#endif
+    double mu1[ 4 ] = { 0.0, 0.0, 0.0, 0.0 }, mu2[ 4 ] = { 0.0, 0.0, 0.0, 0.0 };
+    double z1[ 4 ] = { 0.0, 0.0, 0.0, 0.0 }, z2[ 4 ] = { 0.0, 0.0, 0.0, 0.0 };
+    double z12[ 4 ] = { 0.0, 0.0, 0.0, 0.0 };
 
     weights = s->weights;
     map1 = s->map1;
@@ -116,244 +167,144 @@ static void trp_pix_ssim_calculate( trp_pix_ssim_t *s )
 
     for ( i = 0 ; i < s->win_h ; i++, map1 += s->w, map2 += s->w )
         for ( j = 0, p1 = map1, p2 = map2 ; j < s->win_w ; j++, p1++, p2++ ) {
+#ifdef __SSE2__
+            w = _mm_set1_pd( *weights++ );
+            v = _mm_unpacklo_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( (int)( p1->rgba ) ), zero ), zero );
+            x1lo = _mm_cvtepi32_pd( v );
+            x1hi = _mm_cvtepi32_pd( _mm_srli_si128( v, 8 ) );
+            v = _mm_unpacklo_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( (int)( p2->rgba ) ), zero ), zero );
+            x2lo = _mm_cvtepi32_pd( v );
+            x2hi = _mm_cvtepi32_pd( _mm_srli_si128( v, 8 ) );
+            t = _mm_mul_pd( w, x1lo );
+            mu1lo = _mm_add_pd( mu1lo, t );
+            z1lo = _mm_add_pd( z1lo, _mm_mul_pd( t, x1lo ) );
+            z12lo = _mm_add_pd( z12lo, _mm_mul_pd( t, x2lo ) );
+            t = _mm_mul_pd( w, x1hi );
+            mu1hi = _mm_add_pd( mu1hi, t );
+            z1hi = _mm_add_pd( z1hi, _mm_mul_pd( t, x1hi ) );
+            z12hi = _mm_add_pd( z12hi, _mm_mul_pd( t, x2hi ) );
+            t = _mm_mul_pd( w, x2lo );
+            mu2lo = _mm_add_pd( mu2lo, t );
+            z2lo = _mm_add_pd( z2lo, _mm_mul_pd( t, x2lo ) );
+            t = _mm_mul_pd( w, x2hi );
+            mu2hi = _mm_add_pd( mu2hi, t );
+            z2hi = _mm_add_pd( z2hi, _mm_mul_pd( t, x2hi ) );
+#else
             w = *weights++;
-            t1 = (double)( p1->red );
-            t2 = (double)( p2->red );
-            dmur1 += w * t1;
-            dmur2 += w * t2;
-            dzir1 += w * t1 * t1;
-            dzir2 += w * t2 * t2;
-            dzir12 += w * t1 * t2;
-            t1 = (double)( p1->green );
-            t2 = (double)( p2->green );
-            dmug1 += w * t1;
-            dmug2 += w * t2;
-            dzig1 += w * t1 * t1;
-            dzig2 += w * t2 * t2;
-            dzig12 += w * t1 * t2;
-            t1 = (double)( p1->blue );
-            t2 = (double)( p2->blue );
-            dmub1 += w * t1;
-            dmub2 += w * t2;
-            dzib1 += w * t1 * t1;
-            dzib2 += w * t2 * t2;
-            dzib12 += w * t1 * t2;
+            for ( c = 0 ; c < 3 ; c++ ) {
+                t1 = (double)( ((uns8b *)p1)[ c ] );
+                t2 = (double)( ((uns8b *)p2)[ c ] );
+                wt1 = w * t1;
+                mu1[ c ] += wt1;
+                mu2[ c ] += w * t2;
+                z1[ c ] += wt1 * t1;
+                z2[ c ] += w * t2 * t2;
+                z12[ c ] += wt1 * t2;
+            }
+#endif
         }
+#ifdef __SSE2__
+    _mm_storeu_pd( mu1, mu1lo );
+    _mm_storeu_pd( mu1 + 2, mu1hi );
+    _mm_storeu_pd( mu2, mu2lo );
+    _mm_storeu_pd( mu2 + 2, mu2hi );
+    _mm_storeu_pd( z1, z1lo );
+    _mm_storeu_pd( z1 + 2, z1hi );
+    _mm_storeu_pd( z2, z2lo );
+    _mm_storeu_pd( z2 + 2, z2hi );
+    _mm_storeu_pd( z12, z12lo );
+    _mm_storeu_pd( z12 + 2, z12hi );
+#endif
+    trp_pix_ssim_add( s, mu1, mu2, z1, z2, z12 );
+}
+
+/*
+ calcola in col le somme della colonna di 8 pixel che parte da p1, p2
+ */
 
-    t1 = dmur1 * dmur1;
-    t2 = dmur2 * dmur2;
-    t12 = dmur1 * dmur2;
-    dzir1 -= t1;
-    dzir2 -= t2;
-    dzir12 -= t12;
-
-    s->ssim_r +=
-        ( ( 2.0 * t12 + s->c1 ) * ( 2.0 * dzir12 + s->c2 ) ) /
-        ( ( t1 + t2 + s->c1 ) * ( dzir1 + dzir2 + s->c2 ) );
-
-    t1 = dmug1 * dmug1;
-    t2 = dmug2 * dmug2;
-    t12 = dmug1 * dmug2;
-    dzig1 -= t1;
-    dzig2 -= t2;
-    dzig12 -= t12;
-
-    s->ssim_g +=
-        ( ( 2.0 * t12 + s->c1 ) * ( 2.0 * dzig12 + s->c2 ) ) /
-        ( ( t1 + t2 + s->c1 ) * ( dzig1 + dzig2 + s->c2 ) );
-
-    t1 = dmub1 * dmub1;
-    t2 = dmub2 * dmub2;
-    t12 = dmub1 * dmub2;
-    dzib1 -= t1;
-    dzib2 -= t2;
-    dzib12 -= t12;
-
-    s->ssim_b +=
-        ( ( 2.0 * t12 + s->c1 ) * ( 2.0 * dzib12 + s->c2 ) ) /
-        ( ( t1 + t2 + s->c1 ) * ( dzib1 + dzib2 + s->c2 ) );
+static void trp_pix_ssim_column_8( trp_pix_ssim_t *s, trp_pix_color_t *p1, trp_pix_color_t *p2, uns32b *col )
+{
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128(), a, sq;
+    __m128i mu = zero, z1 = zero, z2 = zero, z12 = zero;
+    int j;
+
+    for ( j = 8 ; j ; j--, p1 += s->w, p2 += s->w ) {
+        /*
+         a = [ x1 (rgba), x2 (rgba) ] a 16 bit;
+         i quadrati (<= 65025) stanno ancora in 16 bit senza segno
+         */
+        a = _mm_unpacklo_epi8( _mm_unpacklo_epi32( _mm_cvtsi32_si128( (int)( p1->rgba ) ),
+                                                   _mm_cvtsi32_si128( (int)( p2->rgba ) ) ), zero );
+        mu = _mm_add_epi16( mu, a );
+        sq = _mm_mullo_epi16( a, a );
+        z1 = _mm_add_epi32( z1, _mm_unpacklo_epi16( sq, zero ) );
+        z2 = _mm_add_epi32( z2, _mm_unpackhi_epi16( sq, zero ) );
+        sq = _mm_mullo_epi16( a, _mm_shuffle_epi32( a, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+        z12 = _mm_add_epi32( z12, _mm_unpacklo_epi16( sq, zero ) );
+    }
+    _mm_storeu_si128( (__m128i *)col, _mm_unpacklo_epi16( mu, zero ) );
+    _mm_storeu_si128( (__m128i *)( col + 4 ), _mm_unpackhi_epi16( mu, zero ) );
+    _mm_storeu_si128( (__m128i *)( col + 8 ), z1 );
+    _mm_storeu_si128( (__m128i *)( col + 12 ), z2 );
+    _mm_storeu_si128( (__m128i *)( col + 16 ), z12 );
+#else
+    uns32b x1, x2;
+    int j, c;
+
+    memset( col, 0, sizeof( uns32b ) * 20 );
+    for ( j = 8 ; j ; j--, p1 += s->w, p2 += s->w )
+        for ( c = 0 ; c < 4 ; c++ ) {
+            x1 = ((uns8b *)p1)[ c ];
+            x2 = ((uns8b *)p2)[ c ];
+            col[ c ] += x1;
+            col[ 4 + c ] += x2;
+            col[ 8 + c ] += x1 * x1;
+            col[ 12 + c ] += x2 * x2;
+            col[ 16 + c ] += x1 * x2;
+        }
+#endif
 }
 
 /*
- versione ottimizzata per matrice lineare 8x8
+ versione ottimizzata per matrice lineare 8x8:
+ in ptot si tengono le somme sulle 8 colonne della finestra
  */
 
 static void trp_pix_ssim_calculate_linear_8x8( trp_pix_ssim_t *s )
 {
-    uns32b i, j, x1, x2;
-    uns32b mur1 = 0, mur2 = 0, mug1 = 0, mug2 = 0, mub1 = 0, mub2 = 0;
-    uns32b zir1 = 0, zir2 = 0, zig1 = 0, zig2 = 0, zib1 = 0, zib2 = 0;
-    uns32b zir12 = 0, zig12 = 0, zib12 = 0;
-    trp_pix_color_t *row1, *row2, *p1, *p2;
-    double t1, t2, t12;
-    double dmu1, dmu2, dsi1, dsi2, dsi12;
+    uns32b *col;
+    double mu1[ 3 ], mu2[ 3 ], z1[ 3 ], z2[ 3 ], z12[ 3 ];
+    int i, j;
 
     if ( s->x == 0 ) {
-        for ( i = 0, row1 = s->map1, row2 = s->map2 ;
-              i < 8 ;
-              i++, row1++, row2++ ) {
-            s->pmur1[ i ] = 0;
-            s->pmur2[ i ] = 0;
-            s->pmug1[ i ] = 0;
-            s->pmug2[ i ] = 0;
-            s->pmub1[ i ] = 0;
-            s->pmub2[ i ] = 0;
-            s->pzir1[ i ] = 0;
-            s->pzir2[ i ] = 0;
-            s->pzig1[ i ] = 0;
-            s->pzig2[ i ] = 0;
-            s->pzib1[ i ] = 0;
-            s->pzib2[ i ] = 0;
-            s->pzir12[ i ] = 0;
-            s->pzig12[ i ] = 0;
-            s->pzib12[ i ] = 0;
-            for ( j = 0, p1 = row1, p2 = row2 ;
-                  j < 8 ;
-                  j++, p1 += s->w, p2 += s->w ) {
-                x1 = p1->red;
-                x2 = p2->red;
-                s->pmur1[ i ] += x1;
-                s->pmur2[ i ] += x2;
-                s->pzir1[ i ] += x1 * x1;
-                s->pzir2[ i ] += x2 * x2;
-                s->pzir12[ i ] += x1 * x2;
-                x1 = p1->green;
-                x2 = p2->green;
-                s->pmug1[ i ] += x1;
-                s->pmug2[ i ] += x2;
-                s->pzig1[ i ] += x1 * x1;
-                s->pzig2[ i ] += x2 * x2;
-                s->pzig12[ i ] += x1 * x2;
-                x1 = p1->blue;
-                x2 = p2->blue;
-                s->pmub1[ i ] += x1;
-                s->pmub2[ i ] += x2;
-                s->pzib1[ i ] += x1 * x1;
-                s->pzib2[ i ] += x2 * x2;
-                s->pzib12[ i ] += x1 * x2;
-            }
-            mur1 += s->pmur1[ i ];
-            mur2 += s->pmur2[ i ];
-            mug1 += s->pmug1[ i ];
-            mug2 += s->pmug2[ i ];
-            mub1 += s->pmub1[ i ];
-            mub2 += s->pmub2[ i ];
-            zir1 += s->pzir1[ i ];
-            zir2 += s->pzir2[ i ];
-            zig1 += s->pzig1[ i ];
-            zig2 += s->pzig2[ i ];
-            zib1 += s->pzib1[ i ];
-            zib2 += s->pzib2[ i ];
-            zir12 += s->pzir12[ i ];
-            zig12 += s->pzig12[ i ];
-            zib12 += s->pzib12[ i ];
+        memset( s->ptot, 0, sizeof( s->ptot ) );
+        for ( i = 0 ; i < 8 ; i++ ) {
+            col = s->pcol[ i ];
+            trp_pix_ssim_column_8( s, s->map1 + i, s->map2 + i, col );
+            for ( j = 0 ; j < 20 ; j++ )
+                s->ptot[ j ] += col[ j ];
         }
     } else {
         /*
          s->x > 0 : si ottimizza!
          mi resta solo da calcolare i dati della colonna ( s->x - 1 ) % 8
          */
-        i = ( s->x - 1 ) % 8;
-        s->pmur1[ i ] = 0;
-        s->pmur2[ i ] = 0;
-        s->pmug1[ i ] = 0;
-        s->pmug2[ i ] = 0;
-        s->pmub1[ i ] = 0;
-        s->pmub2[ i ] = 0;
-        s->pzir1[ i ] = 0;
-        s->pzir2[ i ] = 0;
-        s->pzig1[ i ] = 0;
-        s->pzig2[ i ] = 0;
-        s->pzib1[ i ] = 0;
-        s->pzib2[ i ] = 0;
-        s->pzir12[ i ] = 0;
-        s->pzig12[ i ] = 0;
-        s->pzib12[ i ] = 0;
-        for ( j = 0, p1 = s->map1 + 7, p2 = s->map2 + 7 ;
-              j < 8 ;
-              j++, p1 += s->w, p2 += s->w ) {
-            x1 = p1->red;
-            x2 = p2->red;
-            s->pmur1[ i ] += x1;
-            s->pmur2[ i ] += x2;
-            s->pzir1[ i ] += x1 * x1;
-            s->pzir2[ i ] += x2 * x2;
-            s->pzir12[ i ] += x1 * x2;
-            x1 = p1->green;
-            x2 = p2->green;
-            s->pmug1[ i ] += x1;
-            s->pmug2[ i ] += x2;
-            s->pzig1[ i ] += x1 * x1;
-            s->pzig2[ i ] += x2 * x2;
-            s->pzig12[ i ] += x1 * x2;
-            x1 = p1->blue;
-            x2 = p2->blue;
-            s->pmub1[ i ] += x1;
-            s->pmub2[ i ] += x2;
-            s->pzib1[ i ] += x1 * x1;
-            s->pzib2[ i ] += x2 * x2;
-            s->pzib12[ i ] += x1 * x2;
-        }
-        for ( i = 0 ; i < 8 ; i++ ) {
-            mur1 += s->pmur1[ i ];
-            mur2 += s->pmur2[ i ];
-            mug1 += s->pmug1[ i ];
-            mug2 += s->pmug2[ i ];
-            mub1 += s->pmub1[ i ];
-            mub2 += s->pmub2[ i ];
-            zir1 += s->pzir1[ i ];
-            zir2 += s->pzir2[ i ];
-            zig1 += s->pzig1[ i ];
-            zig2 += s->pzig2[ i ];
-            zib1 += s->pzib1[ i ];
-            zib2 += s->pzib2[ i ];
-            zir12 += s->pzir12[ i ];
-            zig12 += s->pzig12[ i ];
-            zib12 += s->pzib12[ i ];
-        }
+        col = s->pcol[ ( s->x - 1 ) % 8 ];
+        for ( i = 0 ; i < 20 ; i++ )
+            s->ptot[ i ] -= col[ i ];
+        trp_pix_ssim_column_8( s, s->map1 + 7, s->map2 + 7, col );
+        for ( i = 0 ; i < 20 ; i++ )
+            s->ptot[ i ] += col[ i ];
     }
-
-    dmu1 = (double)mur1 / 64.0;
-    dmu2 = (double)mur2 / 64.0;
-
-    t1 = dmu1 * dmu1;
-    t2 = dmu2 * dmu2;
-    t12 = dmu1 * dmu2;
-    dsi1 = (double)zir1 / 64.0 - t1;
-    dsi2 = (double)zir2 / 64.0 - t2;
-    dsi12 = (double)zir12 / 64.0 - t12;
-
-    s->ssim_r +=
-        ( ( 2.0 * t12 + s->c1 ) * ( 2.0 * dsi12 + s->c2 ) ) /
-        ( ( t1 + t2 + s->c1 ) * ( dsi1 + dsi2 + s->c2 ) );
-
-    dmu1 = (double)mug1 / 64.0;
-    dmu2 = (double)mug2 / 64.0;
-
-    t1 = dmu1 * dmu1;
-    t2 = dmu2 * dmu2;
-    t12 = dmu1 * dmu2;
-    dsi1 = (double)zig1 / 64.0 - t1;
-    dsi2 = (double)zig2 / 64.0 - t2;
-    dsi12 = (double)zig12 / 64.0 - t12;
-
-    s->ssim_g +=
-        ( ( 2.0 * t12 + s->c1 ) * ( 2.0 * dsi12 + s->c2 ) ) /
-        ( ( t1 + t2 + s->c1 ) * ( dsi1 + dsi2 + s->c2 ) );
-
-    dmu1 = (double)mub1 / 64.0;
-    dmu2 = (double)mub2 / 64.0;
-
-    t1 = dmu1 * dmu1;
-    t2 = dmu2 * dmu2;
-    t12 = dmu1 * dmu2;
-    dsi1 = (double)zib1 / 64.0 - t1;
-    dsi2 = (double)zib2 / 64.0 - t2;
-    dsi12 = (double)zib12 / 64.0 - t12;
-
-    s->ssim_b +=
-        ( ( 2.0 * t12 + s->c1 ) * ( 2.0 * dsi12 + s->c2 ) ) /
-        ( ( t1 + t2 + s->c1 ) * ( dsi1 + dsi2 + s->c2 ) );
+    for ( i = 0 ; i < 3 ; i++ ) {
+        mu1[ i ] = (double)( s->ptot[ i ] ) / 64.0;
+        mu2[ i ] = (double)( s->ptot[ 4 + i ] ) / 64.0;
+        z1[ i ] = (double)( s->ptot[ 8 + i ] ) / 64.0;
+        z2[ i ] = (double)( s->ptot[ 12 + i ] ) / 64.0;
+        z12[ i ] = (double)( s->ptot[ 16 + i ] ) / 64.0;
+    }
+    trp_pix_ssim_add( s, mu1, mu2, z1, z2, z12 );
 }
 
 /*
@@ -369,25 +320,60 @@ static void trp_pix_ssim_calculate_gaussian_11x11( trp_pix_ssim_t *s )
     trp_pix_ssim_calculate( s );
 }
 
-static trp_obj_t *trp_pix_ssim_index_basic( trp_obj_t *pix1, trp_obj_t *pix2, trp_pix_ssim_t *s )
+static void *trp_pix_ssim_routine( void *arg )
 {
-    if ( ( pix1->tipo != TRP_PIX ) || ( pix2->tipo != TRP_PIX ) )
-        return UNDEF;
-    if ( ( ( s->map1 = ((trp_pix_t *)pix1)->map.c ) == NULL ) ||
-         ( ( s->map2 = ((trp_pix_t *)pix2)->map.c ) == NULL ) )
-        return UNDEF;
+    trp_pix_ssim_t *s = (trp_pix_ssim_t *)arg;
 
-    s->w = ((trp_pix_t *)pix1)->w;
-    s->h = ((trp_pix_t *)pix1)->h;
+    do ( s->calculate )( s );
+    while ( trp_pix_ssim_next( s ) );
+    return NULL;
+}
 
-    if ( ( s->w != ((trp_pix_t *)pix2)->w ) ||
-         ( s->h != ((trp_pix_t *)pix2)->h ) ||
-         ( s->w < s->win_w ) || ( s->h < s->win_h ) )
-        return UNDEF;
+/*
+ le righe di finestre sono divise in parts fasce consecutive;
+ ogni fascia ha il proprio stato (le colonne dell'8x8 non si condividono)
+ */
+
+static void trp_pix_ssim_run( trp_pix_ssim_t *s, trp_pix_color_t *map1, trp_pix_color_t *map2, uns32b parts )
+{
+    trp_pix_ssim_t *par;
+    uns32b rows = s->h - s->win_h + 1, i;
+
+    if ( parts > rows / TRP_PIX_SSIM_PAR_ROWS )
+        parts = rows / TRP_PIX_SSIM_PAR_ROWS;
+    if ( ( parts <= 1 ) || ( ( par = malloc( sizeof( trp_pix_ssim_t ) * parts ) ) == NULL ) ) {
+        s->map1 = map1;
+        s->map2 = map2;
+        s->y = 0;
+        s->yend = rows;
+        s->win_cnt = 1;
+        (void)trp_pix_ssim_routine( (void *)s );
+        return;
+    }
+    for ( i = 0 ; i < parts ; i++ ) {
+        memcpy( par + i, s, sizeof( trp_pix_ssim_t ) );
+        par[ i ].y = (uns32b)( ( (uns64b)rows * i ) / parts );
+        par[ i ].yend = (uns32b)( ( (uns64b)rows * ( i + 1 ) ) / parts );
+        par[ i ].map1 = map1 + par[ i ].y * s->w;
+        par[ i ].map2 = map2 + par[ i ].y * s->w;
+        par[ i ].win_cnt = 1;
+    }
+    trp_parallel_run( trp_pix_ssim_routine, par, sizeof( trp_pix_ssim_t ), parts );
+    for ( i = 0 ; i < parts ; i++ ) {
+        s->ssim_r += par[ i ].ssim_r;
+        s->ssim_g += par[ i ].ssim_g;
+        s->ssim_b += par[ i ].ssim_b;
+        s->win_cnt += par[ i ].win_cnt;
+    }
+    free( par );
+}
 
+static double trp_pix_ssim_low( trp_pix_ssim_t *s, trp_pix_color_t *map1, trp_pix_color_t *map2, uns32b w, uns32b h, uns32b parts )
+{
+    s->w = w;
+    s->h = h;
     s->x = 0;
-    s->y = 0;
-    s->win_cnt = 1;
+    s->win_cnt = 0;
 
     s->c1 = 0.01 * 255.0;
     s->c1 *= s->c1;
@@ -398,16 +384,60 @@ static trp_obj_t *trp_pix_ssim_index_basic( trp_obj_t *pix1, trp_obj_t *pix2, tr
     s->ssim_g = 0.0;
     s->ssim_b = 0.0;
 
-    do ( s->calculate )( s );
-    while ( trp_pix_ssim_next( s ) );
+    trp_pix_ssim_run( s, map1, map2, parts );
 
     s->ssim_r /= (double)( s->win_cnt );
     s->ssim_g /= (double)( s->win_cnt );
     s->ssim_b /= (double)( s->win_cnt );
 
-    return trp_double( TRP_PIX_WEIGHT_RED_F * s->ssim_r +
-                       TRP_PIX_WEIGHT_GREEN_F * s->ssim_g +
-                       TRP_PIX_WEIGHT_BLUE_F * s->ssim_b );
+    return TRP_PIX_WEIGHT_RED_F * s->ssim_r +
+        TRP_PIX_WEIGHT_GREEN_F * s->ssim_g +
+        TRP_PIX_WEIGHT_BLUE_F * s->ssim_b;
+}
+
+static trp_obj_t *trp_pix_ssim_index_basic( trp_obj_t *pix1, trp_obj_t *pix2, trp_pix_ssim_t *s )
+{
+    trp_pix_color_t *map1, *map2;
+    uns32b w, h;
+
+    if ( ( pix1->tipo != TRP_PIX ) || ( pix2->tipo != TRP_PIX ) )
+        return UNDEF;
+    if ( ( ( map1 = ((trp_pix_t *)pix1)->map.c ) == NULL ) ||
+         ( ( map2 = ((trp_pix_t *)pix2)->map.c ) == NULL ) )
+        return UNDEF;
+
+    w = ((trp_pix_t *)pix1)->w;
+    h = ((trp_pix_t *)pix1)->h;
+
+    if ( ( w != ((trp_pix_t *)pix2)->w ) ||
+         ( h != ((trp_pix_t *)pix2)->h ) ||
+         ( w < s->win_w ) || ( h < s->win_h ) )
+        return UNDEF;
+
+    return trp_double( trp_pix_ssim_low( s, map1, map2, w, h,
+                                         ( w * h >= TRP_PIX_SSIM_PAR_MIN ) ? trp_ncpus() : 1 ) );
+}
+
+static void trp_pix_ssim_multi_fun( void *ctx, trp_pix_color_t *ref, trp_pix_color_t *map, uns32b w, uns32b h, void *res )
+{
+    *((double *)res) = trp_pix_ssim_low( (trp_pix_ssim_t *)ctx, map, ref, w, h, 1 );
+}
+
+static trp_obj_t *trp_pix_ssim_multi_obj( void *ctx, void *res, uns32b w, uns32b h )
+{
+    return trp_double( *((double *)res) );
+}
+
+/*
+ ogni pix di pixs è confrontata con ref in un singolo thread;
+ sono le pix a essere distribuite fra i thread
+ */
+
+static trp_obj_t *trp_pix_ssim_multi_basic( trp_obj_t *ref, trp_obj_t *pixs, trp_pix_ssim_t *s )
+{
+    return trp_pix_multi( ref, pixs, s->win_w, s->win_h,
+                          (void *)s, sizeof( trp_pix_ssim_t ), trp_pix_ssim_multi_fun,
+                          sizeof( double ), trp_pix_ssim_multi_obj );
 }
 
 trp_obj_t *trp_pix_ssim( trp_obj_t *pix1, trp_obj_t *pix2, trp_obj_t *weights )
@@ -484,3 +514,23 @@ trp_obj_t *trp_pix_ssim_gaussian( trp_obj_t *pix1, trp_obj_t *pix2 )
     return trp_pix_ssim_index_basic( pix1, pix2, &s );
 }
 
+trp_obj_t *trp_pix_ssim_linear_multi( trp_obj_t *ref, trp_obj_t *pixs )
+{
+    trp_pix_ssim_t s;
+
+    s.win_w = s.win_h = 8;
+    s.weights = _ssim_linear_8x8;
+    s.calculate = trp_pix_ssim_calculate_linear_8x8;
+    return trp_pix_ssim_multi_basic( ref, pixs, &s );
+}
+
+trp_obj_t *trp_pix_ssim_gaussian_multi( trp_obj_t *ref, trp_obj_t *pixs )
+{
+    trp_pix_ssim_t s;
+
+    s.win_w = s.win_h = 11;
+    s.weights = _ssim_gaussian_11x11;
+    s.calculate = trp_pix_ssim_calculate_gaussian_11x11;
+    return trp_pix_ssim_multi_basic( ref, pixs, &s );
+}
+
@@ -64,3 +64,108 @@ flt64b pix_color_diff_color( uns8b r, uns8b g, uns8b b, trp_pix_color_t *c )
     return pix_color_diff( r, g, b, c->red, c->green, c->blue );
 }
 
+typedef struct {
+    trp_pix_multi_fun_t f;
+    void *ctx;
+    trp_pix_color_t *ref;
+    trp_pix_color_t **maps;
+    uns8b *res;
+    size_t rsize;
+    uns32b w, h, fr, to;
+} trp_pix_multi_par_t;
+
+static void *trp_pix_multi_routine( void *arg )
+{
+    trp_pix_multi_par_t *p = (trp_pix_multi_par_t *)arg;
+    uns32b i;
+
+    for ( i = p->fr ; i < p->to ; i++ )
+        if ( p->maps[ i ] )
+            ( p->f )( p->ctx, p->ref, p->maps[ i ], p->w, p->h, (void *)( p->res + i * p->rsize ) );
+    return NULL;
+}
+
+/*
+ confronta ref con ciascuna pix di pixs (array o coda): f calcola
+ la metrica (senza allocare oggetti) in un buffer di rsize byte,
+ mk la trasforma nel risultato; le pix sono divise fra i thread
+ e ciascun thread ha la propria copia di ctx;
+ le pix non confrontabili con ref danno UNDEF
+ */
+
+trp_obj_t *trp_pix_multi( trp_obj_t *ref, trp_obj_t *pixs, uns32b minw, uns32b minh,
+                          void *ctx, size_t ctxsize, trp_pix_multi_fun_t f,
+                          size_t rsize, trp_pix_multi_obj_t mk )
+{
+    trp_pix_multi_par_t *par;
+    trp_pix_color_t *mref, **maps;
+    trp_obj_t *res, *obj;
+    uns8b *r, *ctxs;
+    uns32b w, h, n, parts, i;
+
+    if ( ref->tipo != TRP_PIX )
+        return UNDEF;
+    if ( ( mref = ((trp_pix_t *)ref)->map.c ) == NULL )
+        return UNDEF;
+    w = ((trp_pix_t *)ref)->w;
+    h = ((trp_pix_t *)ref)->h;
+    if ( ( w < minw ) || ( h < minh ) )
+        return UNDEF;
+    switch ( pixs->tipo ) {
+        case TRP_ARRAY:
+            n = ((trp_array_t *)pixs)->len;
+            break;
+        case TRP_QUEUE:
+            n = ((trp_queue_t *)pixs)->len;
+            break;
+        default:
+            return UNDEF;
+    }
+    res = trp_array_ext_internal( UNDEF, 1, n );
+    if ( n == 0 )
+        return res;
+    parts = ( n < trp_ncpus() ) ? n : trp_ncpus();
+    maps = malloc( sizeof( trp_pix_color_t * ) * n );
+    r = malloc( rsize * n );
+    par = malloc( ( sizeof( trp_pix_multi_par_t ) + ctxsize ) * parts );
+    if ( ( maps == NULL ) || ( r == NULL ) || ( par == NULL ) ) {
+        free( maps );
+        free( r );
+        free( par );
+        return UNDEF;
+    }
+    for ( i = 0 ; i < n ; i++ ) {
+        obj = ( pixs->tipo == TRP_ARRAY )
+            ? ((trp_array_t *)pixs)->data[ i ]
+            : trp_queue_nth( i, (trp_queue_t *)pixs );
+        maps[ i ] = ( ( obj->tipo == TRP_PIX ) &&
+                      ( ((trp_pix_t *)obj)->w == w ) &&
+                      ( ((trp_pix_t *)obj)->h == h ) )
+            ? ((trp_pix_t *)obj)->map.c
+            : NULL;
+    }
+    ctxs = (uns8b *)( par + parts );
+    for ( i = 0 ; i < parts ; i++ ) {
+        par[ i ].f = f;
+        par[ i ].ctx = (void *)( ctxs + i * ctxsize );
+        if ( ctxsize )
+            memcpy( par[ i ].ctx, ctx, ctxsize );
+        par[ i ].ref = mref;
+        par[ i ].maps = maps;
+        par[ i ].res = r;
+        par[ i ].rsize = rsize;
+        par[ i ].w = w;
+        par[ i ].h = h;
+        par[ i ].fr = (uns32b)( ( (uns64b)n * i ) / parts );
+        par[ i ].to = (uns32b)( ( (uns64b)n * ( i + 1 ) ) / parts );
+    }
+    trp_parallel_run( trp_pix_multi_routine, par, sizeof( trp_pix_multi_par_t ), parts );
+    for ( i = 0 ; i < n ; i++ )
+        if ( maps[ i ] )
+            ((trp_array_t *)res)->data[ i ] = ( mk )( ctx, (void *)( r + i * rsize ), w, h );
+    free( par );
+    free( r );
+    free( maps );
+    return res;
+}
+
@@ -35,11 +35,6 @@ typedef struct {
     trp_sift_keypoint_t *kp;
 } trp_sift_t;
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
 static uns8b trp_sift_print( trp_print_t *p, trp_sift_t *obj );
 static uns8b trp_sift_close( trp_sift_t *obj );
 static uns8b trp_sift_close_basic( uns8b flags, trp_sift_t *obj );
@@ -313,10 +308,10 @@ trp_obj_t *trp_sift_match( trp_obj_t *obj1, trp_obj_t *obj2, trp_obj_t *threshol
 
 trp_obj_t *trp_sift_analyze( trp_obj_t *m )
 {
-    trp_queue_elem *elem1, *elem2;
+    trp_obj_t *elem1, *elem2;
     flt64b x1, y1, x2, y2, dx1, dy1, dx2, dy2, u;
     flt64b sumx[ 100 ], sumy[ 100 ], deltax[ 100 ], deltay[ 100 ];
-    uns32b cntx[ 100 ], cnty[ 100 ], nx, ny, bnx, bny, i, j;
+    uns32b cntx[ 100 ], cnty[ 100 ], nx, ny, bnx, bny, i, j, n1, n2;
 
     if ( m->tipo != TRP_QUEUE )
         return UNDEF;
@@ -324,21 +319,19 @@ trp_obj_t *trp_sift_analyze( trp_obj_t *m )
         sumx[ i ] = sumy[ i ] = deltax[ i ] = deltay[ i ] = 0.0;
         cntx[ i ] = cnty[ i ] = 0;
     }
-    for ( elem1 = (trp_queue_elem *)( ((trp_queue_t *)m)->first );
-          elem1 ;
-          elem1 = (trp_queue_elem *)( elem1->next ) ) {
-        if ( trp_cast_flt64b( trp_car( trp_car ( elem1->val ) ), &x1 ) ||
-             trp_cast_flt64b( trp_cdr( trp_car ( elem1->val ) ), &y1 ) ||
-             trp_cast_flt64b( trp_car( trp_cdr ( elem1->val ) ), &x2 ) ||
-             trp_cast_flt64b( trp_cdr( trp_cdr ( elem1->val ) ), &y2 ) )
+    for ( n1 = 0 ; n1 < ((trp_queue_t *)m)->len ; n1++ ) {
+        elem1 = trp_queue_nth( n1, (trp_queue_t *)m );
+        if ( trp_cast_flt64b( trp_car( trp_car ( elem1 ) ), &x1 ) ||
+             trp_cast_flt64b( trp_cdr( trp_car ( elem1 ) ), &y1 ) ||
+             trp_cast_flt64b( trp_car( trp_cdr ( elem1 ) ), &x2 ) ||
+             trp_cast_flt64b( trp_cdr( trp_cdr ( elem1 ) ), &y2 ) )
             return UNDEF;
-        for ( elem2 = (trp_queue_elem *)( elem1->next );
-              elem2 ;
-              elem2 = (trp_queue_elem *)( elem2->next ) ) {
-            if ( trp_cast_flt64b( trp_car( trp_car ( elem2->val ) ), &dx1 ) ||
-                 trp_cast_flt64b( trp_cdr( trp_car ( elem2->val ) ), &dy1 ) ||
-                 trp_cast_flt64b( trp_car( trp_cdr ( elem2->val ) ), &dx2 ) ||
-                 trp_cast_flt64b( trp_cdr( trp_cdr ( elem2->val ) ), &dy2 ) )
+        for ( n2 = n1 + 1 ; n2 < ((trp_queue_t *)m)->len ; n2++ ) {
+            elem2 = trp_queue_nth( n2, (trp_queue_t *)m );
+            if ( trp_cast_flt64b( trp_car( trp_car ( elem2 ) ), &dx1 ) ||
+                 trp_cast_flt64b( trp_cdr( trp_car ( elem2 ) ), &dy1 ) ||
+                 trp_cast_flt64b( trp_car( trp_cdr ( elem2 ) ), &dx2 ) ||
+                 trp_cast_flt64b( trp_cdr( trp_cdr ( elem2 ) ), &dy2 ) )
                 return UNDEF;
             dx1 -= x1;
             dx2 -= x2;
@@ -20,12 +20,58 @@
 #include "./trpsqlite3.h"
 #include <sqlite3.h>
 
+/*
+ la connessione è condivisa fra il db e le sue istruzioni
+ preparate: queste non puntano al db (che ha un finalizzatore
+ e punta a loro tramite la cache), altrimenti il ciclo non
+ verrebbe mai finalizzato
+ */
+
+typedef struct {
+    sqlite3 *s;
+} trp_sqlite3_handle_t;
+
+/*
+ numero massimo di istruzioni tenute nella cache di un db
+ */
+#define TRP_SQLITE3_CACHE_MAX 64
+
+typedef struct trp_sqlite3_stmt_s trp_sqlite3_stmt_t;
+
+typedef struct {
+    trp_obj_t *sql;
+    uns64b tick;
+    uns32b n;
+    trp_sqlite3_stmt_t *stmt[ TRP_SQLITE3_CACHE_MAX ];
+} trp_sqlite3_cache_t;
+
 typedef struct {
     uns8b tipo;
+    uns8b sottotipo;
     sqlite3 *s;
     uns32b level;
+    trp_sqlite3_handle_t *h;
+    trp_sqlite3_cache_t *cache;
 } trp_sqlite3_t;
 
+/*
+ cache è NULL per le istruzioni fuori dalla cache: queste
+ hanno un finalizzatore, le altre vengono finalizzate
+ insieme al db
+ */
+
+struct trp_sqlite3_stmt_s {
+    uns8b tipo;
+    uns8b sottotipo;
+    sqlite3_stmt *stmt;
+    trp_sqlite3_handle_t *h;
+    trp_sqlite3_cache_t *cache;
+    trp_obj_t *sql;
+    trp_obj_t **binds;
+    uns32b nbinds;
+    uns64b used;
+};
+
 typedef struct {
     uns8b mode;
     uns8b unc_tipo;
@@ -64,6 +110,15 @@ static int trp_sqlite3_callback( trp_sqlite3_flags_t *flags, int argc, char **ar
 static trp_obj_t *trp_sqlite3_exec_low( uns8b flags, trp_obj_t *obj, uns8b *q );
 static int trp_sqlite3_test_callback( trp_sqlite3_flags_t *flags, int argc, char **argv, char **col_names );
 static uns8b trp_sqlite3_exec_data_low( uns8b flags, trp_obj_t *obj, trp_obj_t *net, trp_obj_t *data, uns8b *q );
+static void trp_sqlite3_stmt_finalize( void *obj, void *data );
+static void trp_sqlite3_cache_remove( trp_sqlite3_stmt_t *st );
+static trp_sqlite3_stmt_t *trp_sqlite3_stmt_new( trp_sqlite3_t *db, sqlite3 *s, trp_obj_t *sql, uns8b *q, uns8b cached );
+static uns8b trp_sqlite3_stmt_check( trp_obj_t *obj, sqlite3_stmt **stmt );
+static uns8b trp_sqlite3_mpi_sig64( trp_mpi_t *obj, sig64b *val );
+static uns8b *trp_sqlite3_encode_obj( trp_obj_t *obj, uns32b *len );
+static uns8b trp_sqlite3_bind_low( trp_sqlite3_stmt_t *st, va_list args );
+static trp_obj_t *trp_sqlite3_column( sqlite3_stmt *stmt, int i );
+static trp_obj_t *trp_sqlite3_row( sqlite3_stmt *stmt );
 
 uns8b trp_sqlite3_init()
 {
@@ -84,6 +139,15 @@ void trp_sqlite3_quit()
 
 static uns8b trp_sqlite3_print( trp_print_t *p, trp_sqlite3_t *obj )
 {
+    if ( obj->sottotipo ) {
+        if ( trp_print_char_star( p, "#sqlite3 stmt" ) )
+            return 1;
+        if ( ( ((trp_sqlite3_stmt_t *)obj)->stmt == NULL ) ||
+             ( ((trp_sqlite3_stmt_t *)obj)->h->s == NULL ) )
+            if ( trp_print_char_star( p, " (closed)" ) )
+                return 1;
+        return trp_print_char( p, '#' );
+    }
     if ( trp_print_char_star( p, "#sqlite3 db" ) )
         return 1;
     if ( obj->s == NULL )
@@ -94,11 +158,28 @@ static uns8b trp_sqlite3_print( trp_print_t *p, trp_sqlite3_t *obj )
 
 static uns8b trp_sqlite3_close( trp_sqlite3_t *obj )
 {
+    if ( obj->sottotipo ) {
+        trp_sqlite3_stmt_t *st = (trp_sqlite3_stmt_t *)obj;
+
+        if ( st->stmt ) {
+            if ( st->h->s ) {
+                (void)sqlite3_finalize( st->stmt );
+                st->stmt = NULL;
+                if ( st->cache )
+                    trp_sqlite3_cache_remove( st );
+            }
+            st->stmt = NULL;
+            st->binds = NULL;
+            st->nbinds = 0;
+        }
+        return 0;
+    }
     return trp_sqlite3_close_basic( 1, obj );
 }
 
 static uns8b trp_sqlite3_close_basic( uns8b flags, trp_sqlite3_t *obj )
 {
+    sqlite3_stmt *stmt;
     uns8b res = 0;
 
     if ( obj->s ) {
@@ -108,8 +189,12 @@ static uns8b trp_sqlite3_close_basic( uns8b flags, trp_sqlite3_t *obj )
             (void)sqlite3_exec( obj->s, "ROLLBACK", NULL, NULL, NULL );
             obj->level = 0;
         }
+        while ( ( stmt = sqlite3_next_stmt( obj->s, NULL ) ) )
+            (void)sqlite3_finalize( stmt );
         res = sqlite3_close( obj->s ) ? 1 : 0;
         obj->s = NULL;
+        obj->h->s = NULL;
+        obj->cache = NULL;
     }
     return res;
 }
@@ -121,7 +206,7 @@ static void trp_sqlite3_finalize( void *obj, void *data )
 
 static uns8b trp_sqlite3_check( trp_obj_t *obj, sqlite3 **s, uns32b *level )
 {
-    if ( obj->tipo != TRP_SQLITE3 )
+    if ( ( obj->tipo != TRP_SQLITE3 ) || ((trp_sqlite3_t *)obj)->sottotipo )
         return 1;
     *s = ((trp_sqlite3_t *)obj)->s;
     if ( *s == NULL )
@@ -138,10 +223,17 @@ trp_obj_t *trp_sqlite3_open( trp_obj_t *path )
     uns8b *cpath = trp_csprint( path );
 
     if ( sqlite3_open( cpath, &s ) == SQLITE_OK ) {
-        obj = trp_gc_malloc_atomic_finalize( sizeof( trp_sqlite3_t ), trp_sqlite3_finalize );
+        obj = trp_gc_malloc_finalize( sizeof( trp_sqlite3_t ), trp_sqlite3_finalize );
         obj->tipo = TRP_SQLITE3;
+        obj->sottotipo = 0;
         obj->s = s;
         obj->level = 0;
+        obj->h = trp_gc_malloc_atomic( sizeof( trp_sqlite3_handle_t ) );
+        obj->h->s = s;
+        obj->cache = trp_gc_malloc( sizeof( trp_sqlite3_cache_t ) );
+        obj->cache->sql = trp_assoc();
+        obj->cache->tick = 0;
+        obj->cache->n = 0;
     }
     trp_csprint_free( cpath );
     return (trp_obj_t *)obj;
@@ -762,3 +854,385 @@ trp_obj_t *trp_sqlite3_total_changes( trp_obj_t *obj )
     return trp_sig64( sqlite3_total_changes( s ) );
 }
 
+static void trp_sqlite3_stmt_finalize( void *obj, void *data )
+{
+    trp_sqlite3_stmt_t *st = (trp_sqlite3_stmt_t *)obj;
+
+    if ( st->stmt && st->h->s )
+        (void)sqlite3_finalize( st->stmt );
+    st->stmt = NULL;
+}
+
+/*
+ toglie l'istruzione dalla cache; da qui in poi la finalizza il gc
+ (chi la usa ancora la può continuare a usare)
+ */
+
+static void trp_sqlite3_cache_remove( trp_sqlite3_stmt_t *st )
+{
+    trp_sqlite3_cache_t *c = st->cache;
+    uns32b i;
+
+    (void)trp_assoc_clr( c->sql, st->sql );
+    for ( i = 0 ; i < c->n ; i++ )
+        if ( c->stmt[ i ] == st ) {
+            c->stmt[ i ] = c->stmt[ --( c->n ) ];
+            c->stmt[ c->n ] = NULL;
+            break;
+        }
+    st->cache = NULL;
+    if ( st->stmt )
+        GC_register_finalizer( (void *)st, trp_sqlite3_stmt_finalize, NULL, NULL, NULL );
+}
+
+static trp_sqlite3_stmt_t *trp_sqlite3_stmt_new( trp_sqlite3_t *db, sqlite3 *s, trp_obj_t *sql, uns8b *q, uns8b cached )
+{
+    trp_sqlite3_cache_t *c = db->cache;
+    trp_sqlite3_stmt_t *st;
+    sqlite3_stmt *stmt;
+    uns32b i, j;
+
+    if ( sqlite3_prepare_v2( s, q, -1, &stmt, NULL ) != SQLITE_OK )
+        return NULL;
+    if ( stmt == NULL )
+        return NULL;
+    if ( cached ) {
+        st = trp_gc_malloc( sizeof( trp_sqlite3_stmt_t ) );
+    } else {
+        st = trp_gc_malloc_finalize( sizeof( trp_sqlite3_stmt_t ), trp_sqlite3_stmt_finalize );
+    }
+    st->tipo = TRP_SQLITE3;
+    st->sottotipo = 1;
+    st->stmt = stmt;
+    st->h = db->h;
+    st->cache = NULL;
+    st->sql = sql;
+    st->binds = NULL;
+    st->nbinds = 0;
+    st->used = ++( c->tick );
+    if ( cached ) {
+        /*
+         cache piena: si scarta l'istruzione usata meno di recente
+         */
+        if ( c->n == TRP_SQLITE3_CACHE_MAX ) {
+            for ( i = 0, j = 1 ; j < c->n ; j++ )
+                if ( c->stmt[ j ]->used < c->stmt[ i ]->used )
+                    i = j;
+            trp_sqlite3_cache_remove( c->stmt[ i ] );
+        }
+        st->cache = c;
+        c->stmt[ ( c->n )++ ] = st;
+        (void)trp_assoc_set( c->sql, sql, (trp_obj_t *)st );
+    }
+    return st;
+}
+
+/*
+ istruzioni preparate: il testo SQL (i pezzi vengono concatenati
+ come in exec) è compilato una sola volta per connessione; una
+ seconda prepare dello stesso testo rende la stessa istruzione,
+ azzerata, a meno che non sia ancora in corso (un cursore non
+ esaurito): in tal caso se ne compila una nuova, fuori dalla
+ cache; i parametri (?, ?NNN, :nome...) si legano con bind
+ */
+
+trp_obj_t *trp_sqlite3_prepare( trp_obj_t *obj, trp_obj_t *query, ... )
+{
+    trp_sqlite3_stmt_t *st;
+    trp_obj_t *sql;
+    sqlite3 *s;
+    uns8b *q;
+    va_list args;
+
+    if ( trp_sqlite3_check( obj, &s, NULL ) )
+        return UNDEF;
+    va_start( args, query );
+    q = trp_csprint_multi( query, args );
+    va_end( args );
+    sql = trp_cord( q );
+    st = (trp_sqlite3_stmt_t *)trp_assoc_get( ((trp_sqlite3_t *)obj)->cache->sql, sql );
+    if ( (trp_obj_t *)st != UNDEF ) {
+        if ( sqlite3_stmt_busy( st->stmt ) ) {
+            st = trp_sqlite3_stmt_new( (trp_sqlite3_t *)obj, s, sql, q, 0 );
+            trp_csprint_free( q );
+            return st ? (trp_obj_t *)st : UNDEF;
+        }
+        trp_csprint_free( q );
+        (void)sqlite3_reset( st->stmt );
+        (void)sqlite3_clear_bindings( st->stmt );
+        st->binds = NULL;
+        st->nbinds = 0;
+        st->used = ++( ((trp_sqlite3_t *)obj)->cache->tick );
+        return (trp_obj_t *)st;
+    }
+    st = trp_sqlite3_stmt_new( (trp_sqlite3_t *)obj, s, sql, q, 1 );
+    trp_csprint_free( q );
+    return st ? (trp_obj_t *)st : UNDEF;
+}
+
+static uns8b trp_sqlite3_stmt_check( trp_obj_t *obj, sqlite3_stmt **stmt )
+{
+    if ( ( obj->tipo != TRP_SQLITE3 ) || ( ((trp_sqlite3_t *)obj)->sottotipo != 1 ) )
+        return 1;
+    if ( ( ((trp_sqlite3_stmt_t *)obj)->stmt == NULL ) ||
+         ( ((trp_sqlite3_stmt_t *)obj)->h->s == NULL ) )
+        return 1;
+    *stmt = ((trp_sqlite3_stmt_t *)obj)->stmt;
+    return 0;
+}
+
+/*
+ stessa codifica usata da trp_sqlite3_create_query per gli
+ oggetti che non sono numeri, caratteri, stringhe o raw
+ */
+
+static uns8b *trp_sqlite3_encode_obj( trp_obj_t *obj, uns32b *len )
+{
+    trp_sqlite3_extra_t extra;
+    trp_raw_t *raw;
+    uns8b *q;
+
+    if ( ( obj->tipo == TRP_RAW ) && ((trp_raw_t *)obj)->mode ) {
+        raw = (trp_raw_t *)obj;
+    } else {
+        raw = (trp_raw_t *)trp_compress( obj, DIECI );
+        if ( (trp_obj_t *)raw == UNDEF )
+            return NULL;
+    }
+    extra.mode = raw->mode;
+    extra.unc_tipo = raw->unc_tipo;
+    extra.compression_level = raw->compression_level;
+    extra.len = norm32( raw->len );
+    extra.unc_len = norm32( raw->unc_len );
+    *len = 4 +
+        trp_sqlite3_encode_binary( (uns8b *)(&extra), sizeof( trp_sqlite3_extra_t ), NULL ) +
+        trp_sqlite3_encode_binary( raw->data, raw->len, NULL );
+    q = trp_malloc( *len + 1 );
+    q[ 0 ] = 155;
+    q[ 1 ] = 155;
+    q[ 2 ] = ( raw == (trp_raw_t *)obj ) ? 153 : 152;
+    q[ 3 ] = trp_sqlite3_encode_binary( (uns8b *)(&extra), sizeof( trp_sqlite3_extra_t ), q + 4 );
+    trp_sqlite3_encode_binary( raw->data, raw->len, q + 4 + q[ 3 ] );
+    q[ *len ] = 0;
+    if ( raw != (trp_raw_t *)obj ) {
+        trp_raw_close( raw );
+        trp_gc_free( raw );
+    }
+    return q;
+}
+
+/*
+ un intero grande che sta comunque in 64 bit
+ */
+
+static uns8b trp_sqlite3_mpi_sig64( trp_mpi_t *obj, sig64b *val )
+{
+    mpz_t t;
+    uns64b v;
+
+    if ( mpz_sizeinbase( obj->val, 2 ) > 63 )
+        return 1;
+    mpz_init( t );
+    mpz_abs( t, obj->val );
+    v = (uns64b)( mpz_get_ui( t ) & 0xffffffff );
+    mpz_tdiv_q_2exp( t, t, 32 );
+    v |= ( ( (uns64b)( mpz_get_ui( t ) & 0xffffffff ) ) << 32 );
+    mpz_clear( t );
+    *val = ( mpz_sgn( obj->val ) < 0 ) ? -(sig64b)v : (sig64b)v;
+    return 0;
+}
+
+/*
+ stringhe e raw non compressi sono legati senza copia: l'istruzione
+ tiene un riferimento agli oggetti finché non viene rilegata
+ (non bisogna chiudere un raw legato prima di averla eseguita)
+ */
+
+static uns8b trp_sqlite3_bind_low( trp_sqlite3_stmt_t *st, va_list args )
+{
+    sqlite3_stmt *stmt = st->stmt;
+    trp_obj_t *obj;
+    uns8b *p;
+    uns32b len;
+    sig64b v;
+    int i, n, rc;
+
+    (void)sqlite3_reset( stmt );
+    (void)sqlite3_clear_bindings( stmt );
+    n = sqlite3_bind_parameter_count( stmt );
+    if ( (uns32b)n > st->nbinds ) {
+        st->binds = trp_gc_malloc( sizeof( trp_obj_t * ) * n );
+        st->nbinds = n;
+    }
+    for ( i = 0 ; i < (int)st->nbinds ; i++ )
+        st->binds[ i ] = NULL;
+    for ( i = 0 ; ( obj = va_arg( args, trp_obj_t * ) ) ; i++ ) {
+        if ( i >= n )
+            return 1;
+        switch ( obj->tipo ) {
+        case TRP_SIG64:
+            rc = sqlite3_bind_int64( stmt, i + 1, (sqlite3_int64)( ((trp_sig64_t *)obj)->val ) );
+            break;
+        case TRP_CHAR:
+            rc = sqlite3_bind_text( stmt, i + 1, &( ((trp_char_t *)obj)->c ), 1, SQLITE_TRANSIENT );
+            break;
+        case TRP_CORD:
+            p = (uns8b *)CORD_to_const_char_star( ((trp_cord_t *)obj)->c );
+            st->binds[ i ] = (trp_obj_t *)p;
+            rc = sqlite3_bind_text( stmt, i + 1, p, ((trp_cord_t *)obj)->len, SQLITE_STATIC );
+            break;
+        case TRP_MPI:
+            if ( trp_sqlite3_mpi_sig64( (trp_mpi_t *)obj, &v ) == 0 ) {
+                rc = sqlite3_bind_int64( stmt, i + 1, (sqlite3_int64)v );
+                break;
+            }
+            /* fall through */
+        case TRP_RATIO:
+            p = trp_csprint( obj );
+            rc = sqlite3_bind_text( stmt, i + 1, p, -1, SQLITE_TRANSIENT );
+            trp_csprint_free( p );
+            break;
+        default:
+            if ( obj == UNDEF ) {
+                rc = sqlite3_bind_null( stmt, i + 1 );
+            } else if ( ( obj->tipo == TRP_RAW ) && ( ((trp_raw_t *)obj)->mode == 0 ) ) {
+                st->binds[ i ] = obj;
+                rc = sqlite3_bind_blob( stmt, i + 1, ((trp_raw_t *)obj)->data, ((trp_raw_t *)obj)->len, SQLITE_STATIC );
+            } else {
+                if ( ( p = trp_sqlite3_encode_obj( obj, &len ) ) == NULL )
+                    return 1;
+                rc = sqlite3_bind_text( stmt, i + 1, p, len, free );
+            }
+            break;
+        }
+        if ( rc != SQLITE_OK )
+            return 1;
+    }
+    return 0;
+}
+
+uns8b trp_sqlite3_bind( trp_obj_t *obj, ... )
+{
+    sqlite3_stmt *stmt;
+    uns8b res;
+    va_list args;
+
+    if ( trp_sqlite3_stmt_check( obj, &stmt ) )
+        return 1;
+    va_start( args, obj );
+    res = trp_sqlite3_bind_low( (trp_sqlite3_stmt_t *)obj, args );
+    va_end( args );
+    return res;
+}
+
+/*
+ lega i parametri ed esegue fino in fondo, scartando le eventuali
+ righe: è il caso tipico delle INSERT ripetute
+ */
+
+uns8b trp_sqlite3_run( trp_obj_t *obj, ... )
+{
+    sqlite3_stmt *stmt;
+    uns8b res;
+    int rc;
+    va_list args;
+
+    if ( trp_sqlite3_stmt_check( obj, &stmt ) )
+        return 1;
+    va_start( args, obj );
+    res = trp_sqlite3_bind_low( (trp_sqlite3_stmt_t *)obj, args );
+    va_end( args );
+    if ( res )
+        return 1;
+    while ( ( rc = sqlite3_step( stmt ) ) == SQLITE_ROW );
+    (void)sqlite3_reset( stmt );
+    return ( rc == SQLITE_DONE ) ? 0 : 1;
+}
+
+static trp_obj_t *trp_sqlite3_column( sqlite3_stmt *stmt, int i )
+{
+    extern trp_obj_t *trp_raw_internal( uns32b sz, uns8b use_malloc );
+    trp_obj_t *res;
+    uns8b *p, *q;
+    int n;
+
+    switch ( sqlite3_column_type( stmt, i ) ) {
+    case SQLITE_NULL:
+        return UNDEF;
+    case SQLITE_INTEGER:
+        return trp_sig64( (sig64b)sqlite3_column_int64( stmt, i ) );
+    case SQLITE_FLOAT:
+        return trp_double( sqlite3_column_double( stmt, i ) );
+    case SQLITE_BLOB:
+        p = (uns8b *)sqlite3_column_blob( stmt, i );
+        n = sqlite3_column_bytes( stmt, i );
+        res = trp_raw_internal( n, 0 );
+        if ( n )
+            memcpy( ((trp_raw_t *)res)->data, p, n );
+        return res;
+    }
+    p = (uns8b *)sqlite3_column_text( stmt, i );
+    if ( p == NULL )
+        return UNDEF;
+    if ( p[ 0 ] != 155 )
+        return trp_cord( p );
+    /*
+     trp_sqlite3_get_value scrive temporaneamente nel buffer
+     */
+    n = sqlite3_column_bytes( stmt, i );
+    q = trp_malloc( n + 1 );
+    memcpy( q, p, n + 1 );
+    res = trp_sqlite3_get_value( 0, q );
+    free( q );
+    return res;
+}
+
+static trp_obj_t *trp_sqlite3_row( sqlite3_stmt *stmt )
+{
+    trp_obj_t *l = NIL;
+    int n;
+
+    for ( n = sqlite3_column_count( stmt ) ; n ; )
+        l = trp_cons( trp_sqlite3_column( stmt, --n ), l );
+    return l;
+}
+
+/*
+ rende la riga successiva (lista dei valori, con i tipi delle
+ colonne) oppure UNDEF alla fine, dopo aver azzerato l'istruzione
+ */
+
+trp_obj_t *trp_sqlite3_step( trp_obj_t *obj )
+{
+    sqlite3_stmt *stmt;
+
+    if ( trp_sqlite3_stmt_check( obj, &stmt ) )
+        return UNDEF;
+    if ( sqlite3_step( stmt ) == SQLITE_ROW )
+        return trp_sqlite3_row( stmt );
+    (void)sqlite3_reset( stmt );
+    return UNDEF;
+}
+
+/*
+ riempie l'array già allocato con le righe successive, fino alla
+ sua lunghezza; rende il numero di righe lette (0 alla fine)
+ */
+
+trp_obj_t *trp_sqlite3_fetch( trp_obj_t *obj, trp_obj_t *a )
+{
+    sqlite3_stmt *stmt;
+    uns32b i;
+
+    if ( trp_sqlite3_stmt_check( obj, &stmt ) || ( a->tipo != TRP_ARRAY ) )
+        return UNDEF;
+    for ( i = 0 ; i < ((trp_array_t *)a)->len ; i++ ) {
+        if ( sqlite3_step( stmt ) != SQLITE_ROW ) {
+            (void)sqlite3_reset( stmt );
+            break;
+        }
+        ((trp_array_t *)a)->data[ i ] = trp_sqlite3_row( stmt );
+    }
+    return trp_sig64( i );
+}
+
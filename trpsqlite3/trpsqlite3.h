@@ -33,5 +33,10 @@ uns8b trp_sqlite3_end( trp_obj_t *obj );
 uns8b trp_sqlite3_rollback( trp_obj_t *obj );
 trp_obj_t *trp_sqlite3_changes( trp_obj_t *obj );
 trp_obj_t *trp_sqlite3_total_changes( trp_obj_t *obj );
+trp_obj_t *trp_sqlite3_prepare( trp_obj_t *obj, trp_obj_t *query, ... );
+uns8b trp_sqlite3_bind( trp_obj_t *obj, ... );
+uns8b trp_sqlite3_run( trp_obj_t *obj, ... );
+trp_obj_t *trp_sqlite3_step( trp_obj_t *obj );
+trp_obj_t *trp_sqlite3_fetch( trp_obj_t *obj, trp_obj_t *a );
 
 #endif /* !__trpsqlite3__h */
@@ -0,0 +1,680 @@
+/*
+    TreeP Run Time Support
+    Copyright (C) 2008-2026 Frank Sinapsi
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../trp/trp.h"
+#include "./trpstr.h"
+#include "./c_escape.h"
+#include "./src.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ parser e serializzatore JSON in un solo passaggio; l'albero
+ costruito è lo stesso di json-parse in common-json.tin:
+ ogni nodo è un tree il cui valore è l'array [ tipo valore ]
+ */
+
+#define TRP_JSON_MAX_DEPTH 4096
+
+typedef struct {
+    trp_str_src_t s;
+    uns8b *tok;
+    uns32b tlen;
+    uns32b tmax;
+    uns32b depth;
+} trp_json_t;
+
+typedef struct {
+    uns8b *buf;
+    uns64b len;
+    uns64b size;
+} trp_json_out_t;
+
+static trp_obj_t *_trp_json_type[ 5 ] = { NULL, NULL, NULL, NULL, NULL };
+
+static uns8b *trp_json_ws( uns8b *p, uns8b *e );
+static uns8b *trp_json_str_end( uns8b *p, uns8b *e );
+static int trp_json_peek( trp_json_t *js );
+static void trp_json_tok( trp_json_t *js, uns8b *p, uns32b n );
+static trp_obj_t *trp_json_node( uns8b type, trp_obj_t *val );
+static trp_obj_t *trp_json_string( trp_json_t *js );
+static trp_obj_t *trp_json_word( trp_json_t *js );
+static trp_obj_t *trp_json_number( trp_json_t *js );
+static trp_obj_t *trp_json_value( trp_json_t *js );
+static void trp_json_put( trp_json_out_t *o, uns8b *s, uns64b n );
+static uns8b trp_json_clean( uns8b *p, uns32b n );
+static uns8b trp_json_put_string( trp_json_out_t *o, trp_obj_t *s );
+static uns8b trp_json_put_print( trp_json_out_t *o, trp_obj_t *obj );
+static uns8b trp_json_put_ratio( trp_json_out_t *o, trp_ratio_t *obj );
+static uns8b trp_json_dump_assoc( trp_json_out_t *o, trp_obj_t *a, uns32b depth );
+static uns8b trp_json_dump_low( trp_json_out_t *o, trp_obj_t *obj, uns32b depth );
+
+/*
+ scansioni a 16 byte per volta: spazi da saltare e fine
+ del tratto di stringa che non richiede attenzione
+ */
+
+static uns8b *trp_json_ws( uns8b *p, uns8b *e )
+{
+    if ( ( p < e ) && ( *p > ' ' ) )
+        return p;
+#ifdef __SSE2__
+    {
+        const __m128i sp = _mm_set1_epi8( ' ' ), ht = _mm_set1_epi8( '\t' ),
+                      nl = _mm_set1_epi8( '\n' ), cr = _mm_set1_epi8( '\r' );
+        __m128i v;
+        int m;
+
+        for ( ; p + 16 <= e ; p += 16 ) {
+            v = _mm_loadu_si128( (const __m128i *)p );
+            m = _mm_movemask_epi8( _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, sp ),
+                                                               _mm_cmpeq_epi8( v, ht ) ),
+                                                 _mm_or_si128( _mm_cmpeq_epi8( v, nl ),
+                                                               _mm_cmpeq_epi8( v, cr ) ) ) ) ^ 0xffff;
+            if ( m )
+                return p + __builtin_ctz( m );
+        }
+    }
+#endif
+    while ( ( p < e ) && ( ( *p == ' ' ) || ( *p == '\t' ) || ( *p == '\n' ) || ( *p == '\r' ) ) )
+        p++;
+    return p;
+}
+
+static uns8b *trp_json_str_end( uns8b *p, uns8b *e )
+{
+#ifdef __SSE2__
+    {
+        const __m128i qu = _mm_set1_epi8( '"' ), bs = _mm_set1_epi8( '\\' );
+        __m128i v;
+        int m;
+
+        for ( ; p + 16 <= e ; p += 16 ) {
+            v = _mm_loadu_si128( (const __m128i *)p );
+            m = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( v, qu ),
+                                                 _mm_cmpeq_epi8( v, bs ) ) );
+            if ( m )
+                return p + __builtin_ctz( m );
+        }
+    }
+#endif
+    while ( ( p < e ) && ( *p != '"' ) && ( *p != '\\' ) )
+        p++;
+    return p;
+}
+
+/*
+ salta gli spazi e rende il primo carattere significativo
+ (senza consumarlo), -1 alla fine del testo
+ */
+
+static int trp_json_peek( trp_json_t *js )
+{
+    for ( ; ; ) {
+        js->s.p = trp_json_ws( js->s.p, js->s.e );
+        if ( js->s.p < js->s.e )
+            return (int)( *( js->s.p ) );
+        if ( trp_str_src_fill( &( js->s ) ) )
+            return -1;
+    }
+}
+
+static void trp_json_tok( trp_json_t *js, uns8b *p, uns32b n )
+{
+    if ( n == 0 )
+        return;
+    if ( js->tlen + n > js->tmax ) {
+        do {
+            js->tmax = js->tmax ? js->tmax << 1 : 256;
+        } while ( js->tlen + n > js->tmax );
+        js->tok = trp_realloc( js->tok, js->tmax );
+    }
+    memcpy( js->tok + js->tlen, p, n );
+    js->tlen += n;
+}
+
+static trp_obj_t *trp_json_node( uns8b type, trp_obj_t *val )
+{
+    trp_obj_t *a;
+
+    if ( _trp_json_type[ type ] == NULL ) {
+        static uns8b *names[ 5 ] = { "assoc", "array", "string", "special", "number" };
+
+        _trp_json_type[ type ] = trp_cord( names[ type ] );
+    }
+    a = trp_array_ext_internal( UNDEF, 2, 2 );
+    ((trp_array_t *)a)->data[ 0 ] = _trp_json_type[ type ];
+    ((trp_array_t *)a)->data[ 1 ] = val;
+    return trp_tree( a, NULL );
+}
+
+/*
+ le stringhe si accumulano in tok (possono stare a cavallo di più
+ pezzi); solo quelle con qualche \ passano per unescape
+ */
+
+static trp_obj_t *trp_json_string( trp_json_t *js )
+{
+    trp_obj_t *res;
+    uns8b *q, esc = 0;
+
+    js->tlen = 0;
+    for ( ; ; ) {
+        if ( js->s.p == js->s.e )
+            if ( trp_str_src_fill( &( js->s ) ) )
+                return NULL;
+        q = trp_json_str_end( js->s.p, js->s.e );
+        trp_json_tok( js, js->s.p, (uns32b)( q - js->s.p ) );
+        js->s.p = q;
+        if ( q == js->s.e )
+            continue;
+        js->s.p++;
+        if ( *q == '"' )
+            break;
+        trp_json_tok( js, "\\", 1 );
+        if ( js->s.p == js->s.e )
+            if ( trp_str_src_fill( &( js->s ) ) )
+                return NULL;
+        trp_json_tok( js, js->s.p++, 1 );
+        esc = 1;
+    }
+    trp_json_tok( js, "", 1 );
+    if ( esc ) {
+        if ( ( q = unescape( js->tok, CE_JSON, NULL ) ) == NULL )
+            return NULL;
+        res = trp_cord( q );
+        free( q );
+        return res;
+    }
+    return trp_cord( js->tok );
+}
+
+static trp_obj_t *trp_json_word( trp_json_t *js )
+{
+    for ( js->tlen = 0 ; ; js->s.p++ ) {
+        if ( js->s.p == js->s.e )
+            if ( trp_str_src_fill( &( js->s ) ) )
+                break;
+        if ( ( *( js->s.p ) < 'a' ) || ( *( js->s.p ) > 'z' ) || ( js->tlen == 5 ) )
+            break;
+        trp_json_tok( js, js->s.p, 1 );
+    }
+    if ( ( js->tlen == 4 ) && ( memcmp( js->tok, "true", 4 ) == 0 ) )
+        return TRP_TRUE;
+    if ( ( js->tlen == 5 ) && ( memcmp( js->tok, "false", 5 ) == 0 ) )
+        return TRP_FALSE;
+    if ( ( js->tlen == 4 ) && ( memcmp( js->tok, "null", 4 ) == 0 ) )
+        return NIL;
+    return NULL;
+}
+
+/*
+ gli interi che stanno in un sig64 si convertono subito,
+ gli altri numeri come str->num (quindi razionali esatti)
+ */
+
+static trp_obj_t *trp_json_number( trp_json_t *js )
+{
+    trp_obj_t *res;
+    uns32b i, n;
+    uns8b c, simple;
+
+    for ( js->tlen = 0 ; ; js->s.p++ ) {
+        if ( js->s.p == js->s.e )
+            if ( trp_str_src_fill( &( js->s ) ) )
+                break;
+        c = *( js->s.p );
+        if ( ( ( c < '0' ) || ( c > '9' ) ) &&
+             ( c != '-' ) && ( c != '+' ) && ( c != '.' ) && ( c != 'e' ) && ( c != 'E' ) )
+            break;
+        trp_json_tok( js, js->s.p, 1 );
+    }
+    if ( ( n = js->tlen ) == 0 )
+        return NULL;
+    trp_json_tok( js, "", 1 );
+    i = ( js->tok[ 0 ] == '-' ) ? 1 : 0;
+    simple = ( ( n > i ) && ( n - i <= 18 ) ) ? 1 : 0;
+    for ( ; simple && ( i < n ) ; i++ )
+        if ( ( js->tok[ i ] < '0' ) || ( js->tok[ i ] > '9' ) )
+            simple = 0;
+    if ( simple )
+        return trp_sig64( (sig64b)strtoll( js->tok, NULL, 10 ) );
+    res = trp_cord_str2num( trp_cord( js->tok ) );
+    return ( res == UNDEF ) ? NULL : res;
+}
+
+/*
+ rende NULL in caso di errore
+ */
+
+static trp_obj_t *trp_json_value( trp_json_t *js )
+{
+    trp_obj_t *res, *val, *key, *elem;
+    int c;
+
+    switch ( c = trp_json_peek( js ) ) {
+    case '{':
+        if ( ++( js->depth ) > TRP_JSON_MAX_DEPTH )
+            return NULL;
+        js->s.p++;
+        val = trp_assoc();
+        res = trp_json_node( 0, val );
+        if ( ( c = trp_json_peek( js ) ) != '}' )
+            for ( ; ; ) {
+                if ( c != '"' )
+                    return NULL;
+                js->s.p++;
+                if ( ( key = trp_json_string( js ) ) == NULL )
+                    return NULL;
+                if ( trp_json_peek( js ) != ':' )
+                    return NULL;
+                js->s.p++;
+                if ( ( elem = trp_json_value( js ) ) == NULL )
+                    return NULL;
+                (void)trp_assoc_set( val, key, elem );
+                if ( ( c = trp_json_peek( js ) ) == '}' )
+                    break;
+                if ( c != ',' )
+                    return NULL;
+                js->s.p++;
+                c = trp_json_peek( js );
+            }
+        js->s.p++;
+        js->depth--;
+        return res;
+    case '[':
+        if ( ++( js->depth ) > TRP_JSON_MAX_DEPTH )
+            return NULL;
+        js->s.p++;
+        res = trp_json_node( 1, UNDEF );
+        if ( trp_json_peek( js ) != ']' )
+            for ( ; ; ) {
+                if ( ( elem = trp_json_value( js ) ) == NULL )
+                    return NULL;
+                (void)trp_tree_append( res, elem );
+                if ( ( c = trp_json_peek( js ) ) == ']' )
+                    break;
+                if ( c != ',' )
+                    return NULL;
+                js->s.p++;
+            }
+        js->s.p++;
+        js->depth--;
+        return res;
+    case '"':
+        js->s.p++;
+        if ( ( val = trp_json_string( js ) ) == NULL )
+            return NULL;
+        return trp_json_node( 2, val );
+    case 't':
+    case 'f':
+    case 'n':
+        if ( ( val = trp_json_word( js ) ) == NULL )
+            return NULL;
+        return trp_json_node( 3, val );
+    case -1:
+        return NULL;
+    }
+    if ( ( val = trp_json_number( js ) ) == NULL )
+        return NULL;
+    return trp_json_node( 4, val );
+}
+
+static uns8b trp_json_init( trp_json_t *js, trp_obj_t *obj )
+{
+    js->tok = NULL;
+    js->tlen = js->tmax = 0;
+    js->depth = 0;
+    return trp_str_src_init( &( js->s ), obj );
+}
+
+/*
+ s è un cord, un raw non compresso oppure un file; l'intero testo
+ deve contenere un solo valore; rende UNDEF se non è JSON valido
+ */
+
+trp_obj_t *trp_str_json_parse( trp_obj_t *s )
+{
+    trp_json_t js;
+    trp_obj_t *res;
+
+    if ( trp_json_init( &js, s ) )
+        return UNDEF;
+    res = trp_json_value( &js );
+    if ( res )
+        if ( trp_json_peek( &js ) != -1 )
+            res = NULL;
+    trp_str_src_done( &( js.s ) );
+    free( js.tok );
+    return res ? res : UNDEF;
+}
+
+/*
+ lettura incrementale da file, per testi che non stanno in memoria:
+ ogni chiamata rende il valore successivo al primo livello (un valore
+ per riga, ecc.); se elems è true il file contiene un unico array
+ e se ne rendono gli elementi uno alla volta;
+ rende UNDEF alla fine (e in caso di errore)
+ */
+
+trp_obj_t *trp_str_json_next( trp_obj_t *f, trp_obj_t *elems )
+{
+    trp_json_t js;
+    trp_obj_t *res = NULL;
+    int c;
+
+    if ( f->tipo != TRP_FILE )
+        return UNDEF;
+    (void)trp_json_init( &js, f );
+    c = trp_json_peek( &js );
+    if ( ( elems == NULL ) || ( elems == TRP_FALSE ) ) {
+        if ( c != -1 )
+            res = trp_json_value( &js );
+    } else if ( ( c == '[' ) || ( c == ',' ) ) {
+        js.s.p++;
+        if ( ( c == ',' ) || ( trp_json_peek( &js ) != ']' ) )
+            res = trp_json_value( &js );
+        else
+            js.s.p++;
+    } else if ( c == ']' )
+        js.s.p++;
+    trp_str_src_done( &( js.s ) );
+    free( js.tok );
+    return res ? res : UNDEF;
+}
+
+static void trp_json_put( trp_json_out_t *o, uns8b *s, uns64b n )
+{
+    if ( o->len + n + 1 > o->size ) {
+        do {
+            o->size <<= 1;
+        } while ( o->len + n + 1 > o->size );
+        o->buf = trp_gc_realloc( o->buf, o->size );
+    }
+    memcpy( o->buf + o->len, s, n );
+    o->len += n;
+}
+
+/*
+ vero se nessun carattere va sostituito da escape()
+ */
+
+static uns8b trp_json_clean( uns8b *p, uns32b n )
+{
+    uns8b *e = p + n;
+
+#ifdef __SSE2__
+    {
+        const __m128i lo = _mm_set1_epi8( ' ' ), del = _mm_set1_epi8( 0x7f ),
+                      qu = _mm_set1_epi8( '"' ), bs = _mm_set1_epi8( '\\' );
+        __m128i v;
+
+        /*
+         il confronto è con segno: i byte >= 0x80 risultano < ' '
+         */
+        for ( ; p + 16 <= e ; p += 16 ) {
+            v = _mm_loadu_si128( (const __m128i *)p );
+            if ( _mm_movemask_epi8( _mm_or_si128( _mm_or_si128( _mm_cmplt_epi8( v, lo ),
+                                                                _mm_cmpeq_epi8( v, del ) ),
+                                                  _mm_or_si128( _mm_cmpeq_epi8( v, qu ),
+                                                                _mm_cmpeq_epi8( v, bs ) ) ) ) )
+                return 0;
+        }
+    }
+#endif
+    for ( ; p < e ; p++ )
+        if ( ( *p < ' ' ) || ( *p > '~' ) || ( *p == '"' ) || ( *p == '\\' ) )
+            return 0;
+    return 1;
+}
+
+static uns8b trp_json_put_string( trp_json_out_t *o, trp_obj_t *s )
+{
+    uns8b *p, *e, *q, *d;
+
+    if ( s->tipo == TRP_CHAR ) {
+        s = trp_cord_cons( CORD_chars( ((trp_char_t *)s)->c, 1 ), 1 );
+    } else if ( s->tipo != TRP_CORD )
+        return 1;
+    p = (uns8b *)CORD_to_const_char_star( ((trp_cord_t *)s)->c );
+    trp_json_put( o, "\"", 1 );
+    if ( trp_json_clean( p, ((trp_cord_t *)s)->len ) ) {
+        trp_json_put( o, p, ((trp_cord_t *)s)->len );
+    } else {
+        /*
+         escape() si ferma al primo NUL: i tratti fra due NUL
+         vengono passati separatamente
+         */
+        for ( e = p + ((trp_cord_t *)s)->len ; ; p = q + 1 ) {
+            if ( ( q = memchr( p, 0, e - p ) ) == NULL )
+                q = e;
+            if ( ( d = escape( p, CE_JSON ) ) == NULL )
+                return 1;
+            trp_json_put( o, d, strlen( d ) );
+            free( d );
+            if ( q == e )
+                break;
+            trp_json_put( o, "\\u0000", 6 );
+        }
+    }
+    trp_json_put( o, "\"", 1 );
+    return 0;
+}
+
+static uns8b trp_json_put_print( trp_json_out_t *o, trp_obj_t *obj )
+{
+    uns8b *p = trp_csprint( obj );
+
+    trp_json_put( o, p, strlen( p ) );
+    trp_csprint_free( p );
+    return 0;
+}
+
+/*
+ i razionali con denominatore 2^a*5^b (tutti quelli letti dal parser)
+ si scrivono come decimali esatti, gli altri come double con 17 cifre
+ significative (rilette danno lo stesso double);
+ fallisce se il valore non è un double finito
+ */
+
+static uns8b trp_json_put_ratio( trp_json_out_t *o, trp_ratio_t *obj )
+{
+    mpz_t t, f;
+    uns8b *buf;
+    int len;
+    uns32b a, b, k;
+    flt64b d;
+    uns8b tmp[ 32 ];
+
+    mpz_init( t );
+    mpz_init_set_ui( f, 2 );
+    a = mpz_remove( t, mpq_denref( obj->val ), f );
+    mpz_set_ui( f, 5 );
+    b = mpz_remove( t, t, f );
+    if ( mpz_cmp_ui( t, 1 ) == 0 ) {
+        k = ( a > b ) ? a : b;
+        mpz_ui_pow_ui( t, 2, k - a );
+        mpz_ui_pow_ui( f, 5, k - b );
+        mpz_mul( t, t, f );
+        mpz_mul( t, t, mpq_numref( obj->val ) );
+        if ( mpz_sgn( t ) < 0 ) {
+            trp_json_put( o, "-", 1 );
+            mpz_neg( t, t );
+        }
+        len = gmp_asprintf( (char **)&buf, "%Zd", t );
+        mpz_clear( f );
+        mpz_clear( t );
+        if ( len <= k ) {
+            trp_json_put( o, "0.", 2 );
+            for ( ; len < k ; k-- )
+                trp_json_put( o, "0", 1 );
+            trp_json_put( o, buf, len );
+        } else {
+            trp_json_put( o, buf, len - k );
+            trp_json_put( o, ".", 1 );
+            trp_json_put( o, buf + len - k, k );
+        }
+        trp_gc_free( buf );
+        return 0;
+    }
+    mpz_clear( f );
+    mpz_clear( t );
+    d = mpq_get_d( obj->val );
+    if ( !isfinite( d ) )
+        return 1;
+    len = snprintf( tmp, sizeof( tmp ), "%.17g", d );
+    trp_json_put( o, tmp, len );
+    return 0;
+}
+
+static uns8b trp_json_dump_assoc( trp_json_out_t *o, trp_obj_t *a, uns32b depth )
+{
+    trp_obj_t *q, *kv;
+    uns32b i, n;
+
+    q = trp_assoc_queue( a );
+    n = ((trp_queue_t *)q)->len;
+    trp_json_put( o, "{", 1 );
+    for ( i = 0 ; i < n ; i++ ) {
+        kv = trp_queue_get( q );
+        if ( i )
+            trp_json_put( o, ",", 1 );
+        if ( trp_json_put_string( o, ((trp_cons_t *)kv)->car ) )
+            return 1;
+        trp_json_put( o, ":", 1 );
+        if ( trp_json_dump_low( o, ((trp_cons_t *)kv)->cdr, depth ) )
+            return 1;
+    }
+    trp_json_put( o, "}", 1 );
+    return 0;
+}
+
+/*
+ oltre agli alberi prodotti dal parser si accettano direttamente
+ assoc, array, liste, stringhe, numeri, true, false e nil
+ */
+
+static uns8b trp_json_dump_low( trp_json_out_t *o, trp_obj_t *obj, uns32b depth )
+{
+    trp_obj_t *val;
+    CORD type;
+    uns32b i, n;
+
+    if ( ++depth > TRP_JSON_MAX_DEPTH )
+        return 1;
+    if ( obj == TRP_TRUE ) {
+        trp_json_put( o, "true", 4 );
+        return 0;
+    }
+    if ( obj == TRP_FALSE ) {
+        trp_json_put( o, "false", 5 );
+        return 0;
+    }
+    if ( obj == NIL ) {
+        trp_json_put( o, "null", 4 );
+        return 0;
+    }
+    switch ( obj->tipo ) {
+    case TRP_TREE:
+        val = ((trp_tree_t *)obj)->val;
+        if ( ( val->tipo != TRP_ARRAY ) || ( ((trp_array_t *)val)->len < 2 ) ||
+             ( ((trp_array_t *)val)->data[ 0 ]->tipo != TRP_CORD ) )
+            return 1;
+        type = ((trp_cord_t *)( ((trp_array_t *)val)->data[ 0 ] ))->c;
+        val = ((trp_array_t *)val)->data[ 1 ];
+        if ( CORD_cmp( type, "assoc" ) == 0 ) {
+            if ( val->tipo != TRP_ASSOC )
+                return 1;
+            return trp_json_dump_assoc( o, val, depth );
+        }
+        if ( CORD_cmp( type, "array" ) == 0 ) {
+            n = ((trp_tree_t *)obj)->children->len;
+            trp_json_put( o, "[", 1 );
+            for ( i = 0 ; i < n ; i++ ) {
+                if ( i )
+                    trp_json_put( o, ",", 1 );
+                if ( trp_json_dump_low( o, ((trp_tree_t *)obj)->children->data[ i ], depth ) )
+                    return 1;
+            }
+            trp_json_put( o, "]", 1 );
+            return 0;
+        }
+        if ( CORD_cmp( type, "string" ) == 0 )
+            return trp_json_put_string( o, val );
+        if ( CORD_cmp( type, "special" ) == 0 ) {
+            if ( ( val != TRP_TRUE ) && ( val != TRP_FALSE ) && ( val != NIL ) )
+                return 1;
+            return trp_json_dump_low( o, val, depth );
+        }
+        if ( CORD_cmp( type, "number" ) == 0 )
+            return trp_json_dump_low( o, val, depth );
+        return 1;
+    case TRP_ASSOC:
+        return trp_json_dump_assoc( o, obj, depth );
+    case TRP_ARRAY:
+        n = ((trp_array_t *)obj)->len;
+        trp_json_put( o, "[", 1 );
+        for ( i = 0 ; i < n ; i++ ) {
+            if ( i )
+                trp_json_put( o, ",", 1 );
+            if ( trp_json_dump_low( o, ((trp_array_t *)obj)->data[ i ], depth ) )
+                return 1;
+        }
+        trp_json_put( o, "]", 1 );
+        return 0;
+    case TRP_CONS:
+        trp_json_put( o, "[", 1 );
+        for ( i = 0 ; obj->tipo == TRP_CONS ; obj = ((trp_cons_t *)obj)->cdr, i++ ) {
+            if ( i )
+                trp_json_put( o, ",", 1 );
+            if ( trp_json_dump_low( o, ((trp_cons_t *)obj)->car, depth ) )
+                return 1;
+        }
+        if ( obj != NIL )
+            return 1;
+        trp_json_put( o, "]", 1 );
+        return 0;
+    case TRP_CORD:
+    case TRP_CHAR:
+        return trp_json_put_string( o, obj );
+    case TRP_SIG64:
+    case TRP_MPI:
+        return trp_json_put_print( o, obj );
+    case TRP_RATIO:
+        return trp_json_put_ratio( o, (trp_ratio_t *)obj );
+    }
+    return 1;
+}
+
+trp_obj_t *trp_str_json_dump( trp_obj_t *obj )
+{
+    trp_json_out_t o;
+
+    o.size = 4096;
+    o.len = 0;
+    o.buf = trp_gc_malloc_atomic( o.size );
+    if ( trp_json_dump_low( &o, obj, 0 ) || ( o.len > 0xffffffff ) ) {
+        trp_gc_free( o.buf );
+        return UNDEF;
+    }
+    o.buf[ o.len ] = 0;
+    if ( o.size - o.len > 4096 )
+        o.buf = trp_gc_realloc( o.buf, o.len + 1 );
+    return trp_cord_cons( (CORD)( o.buf ), o.len );
+}
@@ -0,0 +1,120 @@
+/*
+    TreeP Run Time Support
+    Copyright (C) 2008-2026 Frank Sinapsi
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../trp/trp.h"
+#include "./src.h"
+
+/*
+ obj è un cord, un raw non compresso oppure un file aperto in lettura;
+ un cord piatto si legge in un colpo solo, gli altri foglia per foglia
+ */
+
+uns8b trp_str_src_init( trp_str_src_t *src, trp_obj_t *obj )
+{
+    src->p = src->e = src->base = NULL;
+    src->f = NULL;
+    src->mode = 0;
+    switch ( obj->tipo ) {
+    case TRP_CORD:
+        if ( ((trp_cord_t *)obj)->len == 0 )
+            break;
+        if ( CORD_IS_STRING( ((trp_cord_t *)obj)->c ) ) {
+            src->p = src->base = (uns8b *)( ((trp_cord_t *)obj)->c );
+            src->e = src->p + ((trp_cord_t *)obj)->len;
+        } else {
+            src->mode = 1;
+            CORD_set_pos( src->pos, ((trp_cord_t *)obj)->c, 0 );
+        }
+        break;
+    case TRP_RAW:
+        if ( ((trp_raw_t *)obj)->mode )
+            return 1;
+        src->p = src->base = ((trp_raw_t *)obj)->data;
+        src->e = src->p + ((trp_raw_t *)obj)->len;
+        break;
+    case TRP_FILE:
+        src->mode = 2;
+        src->f = obj;
+        break;
+    default:
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ passa al pezzo successivo; rende 1 alla fine del testo
+ */
+
+uns8b trp_str_src_fill( trp_str_src_t *src )
+{
+    extern uns8b *trp_file_peek_internal( trp_obj_t *stream, uns32b *n );
+    extern void trp_file_skip_internal( trp_obj_t *stream, uns32b n );
+    long l;
+    uns32b n;
+
+    switch ( src->mode ) {
+    case 1:
+        if ( !CORD_pos_valid( src->pos ) )
+            return 1;
+        if ( src->base == &( src->cs ) ) {
+            CORD_next( src->pos );
+        } else if ( src->base ) {
+            CORD_pos_advance( src->pos, (size_t)( src->e - src->base ) );
+        }
+        if ( !CORD_pos_valid( src->pos ) ) {
+            src->base = src->p = src->e = NULL;
+            return 1;
+        }
+        if ( ( l = CORD_pos_chars_left( src->pos ) ) > 0 ) {
+            src->base = (uns8b *)CORD_pos_cur_char_addr( src->pos );
+            n = (uns32b)l;
+        } else {
+            src->cs = CORD_pos_fetch( src->pos );
+            src->base = &( src->cs );
+            n = 1;
+        }
+        break;
+    case 2:
+        if ( src->base )
+            trp_file_skip_internal( src->f, (uns32b)( src->e - src->base ) );
+        if ( ( src->base = trp_file_peek_internal( src->f, &n ) ) == NULL ) {
+            src->p = src->e = NULL;
+            return 1;
+        }
+        break;
+    default:
+        return 1;
+    }
+    src->p = src->base;
+    src->e = src->base + n;
+    return 0;
+}
+
+/*
+ per i file: consuma quanto letto, lasciando il resto
+ alla lettura successiva
+ */
+
+void trp_str_src_done( trp_str_src_t *src )
+{
+    extern void trp_file_skip_internal( trp_obj_t *stream, uns32b n );
+
+    if ( ( src->mode == 2 ) && src->base )
+        trp_file_skip_internal( src->f, (uns32b)( src->p - src->base ) );
+}
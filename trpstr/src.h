@@ -0,0 +1,43 @@
+/*
+    TreeP Run Time Support
+    Copyright (C) 2008-2026 Frank Sinapsi
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __trpstr_src__h
+#define __trpstr_src__h
+
+/*
+ testo in ingresso ai parser, letto a pezzi: tutto insieme
+ (stringa piatta o raw), foglia per foglia (cord) oppure dal
+ buffer di lettura di un file; p..e è il pezzo corrente,
+ base il suo inizio
+ */
+
+typedef struct {
+    uns8b *p;
+    uns8b *e;
+    uns8b *base;
+    trp_obj_t *f;
+    CORD_pos pos;
+    uns8b mode;
+    uns8b cs;
+} trp_str_src_t;
+
+uns8b trp_str_src_init( trp_str_src_t *src, trp_obj_t *obj );
+uns8b trp_str_src_fill( trp_str_src_t *src );
+void trp_str_src_done( trp_str_src_t *src );
+
+#endif /* !__trpstr_src__h */
@@ -29,5 +29,11 @@ trp_obj_t *trp_str_encode_url( trp_obj_t *s, ... );
 trp_obj_t *trp_str_json_unescape( trp_obj_t *s, ... );
 trp_obj_t *trp_str_json_escape( trp_obj_t *s, ... );
 trp_obj_t *trp_str_fields( trp_obj_t *s, trp_obj_t *sep );
+trp_obj_t *trp_str_json_parse( trp_obj_t *s );
+trp_obj_t *trp_str_json_next( trp_obj_t *f, trp_obj_t *elems );
+trp_obj_t *trp_str_json_dump( trp_obj_t *obj );
+trp_obj_t *trp_str_xml_parse( trp_obj_t *s );
+trp_obj_t *trp_str_xml_next( trp_obj_t *f );
+trp_obj_t *trp_str_xml_attributes( trp_obj_t *s );
 
 #endif /* !__trpstr__h */
@@ -0,0 +1,686 @@
+/*
+    TreeP Run Time Support
+    Copyright (C) 2008-2026 Frank Sinapsi
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../trp/trp.h"
+#include "./trpstr.h"
+#include "./entities.h"
+#include "./src.h"
+
+/*
+ tokenizzatore XML/HTML in un solo passaggio; l'albero costruito
+ è lo stesso di xml-parse in common-xml.tin: la radice è il tag
+ "fake" e ogni nodo è un tree il cui valore è l'array
+ [ tipo campo1 campo2 campo3 ]
+ */
+
+#define TRP_XML_EOF     0
+#define TRP_XML_TEXT    1
+#define TRP_XML_OPEN    2
+#define TRP_XML_END     3
+#define TRP_XML_COMMENT 4
+#define TRP_XML_SPECIAL 5
+
+#define TRP_XML_NAMES 1024
+#define TRP_XML_NAME_MAX 32
+
+#define TRP_XML_WS(c) (((c)==' ')||((c)=='\t')||((c)=='\r')||((c)=='\n'))
+#define TRP_XML_LOWER(c) ((((c)>='A')&&((c)<='Z'))?(c)+('a'-'A'):(c))
+
+typedef struct {
+    uns8b *b;
+    uns32b len;
+    uns32b max;
+} trp_xml_buf_t;
+
+typedef struct {
+    trp_str_src_t s;
+    trp_xml_buf_t tok;
+    trp_xml_buf_t txt;
+    trp_xml_buf_t nm;
+    uns8b special;
+    uns8b sc;
+} trp_xml_t;
+
+typedef struct {
+    trp_obj_t *name;
+    trp_obj_t *node;
+    uns8b vd;
+} trp_xml_open_t;
+
+static trp_obj_t *_trp_xml_const[ 9 ] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+static trp_obj_t *_trp_xml_names[ TRP_XML_NAMES ];
+
+static trp_obj_t *trp_xml_const( uns8b i );
+static trp_obj_t *trp_xml_intern( uns8b *p, uns32b n );
+static void trp_xml_put( trp_xml_buf_t *b, uns8b *p, uns32b n );
+static uns8b *trp_xml_str( trp_xml_buf_t *b );
+static trp_obj_t *trp_xml_cord( trp_xml_buf_t *b );
+static trp_obj_t *trp_xml_text( trp_xml_buf_t *b );
+static trp_obj_t *trp_xml_local( trp_xml_t *x );
+static void trp_xml_utf8_lower( trp_xml_buf_t *b );
+static uns8b trp_xml_same( trp_obj_t *name, trp_xml_buf_t *b );
+static uns8b trp_xml_void( uns8b *p, uns32b n );
+static uns8b trp_xml_rawtag( uns8b *p, uns32b n );
+static int trp_xml_cur( trp_xml_t *x );
+static void trp_xml_take( trp_xml_t *x );
+static uns8b trp_xml_match( trp_xml_t *x, uns8b *s );
+static uns8b trp_xml_until( trp_xml_t *x, uns8b *term, uns32b n );
+static int trp_xml_tag( trp_xml_t *x );
+static int trp_xml_token( trp_xml_t *x );
+static uns8b trp_xml_raw( trp_xml_t *x, uns8b *name );
+static trp_obj_t *trp_xml_array( uns32b n, ... );
+static trp_obj_t *trp_xml_node( trp_obj_t *type, trp_obj_t *f1, trp_obj_t *f2, trp_obj_t *f3 );
+static trp_obj_t *trp_xml_build( trp_xml_t *x );
+static uns8b trp_xml_init( trp_xml_t *x, trp_obj_t *obj );
+static void trp_xml_close( trp_xml_t *x );
+
+static trp_obj_t *trp_xml_const( uns8b i )
+{
+    if ( _trp_xml_const[ i ] == NULL ) {
+        static uns8b *names[ 9 ] = { "[text]", "[tag]", "[comment]", "[raw]", "[end]",
+                                     "fake", "!DOCTYPE", "![", "?xml" };
+
+        _trp_xml_const[ i ] = trp_cord( names[ i ] );
+    }
+    return _trp_xml_const[ i ];
+}
+
+/*
+ i nomi di tag e attributi si ripetono: una piccola cache
+ a indirizzamento diretto evita di ricostruirli ogni volta;
+ p[ n ] deve essere 0
+ */
+
+static trp_obj_t *trp_xml_intern( uns8b *p, uns32b n )
+{
+    trp_obj_t *e;
+    uns32b h = 2166136261U, i;
+
+    if ( n == 0 )
+        return EMPTYCORD;
+    if ( n > TRP_XML_NAME_MAX )
+        return trp_cord( p );
+    for ( i = 0 ; i < n ; i++ )
+        h = ( h ^ p[ i ] ) * 16777619U;
+    h = ( h ^ ( h >> 16 ) ) & ( TRP_XML_NAMES - 1 );
+    e = _trp_xml_names[ h ];
+    if ( e )
+        if ( ( ((trp_cord_t *)e)->len == n ) &&
+             ( memcmp( ((trp_cord_t *)e)->c, p, n ) == 0 ) )
+            return e;
+    e = trp_cord( p );
+    _trp_xml_names[ h ] = e;
+    return e;
+}
+
+static void trp_xml_put( trp_xml_buf_t *b, uns8b *p, uns32b n )
+{
+    if ( n == 0 )
+        return;
+    if ( b->len + n > b->max ) {
+        do {
+            b->max = b->max ? b->max << 1 : 256;
+        } while ( b->len + n > b->max );
+        b->b = trp_realloc( b->b, b->max );
+    }
+    memcpy( b->b + b->len, p, n );
+    b->len += n;
+}
+
+static uns8b *trp_xml_str( trp_xml_buf_t *b )
+{
+    trp_xml_put( b, "", 1 );
+    b->len--;
+    return b->b;
+}
+
+static trp_obj_t *trp_xml_cord( trp_xml_buf_t *b )
+{
+    return trp_cord( trp_xml_str( b ) );
+}
+
+/*
+ le entità si decodificano sul posto, e solo se c'è qualche &;
+ il buffer viene svuotato
+ */
+
+static trp_obj_t *trp_xml_text( trp_xml_buf_t *b )
+{
+    uns8b *p = trp_xml_str( b );
+
+    if ( memchr( p, '&', b->len ) )
+        (void)decode_html_entities_utf8( p, NULL );
+    b->len = 0;
+    return trp_cord( p );
+}
+
+/*
+ nome senza l'eventuale prefisso del namespace
+ */
+
+static trp_obj_t *trp_xml_local( trp_xml_t *x )
+{
+    uns8b *q;
+
+    if ( ( q = memchr( x->nm.b, ':', x->nm.len ) ) == NULL )
+        return trp_xml_intern( x->nm.b, x->nm.len );
+    q++;
+    return trp_xml_intern( q, x->nm.len - (uns32b)( q - x->nm.b ) );
+}
+
+/*
+ i nomi sono già in minuscolo per la parte ASCII; se ci sono
+ altri caratteri si usa utf8-tolower, come in xml-parse-tags
+ */
+
+static void trp_xml_utf8_lower( trp_xml_buf_t *b )
+{
+    trp_obj_t *l;
+    uns8b *p;
+    uns32b i;
+
+    for ( i = 0 ; ( i < b->len ) && ( b->b[ i ] < 0x80 ) ; i++ );
+    if ( i == b->len )
+        return;
+    l = trp_cord_utf8_tolower( trp_cord( trp_xml_str( b ) ), NULL );
+    if ( l == UNDEF )
+        return;
+    p = trp_csprint( l );
+    b->len = 0;
+    trp_xml_put( b, p, strlen( p ) );
+    trp_csprint_free( p );
+}
+
+static uns8b trp_xml_same( trp_obj_t *name, trp_xml_buf_t *b )
+{
+    if ( ((trp_cord_t *)name)->len != b->len )
+        return 0;
+    return ( memcmp( ((trp_cord_t *)name)->c, b->b, b->len ) == 0 ) ? 1 : 0;
+}
+
+/*
+ tag che di solito non vengono chiusi (style, come script,
+ è trattato a parte)
+ */
+
+static uns8b trp_xml_void( uns8b *p, uns32b n )
+{
+    static uns8b *voids[] = { "meta", "source", "base", "link", "img",
+                              "input", "col", "br", "hr", NULL };
+    uns32b i;
+
+    for ( i = 0 ; voids[ i ] ; i++ )
+        if ( ( strlen( voids[ i ] ) == n ) && ( memcmp( voids[ i ], p, n ) == 0 ) )
+            return 1;
+    return 0;
+}
+
+static uns8b trp_xml_rawtag( uns8b *p, uns32b n )
+{
+    return ( ( ( n == 6 ) && ( memcmp( p, "script", 6 ) == 0 ) ) ||
+             ( ( n == 5 ) && ( memcmp( p, "style", 5 ) == 0 ) ) ) ? 1 : 0;
+}
+
+static int trp_xml_cur( trp_xml_t *x )
+{
+    if ( x->s.p == x->s.e )
+        if ( trp_str_src_fill( &( x->s ) ) )
+            return -1;
+    return (int)( *( x->s.p ) );
+}
+
+static void trp_xml_take( trp_xml_t *x )
+{
+    trp_xml_put( &( x->tok ), x->s.p, 1 );
+    x->s.p++;
+}
+
+/*
+ consuma i caratteri finché coincidono con s (minuscola),
+ senza distinguere maiuscole e minuscole; rende 1 se non
+ arriva in fondo a s
+ */
+
+static uns8b trp_xml_match( trp_xml_t *x, uns8b *s )
+{
+    int c;
+
+    for ( ; *s ; s++ ) {
+        if ( ( c = trp_xml_cur( x ) ) == -1 )
+            return 1;
+        if ( TRP_XML_LOWER( c ) != *s )
+            return 1;
+        trp_xml_take( x );
+    }
+    return 0;
+}
+
+/*
+ accumula in tok fino a term compreso (tutti i terminatori
+ finiscono con >); rende 1 alla fine del testo
+ */
+
+static uns8b trp_xml_until( trp_xml_t *x, uns8b *term, uns32b n )
+{
+    uns8b *q;
+
+    for ( ; ; ) {
+        if ( x->s.p == x->s.e )
+            if ( trp_str_src_fill( &( x->s ) ) )
+                return 1;
+        if ( ( q = memchr( x->s.p, '>', x->s.e - x->s.p ) ) == NULL ) {
+            trp_xml_put( &( x->tok ), x->s.p, (uns32b)( x->s.e - x->s.p ) );
+            x->s.p = x->s.e;
+            continue;
+        }
+        q++;
+        trp_xml_put( &( x->tok ), x->s.p, (uns32b)( q - x->s.p ) );
+        x->s.p = q;
+        if ( x->tok.len >= n )
+            if ( memcmp( x->tok.b + x->tok.len - n, term, n ) == 0 )
+                return 0;
+    }
+}
+
+/*
+ siamo su un <; il tag letto resta in tok, il nome normalizzato
+ in nm; se non è un tag valido rende TRP_XML_TEXT e quanto
+ consumato (mai un altro <) va trattato come testo
+ */
+
+static int trp_xml_tag( trp_xml_t *x )
+{
+    uns8b *p, cc;
+    uns32b n;
+    int c;
+
+    x->tok.len = 0;
+    x->nm.len = 0;
+    trp_xml_take( x );
+    c = trp_xml_cur( x );
+    if ( c == '/' ) {
+        trp_xml_take( x );
+        if ( trp_xml_until( x, ">", 1 ) )
+            return TRP_XML_TEXT;
+        p = x->tok.b + 2;
+        n = x->tok.len - 3;
+        for ( ; n && TRP_XML_WS( *p ) ; p++, n-- );
+        for ( ; n && TRP_XML_WS( p[ n - 1 ] ) ; n-- );
+        for ( ; n ; p++, n-- ) {
+            cc = ( ( *p == '\r' ) || ( *p == '\n' ) ) ? ' ' : TRP_XML_LOWER( *p );
+            trp_xml_put( &( x->nm ), &cc, 1 );
+        }
+        trp_xml_utf8_lower( &( x->nm ) );
+        (void)trp_xml_str( &( x->nm ) );
+        return TRP_XML_END;
+    }
+    if ( c == '!' ) {
+        trp_xml_take( x );
+        c = trp_xml_cur( x );
+        if ( c == '-' ) {
+            trp_xml_take( x );
+            if ( trp_xml_match( x, "-" ) || trp_xml_until( x, "-->", 3 ) )
+                return TRP_XML_TEXT;
+            return TRP_XML_COMMENT;
+        }
+        if ( c == '[' ) {
+            trp_xml_take( x );
+            if ( trp_xml_until( x, "]>", 2 ) )
+                return TRP_XML_TEXT;
+            x->special = 7;
+            return TRP_XML_SPECIAL;
+        }
+        if ( trp_xml_match( x, "doctype" ) || trp_xml_until( x, ">", 1 ) )
+            return TRP_XML_TEXT;
+        x->special = 6;
+        return TRP_XML_SPECIAL;
+    }
+    if ( c == '?' ) {
+        trp_xml_take( x );
+        if ( trp_xml_match( x, "xml" ) || trp_xml_until( x, "?>", 2 ) )
+            return TRP_XML_TEXT;
+        x->special = 8;
+        return TRP_XML_SPECIAL;
+    }
+    if ( ( TRP_XML_LOWER( c ) < 'a' ) || ( TRP_XML_LOWER( c ) > 'z' ) )
+        return TRP_XML_TEXT;
+    do {
+        cc = (uns8b)TRP_XML_LOWER( c );
+        trp_xml_put( &( x->nm ), &cc, 1 );
+        trp_xml_take( x );
+        c = trp_xml_cur( x );
+    } while ( ( ( TRP_XML_LOWER( c ) >= 'a' ) && ( TRP_XML_LOWER( c ) <= 'z' ) ) ||
+              ( ( c >= '0' ) && ( c <= '9' ) ) || ( c == ':' ) || ( c == '-' ) );
+    if ( !TRP_XML_WS( c ) && ( c != '/' ) && ( c != '>' ) )
+        return TRP_XML_TEXT;
+    if ( trp_xml_until( x, ">", 1 ) )
+        return TRP_XML_TEXT;
+    (void)trp_xml_str( &( x->nm ) );
+    for ( n = x->tok.len - 1 ; TRP_XML_WS( x->tok.b[ n - 1 ] ) ; n-- );
+    x->sc = ( x->tok.b[ n - 1 ] == '/' ) ? 1 : 0;
+    return TRP_XML_OPEN;
+}
+
+/*
+ il testo si accumula in txt (dopo quanto già c'era) e si ferma
+ prima di ogni <, senza sapere se apre un tag valido
+ */
+
+static int trp_xml_token( trp_xml_t *x )
+{
+    uns8b *q;
+    uns32b start = x->txt.len;
+    int t;
+
+    for ( ; ; ) {
+        if ( x->s.p == x->s.e )
+            if ( trp_str_src_fill( &( x->s ) ) )
+                return ( x->txt.len > start ) ? TRP_XML_TEXT : TRP_XML_EOF;
+        if ( *( x->s.p ) == '<' ) {
+            if ( x->txt.len > start )
+                return TRP_XML_TEXT;
+            if ( ( t = trp_xml_tag( x ) ) != TRP_XML_TEXT )
+                return t;
+            trp_xml_put( &( x->txt ), x->tok.b, x->tok.len );
+            continue;
+        }
+        if ( ( q = memchr( x->s.p, '<', x->s.e - x->s.p ) ) == NULL )
+            q = x->s.e;
+        trp_xml_put( &( x->txt ), x->s.p, (uns32b)( q - x->s.p ) );
+        x->s.p = q;
+    }
+}
+
+/*
+ contenuto di script e style: tutto testo fino a </name>;
+ il corpo va in txt, il tag di chiusura in tok
+ */
+
+static uns8b trp_xml_raw( trp_xml_t *x, uns8b *name )
+{
+    uns8b *q;
+    int c;
+
+    for ( ; ; ) {
+        if ( x->s.p == x->s.e )
+            if ( trp_str_src_fill( &( x->s ) ) )
+                return 1;
+        if ( *( x->s.p ) != '<' ) {
+            if ( ( q = memchr( x->s.p, '<', x->s.e - x->s.p ) ) == NULL )
+                q = x->s.e;
+            trp_xml_put( &( x->txt ), x->s.p, (uns32b)( q - x->s.p ) );
+            x->s.p = q;
+            continue;
+        }
+        x->tok.len = 0;
+        trp_xml_take( x );
+        if ( ( trp_xml_match( x, "/" ) == 0 ) && ( trp_xml_match( x, name ) == 0 ) ) {
+            while ( ( c = trp_xml_cur( x ) ) != -1 ) {
+                if ( !TRP_XML_WS( c ) )
+                    break;
+                trp_xml_take( x );
+            }
+            if ( c == '>' ) {
+                trp_xml_take( x );
+                return 0;
+            }
+        }
+        trp_xml_put( &( x->txt ), x->tok.b, x->tok.len );
+    }
+}
+
+static trp_obj_t *trp_xml_array( uns32b n, ... )
+{
+    trp_obj_t *a;
+    uns32b i;
+    va_list args;
+
+    a = trp_array_ext_internal( UNDEF, n, n );
+    va_start( args, n );
+    for ( i = 0 ; i < n ; i++ )
+        ((trp_array_t *)a)->data[ i ] = va_arg( args, trp_obj_t * );
+    va_end( args );
+    return a;
+}
+
+static trp_obj_t *trp_xml_node( trp_obj_t *type, trp_obj_t *f1, trp_obj_t *f2, trp_obj_t *f3 )
+{
+    return trp_tree( trp_xml_array( 4, type, f1, f2, f3 ), NULL );
+}
+
+/*
+ pila dei tag aperti come in xml-parse-tags: i tag vuoti (br, img...)
+ restano in pila finché non arriva il tag di chiusura (e allora hanno
+ figli) o un altro tag (e allora si scartano); rende NULL se i tag
+ non sono bilanciati
+ */
+
+static trp_obj_t *trp_xml_build( trp_xml_t *x )
+{
+    trp_xml_open_t *st = NULL;
+    trp_obj_t *root, *parent, *node;
+    uns32b sp = 0, smax = 0, i;
+    int t;
+
+    root = trp_xml_node( trp_xml_const( 1 ), trp_xml_const( 5 ), EMPTYCORD, EMPTYCORD );
+    for ( ; ; ) {
+        if ( ( t = trp_xml_token( x ) ) == TRP_XML_TEXT )
+            continue;
+        if ( t == TRP_XML_END ) {
+            for ( i = sp ; i ; i-- )
+                if ( ( st[ i - 1 ].vd == 0 ) || trp_xml_same( st[ i - 1 ].name, &( x->nm ) ) )
+                    break;
+            if ( i == 0 ) {
+                sp = 0;
+                trp_xml_put( &( x->txt ), x->tok.b, x->tok.len );
+                continue;
+            }
+            if ( trp_xml_same( st[ i - 1 ].name, &( x->nm ) ) == 0 )
+                return NULL;
+            sp = i - 1;
+            if ( x->txt.len )
+                (void)trp_tree_append( st[ sp ].node, trp_xml_node( trp_xml_const( 0 ), trp_xml_text( &( x->txt ) ), UNDEF, UNDEF ) );
+            ((trp_array_t *)trp_tree_get( st[ sp ].node ))->data[ 3 ] = trp_xml_cord( &( x->tok ) );
+            continue;
+        }
+        while ( sp && st[ sp - 1 ].vd )
+            sp--;
+        parent = sp ? st[ sp - 1 ].node : root;
+        if ( x->txt.len )
+            (void)trp_tree_append( parent, trp_xml_node( trp_xml_const( 0 ), trp_xml_text( &( x->txt ) ), UNDEF, UNDEF ) );
+        if ( t == TRP_XML_EOF )
+            break;
+        if ( t == TRP_XML_COMMENT )
+            node = trp_xml_node( trp_xml_const( 2 ), trp_xml_cord( &( x->tok ) ), UNDEF, UNDEF );
+        else
+            node = trp_xml_node( trp_xml_const( 1 ),
+                                 ( t == TRP_XML_SPECIAL ) ? trp_xml_const( x->special ) : trp_xml_local( x ),
+                                 trp_xml_cord( &( x->tok ) ), EMPTYCORD );
+        (void)trp_tree_append( parent, node );
+        if ( ( t != TRP_XML_OPEN ) || x->sc )
+            continue;
+        if ( trp_xml_rawtag( x->nm.b, x->nm.len ) ) {
+            if ( trp_xml_raw( x, x->nm.b ) ) {
+                /*
+                 come in xml-parse-tags uno style non chiuso è
+                 tollerato: il resto del testo segue come testo
+                 */
+                if ( x->nm.len != 5 )
+                    return NULL;
+                if ( x->txt.len )
+                    (void)trp_tree_append( parent, trp_xml_node( trp_xml_const( 0 ), trp_xml_text( &( x->txt ) ), UNDEF, UNDEF ) );
+                continue;
+            }
+            if ( x->txt.len ) {
+                (void)trp_tree_append( node, trp_xml_node( trp_xml_const( 3 ), trp_xml_cord( &( x->txt ) ), UNDEF, UNDEF ) );
+                x->txt.len = 0;
+            }
+            ((trp_array_t *)trp_tree_get( node ))->data[ 3 ] = trp_xml_cord( &( x->tok ) );
+            continue;
+        }
+        if ( sp == smax ) {
+            smax = smax ? smax << 1 : 32;
+            st = trp_gc_realloc( st, sizeof( trp_xml_open_t ) * smax );
+        }
+        st[ sp ].name = trp_xml_intern( x->nm.b, x->nm.len );
+        st[ sp ].node = node;
+        st[ sp ].vd = trp_xml_void( x->nm.b, x->nm.len );
+        sp++;
+    }
+    return sp ? NULL : root;
+}
+
+static uns8b trp_xml_init( trp_xml_t *x, trp_obj_t *obj )
+{
+    memset( &( x->tok ), 0, sizeof( trp_xml_buf_t ) );
+    memset( &( x->txt ), 0, sizeof( trp_xml_buf_t ) );
+    memset( &( x->nm ), 0, sizeof( trp_xml_buf_t ) );
+    return trp_str_src_init( &( x->s ), obj );
+}
+
+static void trp_xml_close( trp_xml_t *x )
+{
+    trp_str_src_done( &( x->s ) );
+    free( x->tok.b );
+    free( x->txt.b );
+    free( x->nm.b );
+}
+
+/*
+ s è un cord, un raw non compresso oppure un file;
+ rende UNDEF se i tag non sono bilanciati
+ */
+
+trp_obj_t *trp_str_xml_parse( trp_obj_t *s )
+{
+    trp_xml_t x;
+    trp_obj_t *res;
+
+    if ( trp_xml_init( &x, s ) )
+        return UNDEF;
+    res = trp_xml_build( &x );
+    trp_xml_close( &x );
+    return res ? res : UNDEF;
+}
+
+/*
+ lettura incrementale da file (SAX): ogni chiamata rende l'evento
+ successivo, senza costruire l'albero:
+ [ "[text]" testo ], [ "[comment]" commento ],
+ [ "[tag]" nome tag-beg ], [ "[end]" nome tag-end ];
+ script e style si leggono in un colpo solo:
+ [ "[tag]" nome tag-beg corpo tag-end ] (tag-end vuoto
+ per uno style non chiuso);
+ rende UNDEF alla fine (e in caso di errore)
+ */
+
+trp_obj_t *trp_str_xml_next( trp_obj_t *f )
+{
+    trp_xml_t x;
+    trp_obj_t *res = NULL, *name, *beg;
+
+    if ( f->tipo != TRP_FILE )
+        return UNDEF;
+    (void)trp_xml_init( &x, f );
+    switch ( trp_xml_token( &x ) ) {
+    case TRP_XML_TEXT:
+        res = trp_xml_array( 2, trp_xml_const( 0 ), trp_xml_text( &( x.txt ) ) );
+        break;
+    case TRP_XML_COMMENT:
+        res = trp_xml_array( 2, trp_xml_const( 2 ), trp_xml_cord( &( x.tok ) ) );
+        break;
+    case TRP_XML_SPECIAL:
+        res = trp_xml_array( 3, trp_xml_const( 1 ), trp_xml_const( x.special ), trp_xml_cord( &( x.tok ) ) );
+        break;
+    case TRP_XML_OPEN:
+        name = trp_xml_local( &x );
+        beg = trp_xml_cord( &( x.tok ) );
+        if ( x.sc || ( trp_xml_rawtag( x.nm.b, x.nm.len ) == 0 ) )
+            res = trp_xml_array( 3, trp_xml_const( 1 ), name, beg );
+        else if ( trp_xml_raw( &x, x.nm.b ) == 0 )
+            res = trp_xml_array( 5, trp_xml_const( 1 ), name, beg,
+                                 trp_xml_cord( &( x.txt ) ), trp_xml_cord( &( x.tok ) ) );
+        else if ( x.nm.len == 5 )
+            res = trp_xml_array( 5, trp_xml_const( 1 ), name, beg,
+                                 trp_xml_cord( &( x.txt ) ), EMPTYCORD );
+        break;
+    case TRP_XML_END:
+        res = trp_xml_array( 3, trp_xml_const( 4 ), trp_xml_local( &x ), trp_xml_cord( &( x.tok ) ) );
+        break;
+    }
+    trp_xml_close( &x );
+    return res ? res : UNDEF;
+}
+
+/*
+ attributi di un tag (tag-beg): valori tra virgolette, tra apici,
+ senza delimitatori o assenti (stringa vuota); nomi in minuscolo
+ e valori con le entità decodificate
+ */
+
+trp_obj_t *trp_str_xml_attributes( trp_obj_t *s )
+{
+    trp_xml_buf_t nm, val;
+    trp_obj_t *res;
+    uns8b *p, *q, c;
+
+    if ( s->tipo != TRP_CORD )
+        return UNDEF;
+    res = trp_assoc();
+    if ( ((trp_cord_t *)s)->len == 0 )
+        return res;
+    memset( &nm, 0, sizeof( trp_xml_buf_t ) );
+    memset( &val, 0, sizeof( trp_xml_buf_t ) );
+    p = (uns8b *)CORD_to_const_char_star( ((trp_cord_t *)s)->c );
+    if ( *p == '<' )
+        p++;
+    for ( ; *p && !TRP_XML_WS( *p ) && ( *p != '>' ) && ( *p != '/' ) ; p++ );
+    for ( ; ; ) {
+        for ( ; TRP_XML_WS( *p ) ; p++ );
+        if ( ( *p == '\0' ) || ( *p == '>' ) || ( *p == '/' ) || ( *p == '?' ) )
+            break;
+        for ( nm.len = 0 ; *p && !TRP_XML_WS( *p ) && ( *p != '=' ) && ( *p != '>' ) && ( *p != '/' ) ; p++ ) {
+            c = TRP_XML_LOWER( *p );
+            trp_xml_put( &nm, &c, 1 );
+        }
+        if ( nm.len == 0 ) {
+            p++;
+            continue;
+        }
+        for ( ; TRP_XML_WS( *p ) ; p++ );
+        if ( *p == '=' ) {
+            for ( p++ ; TRP_XML_WS( *p ) ; p++ );
+            if ( ( *p == '"' ) || ( *p == '\'' ) ) {
+                c = *p++;
+                for ( q = p ; *p && ( *p != c ) ; p++ );
+                trp_xml_put( &val, q, (uns32b)( p - q ) );
+                if ( *p )
+                    p++;
+            } else {
+                for ( q = p ; *p && !TRP_XML_WS( *p ) && ( *p != '>' ) &&
+                              ( ( *p != '/' ) || ( p[ 1 ] != '>' ) ) ; p++ );
+                trp_xml_put( &val, q, (uns32b)( p - q ) );
+            }
+        }
+        trp_xml_utf8_lower( &nm );
+        (void)trp_assoc_set( res, trp_xml_intern( trp_xml_str( &nm ), nm.len ), trp_xml_text( &val ) );
+    }
+    free( nm.b );
+    free( val.b );
+    return res;
+}
@@ -32,11 +32,6 @@ typedef struct {
     uns32b *LCP;
 } trp_suf_t;
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
 static uns8b trp_suf_print( trp_print_t *p, trp_suf_t *obj );
 static uns8b trp_suf_close( trp_suf_t *obj );
 static uns8b trp_suf_close_basic( uns8b flags, trp_suf_t *obj );
@@ -447,7 +442,6 @@ static trp_obj_t *trp_suf_lcs_k_low( uns8b flags, trp_obj_t *k, trp_obj_t *s, va
         }
     } else {
         trp_obj_t *t = s;
-        trp_queue_elem *elem;
 
         if ( va_arg( args1, trp_obj_t * ) )
             return UNDEF;
@@ -466,12 +460,10 @@ static trp_obj_t *trp_suf_lcs_k_low( uns8b flags, trp_obj_t *k, trp_obj_t *s, va
             break;
         case TRP_QUEUE:
             N = ((trp_queue_t *)t)->len;
-            for ( elem = (trp_queue_elem *)( ((trp_queue_t *)t)->first ) ;
-                  elem ;
-                  elem = (trp_queue_elem *)( elem->next ) ) {
-                if ( elem->val->tipo != TRP_CORD )
+            for ( j = 0 ; j < N ; j++ ) {
+                if ( trp_queue_nth( j, (trp_queue_t *)t )->tipo != TRP_CORD )
                     return UNDEF;
-                n += ((trp_cord_t *)(elem->val))->len;
+                n += ((trp_cord_t *)trp_queue_nth( j, (trp_queue_t *)t ))->len;
             }
             break;
         case TRP_ARRAY:
@@ -524,7 +516,6 @@ static trp_obj_t *trp_suf_lcs_k_low( uns8b flags, trp_obj_t *k, trp_obj_t *s, va
         }
     } else {
         trp_obj_t *t = s;
-        trp_queue_elem *elem;
         unsigned char *p = T;
         CORD_pos i;
 
@@ -542,14 +533,14 @@ static trp_obj_t *trp_suf_lcs_k_low( uns8b flags, trp_obj_t *k, trp_obj_t *s, va
             }
             break;
         case TRP_QUEUE:
-            for ( elem = (trp_queue_elem *)( ((trp_queue_t *)t)->first ), j = 0 ; ; ) {
-                pos[ j++ ] = (uns32b)( p - T );
-                for ( CORD_set_pos( i, ((trp_cord_t *)(elem->val))->c, 0 ) ;
+            for ( j = 0 ; ; ) {
+                pos[ j ] = (uns32b)( p - T );
+                for ( CORD_set_pos( i, ((trp_cord_t *)trp_queue_nth( j, (trp_queue_t *)t ))->c, 0 ) ;
                       CORD_pos_valid( i ) ;
                       CORD_next( i ) )
                     *p++ = CORD_pos_fetch( i );
                 *p++ = 0;
-                if ( ( elem = (trp_queue_elem *)( elem->next ) ) == NULL )
+                if ( ++j == N )
                     break;
             }
             break;
@@ -721,8 +712,6 @@ static trp_obj_t *trp_suf_lcs_k_low( uns8b flags, trp_obj_t *k, trp_obj_t *s, va
         for ( ; max_idx ; max_idx-- )
             s = va_arg( args3, trp_obj_t * );
     } else {
-        trp_queue_elem *elem;
-
         switch ( s->tipo ) {
         case TRP_CONS:
             for ( ; max_idx ; max_idx-- )
@@ -730,9 +719,7 @@ static trp_obj_t *trp_suf_lcs_k_low( uns8b flags, trp_obj_t *k, trp_obj_t *s, va
             s = ((trp_cons_t *)s)->car;
             break;
         case TRP_QUEUE:
-            for ( elem = (trp_queue_elem *)( ((trp_queue_t *)s)->first ) ; max_idx ; max_idx-- )
-                elem = (trp_queue_elem *)( elem->next );
-            s = elem->val;
+            s = trp_queue_nth( max_idx, (trp_queue_t *)s );
             break;
         case TRP_ARRAY:
             s = ((trp_array_t *)s)->data[ max_idx ];
@@ -18,6 +18,7 @@
 
 #include "../trp/trp.h"
 #include "./trpthread.h"
+#include <errno.h>
 
 typedef struct {
     uns8b tipo;
@@ -38,17 +39,56 @@ typedef struct {
 #define TRP_THREAD_STATE_WAITING_ON_SEND 3
 #define TRP_THREAD_STATE_WAITING_ON_SEND_TERM_DEST 4
 
-typedef struct {
-    trp_obj_t *val;
-    void *next;
-} trp_queue_elem;
-
 typedef struct {
     trp_thread_t *mitt;
     trp_obj_t *msg;
     uns8b mitt_is_susp;
 } trp_thread_msg_t;
 
+/*
+ pool di worker per parallel-map e parallel-for: ogni worker
+ (e anche il thread chiamante) ha una deque di indici [lo,hi);
+ il proprietario consuma dal basso, chi resta senza lavoro
+ ruba la meta' alta della deque di un altro
+ */
+
+typedef struct {
+    pthread_mutex_t mutex;
+    uns32b lo;
+    uns32b hi;
+} trp_thread_deque_t;
+
+typedef struct {
+    trp_obj_t *f;
+    trp_obj_t *coll;
+    trp_obj_t **res;
+    uns8b fail;
+} trp_thread_job_t;
+
+/*
+ canale: coda circolare limitata multi-produttore multi-consumatore
+ senza lock (ogni cella ha un numero di sequenza); mutex e cond
+ servono solo per addormentare chi deve aspettare
+ */
+
+typedef struct {
+    uns64b seq;
+    trp_obj_t *obj;
+} trp_thread_chan_cell_t;
+
+typedef struct {
+    uns8b tipo;
+    uns8b closed;
+    uns32b mask;
+    uns32b swait;
+    uns32b rwait;
+    uns64b enq;
+    uns64b deq;
+    trp_thread_chan_cell_t *cell;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} trp_thread_chan_t;
+
 typedef struct {
     uns32b priority;
     uns32b retcode;
@@ -62,15 +102,50 @@ static uns32b _trp_thread_max = 1;
 static trp_obj_t *_trp_thread_q;
 static pthread_mutex_t _trp_thread_q_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_key_t _trp_thread_key;
+static pthread_key_t _trp_thread_auto_key;
+static uns32b _trp_thread_pool_size = 0;
+static trp_thread_deque_t *_trp_thread_pool_dq = NULL;
+static trp_thread_job_t *_trp_thread_pool_job = NULL;
+static trp_thread_t **_trp_thread_pool_th = NULL;
+static uns32b _trp_thread_pool_gen = 0;
+static uns32b _trp_thread_pool_active = 0;
+static pthread_mutex_t _trp_thread_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t _trp_thread_pool_imutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t _trp_thread_pool_wmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _trp_thread_pool_wcond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _trp_thread_pool_dcond = PTHREAD_COND_INITIALIZER;
+static uns32b _trp_thread_chan_selwait = 0;
+static pthread_mutex_t _trp_thread_chan_selmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _trp_thread_chan_selcond = PTHREAD_COND_INITIALIZER;
 
 static uns8b trp_thread_print( trp_print_t *p, trp_thread_t *obj );
 static trp_obj_t *trp_thread_length( trp_thread_t *obj );
 static trp_obj_t *trp_thread_env_stack();
 static trp_obj_t *trp_thread_create_internal();
+static trp_thread_t *trp_thread_alloc_internal();
 static void trp_thread_setspecific( trp_thread_t *th );
 static void *trp_thread_start_routine( void *arg );
 static void trp_thread_exit();
+static void trp_thread_auto_destructor( void *th );
 static trp_obj_t *trp_thread_case_cmp( trp_thread_alternative_t *x, trp_thread_alternative_t *y );
+static uns32b trp_thread_pool_init();
+static void *trp_thread_pool_routine( void *arg );
+static uns8b trp_thread_pool_next( uns32b id, uns32b *i );
+static void trp_thread_pool_apply( trp_thread_job_t *job, uns32b i );
+static void trp_thread_pool_work( trp_thread_job_t *job, uns32b id );
+static uns8b trp_thread_pool_run( trp_obj_t *f, trp_obj_t *coll, trp_obj_t **res );
+static uns8b trp_thread_pool_check( trp_obj_t *f, uns8b tipo, trp_obj_t *coll );
+static uns8b trp_thread_chan_print( trp_print_t *p, trp_thread_chan_t *obj );
+static trp_obj_t *trp_thread_chan_length( trp_thread_chan_t *obj );
+static uns8b trp_thread_chan_close( trp_thread_chan_t *obj );
+static uns8b trp_thread_chan_trysend( trp_thread_chan_t *ch, trp_obj_t *obj );
+static uns8b trp_thread_chan_tryreceive( trp_thread_chan_t *ch, trp_obj_t **obj );
+static void trp_thread_chan_wakeup( trp_thread_chan_t *ch, uns32b *wait );
+static uns8b trp_thread_chan_ready( trp_thread_chan_t *ch );
+static void trp_thread_chan_deadline( uns32b ms, struct timespec *ts );
+static uns8b trp_thread_chan_send_internal( trp_obj_t *ch, trp_obj_t *obj, uns8b flags, uns32b ms );
+static trp_obj_t *trp_thread_chan_receive_internal( trp_obj_t *ch, uns8b flags, uns32b ms );
+static trp_obj_t *trp_thread_chan_select_internal( trp_obj_t *chs, uns8b flags, uns32b ms );
 #ifdef TRP_FORCE_FREE
 static void trp_thread_case_free_array( trp_array_t *a );
 #else
@@ -87,15 +162,20 @@ uns8b trp_thread_init()
 {
     extern uns8bfun_t _trp_print_fun[];
     extern objfun_t _trp_length_fun[];
+    extern uns8bfun_t _trp_close_fun[];
     extern objfun_t _trp_env_stack;
 
-    if ( pthread_key_create( &_trp_thread_key, NULL ) ) {
+    if ( pthread_key_create( &_trp_thread_key, NULL ) ||
+         pthread_key_create( &_trp_thread_auto_key, trp_thread_auto_destructor ) ) {
         fprintf( stderr, "Initialization of pthread key failed\n" );
         return 1;
     }
     _trp_thread_q = trp_queue();
     _trp_print_fun[ TRP_THREAD ] = trp_thread_print;
     _trp_length_fun[ TRP_THREAD ] = trp_thread_length;
+    _trp_print_fun[ TRP_CHAN ] = trp_thread_chan_print;
+    _trp_length_fun[ TRP_CHAN ] = trp_thread_chan_length;
+    _trp_close_fun[ TRP_CHAN ] = trp_thread_chan_close;
     _trp_env_stack = trp_thread_env_stack;
     _trp_thread_main = trp_thread_create_internal();
     trp_thread_setspecific( (trp_thread_t *)_trp_thread_main );
@@ -132,6 +212,21 @@ static trp_obj_t *trp_thread_env_stack()
 }
 
 static trp_obj_t *trp_thread_create_internal()
+{
+    trp_thread_t *th = trp_thread_alloc_internal();
+
+    trp_thread_q_lock();
+    (void)trp_queue_put( _trp_thread_q, (trp_obj_t *)th );
+    trp_thread_q_unlock();
+    return (trp_obj_t *)th;
+}
+
+/*
+ i worker del pool hanno un trp_thread_t (serve per lo stack
+ degli ambienti) ma non compaiono nella coda dei thread
+ */
+
+static trp_thread_t *trp_thread_alloc_internal()
 {
     extern void trp_queue_init_internal( trp_queue_t *q );
     trp_thread_t *th;
@@ -146,10 +241,7 @@ static trp_obj_t *trp_thread_create_internal()
     trp_queue_init_internal( &( th->mitt ) );
     (void)pthread_mutex_init( &( th->mutex ), NULL );
     (void)pthread_cond_init( &( th->cond ), NULL );
-    trp_thread_q_lock();
-    (void)trp_queue_put( _trp_thread_q, (trp_obj_t *)th );
-    trp_thread_q_unlock();
-    return (trp_obj_t *)th;
+    return th;
 }
 
 static void trp_thread_setspecific( trp_thread_t *th )
@@ -301,58 +393,36 @@ static void trp_thread_exit()
      svegliarli...
      */
     {
-        trp_queue_elem *elem, *prev = NULL, *elem2, *prev2;
-        void *tmp;
+        extern void trp_queue_del_internal( trp_queue_t *q, uns32b n );
+        trp_thread_t *th;
+        uns32b i, j;
         uns8b sveglia;
 
         trp_thread_q_lock();
-        for ( elem = (trp_queue_elem *)( ((trp_queue_t *)_trp_thread_q)->first ) ;
-              elem ; ) {
-            if ( (trp_thread_t *)( elem->val ) == me ) {
-                if ( prev == NULL )
-                    ((trp_queue_t *)_trp_thread_q)->first = elem->next;
-                else
-                    prev->next = elem->next;
-                if ( elem->next == NULL )
-                    ((trp_queue_t *)_trp_thread_q)->last = prev;
-                prev = elem;
-                elem = (trp_queue_elem *)( elem->next );
-                trp_gc_free( prev );
+        for ( i = 0 ; i < ((trp_queue_t *)_trp_thread_q)->len ; ) {
+            th = (trp_thread_t *)trp_queue_nth( i, (trp_queue_t *)_trp_thread_q );
+            if ( th == me ) {
+                trp_queue_del_internal( (trp_queue_t *)_trp_thread_q, i );
             } else {
                 sveglia = 0;
-                trp_thread_private_lock( elem->val );
-                if ( ( (trp_thread_t *)( elem->val ) )->stato == TRP_THREAD_STATE_WAITING_ON_RECEIVE )
-                    if ( ( (trp_thread_t *)( elem->val ) )->msg == NULL ) {
-                        prev2 = NULL;
-                        for ( elem2 = (trp_queue_elem *)( ( (trp_thread_t *)( elem->val ) )->mitt.first ) ;
-                              elem2 ; ) {
-                            if ( (trp_thread_t *)(elem2->val) == me ) {
-                                if ( prev2 == NULL )
-                                    ( (trp_thread_t *)( elem->val ) )->mitt.first = elem2->next;
-                                else
-                                    prev2->next = elem2->next;
-                                if ( elem2->next == NULL )
-                                    ( (trp_thread_t *)( elem->val ) )->mitt.last = prev2;
-                                tmp = (void *)elem2;
-                                elem2 = (trp_queue_elem *)( elem2->next );
-                                trp_gc_free( tmp );
-                                ( (trp_thread_t *)( elem->val ) )->mitt.len--;
-                                if ( ( (trp_thread_t *)( elem->val ) )->mitt.len == 0 )
+                trp_thread_private_lock( th );
+                if ( th->stato == TRP_THREAD_STATE_WAITING_ON_RECEIVE )
+                    if ( th->msg == NULL ) {
+                        for ( j = 0 ; j < th->mitt.len ; ) {
+                            if ( (trp_thread_t *)trp_queue_nth( j, &( th->mitt ) ) == me ) {
+                                trp_queue_del_internal( &( th->mitt ), j );
+                                if ( th->mitt.len == 0 )
                                     sveglia = 1;
-                            } else {
-                                prev2 = elem2;
-                                elem2 = (trp_queue_elem *)( elem2->next );
-                            }
+                            } else
+                                j++;
                         }
                     }
-                trp_thread_private_unlock( elem->val );
+                trp_thread_private_unlock( th );
                 if ( sveglia )
-                    trp_thread_private_signal( elem->val );
-                prev = elem;
-                elem = (trp_queue_elem *)( elem->next );
+                    trp_thread_private_signal( th );
+                i++;
             }
         }
-        ((trp_queue_t *)_trp_thread_q)->len--;
         trp_thread_q_unlock();
     }
     /*
@@ -391,20 +461,14 @@ trp_obj_t *trp_thread_create( trp_obj_t *net, ... )
     }
     arg[ i ] = net = trp_thread_create_internal();
     if ( pthread_create( &th, NULL, trp_thread_start_routine, (void *)arg ) ) {
-        trp_queue_elem *elem, *prev = NULL;
+        extern void trp_queue_del_internal( trp_queue_t *q, uns32b n );
+        uns32b i;
 
         trp_thread_q_lock();
-        for ( elem = (trp_queue_elem *)( ((trp_queue_t *)_trp_thread_q)->first ) ;
-              elem->val != net ;
-              elem = (trp_queue_elem *)( elem->next ) )
-            prev = elem;
-        if ( prev == NULL )
-            ((trp_queue_t *)_trp_thread_q)->first = elem->next;
-        else
-            prev->next = elem->next;
-        if ( elem->next == NULL )
-            ((trp_queue_t *)_trp_thread_q)->last = prev;
-        ((trp_queue_t *)_trp_thread_q)->len--;
+        for ( i = 0 ;
+              trp_queue_nth( i, (trp_queue_t *)_trp_thread_q ) != net ;
+              i++ );
+        trp_queue_del_internal( (trp_queue_t *)_trp_thread_q, i );
         trp_thread_q_unlock();
         trp_gc_free( net );
         trp_gc_free( arg );
@@ -460,13 +524,11 @@ trp_obj_t *trp_thread_max()
 trp_obj_t *trp_thread_list()
 {
     trp_obj_t *res = NIL;
-    trp_queue_elem *elem;
+    uns32b i;
 
     trp_thread_q_lock();
-    for ( elem = (trp_queue_elem *)( ((trp_queue_t *)_trp_thread_q)->first ) ;
-          elem ;
-          elem = (trp_queue_elem *)( elem->next ) ) {
-        res = trp_cons( elem->val, res );
+    for ( i = 0 ; i < ((trp_queue_t *)_trp_thread_q)->len ; i++ ) {
+        res = trp_cons( trp_queue_nth( i, (trp_queue_t *)_trp_thread_q ), res );
     }
     trp_thread_q_unlock();
     return res;
@@ -493,14 +555,12 @@ uns8b trp_thread_send( uns8b flags, trp_obj_t *bmax, trp_obj_t *obj, trp_obj_t *
              finora non lo ha sbloccato nessuno;
              resta da vedere se e' in attesa di un messaggio da noi
              */
-            trp_queue_elem *elem;
+            uns32b i;
 
-            for ( elem = (trp_queue_elem *)( ((trp_thread_t *)th)->mitt.first ) ;
-                  elem ;
-                  elem = (trp_queue_elem *)( elem->next ) )
-                if ( (trp_thread_t *)( elem->val ) == me )
+            for ( i = 0 ; i < ((trp_thread_t *)th)->mitt.len ; i++ )
+                if ( (trp_thread_t *)trp_queue_nth( i, &( ((trp_thread_t *)th)->mitt ) ) == me )
                     break;
-            if ( elem ) {
+            if ( i < ((trp_thread_t *)th)->mitt.len ) {
                 /*
                  possiamo lasciare il messaggio direttamente
                  */
@@ -547,10 +607,12 @@ uns8b trp_thread_send( uns8b flags, trp_obj_t *bmax, trp_obj_t *obj, trp_obj_t *
 
 uns8b trp_thread_receive( uns8b flags, trp_obj_t **obj, trp_obj_t **mitt, trp_obj_t *th, ... )
 {
+    extern void trp_queue_del_internal( trp_queue_t *q, uns32b n );
     trp_thread_t *me;
     trp_obj_t *mittq;
-    trp_queue_elem *elem, *prev = NULL;
+    trp_thread_msg_t *msg;
     va_list args;
+    uns32b i, j;
     uns8b res;
 
     if ( mitt ) {
@@ -562,15 +624,15 @@ uns8b trp_thread_receive( uns8b flags, trp_obj_t **obj, trp_obj_t **mitt, trp_ob
         if ( th ) {
             switch ( th->tipo ) {
             case TRP_QUEUE:
-                for ( elem = (trp_queue_elem *)( ((trp_queue_t *)th)->first ) ;
-                      elem ;
-                      elem = (trp_queue_elem *)( elem->next ) ) {
-                    if ( elem->val->tipo != TRP_THREAD ) {
+                for ( i = 0 ; i < ((trp_queue_t *)th)->len ; i++ ) {
+                    trp_obj_t *o = trp_queue_nth( i, (trp_queue_t *)th );
+
+                    if ( o->tipo != TRP_THREAD ) {
                         err = 1;
                         break;
                     }
-                    if ( (trp_thread_t *)( elem->val ) != me )
-                        (void)trp_queue_put( mittq, elem->val );
+                    if ( (trp_thread_t *)o != me )
+                        (void)trp_queue_put( mittq, o );
                 }
                 break;
             case TRP_CONS:
@@ -642,42 +704,27 @@ uns8b trp_thread_receive( uns8b flags, trp_obj_t **obj, trp_obj_t **mitt, trp_ob
      dobbiamo controllare se nella nostra mailbox c'e' gia'
      un messaggio proveniente da uno dei mittenti
      */
-    {
-        trp_queue_elem *elem2;
-
-        for ( elem = (trp_queue_elem *)( me->msgq.first ) ;
-              elem ;
-              elem = (trp_queue_elem *)( elem->next ) ) {
-            th = (trp_obj_t *)( ((trp_thread_msg_t *)( elem->val ))->mitt );
-            for ( elem2 = (trp_queue_elem *)( ((trp_queue_t *)mittq)->first ) ;
-                  elem2 ;
-                  elem2 = (trp_queue_elem *)( elem2->next ) )
-                if ( elem2->val == th )
-                    break;
-            if ( elem2 )
+    for ( i = 0 ; i < me->msgq.len ; i++ ) {
+        th = (trp_obj_t *)( ((trp_thread_msg_t *)trp_queue_nth( i, &( me->msgq ) ))->mitt );
+        for ( j = 0 ; j < ((trp_queue_t *)mittq)->len ; j++ )
+            if ( trp_queue_nth( j, (trp_queue_t *)mittq ) == th )
                 break;
-            prev = elem;
-        }
+        if ( j < ((trp_queue_t *)mittq)->len )
+            break;
     }
-    if ( elem ) {
+    if ( i < me->msgq.len ) {
         /*
          possiamo consumare il messaggio e risvegliare il mittente
          */
-        *obj = ((trp_thread_msg_t *)( elem->val ))->msg;
+        msg = (trp_thread_msg_t *)trp_queue_nth( i, &( me->msgq ) );
+        *obj = msg->msg;
         if ( mitt )
             *mitt = th;
-        if ( prev == NULL )
-            me->msgq.first = elem->next;
-        else
-            prev->next = elem->next;
-        if ( elem->next == NULL )
-            me->msgq.last = prev;
-        me->msgq.len--;
+        trp_queue_del_internal( &( me->msgq ), i );
         trp_thread_private_unlock( me );
-        if ( ((trp_thread_msg_t *)( elem->val ))->mitt_is_susp )
+        if ( msg->mitt_is_susp )
             trp_thread_private_signal( th );
-        trp_gc_free( elem->val );
-        trp_gc_free( elem );
+        trp_gc_free( msg );
         while ( ((trp_queue_t *)mittq)->len )
             (void)trp_queue_get( mittq );
         trp_gc_free( mittq );
@@ -766,13 +813,14 @@ static void trp_thread_case_free_array( trp_array_t *a )
 trp_obj_t *trp_thread_case( trp_obj_t *obj, ... )
 {
     extern void trp_queue_init_internal( trp_queue_t *q );
+    extern void trp_queue_del_internal( trp_queue_t *q, uns32b n );
     extern uns8b trp_array_sort_internal( trp_array_t *a, objfun_t *cmp );
 
     trp_thread_t *me;
     trp_array_t *a;
     trp_thread_alternative_t *alt;
-    trp_queue_elem *elem, *prev;
-    uns32b n, i;
+    trp_thread_msg_t *msg;
+    uns32b n, i, j, k;
     va_list args;
     uns8b err = 0;
 
@@ -798,15 +846,15 @@ trp_obj_t *trp_thread_case( trp_obj_t *obj, ... )
                     if ( obj ) {
                         switch ( obj->tipo ) {
                         case TRP_QUEUE:
-                            for ( elem = (trp_queue_elem *)( ((trp_queue_t *)obj)->first ) ;
-                                  elem ;
-                                  elem = (trp_queue_elem *)( elem->next ) ) {
-                                if ( elem->val->tipo != TRP_THREAD ) {
+                            for ( j = 0 ; j < ((trp_queue_t *)obj)->len ; j++ ) {
+                                trp_obj_t *o = trp_queue_nth( j, (trp_queue_t *)obj );
+
+                                if ( o->tipo != TRP_THREAD ) {
                                     err = 1;
                                     break;
                                 }
-                                if ( (trp_thread_t *)( elem->val ) != me )
-                                    (void)trp_queue_put( (trp_obj_t *)( &( alt->mittq ) ), elem->val );
+                                if ( (trp_thread_t *)o != me )
+                                    (void)trp_queue_put( (trp_obj_t *)( &( alt->mittq ) ), o );
                             }
                             break;
                         case TRP_CONS:
@@ -909,59 +957,44 @@ trp_obj_t *trp_thread_case( trp_obj_t *obj, ... )
      inizia la sezione critica
      */
     trp_thread_private_lock( me );
-    {
-        trp_queue_elem *elem2;
-
-        for ( n = 0 ; n < a->len ; n++ ) {
-            alt = (trp_thread_alternative_t *)( a->data[ n ] );
-            if ( alt->obj == NULL ) {
-                trp_thread_private_unlock( me );
-                obj = trp_sig64( alt->retcode );
-                trp_thread_case_free_array( a );
-                return obj;
-            }
-            for ( prev = NULL, elem = (trp_queue_elem *)( me->msgq.first ) ;
-                  elem ;
-                  elem = (trp_queue_elem *)( elem->next ) ) {
-                obj = (trp_obj_t *)( ((trp_thread_msg_t *)( elem->val ))->mitt );
-                for ( elem2 = (trp_queue_elem *)( alt->mittq.first ) ;
-                      elem2 ;
-                      elem2 = (trp_queue_elem *)( elem2->next ) )
-                    if ( elem2->val == obj )
-                        break;
-                if ( elem2 )
+    for ( n = 0 ; n < a->len ; n++ ) {
+        alt = (trp_thread_alternative_t *)( a->data[ n ] );
+        if ( alt->obj == NULL ) {
+            trp_thread_private_unlock( me );
+            obj = trp_sig64( alt->retcode );
+            trp_thread_case_free_array( a );
+            return obj;
+        }
+        for ( j = 0 ; j < me->msgq.len ; j++ ) {
+            obj = (trp_obj_t *)( ((trp_thread_msg_t *)trp_queue_nth( j, &( me->msgq ) ))->mitt );
+            for ( k = 0 ; k < alt->mittq.len ; k++ )
+                if ( trp_queue_nth( k, &( alt->mittq ) ) == obj )
                     break;
-                prev = elem;
-            }
-            if ( elem ) {
-                *( alt->obj ) = ((trp_thread_msg_t *)( elem->val ))->msg;
-                if ( alt->mitt )
-                    *( alt->mitt ) = obj;
-                if ( prev == NULL )
-                    me->msgq.first = elem->next;
-                else
-                    prev->next = elem->next;
-                if ( elem->next == NULL )
-                    me->msgq.last = prev;
-                me->msgq.len--;
-                trp_thread_private_unlock( me );
-                if ( ((trp_thread_msg_t *)( elem->val ))->mitt_is_susp )
-                    trp_thread_private_signal( obj );
-                trp_gc_free( elem->val );
-                trp_gc_free( elem );
-                obj = trp_sig64( alt->retcode );
-                trp_thread_case_free_array( a );
-                return obj;
-            }
+            if ( k < alt->mittq.len )
+                break;
+        }
+        if ( j < me->msgq.len ) {
+            msg = (trp_thread_msg_t *)trp_queue_nth( j, &( me->msgq ) );
+            *( alt->obj ) = msg->msg;
+            if ( alt->mitt )
+                *( alt->mitt ) = obj;
+            trp_queue_del_internal( &( me->msgq ), j );
+            trp_thread_private_unlock( me );
+            if ( msg->mitt_is_susp )
+                trp_thread_private_signal( obj );
+            trp_gc_free( msg );
+            obj = trp_sig64( alt->retcode );
+            trp_thread_case_free_array( a );
+            return obj;
         }
     }
     for ( n = 0 ; n < a->len ; n++ ) {
         alt = (trp_thread_alternative_t *)( a->data[ n ] );
-        for ( elem = (trp_queue_elem *)( alt->mittq.first ) ;
-              elem ;
-              elem = (trp_queue_elem *)( elem->next ) )
-            if ( ((trp_thread_t *)( elem->val ))->stato != TRP_THREAD_STATE_STOPPED )
-                (void)trp_queue_put( (trp_obj_t *)( &(me->mitt) ), elem->val );
+        for ( j = 0 ; j < alt->mittq.len ; j++ ) {
+            obj = trp_queue_nth( j, &( alt->mittq ) );
+            if ( ((trp_thread_t *)obj)->stato != TRP_THREAD_STATE_STOPPED )
+                (void)trp_queue_put( (trp_obj_t *)( &(me->mitt) ), obj );
+        }
     }
     if ( me->mitt.len == 0 ) {
         trp_thread_private_unlock( me );
@@ -980,12 +1013,10 @@ trp_obj_t *trp_thread_case( trp_obj_t *obj, ... )
     }
     for ( n = 0 ; ; n++ ) {
         alt = (trp_thread_alternative_t *)( a->data[ n ] );
-        for ( elem = (trp_queue_elem *)( alt->mittq.first ) ;
-              elem ;
-              elem = (trp_queue_elem *)( elem->next ) )
-            if ( elem->val == me->msg_mitt )
+        for ( j = 0 ; j < alt->mittq.len ; j++ )
+            if ( trp_queue_nth( j, &( alt->mittq ) ) == me->msg_mitt )
                 break;
-        if ( elem )
+        if ( j < alt->mittq.len )
             break;
     }
     *( alt->obj ) = me->msg;
@@ -1000,6 +1031,647 @@ trp_obj_t *trp_thread_case( trp_obj_t *obj, ... )
     return obj;
 }
 
+static uns32b trp_thread_pool_init()
+{
+    trp_obj_t **arg;
+    pthread_t th;
+    uns32b n, i;
+
+    (void)pthread_mutex_lock( &_trp_thread_pool_imutex );
+    if ( _trp_thread_pool_dq ) {
+        (void)pthread_mutex_unlock( &_trp_thread_pool_imutex );
+        return _trp_thread_pool_size;
+    }
+    n = trp_ncpus();
+    /*
+     l'ultima deque e' quella del thread chiamante
+     */
+    _trp_thread_pool_dq = malloc( n * sizeof( trp_thread_deque_t ) );
+    if ( _trp_thread_pool_dq == NULL ) {
+        (void)pthread_mutex_unlock( &_trp_thread_pool_imutex );
+        return 0;
+    }
+    for ( i = 0 ; i < n ; i++ ) {
+        (void)pthread_mutex_init( &( _trp_thread_pool_dq[ i ].mutex ), NULL );
+        _trp_thread_pool_dq[ i ].lo = _trp_thread_pool_dq[ i ].hi = 0;
+    }
+    /*
+     i descrittori dei worker sono raggiungibili solo via TSD,
+     che il GC non esamina: li teniamo qui
+     */
+    _trp_thread_pool_th = (trp_thread_t **)trp_gc_malloc( n * sizeof( trp_thread_t * ) );
+    for ( i = 0 ; i + 1 < n ; i++ ) {
+        /*
+         qui non si puo' usare trp_gc_malloc_atomic...
+         */
+        arg = (trp_obj_t **)trp_gc_malloc( 3 * sizeof( trp_obj_t * ) );
+        arg[ 0 ] = trp_sig64( i );
+        arg[ 1 ] = trp_sig64( _trp_thread_pool_gen );
+        arg[ 2 ] = (trp_obj_t *)trp_thread_alloc_internal();
+        _trp_thread_pool_th[ i ] = (trp_thread_t *)( arg[ 2 ] );
+        if ( pthread_create( &th, NULL, trp_thread_pool_routine, (void *)arg ) ) {
+            trp_gc_free( arg );
+            break;
+        }
+        (void)pthread_detach( th );
+    }
+    _trp_thread_pool_size = i;
+    (void)pthread_mutex_unlock( &_trp_thread_pool_imutex );
+    return i;
+}
+
+static void *trp_thread_pool_routine( void *arg )
+{
+    trp_thread_job_t *job;
+    uns32b id, gen;
+
+    /*
+     gen e' quella al momento della creazione: il primo lavoro
+     potrebbe essere gia' stato lanciato prima che partissimo
+     */
+    id = (uns32b)( ((trp_sig64_t *)( ((trp_obj_t **)arg)[ 0 ] ))->val );
+    gen = (uns32b)( ((trp_sig64_t *)( ((trp_obj_t **)arg)[ 1 ] ))->val );
+    trp_thread_setspecific( (trp_thread_t *)( ((trp_obj_t **)arg)[ 2 ] ) );
+    trp_gc_free( arg );
+    (void)pthread_mutex_lock( &_trp_thread_pool_wmutex );
+    for ( ; ; gen = _trp_thread_pool_gen ) {
+        while ( gen == _trp_thread_pool_gen )
+            (void)pthread_cond_wait( &_trp_thread_pool_wcond, &_trp_thread_pool_wmutex );
+        job = _trp_thread_pool_job;
+        (void)pthread_mutex_unlock( &_trp_thread_pool_wmutex );
+        trp_thread_pool_work( job, id );
+        (void)pthread_mutex_lock( &_trp_thread_pool_wmutex );
+        if ( --_trp_thread_pool_active == 0 )
+            (void)pthread_cond_signal( &_trp_thread_pool_dcond );
+    }
+    return NULL;
+}
+
+static uns8b trp_thread_pool_next( uns32b id, uns32b *i )
+{
+    trp_thread_deque_t *dq = _trp_thread_pool_dq + id, *v;
+    uns32b n = _trp_thread_pool_size + 1, k, lo, hi;
+
+    (void)pthread_mutex_lock( &( dq->mutex ) );
+    if ( dq->lo < dq->hi ) {
+        *i = dq->lo++;
+        (void)pthread_mutex_unlock( &( dq->mutex ) );
+        return 0;
+    }
+    (void)pthread_mutex_unlock( &( dq->mutex ) );
+    for ( k = 1 ; k < n ; k++ ) {
+        v = _trp_thread_pool_dq + ( id + k ) % n;
+        (void)pthread_mutex_lock( &( v->mutex ) );
+        if ( v->lo < v->hi ) {
+            hi = v->hi;
+            lo = v->lo + ( v->hi - v->lo ) / 2;
+            v->hi = lo;
+            (void)pthread_mutex_unlock( &( v->mutex ) );
+            (void)pthread_mutex_lock( &( dq->mutex ) );
+            dq->lo = lo + 1;
+            dq->hi = hi;
+            (void)pthread_mutex_unlock( &( dq->mutex ) );
+            *i = lo;
+            return 0;
+        }
+        (void)pthread_mutex_unlock( &( v->mutex ) );
+    }
+    return 1;
+}
+
+static void trp_thread_pool_apply( trp_thread_job_t *job, uns32b i )
+{
+    trp_obj_t *obj;
+
+    switch ( job->coll->tipo ) {
+    case TRP_ARRAY:
+        obj = ((trp_array_t *)( job->coll ))->data[ i ];
+        break;
+    case TRP_QUEUE:
+        obj = trp_queue_nth( i, (trp_queue_t *)( job->coll ) );
+        break;
+    default:
+        obj = trp_sig64( i );
+        break;
+    }
+    if ( job->res )
+        job->res[ i ] = (((trp_funptr_t *)( job->f ))->f)( obj );
+    else if ( (((trp_netptr_t *)( job->f ))->f)( obj ) )
+        job->fail = 1;
+}
+
+static void trp_thread_pool_work( trp_thread_job_t *job, uns32b id )
+{
+    uns32b i;
+
+    while ( trp_thread_pool_next( id, &i ) == 0 )
+        trp_thread_pool_apply( job, i );
+}
+
+/*
+ se il pool e' gia' occupato (chiamate annidate o concorrenti)
+ il lavoro viene fatto tutto dal thread chiamante
+ */
+
+static uns8b trp_thread_pool_run( trp_obj_t *f, trp_obj_t *coll, trp_obj_t **res )
+{
+    trp_thread_job_t job;
+    uns32b n, w, k;
+
+    switch ( coll->tipo ) {
+    case TRP_ARRAY:
+        n = ((trp_array_t *)coll)->len;
+        break;
+    case TRP_QUEUE:
+        n = ((trp_queue_t *)coll)->len;
+        break;
+    default:
+        n = (uns32b)( ((trp_sig64_t *)coll)->val );
+        break;
+    }
+    job.f = f;
+    job.coll = coll;
+    job.res = res;
+    job.fail = 0;
+    if ( pthread_mutex_trylock( &_trp_thread_pool_mutex ) == 0 ) {
+        w = trp_thread_pool_init() + 1;
+        if ( _trp_thread_pool_dq == NULL )
+            (void)pthread_mutex_unlock( &_trp_thread_pool_mutex );
+    } else
+        w = 0;
+    if ( ( w == 0 ) || ( _trp_thread_pool_dq == NULL ) ) {
+        for ( k = 0 ; k < n ; k++ )
+            trp_thread_pool_apply( &job, k );
+        return job.fail;
+    }
+    for ( k = 0 ; k < w ; k++ ) {
+        (void)pthread_mutex_lock( &( _trp_thread_pool_dq[ k ].mutex ) );
+        _trp_thread_pool_dq[ k ].lo = (uns32b)( ( (uns64b)n * k ) / w );
+        _trp_thread_pool_dq[ k ].hi = (uns32b)( ( (uns64b)n * ( k + 1 ) ) / w );
+        (void)pthread_mutex_unlock( &( _trp_thread_pool_dq[ k ].mutex ) );
+    }
+    if ( w > 1 ) {
+        (void)pthread_mutex_lock( &_trp_thread_pool_wmutex );
+        _trp_thread_pool_job = &job;
+        _trp_thread_pool_active = w - 1;
+        _trp_thread_pool_gen++;
+        (void)pthread_cond_broadcast( &_trp_thread_pool_wcond );
+        (void)pthread_mutex_unlock( &_trp_thread_pool_wmutex );
+    }
+    trp_thread_pool_work( &job, w - 1 );
+    if ( w > 1 ) {
+        (void)pthread_mutex_lock( &_trp_thread_pool_wmutex );
+        while ( _trp_thread_pool_active )
+            (void)pthread_cond_wait( &_trp_thread_pool_dcond, &_trp_thread_pool_wmutex );
+        _trp_thread_pool_job = NULL;
+        (void)pthread_mutex_unlock( &_trp_thread_pool_wmutex );
+    }
+    (void)pthread_mutex_unlock( &_trp_thread_pool_mutex );
+    return job.fail;
+}
+
+static uns8b trp_thread_pool_check( trp_obj_t *f, uns8b tipo, trp_obj_t *coll )
+{
+    if ( ( f->tipo != tipo ) ||
+         ( ( ( tipo == TRP_FUNPTR ) ? ((trp_funptr_t *)f)->nargs : ((trp_netptr_t *)f)->nargs ) != 1 ) )
+        return 1;
+    switch ( coll->tipo ) {
+    case TRP_ARRAY:
+    case TRP_QUEUE:
+        break;
+    case TRP_SIG64:
+        if ( ( ((trp_sig64_t *)coll)->val < 0 ) ||
+             ( ((trp_sig64_t *)coll)->val > 0xffffffff ) )
+            return 1;
+        break;
+    default:
+        return 1;
+    }
+    return 0;
+}
+
+trp_obj_t *trp_thread_pool_size()
+{
+    return trp_sig64( trp_thread_pool_init() + 1 );
+}
+
+/*
+ f e' un funptr con un argomento, coll un array, una coda
+ o un intero n (l'intervallo 0..n-1); il risultato e' un array
+ con f applicata ad ogni elemento, nello stesso ordine
+ */
+
+trp_obj_t *trp_thread_parallel_map( trp_obj_t *f, trp_obj_t *coll )
+{
+    trp_obj_t *res;
+
+    if ( trp_thread_pool_check( f, TRP_FUNPTR, coll ) )
+        return UNDEF;
+    res = trp_array_ext_internal( UNDEF, 1, ( coll->tipo == TRP_SIG64 )
+                                  ? (uns32b)( ((trp_sig64_t *)coll)->val )
+                                  : ( ( coll->tipo == TRP_ARRAY )
+                                      ? ((trp_array_t *)coll)->len
+                                      : ((trp_queue_t *)coll)->len ) );
+    if ( ((trp_array_t *)res)->len )
+        (void)trp_thread_pool_run( f, coll, ((trp_array_t *)res)->data );
+    return res;
+}
+
+/*
+ come parallel-map, ma con una net; fallisce se fallisce
+ almeno una delle chiamate (le altre vengono comunque eseguite)
+ */
+
+uns8b trp_thread_parallel_for( trp_obj_t *net, trp_obj_t *coll )
+{
+    if ( trp_thread_pool_check( net, TRP_NETPTR, coll ) )
+        return 1;
+    return trp_thread_pool_run( net, coll, NULL );
+}
+
+static uns8b trp_thread_chan_print( trp_print_t *p, trp_thread_chan_t *obj )
+{
+    if ( trp_print_char_star( p, "#chan" ) )
+        return 1;
+    if ( obj->closed )
+        if ( trp_print_char_star( p, " (closed)" ) )
+            return 1;
+    return trp_print_char( p, '#' );
+}
+
+static trp_obj_t *trp_thread_chan_length( trp_thread_chan_t *obj )
+{
+    uns64b enq, deq;
+
+    deq = __atomic_load_n( &( obj->deq ), __ATOMIC_SEQ_CST );
+    enq = __atomic_load_n( &( obj->enq ), __ATOMIC_SEQ_CST );
+    return trp_sig64( ( enq > deq ) ? (sig64b)( enq - deq ) : 0 );
+}
+
+/*
+ dopo la chiusura le send falliscono, le receive
+ consumano quello che resta e poi falliscono
+ */
+
+static uns8b trp_thread_chan_close( trp_thread_chan_t *obj )
+{
+    (void)pthread_mutex_lock( &( obj->mutex ) );
+    __atomic_store_n( &( obj->closed ), 1, __ATOMIC_SEQ_CST );
+    (void)pthread_cond_broadcast( &( obj->cond ) );
+    (void)pthread_mutex_unlock( &( obj->mutex ) );
+    (void)pthread_mutex_lock( &_trp_thread_chan_selmutex );
+    (void)pthread_cond_broadcast( &_trp_thread_chan_selcond );
+    (void)pthread_mutex_unlock( &_trp_thread_chan_selmutex );
+    return 0;
+}
+
+trp_obj_t *trp_thread_chan( trp_obj_t *size )
+{
+    trp_thread_chan_t *ch;
+    uns32b n, i;
+
+    if ( trp_cast_uns32b( size, &n ) )
+        return UNDEF;
+    if ( ( n == 0 ) || ( n > 0x40000000 ) )
+        return UNDEF;
+    for ( i = 1 ; i < n ; i <<= 1 );
+    ch = trp_gc_malloc( sizeof( trp_thread_chan_t ) );
+    ch->tipo = TRP_CHAN;
+    ch->closed = 0;
+    ch->mask = i - 1;
+    ch->swait = 0;
+    ch->rwait = 0;
+    ch->enq = 0;
+    ch->deq = 0;
+    ch->cell = trp_gc_malloc( i * sizeof( trp_thread_chan_cell_t ) );
+    for ( n = 0 ; n < i ; n++ ) {
+        ch->cell[ n ].seq = n;
+        ch->cell[ n ].obj = NULL;
+    }
+    (void)pthread_mutex_init( &( ch->mutex ), NULL );
+    (void)pthread_cond_init( &( ch->cond ), NULL );
+    return (trp_obj_t *)ch;
+}
+
+static uns8b trp_thread_chan_trysend( trp_thread_chan_t *ch, trp_obj_t *obj )
+{
+    trp_thread_chan_cell_t *c;
+    uns64b pos, seq;
+    sig64b d;
+
+    pos = __atomic_load_n( &( ch->enq ), __ATOMIC_RELAXED );
+    for ( ; ; ) {
+        c = ch->cell + ( pos & ch->mask );
+        seq = __atomic_load_n( &( c->seq ), __ATOMIC_ACQUIRE );
+        d = (sig64b)( seq - pos );
+        if ( d == 0 ) {
+            if ( __atomic_compare_exchange_n( &( ch->enq ), &pos, pos + 1, 1,
+                                              __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) )
+                break;
+        } else if ( d < 0 ) {
+            return 1;
+        } else {
+            pos = __atomic_load_n( &( ch->enq ), __ATOMIC_RELAXED );
+        }
+    }
+    c->obj = obj;
+    __atomic_store_n( &( c->seq ), pos + 1, __ATOMIC_SEQ_CST );
+    return 0;
+}
+
+static uns8b trp_thread_chan_tryreceive( trp_thread_chan_t *ch, trp_obj_t **obj )
+{
+    trp_thread_chan_cell_t *c;
+    uns64b pos, seq;
+    sig64b d;
+
+    pos = __atomic_load_n( &( ch->deq ), __ATOMIC_RELAXED );
+    for ( ; ; ) {
+        c = ch->cell + ( pos & ch->mask );
+        seq = __atomic_load_n( &( c->seq ), __ATOMIC_ACQUIRE );
+        d = (sig64b)( seq - ( pos + 1 ) );
+        if ( d == 0 ) {
+            if ( __atomic_compare_exchange_n( &( ch->deq ), &pos, pos + 1, 1,
+                                              __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) )
+                break;
+        } else if ( d < 0 ) {
+            return 1;
+        } else {
+            pos = __atomic_load_n( &( ch->deq ), __ATOMIC_RELAXED );
+        }
+    }
+    *obj = c->obj;
+    c->obj = NULL;
+    __atomic_store_n( &( c->seq ), pos + ch->mask + 1, __ATOMIC_SEQ_CST );
+    return 0;
+}
+
+/*
+ 1 se la cella in testa e' pubblicata
+ */
+
+static uns8b trp_thread_chan_ready( trp_thread_chan_t *ch )
+{
+    uns64b pos = __atomic_load_n( &( ch->deq ), __ATOMIC_SEQ_CST );
+
+    return ( __atomic_load_n( &( ch->cell[ pos & ch->mask ].seq ), __ATOMIC_SEQ_CST ) == pos + 1 ) ? 1 : 0;
+}
+
+/*
+ il mutex si prende solo se qualcuno sta aspettando:
+ chi aspetta incrementa il contatore prima di ricontrollare
+ la coda, quindi la sveglia non puo' andare persa
+ */
+
+static void trp_thread_chan_wakeup( trp_thread_chan_t *ch, uns32b *wait )
+{
+    if ( __atomic_load_n( wait, __ATOMIC_SEQ_CST ) ) {
+        (void)pthread_mutex_lock( &( ch->mutex ) );
+        (void)pthread_cond_broadcast( &( ch->cond ) );
+        (void)pthread_mutex_unlock( &( ch->mutex ) );
+    }
+    if ( ( wait == &( ch->rwait ) ) &&
+         __atomic_load_n( &_trp_thread_chan_selwait, __ATOMIC_SEQ_CST ) ) {
+        (void)pthread_mutex_lock( &_trp_thread_chan_selmutex );
+        (void)pthread_cond_broadcast( &_trp_thread_chan_selcond );
+        (void)pthread_mutex_unlock( &_trp_thread_chan_selmutex );
+    }
+}
+
+static void trp_thread_chan_deadline( uns32b ms, struct timespec *ts )
+{
+    struct timeval tv;
+
+    (void)gettimeofday( &tv, NULL );
+    ts->tv_sec = tv.tv_sec + ms / 1000;
+    ts->tv_nsec = tv.tv_usec * 1000 + ( ms % 1000 ) * 1000000;
+    if ( ts->tv_nsec >= 1000000000 ) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/*
+ flags: 1 non bloccante, 2 con timeout di ms millisecondi
+ */
+
+static uns8b trp_thread_chan_send_internal( trp_obj_t *ch, trp_obj_t *obj, uns8b flags, uns32b ms )
+{
+    trp_thread_chan_t *c = (trp_thread_chan_t *)ch;
+    struct timespec ts;
+    uns8b res = 0;
+
+    if ( ch->tipo != TRP_CHAN )
+        return 1;
+    if ( __atomic_load_n( &( c->closed ), __ATOMIC_SEQ_CST ) )
+        return 1;
+    if ( trp_thread_chan_trysend( c, obj ) == 0 ) {
+        trp_thread_chan_wakeup( c, &( c->rwait ) );
+        return 0;
+    }
+    if ( flags & 1 )
+        return 1;
+    if ( flags & 2 )
+        trp_thread_chan_deadline( ms, &ts );
+    __atomic_add_fetch( &( c->swait ), 1, __ATOMIC_SEQ_CST );
+    (void)pthread_mutex_lock( &( c->mutex ) );
+    for ( ; ; ) {
+        if ( c->closed ) {
+            res = 1;
+            break;
+        }
+        if ( trp_thread_chan_trysend( c, obj ) == 0 )
+            break;
+        if ( flags & 2 ) {
+            if ( pthread_cond_timedwait( &( c->cond ), &( c->mutex ), &ts ) == ETIMEDOUT ) {
+                if ( trp_thread_chan_trysend( c, obj ) )
+                    res = 1;
+                break;
+            }
+        } else
+            (void)pthread_cond_wait( &( c->cond ), &( c->mutex ) );
+    }
+    (void)pthread_mutex_unlock( &( c->mutex ) );
+    __atomic_sub_fetch( &( c->swait ), 1, __ATOMIC_SEQ_CST );
+    if ( res == 0 )
+        trp_thread_chan_wakeup( c, &( c->rwait ) );
+    return res;
+}
+
+static trp_obj_t *trp_thread_chan_receive_internal( trp_obj_t *ch, uns8b flags, uns32b ms )
+{
+    trp_thread_chan_t *c = (trp_thread_chan_t *)ch;
+    trp_obj_t *obj = UNDEF;
+    struct timespec ts;
+
+    if ( ch->tipo != TRP_CHAN )
+        return UNDEF;
+    if ( trp_thread_chan_tryreceive( c, &obj ) == 0 ) {
+        trp_thread_chan_wakeup( c, &( c->swait ) );
+        return obj;
+    }
+    if ( flags & 1 )
+        return UNDEF;
+    if ( flags & 2 )
+        trp_thread_chan_deadline( ms, &ts );
+    __atomic_add_fetch( &( c->rwait ), 1, __ATOMIC_SEQ_CST );
+    (void)pthread_mutex_lock( &( c->mutex ) );
+    for ( ; ; ) {
+        if ( trp_thread_chan_tryreceive( c, &obj ) == 0 )
+            break;
+        if ( c->closed ) {
+            obj = NULL;
+            break;
+        }
+        if ( flags & 2 ) {
+            if ( pthread_cond_timedwait( &( c->cond ), &( c->mutex ), &ts ) == ETIMEDOUT ) {
+                if ( trp_thread_chan_tryreceive( c, &obj ) )
+                    obj = NULL;
+                break;
+            }
+        } else
+            (void)pthread_cond_wait( &( c->cond ), &( c->mutex ) );
+    }
+    (void)pthread_mutex_unlock( &( c->mutex ) );
+    __atomic_sub_fetch( &( c->rwait ), 1, __ATOMIC_SEQ_CST );
+    if ( obj == NULL )
+        return UNDEF;
+    trp_thread_chan_wakeup( c, &( c->swait ) );
+    return obj;
+}
+
+/*
+ chs e' una lista o un array di canali; il risultato e' la coppia
+ (indice del canale . messaggio), UNDEF se tutti i canali sono
+ chiusi e vuoti o se scade il timeout
+ */
+
+static trp_obj_t *trp_thread_chan_select_internal( trp_obj_t *chs, uns8b flags, uns32b ms )
+{
+    trp_obj_t *a, *obj;
+    trp_thread_chan_t *c;
+    struct timespec ts;
+    uns32b n, i, closed;
+
+    switch ( chs->tipo ) {
+    case TRP_ARRAY:
+        a = chs;
+        break;
+    case TRP_CONS:
+        a = trp_array_ext_internal( NULL, 10, 0 );
+        for ( ; chs->tipo == TRP_CONS ; chs = ((trp_cons_t *)chs)->cdr )
+            (void)trp_array_insert( a, NULL, ((trp_cons_t *)chs)->car, NULL );
+        break;
+    default:
+        return UNDEF;
+    }
+    n = ((trp_array_t *)a)->len;
+    if ( n == 0 )
+        return UNDEF;
+    for ( i = 0 ; i < n ; i++ )
+        if ( ((trp_array_t *)a)->data[ i ]->tipo != TRP_CHAN )
+            return UNDEF;
+    if ( flags & 2 )
+        trp_thread_chan_deadline( ms, &ts );
+    __atomic_add_fetch( &_trp_thread_chan_selwait, 1, __ATOMIC_SEQ_CST );
+    for ( obj = NULL ; ; ) {
+        for ( i = 0, closed = 0 ; i < n ; i++ ) {
+            c = (trp_thread_chan_t *)( ((trp_array_t *)a)->data[ i ] );
+            if ( trp_thread_chan_tryreceive( c, &obj ) == 0 )
+                break;
+            if ( __atomic_load_n( &( c->closed ), __ATOMIC_SEQ_CST ) )
+                closed++;
+        }
+        if ( ( i < n ) || ( closed == n ) || ( flags & 1 ) )
+            break;
+        (void)pthread_mutex_lock( &_trp_thread_chan_selmutex );
+        /*
+         ricontrolliamo sotto mutex per non perdere la sveglia;
+         una cella prenotata ma non ancora pubblicata non conta:
+         chi la pubblica (o chiude un canale) fa broadcast su selcond,
+         e i canali chiusi fanno uscire solo se lo sono tutti
+         */
+        for ( i = 0, closed = 0 ; i < n ; i++ ) {
+            c = (trp_thread_chan_t *)( ((trp_array_t *)a)->data[ i ] );
+            if ( trp_thread_chan_ready( c ) )
+                break;
+            if ( __atomic_load_n( &( c->closed ), __ATOMIC_SEQ_CST ) )
+                closed++;
+        }
+        if ( ( i == n ) && ( closed < n ) ) {
+            if ( flags & 2 ) {
+                if ( pthread_cond_timedwait( &_trp_thread_chan_selcond,
+                                             &_trp_thread_chan_selmutex, &ts ) == ETIMEDOUT )
+                    flags |= 1;
+            } else
+                (void)pthread_cond_wait( &_trp_thread_chan_selcond, &_trp_thread_chan_selmutex );
+        }
+        (void)pthread_mutex_unlock( &_trp_thread_chan_selmutex );
+    }
+    __atomic_sub_fetch( &_trp_thread_chan_selwait, 1, __ATOMIC_SEQ_CST );
+    if ( i >= n )
+        return UNDEF;
+    trp_thread_chan_wakeup( c, &( c->swait ) );
+    return trp_cons( trp_sig64( i ), obj );
+}
+
+uns8b trp_thread_chan_send( trp_obj_t *ch, trp_obj_t *obj )
+{
+    return trp_thread_chan_send_internal( ch, obj, 0, 0 );
+}
+
+uns8b trp_thread_chan_sendnb( trp_obj_t *ch, trp_obj_t *obj )
+{
+    return trp_thread_chan_send_internal( ch, obj, 1, 0 );
+}
+
+uns8b trp_thread_chan_send_timed( trp_obj_t *ch, trp_obj_t *obj, trp_obj_t *ms )
+{
+    uns32b m;
+
+    if ( trp_cast_uns32b( ms, &m ) )
+        return 1;
+    return trp_thread_chan_send_internal( ch, obj, 2, m );
+}
+
+trp_obj_t *trp_thread_chan_receive( trp_obj_t *ch )
+{
+    return trp_thread_chan_receive_internal( ch, 0, 0 );
+}
+
+trp_obj_t *trp_thread_chan_receivenb( trp_obj_t *ch )
+{
+    return trp_thread_chan_receive_internal( ch, 1, 0 );
+}
+
+trp_obj_t *trp_thread_chan_receive_timed( trp_obj_t *ch, trp_obj_t *ms )
+{
+    uns32b m;
+
+    if ( trp_cast_uns32b( ms, &m ) )
+        return UNDEF;
+    return trp_thread_chan_receive_internal( ch, 2, m );
+}
+
+trp_obj_t *trp_thread_chan_select( trp_obj_t *chs )
+{
+    return trp_thread_chan_select_internal( chs, 0, 0 );
+}
+
+trp_obj_t *trp_thread_chan_selectnb( trp_obj_t *chs )
+{
+    return trp_thread_chan_select_internal( chs, 1, 0 );
+}
+
+trp_obj_t *trp_thread_chan_select_timed( trp_obj_t *chs, trp_obj_t *ms )
+{
+    uns32b m;
+
+    if ( trp_cast_uns32b( ms, &m ) )
+        return UNDEF;
+    return trp_thread_chan_select_internal( chs, 2, m );
+}
+
 uns8b trp_thread_register_my_thread()
 {
     if ( !GC_thread_is_registered() ) {
@@ -1021,3 +1693,28 @@ void trp_thread_unregister_my_thread()
     }
 }
 
+/*
+ per i thread creati da librerie esterne (ad es. i worker di
+ libmicrohttpd) di cui non si controlla la terminazione:
+ la deregistrazione avviene nel distruttore di una chiave
+ */
+
+uns8b trp_thread_register_my_thread_auto()
+{
+    if ( !GC_thread_is_registered() ) {
+        if ( trp_thread_register_my_thread() )
+            return 1;
+        (void)pthread_setspecific( _trp_thread_auto_key, (void *)trp_thread_self() );
+    }
+    return 0;
+}
+
+static void trp_thread_auto_destructor( void *th )
+{
+    /*
+     la chiave del thread potrebbe essere gia' stata azzerata
+     */
+    (void)pthread_setspecific( _trp_thread_key, th );
+    trp_thread_unregister_my_thread();
+}
+
@@ -31,7 +31,21 @@ trp_obj_t *trp_thread_list();
 uns8b trp_thread_send( uns8b flags, trp_obj_t *bmax, trp_obj_t *obj, trp_obj_t *th );
 uns8b trp_thread_receive( uns8b flags, trp_obj_t **obj, trp_obj_t **mitt, trp_obj_t *th, ... );
 trp_obj_t *trp_thread_case( trp_obj_t *obj, ... );
+trp_obj_t *trp_thread_pool_size();
+trp_obj_t *trp_thread_parallel_map( trp_obj_t *f, trp_obj_t *coll );
+uns8b trp_thread_parallel_for( trp_obj_t *net, trp_obj_t *coll );
+trp_obj_t *trp_thread_chan( trp_obj_t *size );
+uns8b trp_thread_chan_send( trp_obj_t *ch, trp_obj_t *obj );
+uns8b trp_thread_chan_sendnb( trp_obj_t *ch, trp_obj_t *obj );
+uns8b trp_thread_chan_send_timed( trp_obj_t *ch, trp_obj_t *obj, trp_obj_t *ms );
+trp_obj_t *trp_thread_chan_receive( trp_obj_t *ch );
+trp_obj_t *trp_thread_chan_receivenb( trp_obj_t *ch );
+trp_obj_t *trp_thread_chan_receive_timed( trp_obj_t *ch, trp_obj_t *ms );
+trp_obj_t *trp_thread_chan_select( trp_obj_t *chs );
+trp_obj_t *trp_thread_chan_selectnb( trp_obj_t *chs );
+trp_obj_t *trp_thread_chan_select_timed( trp_obj_t *chs, trp_obj_t *ms );
 uns8b trp_thread_register_my_thread();
 void trp_thread_unregister_my_thread();
+uns8b trp_thread_register_my_thread_auto();
 
 #endif /* !__trpthread__h */